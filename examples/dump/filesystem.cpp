@@ -11,6 +11,7 @@
 
 #include <hadesmem/detail/filesystem.hpp>
 #include <hadesmem/error.hpp>
+#include <hadesmem/memory_source.hpp>
 #include <hadesmem/pelib/nt_headers.hpp>
 #include <hadesmem/pelib/pe_file.hpp>
 #include <hadesmem/process.hpp>
@@ -46,7 +47,10 @@ void DumpFile(std::wstring const& path)
 
     hadesmem::Process const process(GetCurrentProcessId());
 
-    hadesmem::PeFile const pe_file(process,
+    // The file is parsed straight out of the buffer rather than through
+    // ReadProcessMemory.
+    hadesmem::MemorySource const source(process, buf.data(), buf.size());
+    hadesmem::PeFile const pe_file(source,
                                    buf.data(),
                                    hadesmem::PeFileType::Data,
                                    static_cast<DWORD>(buf.size()));
@@ -0,0 +1,485 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <tclap/CmdLine.h>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/detail/parallel_for.hpp>
+#include <hadesmem/detail/pattern_data.hpp>
+#include <hadesmem/detail/pattern_multi_search.hpp>
+#include <hadesmem/detail/pattern_parallel_search.hpp>
+#include <hadesmem/detail/pattern_search.hpp>
+
+// Benchmarks the pattern scanning cores against module images captured to
+// disk (e.g. with the dump example) or synthetic data. Only the portable
+// headers are used so that this also builds and runs on non-Windows platforms,
+// e.g.:
+//
+//   g++ -std=c++14 -O2 -pthread -Iinclude/memory -Ideps/tclap/tclap/include
+//     examples/find_pattern_bench/main.cpp -o find_pattern_bench
+
+// TODO: Add a mode which compares results against a saved baseline, so this
+// can be run as part of CI.
+
+namespace
+{
+using Needle = std::vector<hadesmem::detail::PatternDataByte>;
+
+std::uint32_t ReadU16(std::vector<std::uint8_t> const& buf, std::size_t offset)
+{
+  return buf[offset] | (buf[offset + 1] << 8);
+}
+
+std::uint32_t ReadU32(std::vector<std::uint8_t> const& buf, std::size_t offset)
+{
+  return ReadU16(buf, offset) | (ReadU16(buf, offset + 2) << 16);
+}
+
+// Extracts the code sections of a PE file (either as it is on disk, or as it
+// is mapped in memory). Anything else is benchmarked as-is.
+std::vector<std::uint8_t> GetCodeSections(std::vector<std::uint8_t> const& file,
+                                          bool image_layout)
+{
+  std::size_t const kDosHeaderSize = 0x40;
+  std::size_t const kFileHeaderSize = 0x14;
+  std::size_t const kSectionHeaderSize = 0x28;
+  std::uint32_t const kScnCntCode = 0x20;
+
+  if (file.size() < kDosHeaderSize || file[0] != 'M' || file[1] != 'Z')
+  {
+    return file;
+  }
+
+  std::size_t const nt_headers = ReadU32(file, 0x3C);
+  if (nt_headers > file.size() - 4 - kFileHeaderSize ||
+      ReadU32(file, nt_headers) != 0x00004550)
+  {
+    return file;
+  }
+
+  std::size_t const num_sections = ReadU16(file, nt_headers + 4 + 2);
+  std::size_t const optional_header_size = ReadU16(file, nt_headers + 4 + 16);
+  std::size_t const section_headers =
+    nt_headers + 4 + kFileHeaderSize + optional_header_size;
+
+  std::vector<std::uint8_t> code;
+  for (std::size_t i = 0; i < num_sections; ++i)
+  {
+    std::size_t const header = section_headers + i * kSectionHeaderSize;
+    if (header + kSectionHeaderSize > file.size())
+    {
+      break;
+    }
+
+    if (!(ReadU32(file, header + 36) & kScnCntCode))
+    {
+      continue;
+    }
+
+    std::size_t const virtual_size = ReadU32(file, header + 8);
+    std::size_t const virtual_address = ReadU32(file, header + 12);
+    std::size_t const raw_size = ReadU32(file, header + 16);
+    std::size_t const raw_offset = ReadU32(file, header + 20);
+    std::size_t const offset = image_layout ? virtual_address : raw_offset;
+    std::size_t const size = image_layout ? virtual_size : raw_size;
+    if (offset < file.size())
+    {
+      auto const beg = std::begin(file) + static_cast<std::ptrdiff_t>(offset);
+      auto const len = (std::min)(size, file.size() - offset);
+      code.insert(
+        std::end(code), beg, beg + static_cast<std::ptrdiff_t>(len));
+    }
+  }
+
+  return code.empty() ? file : code;
+}
+
+std::vector<std::uint8_t> LoadFile(std::string const& path)
+{
+  std::ifstream file{path, std::ios::binary};
+  if (!file)
+  {
+    throw std::runtime_error{"Failed to open file '" + path + "'."};
+  }
+
+  return std::vector<std::uint8_t>{std::istreambuf_iterator<char>{file},
+                                   std::istreambuf_iterator<char>{}};
+}
+
+// Random bytes weighted using the same frequency ranking as the search
+// anchor selection, so the anchors see roughly realistic hit rates.
+std::vector<std::uint8_t> GenerateSynthetic(std::size_t size,
+                                            std::mt19937& rng)
+{
+  std::vector<double> weights(0x100);
+  for (std::size_t i = 0; i < weights.size(); ++i)
+  {
+    auto const rank =
+      hadesmem::detail::GetByteFrequencyRank(static_cast<std::uint8_t>(i));
+    weights[i] = static_cast<double>(1U << rank);
+  }
+
+  std::discrete_distribution<int> dist{std::begin(weights),
+                                       std::end(weights)};
+  std::vector<std::uint8_t> data(size);
+  for (auto& b : data)
+  {
+    b = static_cast<std::uint8_t>(dist(rng));
+  }
+
+  return data;
+}
+
+Needle SampleNeedle(std::vector<std::uint8_t> const& haystack,
+                    std::size_t offset,
+                    std::size_t len)
+{
+  Needle needle;
+  for (std::size_t i = 0; i < len; ++i)
+  {
+    needle.push_back(
+      hadesmem::detail::PatternDataByte{haystack[offset + i], 0xFF});
+  }
+
+  return needle;
+}
+
+// Roughly what real signatures look like once relative operands etc. have
+// been wildcarded out.
+void AddWildcards(Needle& needle, std::mt19937& rng)
+{
+  // Keep the first byte exact so the needle is never entirely wildcards.
+  for (std::size_t i = 1; i < needle.size(); ++i)
+  {
+    switch (rng() % 4)
+    {
+    case 0:
+    case 1:
+      needle[i] = hadesmem::detail::PatternDataByte{0, 0};
+      break;
+    case 2:
+      needle[i].mask = 0xF0;
+      needle[i].value &= 0xF0;
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+bool IsPresent(std::vector<std::uint8_t> const& haystack, Needle const& needle)
+{
+  hadesmem::detail::PatternSearch const search{std::begin(needle),
+                                               std::end(needle)};
+  return search.Search(haystack.data(), haystack.data() + haystack.size()) !=
+         nullptr;
+}
+
+// Takes a sample from the haystack and corrupts it until it no longer matches.
+Needle SampleMissingNeedle(std::vector<std::uint8_t> const& haystack,
+                           std::size_t len,
+                           std::mt19937& rng)
+{
+  for (;;)
+  {
+    auto needle = SampleNeedle(haystack, rng() % (haystack.size() - len), len);
+    needle[rng() % len].value ^= static_cast<std::uint8_t>(1 + rng() % 0xFF);
+    if (!IsPresent(haystack, needle))
+    {
+      return needle;
+    }
+  }
+}
+
+struct BenchmarkResult
+{
+  std::string name;
+  std::uint64_t bytes;
+  double seconds;
+};
+
+// Runs the workload the requested number of times and keeps the best time, as
+// that is the least affected by whatever else is happening on the machine.
+// The workload returns the number of bytes it scanned.
+BenchmarkResult Benchmark(std::string const& name,
+                          std::size_t iterations,
+                          std::function<std::uint64_t()> const& workload)
+{
+  BenchmarkResult result{name, 0, 0.0};
+  for (std::size_t i = 0; i < iterations; ++i)
+  {
+    auto const beg = std::chrono::steady_clock::now();
+    result.bytes = workload();
+    auto const end = std::chrono::steady_clock::now();
+    double const seconds = std::chrono::duration<double>(end - beg).count();
+    if (!i || seconds < result.seconds)
+    {
+      result.seconds = seconds;
+    }
+  }
+
+  return result;
+}
+
+std::uint64_t RunMulti(std::vector<std::uint8_t> const& haystack,
+                       std::vector<Needle> const& needles)
+{
+  hadesmem::detail::MultiPatternSearch search;
+  for (auto const& needle : needles)
+  {
+    search.AddPattern(std::begin(needle), std::end(needle));
+  }
+
+  search.Compile();
+
+  std::uint8_t const* const h_beg = haystack.data();
+  std::uint8_t const* const h_end = h_beg + haystack.size();
+  std::vector<bool> done(needles.size());
+  std::uint8_t const* last = h_beg;
+  search.Search(h_beg,
+                h_end,
+                done,
+                [&](std::size_t id, std::uint8_t const* match)
+                {
+                  last = (std::max)(last, match + needles[id].size());
+                  return true;
+                });
+
+  // The search stops once everything has been found.
+  bool const all_done =
+    std::find(std::begin(done), std::end(done), false) == std::end(done);
+  return static_cast<std::uint64_t>(all_done ? last - h_beg : h_end - h_beg);
+}
+
+// The same workload as RunMulti, done with one search per pattern, which is
+// what MultiPatternSearch has to beat to be worth using.
+std::uint64_t RunSingles(std::vector<std::uint8_t> const& haystack,
+                         std::vector<Needle> const& needles)
+{
+  std::uint8_t const* const h_beg = haystack.data();
+  std::uint8_t const* const h_end = h_beg + haystack.size();
+  std::uint8_t const* last = h_beg;
+  bool all_done = true;
+  for (auto const& needle : needles)
+  {
+    hadesmem::detail::PatternSearch const search{std::begin(needle),
+                                                 std::end(needle)};
+    if (auto const match = search.Search(h_beg, h_end))
+    {
+      last = (std::max)(last, match + needle.size());
+    }
+    else
+    {
+      all_done = false;
+    }
+  }
+
+  return static_cast<std::uint64_t>(all_done ? last - h_beg : h_end - h_beg);
+}
+
+void RunBenchmarks(std::string const& name,
+                   std::vector<std::uint8_t> const& haystack,
+                   std::size_t iterations,
+                   std::size_t num_patterns,
+                   std::mt19937& rng)
+{
+  std::size_t const kNeedleLen = 16;
+  if (haystack.size() < kNeedleLen * 2)
+  {
+    std::cout << name << ": Too small to benchmark.\n";
+    return;
+  }
+
+  std::cout << name << " (" << haystack.size() << " bytes)\n";
+
+  std::uint8_t const* const h_beg = haystack.data();
+  std::uint8_t const* const h_end = h_beg + haystack.size();
+
+  // Found somewhere in the last 10% of the haystack.
+  std::size_t const late_offset =
+    haystack.size() - kNeedleLen - rng() % (haystack.size() / 10);
+  auto const late_needle = SampleNeedle(haystack, late_offset, kNeedleLen);
+  hadesmem::detail::PatternSearch const late_search{std::begin(late_needle),
+                                                    std::end(late_needle)};
+  auto const missing_needle = SampleMissingNeedle(haystack, kNeedleLen, rng);
+  hadesmem::detail::PatternSearch const missing_search{
+    std::begin(missing_needle), std::end(missing_needle)};
+
+  std::vector<Needle> present_needles;
+  std::vector<Needle> wildcard_needles;
+  std::vector<Needle> missing_needles;
+  for (std::size_t i = 0; i < num_patterns; ++i)
+  {
+    auto needle = SampleNeedle(
+      haystack, rng() % (haystack.size() - kNeedleLen), kNeedleLen);
+    present_needles.push_back(needle);
+    AddWildcards(needle, rng);
+    wildcard_needles.push_back(needle);
+    missing_needles.push_back(
+      SampleMissingNeedle(haystack, kNeedleLen, rng));
+  }
+
+  std::vector<BenchmarkResult> results;
+
+  results.emplace_back(
+    Benchmark("single", iterations, [&]() -> std::uint64_t
+              {
+                auto const match = late_search.Search(h_beg, h_end);
+                return static_cast<std::uint64_t>(match - h_beg) + kNeedleLen;
+              }));
+
+  results.emplace_back(
+    Benchmark("single-miss", iterations, [&]() -> std::uint64_t
+              {
+                missing_search.Search(h_beg, h_end);
+                return haystack.size();
+              }));
+
+  results.emplace_back(Benchmark(
+    "single-miss-parallel", iterations, [&]() -> std::uint64_t
+    {
+      hadesmem::detail::ParallelPatternSearch(
+        missing_search,
+        h_beg,
+        h_end,
+        hadesmem::detail::kParallelSearchChunkSize,
+        hadesmem::detail::GetDefaultThreadCount());
+      return haystack.size();
+    }));
+
+  results.emplace_back(
+    Benchmark("multi", iterations, [&]()
+              {
+                return RunMulti(haystack, present_needles);
+              }));
+
+  results.emplace_back(
+    Benchmark("singles", iterations, [&]()
+              {
+                return RunSingles(haystack, present_needles);
+              }));
+
+  results.emplace_back(
+    Benchmark("multi-wildcard", iterations, [&]()
+              {
+                return RunMulti(haystack, wildcard_needles);
+              }));
+
+  results.emplace_back(
+    Benchmark("singles-wildcard", iterations, [&]()
+              {
+                return RunSingles(haystack, wildcard_needles);
+              }));
+
+  results.emplace_back(
+    Benchmark("multi-miss", iterations, [&]()
+              {
+                return RunMulti(haystack, missing_needles);
+              }));
+
+  results.emplace_back(
+    Benchmark("singles-miss", iterations, [&]()
+              {
+                return RunSingles(haystack, missing_needles);
+              }));
+
+  for (auto const& r : results)
+  {
+    double const mb_per_sec =
+      r.seconds > 0.0
+        ? static_cast<double>(r.bytes) / r.seconds / (1024.0 * 1024.0)
+        : 0.0;
+    char line[128];
+    std::snprintf(line,
+                  sizeof(line),
+                  "  %-24s %12.1f MB/s %10.3f ms\n",
+                  r.name.c_str(),
+                  mb_per_sec,
+                  r.seconds * 1000.0);
+    std::cout << line;
+  }
+}
+}
+
+int main(int argc, char* argv[])
+{
+  try
+  {
+    std::cout << "HadesMem Pattern Benchmark\n";
+
+    TCLAP::CmdLine cmd{"Pattern scanning benchmark", ' ', "1.0"};
+    TCLAP::UnlabeledMultiArg<std::string> paths_arg{
+      "paths",
+      "Captured module images (synthetic data is used if none are given)",
+      false,
+      "string",
+      cmd};
+    TCLAP::SwitchArg image_layout_arg{
+      "",
+      "image-layout",
+      "Images were captured from memory rather than copied from disk",
+      cmd};
+    TCLAP::ValueArg<std::size_t> size_arg{
+      "", "size", "Size of synthetic data in MB", false, 64, "size_t", cmd};
+    TCLAP::ValueArg<std::size_t> iterations_arg{
+      "", "iterations", "Iterations per workload", false, 5, "size_t", cmd};
+    TCLAP::ValueArg<std::size_t> patterns_arg{
+      "", "patterns", "Patterns per multi workload", false, 100, "size_t", cmd};
+    TCLAP::ValueArg<unsigned int> seed_arg{
+      "", "seed", "Random seed", false, 0, "unsigned int", cmd};
+    cmd.parse(argc, argv);
+
+    std::mt19937 rng{seed_arg.getValue()};
+    std::size_t const iterations = (std::max)(
+      iterations_arg.getValue(), static_cast<std::size_t>(1));
+
+    if (paths_arg.getValue().empty())
+    {
+      auto const data =
+        GenerateSynthetic(size_arg.getValue() * 1024 * 1024, rng);
+      RunBenchmarks(
+        "synthetic", data, iterations, patterns_arg.getValue(), rng);
+    }
+
+    for (auto const& path : paths_arg.getValue())
+    {
+      auto const data =
+        GetCodeSections(LoadFile(path), image_layout_arg.getValue());
+      RunBenchmarks(path, data, iterations, patterns_arg.getValue(), rng);
+    }
+
+    return 0;
+  }
+  catch (...)
+  {
+    std::cerr << "Error!\n";
+    try
+    {
+      throw;
+    }
+    catch (std::exception const& e)
+    {
+      std::cerr << e.what() << "\n";
+    }
+    catch (...)
+    {
+    }
+
+    return 1;
+  }
+}
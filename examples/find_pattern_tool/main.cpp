@@ -0,0 +1,580 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <tclap/CmdLine.h>
+#include <udis86.h>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/debug_privilege.hpp>
+#include <hadesmem/detail/pattern_generator.hpp>
+#include <hadesmem/detail/pugixml_helpers.hpp>
+#include <hadesmem/detail/str_conv.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/find_pattern.hpp>
+#include <hadesmem/module.hpp>
+#include <hadesmem/pelib/nt_headers.hpp>
+#include <hadesmem/pelib/pe_file.hpp>
+#include <hadesmem/pelib/relocation.hpp>
+#include <hadesmem/pelib/relocation_block.hpp>
+#include <hadesmem/pelib/relocation_block_list.hpp>
+#include <hadesmem/pelib/relocation_list.hpp>
+#include <hadesmem/process.hpp>
+#include <hadesmem/process_helpers.hpp>
+#include <hadesmem/read.hpp>
+
+// TODO: Support growing patterns backwards from the target (and emitting the
+// corresponding Add manipulator), for targets which are only unique when
+// preceding code is included.
+
+// TODO: Support generating patterns for a reference to the target (e.g. a call
+// or RIP relative load) with the appropriate Rel manipulator, rather than only
+// for the target itself.
+
+// TODO: Support analyzing compiled pattern files.
+
+namespace
+{
+// Local copy of a module's code or data sections.
+struct ScanRegions
+{
+  std::vector<std::uint8_t*> bases;
+  std::vector<std::vector<std::uint8_t>> buffers;
+  std::vector<hadesmem::detail::PatternSpan> spans;
+};
+
+using RegionList = std::vector<hadesmem::detail::ModuleRegionInfo::ScanRegion>;
+
+ScanRegions ReadScanRegions(hadesmem::Process const& process,
+                            RegionList const& regions)
+{
+  ScanRegions scan_regions;
+  for (auto const& region : regions)
+  {
+    scan_regions.bases.push_back(region.first);
+    scan_regions.buffers.emplace_back(hadesmem::ReadVector<std::uint8_t>(
+      process,
+      region.first,
+      static_cast<std::size_t>(region.second - region.first)));
+    auto const& buffer = scan_regions.buffers.back();
+    scan_regions.spans.emplace_back(buffer.data(),
+                                    buffer.data() + buffer.size());
+  }
+
+  return scan_regions;
+}
+
+std::uint8_t const* RemoteToLocal(ScanRegions const& scan_regions,
+                                  std::uint8_t* address)
+{
+  for (std::size_t i = 0; i < scan_regions.bases.size(); ++i)
+  {
+    auto const base = scan_regions.bases[i];
+    auto const size = scan_regions.buffers[i].size();
+    if (address >= base && address < base + size)
+    {
+      return scan_regions.spans[i].first + (address - base);
+    }
+  }
+
+  return nullptr;
+}
+
+void WildcardBytes(std::vector<std::uint8_t>& masks,
+                   std::ptrdiff_t offset,
+                   std::size_t len)
+{
+  for (std::size_t i = 0; i < len; ++i)
+  {
+    std::ptrdiff_t const cur = offset + static_cast<std::ptrdiff_t>(i);
+    if (cur >= 0 && static_cast<std::size_t>(cur) < masks.size())
+    {
+      masks[static_cast<std::size_t>(cur)] = 0;
+    }
+  }
+}
+
+// Absolute addresses are patched by the loader, so they will differ whenever
+// the module is rebased.
+void WildcardRelocations(hadesmem::Process const& process,
+                         hadesmem::PeFile const& pe_file,
+                         std::uint8_t* target,
+                         std::vector<std::uint8_t>& masks)
+{
+  auto const base = static_cast<std::uint8_t*>(pe_file.GetBase());
+  hadesmem::RelocationBlockList const reloc_blocks{process, pe_file};
+  for (auto const& block : reloc_blocks)
+  {
+    hadesmem::RelocationList const relocs{process,
+                                          pe_file,
+                                          block.GetRelocationDataStart(),
+                                          block.GetNumberOfRelocations()};
+    for (auto const& reloc : relocs)
+    {
+      std::size_t len = 0;
+      switch (reloc.GetType())
+      {
+      case IMAGE_REL_BASED_HIGHLOW:
+        len = sizeof(std::uint32_t);
+        break;
+      case IMAGE_REL_BASED_DIR64:
+        len = sizeof(std::uint64_t);
+        break;
+      default:
+        continue;
+      }
+
+      auto const reloc_va =
+        base + block.GetVirtualAddress() + reloc.GetOffset();
+      WildcardBytes(masks, reloc_va - target, len);
+    }
+  }
+}
+
+// udis86 doesn't tell us where the operands are encoded, but displacements
+// and immediates are always at the end of the instruction (displacement
+// first), so we work backwards from there and double check the encoding.
+std::ptrdiff_t FindOperandOffset(std::uint8_t const* insn,
+                                 std::size_t insn_len,
+                                 std::size_t expected_offset,
+                                 std::uint64_t value,
+                                 std::size_t len)
+{
+  auto const is_encoded_at = [&](std::size_t offset)
+  {
+    for (std::size_t i = 0; i < len; ++i)
+    {
+      if (insn[offset + i] != static_cast<std::uint8_t>(value >> (i * 8)))
+      {
+        return false;
+      }
+    }
+
+    return true;
+  };
+
+  if (expected_offset + len <= insn_len && is_encoded_at(expected_offset))
+  {
+    return static_cast<std::ptrdiff_t>(expected_offset);
+  }
+
+  for (std::size_t offset = insn_len - len; offset != 0; --offset)
+  {
+    if (is_encoded_at(offset))
+    {
+      return static_cast<std::ptrdiff_t>(offset);
+    }
+  }
+
+  return -1;
+}
+
+// Relative branch targets and RIP relative displacements change whenever
+// code is added or removed between the instruction and its target. Absolute
+// displacements are normally covered by the relocations, but are handled here
+// too in case the module has had them stripped. Returns the number of bytes
+// which could be disassembled.
+std::size_t WildcardOperands(std::uint8_t const* target,
+                             std::size_t available,
+                             bool is_64,
+                             std::vector<std::uint8_t>& masks)
+{
+  std::size_t const kMaxInstructionLen = 15U;
+
+  ud_t ud_obj;
+  ud_init(&ud_obj);
+  ud_set_input_buffer(
+    &ud_obj,
+    target,
+    (std::min)(available, masks.size() + kMaxInstructionLen));
+  ud_set_syntax(&ud_obj, UD_SYN_INTEL);
+  ud_set_mode(&ud_obj, is_64 ? 64 : 32);
+
+  std::size_t offset = 0;
+  while (offset < masks.size())
+  {
+    std::uint32_t const len = ud_disassemble(&ud_obj);
+    if (len == 0 || ud_obj.mnemonic == UD_Iinvalid)
+    {
+      break;
+    }
+
+    std::uint8_t const* const insn = target + offset;
+
+    std::size_t imm_len = 0;
+    for (unsigned int i = 0;; ++i)
+    {
+      ud_operand_t const* const op = ud_insn_opr(&ud_obj, i);
+      if (!op)
+      {
+        break;
+      }
+
+      if (op->type == UD_OP_IMM)
+      {
+        imm_len += op->size / 8;
+      }
+      else if (op->type == UD_OP_JIMM)
+      {
+        std::size_t const rel_len = op->size / 8;
+        WildcardBytes(masks,
+                      static_cast<std::ptrdiff_t>(offset + len - rel_len),
+                      rel_len);
+      }
+    }
+
+    for (unsigned int i = 0;; ++i)
+    {
+      ud_operand_t const* const op = ud_insn_opr(&ud_obj, i);
+      if (!op)
+      {
+        break;
+      }
+
+      bool const is_rip_relative = op->base == UD_R_RIP;
+      bool const is_absolute = op->base == UD_NONE && op->index == UD_NONE;
+      std::size_t const disp_len = op->offset / 8;
+      if (op->type != UD_OP_MEM || disp_len < sizeof(std::uint32_t) ||
+          !(is_rip_relative || is_absolute))
+      {
+        continue;
+      }
+
+      std::ptrdiff_t const disp_offset =
+        FindOperandOffset(insn,
+                          len,
+                          len - (std::min)(len - 1, imm_len + disp_len),
+                          op->lval.uqword,
+                          disp_len);
+      if (disp_offset >= 0)
+      {
+        WildcardBytes(
+          masks, static_cast<std::ptrdiff_t>(offset) + disp_offset, disp_len);
+      }
+    }
+
+    offset += len;
+  }
+
+  return offset;
+}
+
+void GeneratePattern(hadesmem::Process const& process,
+                     std::wstring const& module_name,
+                     std::uintptr_t address,
+                     bool is_rva,
+                     std::size_t max_len,
+                     std::wstring const& pattern_name)
+{
+  auto const mod_info = hadesmem::detail::GetModuleInfo(process, module_name);
+  auto const base =
+    reinterpret_cast<std::uint8_t*>(mod_info.module->GetHandle());
+  auto const target =
+    is_rva ? base + address : reinterpret_cast<std::uint8_t*>(address);
+
+  bool scan_data = false;
+  auto scan_regions = ReadScanRegions(process, mod_info.code_regions);
+  std::uint8_t const* local_target = RemoteToLocal(scan_regions, target);
+  if (!local_target)
+  {
+    scan_data = true;
+    scan_regions = ReadScanRegions(process, mod_info.data_regions);
+    local_target = RemoteToLocal(scan_regions, target);
+  }
+
+  if (!local_target)
+  {
+    HADESMEM_DETAIL_THROW_EXCEPTION(
+      hadesmem::Error{} << hadesmem::ErrorString{
+        "Target is not inside a code or data section of the module."});
+  }
+
+  std::size_t available = 0;
+  for (auto const& span : scan_regions.spans)
+  {
+    if (local_target >= span.first && local_target < span.second)
+    {
+      available = static_cast<std::size_t>(span.second - local_target);
+    }
+  }
+
+  hadesmem::PeFile const pe_file{
+    process, base, hadesmem::PeFileType::Image, 0};
+  std::vector<std::uint8_t> masks((std::min)(max_len, available), 0xFF);
+  WildcardRelocations(process, pe_file, target, masks);
+  if (!scan_data)
+  {
+    std::size_t const len =
+      WildcardOperands(local_target, available, pe_file.Is64(), masks);
+    // Don't extend the pattern into whatever follows the code (padding, data,
+    // etc.) if we hit something we can't disassemble.
+    if (len)
+    {
+      masks.resize((std::min)(masks.size(), len));
+    }
+  }
+
+  std::vector<hadesmem::detail::PatternDataByte> needle;
+  std::size_t const num_matches = hadesmem::detail::GeneratePattern(
+    scan_regions.spans, local_target, masks, needle);
+  auto const data = hadesmem::detail::PatternDataToString(needle);
+
+  std::wcout << "\nTarget: " << hadesmem::detail::PtrToHexString(target)
+             << " (RVA " << hadesmem::detail::PtrToHexString(
+                              reinterpret_cast<void*>(target - base))
+             << ").\n";
+  if (num_matches != 1)
+  {
+    std::wcout << "WARNING! No unique pattern found within " << masks.size()
+               << " bytes. Closest match is ambiguous.\n";
+  }
+
+  std::wcout << "Data: " << data << "\n";
+  std::wcout << "Length: " << needle.size() << ".\n";
+  std::wcout << "\n<Pattern Name=\"" << pattern_name << "\" Data=\"" << data;
+  if (scan_data)
+  {
+    std::wcout << "\">\n  <Flag Name=\"ScanData\"/>\n</Pattern>\n";
+  }
+  else
+  {
+    std::wcout << "\"/>\n";
+  }
+}
+
+bool HasScanDataFlag(pugi::xml_node const& node)
+{
+  for (auto const& flag : node.children(L"Flag"))
+  {
+    if (hadesmem::detail::pugixml::GetAttributeValue(flag, L"Name") ==
+        L"ScanData")
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Counts how often each pattern in a pattern file matches across its whole
+// module (ignoring any start address, as a pattern which is only unique after
+// its start address is fragile). Returns the number of patterns which need
+// attention.
+std::size_t AnalyzePatternFile(hadesmem::Process const& process,
+                               std::wstring const& path,
+                               std::size_t max_count)
+{
+  pugi::xml_document doc;
+  auto const load_result = doc.load_file(path.c_str());
+  if (!load_result)
+  {
+    HADESMEM_DETAIL_THROW_EXCEPTION(
+      hadesmem::Error{}
+      << hadesmem::ErrorString{"Loading XML file failed."}
+      << hadesmem::ErrorCodeOther{static_cast<DWORD_PTR>(load_result.status)}
+      << hadesmem::ErrorStringOther{load_result.description()});
+  }
+
+  auto const hadesmem_root = doc.child(L"HadesMem");
+  if (!hadesmem_root)
+  {
+    HADESMEM_DETAIL_THROW_EXCEPTION(
+      hadesmem::Error{} << hadesmem::ErrorString{
+        "Failed to find 'HadesMem' root node."});
+  }
+
+  std::size_t num_bad = 0;
+  std::map<std::wstring, std::pair<ScanRegions, ScanRegions>> modules;
+  for (auto const& find_pattern_node : hadesmem_root.children(L"FindPattern"))
+  {
+    auto const module_name =
+      hadesmem::detail::pugixml::GetOptionalAttributeValue(find_pattern_node,
+                                                           L"Module");
+    auto module_iter = modules.find(module_name);
+    if (module_iter == std::end(modules))
+    {
+      auto const mod_info =
+        hadesmem::detail::GetModuleInfo(process, module_name);
+      module_iter =
+        modules.emplace(module_name,
+                        std::make_pair(
+                          ReadScanRegions(process, mod_info.code_regions),
+                          ReadScanRegions(process, mod_info.data_regions)))
+          .first;
+    }
+
+    std::wcout << "\nModule: "
+               << (module_name.empty() ? L"<Main>" : module_name) << "\n";
+
+    bool const module_scan_data = HasScanDataFlag(find_pattern_node);
+    for (auto const& pattern : find_pattern_node.children(L"Pattern"))
+    {
+      auto const name =
+        hadesmem::detail::pugixml::GetAttributeValue(pattern, L"Name");
+      auto const needle = hadesmem::detail::ConvertData(
+        hadesmem::detail::pugixml::GetAttributeValue(pattern, L"Data"));
+      bool const scan_data = module_scan_data || HasScanDataFlag(pattern);
+      auto const& scan_regions =
+        scan_data ? module_iter->second.second : module_iter->second.first;
+
+      hadesmem::detail::PatternSearch const search{std::begin(needle),
+                                                   std::end(needle)};
+      std::size_t const num_matches = hadesmem::detail::CountPatternMatches(
+        search, scan_regions.spans, max_count);
+
+      std::wcout << "  " << name << ": ";
+      if (num_matches >= max_count)
+      {
+        std::wcout << max_count << "+";
+      }
+      else
+      {
+        std::wcout << num_matches;
+      }
+
+      std::wcout << " match(es).";
+      if (num_matches == 0)
+      {
+        std::wcout << " WARNING! Unmatched.";
+        ++num_bad;
+      }
+      else if (num_matches > 1)
+      {
+        std::wcout << " WARNING! Ambiguous.";
+        ++num_bad;
+      }
+
+      std::wcout << "\n";
+    }
+  }
+
+  return num_bad;
+}
+}
+
+int main(int argc, char* argv[])
+{
+  try
+  {
+    std::cout << "HadesMem Pattern Tool [" << HADESMEM_VERSION_STRING << "]\n";
+
+    TCLAP::CmdLine cmd{
+      "Pattern analyzer and generator", ' ', HADESMEM_VERSION_STRING};
+    TCLAP::ValueArg<DWORD> pid_arg{
+      "", "pid", "Target process id", false, 0, "DWORD"};
+    TCLAP::ValueArg<std::string> name_arg{
+      "", "name", "Target process name", false, "", "string"};
+    cmd.xorAdd(pid_arg, name_arg);
+    TCLAP::SwitchArg name_forced_arg{
+      "",
+      "name-forced",
+      "Default to first matched process name (no warning)",
+      cmd};
+    TCLAP::ValueArg<std::string> module_arg{
+      "",
+      "module",
+      "Module to generate pattern for (default is main module)",
+      false,
+      "",
+      "string",
+      cmd};
+    TCLAP::ValueArg<std::string> address_arg{
+      "", "address", "Generate pattern for address", false, "", "string"};
+    TCLAP::ValueArg<std::string> rva_arg{
+      "", "rva", "Generate pattern for RVA", false, "", "string"};
+    TCLAP::ValueArg<std::string> analyze_arg{
+      "",
+      "analyze",
+      "Report match counts for patterns in file",
+      false,
+      "",
+      "string"};
+    std::vector<TCLAP::Arg*> xor_args{&address_arg, &rva_arg, &analyze_arg};
+    cmd.xorAdd(xor_args);
+    TCLAP::ValueArg<std::size_t> max_len_arg{"",
+                                             "max-len",
+                                             "Maximum generated pattern length",
+                                             false,
+                                             64,
+                                             "size_t",
+                                             cmd};
+    TCLAP::ValueArg<std::size_t> max_count_arg{
+      "", "max-count", "Stop counting matches at", false, 100, "size_t", cmd};
+    TCLAP::ValueArg<std::string> pattern_name_arg{
+      "",
+      "pattern-name",
+      "Name for generated pattern",
+      false,
+      "Generated",
+      "string",
+      cmd};
+    cmd.parse(argc, argv);
+
+    try
+    {
+      hadesmem::GetSeDebugPrivilege();
+
+      std::wcout << "\nAcquired SeDebugPrivilege.\n";
+    }
+    catch (std::exception const& /*e*/)
+    {
+      std::wcout << "\nFailed to acquire SeDebugPrivilege.\n";
+    }
+
+    std::unique_ptr<hadesmem::Process> process;
+    if (pid_arg.isSet())
+    {
+      process = std::make_unique<hadesmem::Process>(pid_arg.getValue());
+    }
+    else
+    {
+      auto const proc_name =
+        hadesmem::detail::MultiByteToWideChar(name_arg.getValue());
+      process = std::make_unique<hadesmem::Process>(
+        hadesmem::GetProcessByName(proc_name, name_forced_arg.isSet()));
+    }
+
+    if (analyze_arg.isSet())
+    {
+      auto const num_bad = AnalyzePatternFile(
+        *process,
+        hadesmem::detail::MultiByteToWideChar(analyze_arg.getValue()),
+        (std::max)(max_count_arg.getValue(), static_cast<std::size_t>(2)));
+      std::wcout << "\n" << num_bad << " pattern(s) need attention.\n";
+      return num_bad ? 2 : 0;
+    }
+
+    bool const is_rva = rva_arg.isSet();
+    auto const address = hadesmem::detail::HexStrToPtr(
+      is_rva ? rva_arg.getValue() : address_arg.getValue());
+    GeneratePattern(
+      *process,
+      hadesmem::detail::MultiByteToWideChar(module_arg.getValue()),
+      address,
+      is_rva,
+      (std::max)(max_len_arg.getValue(), static_cast<std::size_t>(1)),
+      hadesmem::detail::MultiByteToWideChar(pattern_name_arg.getValue()));
+
+    return 0;
+  }
+  catch (...)
+  {
+    std::cerr << "\nError!\n";
+    std::cerr << boost::current_exception_diagnostic_information() << '\n';
+
+    return 1;
+  }
+}
@@ -20,11 +20,17 @@ namespace detail
 {
 inline PVOID TryAlloc(Process const& process, SIZE_T size, PVOID base = nullptr)
 {
-  return ::VirtualAllocEx(process.GetHandle(),
-                          base,
-                          size,
-                          MEM_COMMIT | MEM_RESERVE,
-                          PAGE_EXECUTE_READWRITE);
+  PVOID const address = ::VirtualAllocEx(process.GetHandle(),
+                                         base,
+                                         size,
+                                         MEM_COMMIT | MEM_RESERVE,
+                                         PAGE_EXECUTE_READWRITE);
+  if (address)
+  {
+    process.InvalidateRegionCache();
+  }
+
+  return address;
 }
 }
 
@@ -43,6 +49,8 @@ inline PVOID Alloc(Process const& process, SIZE_T size, PVOID base = nullptr)
                                     << ErrorCodeWinLast{last_error});
   }
 
+  process.InvalidateRegionCache();
+
   return address;
 }
 
@@ -55,6 +63,8 @@ inline void Free(Process const& process, LPVOID address)
                                     << ErrorString{"VirtualFreeEx failed."}
                                     << ErrorCodeWinLast{last_error});
   }
+
+  process.InvalidateRegionCache();
 }
 
 class Allocator
@@ -0,0 +1,209 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/page_cache.hpp>
+#include <hadesmem/detail/read_impl.hpp>
+#include <hadesmem/detail/static_assert.hpp>
+#include <hadesmem/detail/type_traits.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/process.hpp>
+#include <hadesmem/read.hpp>
+
+namespace hadesmem
+{
+// Read-through cache of the pages of a process, for code which reads the same
+// memory over and over again (e.g. following the same pointer chains every
+// frame). Read, ReadVector and ReadString accept a view in place of a
+// process. Cached pages are used until Tick is called or they get older than
+// the time to live (if any), so a view should be ticked whenever the target
+// may have changed, such as once per frame. Pages are only read into the cache
+// if their region can be read as-is (see TryReadAsIs), so guard pages are
+// never touched. Read handles anything else like hadesmem::Read does, by
+// reading the whole range with ReadImpl (which reprotects regions as needed,
+// or throws). Views are not thread safe.
+class CachedProcessView
+{
+public:
+  explicit CachedProcessView(
+    Process const& process,
+    std::size_t budget = 0x100000,
+    std::chrono::steady_clock::duration ttl =
+      std::chrono::steady_clock::duration::zero())
+    : process_{&process}, cache_{0x1000, budget, ttl}
+  {
+  }
+
+  explicit CachedProcessView(
+    Process&& process,
+    std::size_t budget = 0x100000,
+    std::chrono::steady_clock::duration ttl =
+      std::chrono::steady_clock::duration::zero()) = delete;
+
+  Process const& GetProcess() const noexcept
+  {
+    return *process_;
+  }
+
+  void Tick() noexcept
+  {
+    cache_.Invalidate();
+  }
+
+  std::chrono::steady_clock::duration GetTimeToLive() const noexcept
+  {
+    return cache_.GetTimeToLive();
+  }
+
+  void SetTimeToLive(std::chrono::steady_clock::duration ttl) noexcept
+  {
+    cache_.SetTimeToLive(ttl);
+  }
+
+  std::size_t GetPageSize() const noexcept
+  {
+    return cache_.GetPageSize();
+  }
+
+  std::size_t GetNumHits() const noexcept
+  {
+    return cache_.GetNumHits();
+  }
+
+  std::size_t GetNumMisses() const noexcept
+  {
+    return cache_.GetNumMisses();
+  }
+
+  // Copies the len bytes at address to data through the cache. Returns false
+  // if any of their pages can't be read as-is, in which case data is left
+  // partially written.
+  bool TryRead(PVOID address, void* data, std::size_t len)
+  {
+    HADESMEM_DETAIL_ASSERT(len ? address != nullptr : true);
+    HADESMEM_DETAIL_ASSERT(len ? data != nullptr : true);
+
+    Process const& process = *process_;
+    return cache_.Read(
+      static_cast<std::uint8_t const*>(address),
+      data,
+      len,
+      [&](std::uint8_t* page, std::uint8_t* buf, std::size_t page_len)
+      {
+        return detail::TryReadAsIs(process, page, buf, page_len);
+      });
+  }
+
+  // Like TryRead, but if that fails the whole range is read again with
+  // ReadImpl, bypassing the cache (which reprotects or throws on failure).
+  void Read(PVOID address, void* data, std::size_t len)
+  {
+    if (!TryRead(address, data, len))
+    {
+      detail::ReadImpl(*process_, address, data, len);
+    }
+  }
+
+private:
+  Process const* process_;
+  detail::PageCache cache_;
+};
+
+template <typename T> inline T Read(CachedProcessView& view, PVOID address)
+{
+  HADESMEM_DETAIL_STATIC_ASSERT(detail::IsTriviallyCopyable<T>::value);
+  HADESMEM_DETAIL_STATIC_ASSERT(std::is_default_constructible<T>::value);
+
+  HADESMEM_DETAIL_ASSERT(address != nullptr);
+
+  T data;
+  view.Read(address, std::addressof(data), sizeof(data));
+  return data;
+}
+
+template <typename T, std::size_t N>
+inline std::array<T, N> Read(CachedProcessView& view, PVOID address)
+{
+  HADESMEM_DETAIL_ASSERT(address != nullptr);
+
+  return Read<std::array<T, N>>(view, address);
+}
+
+template <typename T, typename Alloc = std::allocator<T>>
+inline std::vector<T, Alloc>
+  ReadVector(CachedProcessView& view, PVOID address, std::size_t count)
+{
+  HADESMEM_DETAIL_STATIC_ASSERT(detail::IsTriviallyCopyable<T>::value);
+  HADESMEM_DETAIL_STATIC_ASSERT(std::is_default_constructible<T>::value);
+
+  HADESMEM_DETAIL_ASSERT(count ? address != nullptr : true);
+
+  std::vector<T, Alloc> data(count);
+  view.Read(address, data.data(), sizeof(T) * count);
+  return data;
+}
+
+template <typename T, typename OutputIterator>
+void ReadString(CachedProcessView& view, PVOID address, OutputIterator data)
+{
+  HADESMEM_DETAIL_STATIC_ASSERT(detail::IsCharType<T>::value);
+  HADESMEM_DETAIL_STATIC_ASSERT(std::is_base_of<
+    std::output_iterator_tag,
+    typename std::iterator_traits<OutputIterator>::iterator_category>::value);
+
+  HADESMEM_DETAIL_ASSERT(address != nullptr);
+
+  std::size_t const page_size = view.GetPageSize();
+  auto cur = static_cast<std::uint8_t*>(address);
+  std::vector<T> buf;
+  for (;;)
+  {
+    // Only read up to the end of the page, so nothing past the terminator is
+    // cached (or has to be readable).
+    std::size_t const len_to_end =
+      page_size - (reinterpret_cast<std::uintptr_t>(cur) & (page_size - 1));
+    buf.resize((std::max)(len_to_end / sizeof(T), std::size_t{1}));
+    if (!view.TryRead(cur, buf.data(), buf.size() * sizeof(T)))
+    {
+      ReadString<T>(view.GetProcess(), cur, data);
+      return;
+    }
+
+    auto const iter = std::find(std::begin(buf), std::end(buf), T());
+    std::copy(std::begin(buf), iter, data);
+    if (iter != std::end(buf))
+    {
+      return;
+    }
+
+    cur += buf.size() * sizeof(T);
+  }
+}
+
+template <typename T,
+          typename Traits = std::char_traits<T>,
+          typename Alloc = std::allocator<T>>
+std::basic_string<T, Traits, Alloc> ReadString(CachedProcessView& view,
+                                               PVOID address)
+{
+  std::basic_string<T, Traits, Alloc> data;
+  ReadString<T>(view, address, std::back_inserter(data));
+  return data;
+}
+}
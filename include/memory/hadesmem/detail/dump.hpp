@@ -16,6 +16,7 @@
 #include <hadesmem/detail/peb.hpp>
 #include <hadesmem/detail/str_conv.hpp>
 #include <hadesmem/find_procedure.hpp>
+#include <hadesmem/memory_source.hpp>
 #include <hadesmem/pelib/dos_header.hpp>
 #include <hadesmem/pelib/export.hpp>
 #include <hadesmem/pelib/export_dir.hpp>
@@ -239,7 +240,8 @@ struct ModuleLight
       {
         auto buffer = PeFileToBuffer(path_);
         Process local_process{::GetCurrentProcessId()};
-        PeFile pe_file{local_process,
+        MemorySource const source{local_process, buffer.data(), buffer.size()};
+        PeFile pe_file{source,
                        buffer.data(),
                        PeFileType::Data,
                        static_cast<DWORD>(buffer.size())};
@@ -587,7 +589,9 @@ private:
         // might think...)
         pe_file_disk_data = PeFileToBuffer(region_path);
         pe_file_disk = std::make_unique<PeFile>(
-          local_process,
+          MemorySource{local_process,
+                       pe_file_disk_data.data(),
+                       pe_file_disk_data.size()},
           pe_file_disk_data.data(),
           PeFileType::Data,
           static_cast<DWORD>(pe_file_disk_data.size()));
@@ -716,10 +720,11 @@ private:
 
     HADESMEM_DETAIL_ASSERT(raw_new.size() <
                            (std::numeric_limits<DWORD>::max)());
-    PeFile const pe_file_new(local_process,
-                             raw_new.data(),
-                             PeFileType::Data,
-                             static_cast<DWORD>(raw_new.size()));
+    PeFile const pe_file_new(
+      MemorySource{local_process, raw_new.data(), raw_new.size()},
+      raw_new.data(),
+      PeFileType::Data,
+      static_cast<DWORD>(raw_new.size()));
     auto const raw_new_capacity = raw_new.capacity();
 
     HADESMEM_DETAIL_TRACE_A("Fixing NT headers.");
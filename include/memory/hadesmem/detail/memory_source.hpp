@@ -0,0 +1,112 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Direct access to a span of memory in this process, used by MemorySource so
+// that local buffers and mapped files can be parsed with plain loads instead
+// of going through ReadProcessMemory. Like the scanning cores, this must not
+// depend on windows.h.
+
+namespace hadesmem
+{
+namespace detail
+{
+class LocalMemorySource
+{
+public:
+  LocalMemorySource() noexcept = default;
+
+  LocalMemorySource(void const* base, std::size_t size) noexcept
+    : base_{static_cast<std::uint8_t const*>(base)}, size_{size}
+  {
+  }
+
+  std::uint8_t const* GetBase() const noexcept
+  {
+    return base_;
+  }
+
+  std::size_t GetSize() const noexcept
+  {
+    return size_;
+  }
+
+  bool IsEmpty() const noexcept
+  {
+    return !size_;
+  }
+
+  bool Contains(void const* address, std::size_t len) const noexcept
+  {
+    auto const cur = reinterpret_cast<std::uintptr_t>(address);
+    auto const beg = reinterpret_cast<std::uintptr_t>(base_);
+    return cur >= beg && cur - beg <= size_ && len <= size_ - (cur - beg);
+  }
+
+  // Returns a pointer to the len bytes at address, or nullptr if they aren't
+  // all inside the span.
+  std::uint8_t const* GetPointer(void const* address,
+                                 std::size_t len) const noexcept
+  {
+    return !IsEmpty() && Contains(address, len)
+             ? static_cast<std::uint8_t const*>(address)
+             : nullptr;
+  }
+
+  bool Read(void const* address, void* data, std::size_t len) const noexcept
+  {
+    std::uint8_t const* const p = GetPointer(address, len);
+    if (!p)
+    {
+      return false;
+    }
+
+    std::memcpy(data, p, len);
+    return true;
+  }
+
+  // Sets len to the number of characters in the string at address, which
+  // ends at its terminator or at upper_bound (if not null), whichever comes
+  // first. Returns false if the span ends before either of them. Strings
+  // don't have to be aligned.
+  template <typename T>
+  bool GetStringLength(void const* address,
+                       void const* upper_bound,
+                       std::size_t& len) const noexcept
+  {
+    if (!GetPointer(address, 0))
+    {
+      return false;
+    }
+
+    auto const cur = static_cast<std::uint8_t const*>(address);
+    std::uint8_t const* const span_end = base_ + size_;
+    bool const bounded = upper_bound && upper_bound <= span_end;
+    std::uint8_t const* const end =
+      bounded ? static_cast<std::uint8_t const*>(upper_bound) : span_end;
+    std::size_t const max_len =
+      end > cur ? static_cast<std::size_t>(end - cur) / sizeof(T) : 0;
+    for (len = 0; len < max_len; ++len)
+    {
+      T c;
+      std::memcpy(&c, cur + len * sizeof(T), sizeof(T));
+      if (c == T())
+      {
+        return true;
+      }
+    }
+
+    return bounded;
+  }
+
+private:
+  std::uint8_t const* base_{};
+  std::size_t size_{};
+};
+}
+}
@@ -0,0 +1,213 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include <hadesmem/detail/assert.hpp>
+
+// LRU cache of remote pages used by CachedProcessView. Pages go stale when
+// the cache is invalidated or when they get older than the time to live, and
+// stale pages are refilled in place. Once the budget is reached, the least
+// recently used page's buffer is reused, so nothing is allocated in the
+// steady state. Like the scanning cores, this must not depend on windows.h.
+
+namespace hadesmem
+{
+namespace detail
+{
+class PageCache
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  // A ttl of zero means pages only go stale when the cache is invalidated.
+  PageCache(std::size_t page_size,
+            std::size_t budget,
+            Clock::duration ttl = Clock::duration::zero())
+    : page_size_{page_size},
+      max_pages_{(std::max)(budget / page_size, std::size_t{1})},
+      ttl_{ttl}
+  {
+    HADESMEM_DETAIL_ASSERT(page_size_ != 0);
+    HADESMEM_DETAIL_ASSERT((page_size_ & (page_size_ - 1)) == 0);
+  }
+
+  // Copies the len bytes at address to data, calling read(address, buf, len)
+  // to fill pages as needed, where read returns whether the page could be
+  // read. Returns false if any of the pages couldn't be read (in which case
+  // data is left partially written).
+  template <typename ReadFunc>
+  bool Read(std::uint8_t const* address,
+            void* data,
+            std::size_t len,
+            ReadFunc read)
+  {
+    auto const begin = reinterpret_cast<std::uintptr_t>(address);
+    HADESMEM_DETAIL_ASSERT(begin + len >= begin);
+
+    auto out = static_cast<std::uint8_t*>(data);
+    std::uintptr_t cur = begin;
+    std::uintptr_t const end = begin + len;
+    while (cur < end)
+    {
+      std::uintptr_t const page = cur & ~(page_size_ - 1);
+      std::uint8_t const* const page_data = GetPage(page, read);
+      if (!page_data)
+      {
+        return false;
+      }
+
+      std::size_t const offset = static_cast<std::size_t>(cur - page);
+      std::size_t const count =
+        (std::min)(static_cast<std::size_t>(end - cur), page_size_ - offset);
+      std::memcpy(out, page_data + offset, count);
+      out += count;
+      cur += count;
+    }
+
+    return true;
+  }
+
+  // Makes every cached page stale.
+  void Invalidate() noexcept
+  {
+    ++generation_;
+  }
+
+  Clock::duration GetTimeToLive() const noexcept
+  {
+    return ttl_;
+  }
+
+  void SetTimeToLive(Clock::duration ttl) noexcept
+  {
+    ttl_ = ttl;
+  }
+
+  std::size_t GetPageSize() const noexcept
+  {
+    return page_size_;
+  }
+
+  std::size_t GetMaxPages() const noexcept
+  {
+    return max_pages_;
+  }
+
+  // Page lookups which did and didn't need the page to be read.
+  std::size_t GetNumHits() const noexcept
+  {
+    return num_hits_;
+  }
+
+  std::size_t GetNumMisses() const noexcept
+  {
+    return num_misses_;
+  }
+
+private:
+  struct Page
+  {
+    std::uintptr_t address;
+    std::uint64_t generation;
+    Clock::time_point time;
+    // Whether the page is in index_.
+    bool valid;
+    std::vector<std::uint8_t> data;
+  };
+
+  using PageList = std::list<Page>;
+
+  bool IsFresh(Page const& page) const
+  {
+    return page.generation == generation_ &&
+           (ttl_ == Clock::duration::zero() || Clock::now() - page.time < ttl_);
+  }
+
+  template <typename ReadFunc>
+  std::uint8_t const* GetPage(std::uintptr_t address, ReadFunc& read)
+  {
+    PageList::iterator iter;
+    auto const index_iter = index_.find(address);
+    if (index_iter != std::end(index_))
+    {
+      iter = index_iter->second;
+      pages_.splice(std::begin(pages_), pages_, iter);
+      if (IsFresh(*iter))
+      {
+        ++num_hits_;
+        return iter->data.data();
+      }
+    }
+    else if (pages_.size() < max_pages_)
+    {
+      pages_.push_front(Page{address,
+                             generation_,
+                             Clock::time_point{},
+                             false,
+                             std::vector<std::uint8_t>(page_size_)});
+      iter = std::begin(pages_);
+    }
+    else
+    {
+      iter = std::prev(std::end(pages_));
+      if (iter->valid)
+      {
+        index_.erase(iter->address);
+      }
+
+      pages_.splice(std::begin(pages_), pages_, iter);
+      iter->valid = false;
+    }
+
+    ++num_misses_;
+
+    if (!read(reinterpret_cast<std::uint8_t*>(address),
+              iter->data.data(),
+              page_size_))
+    {
+      if (iter->valid)
+      {
+        index_.erase(address);
+      }
+
+      iter->valid = false;
+      pages_.splice(std::end(pages_), pages_, iter);
+      return nullptr;
+    }
+
+    iter->address = address;
+    iter->generation = generation_;
+    iter->time = ttl_ != Clock::duration::zero() ? Clock::now()
+                                                  : Clock::time_point{};
+    if (!iter->valid)
+    {
+      index_[address] = iter;
+      iter->valid = true;
+    }
+
+    return iter->data.data();
+  }
+
+  std::size_t page_size_;
+  std::size_t max_pages_;
+  Clock::duration ttl_;
+  std::uint64_t generation_{};
+  // Most recently used first.
+  PageList pages_;
+  std::unordered_map<std::uintptr_t, PageList::iterator> index_;
+  std::size_t num_hits_{};
+  std::size_t num_misses_{};
+};
+}
+}
@@ -0,0 +1,109 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <hadesmem/detail/assert.hpp>
+
+// Must not depend on windows.h, so it can be shared by the portable scanning
+// cores.
+
+namespace hadesmem
+{
+namespace detail
+{
+inline std::size_t GetDefaultThreadCount() noexcept
+{
+  return (std::max)(
+    static_cast<std::size_t>(std::thread::hardware_concurrency()),
+    static_cast<std::size_t>(1));
+}
+
+// Calls func(i, thread) for every i in [0, count) on num_threads threads
+// (including the calling thread), where thread is in [0, num_threads) and can
+// be used to index per-thread state such as buffers. Items are handed out one
+// at a time, so they should be coarse enough to amortize that. If func throws,
+// the remaining items are skipped and the first exception is rethrown once all
+// threads are done.
+template <typename Func>
+void ParallelFor(std::size_t count, std::size_t num_threads, Func func)
+{
+  HADESMEM_DETAIL_ASSERT(num_threads != 0);
+
+  num_threads = (std::min)(num_threads, count);
+  if (num_threads < 2)
+  {
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      func(i, static_cast<std::size_t>(0));
+    }
+
+    return;
+  }
+
+  std::atomic<std::size_t> next{0};
+  std::mutex exception_mutex;
+  std::exception_ptr exception;
+
+  auto const worker = [&](std::size_t thread)
+  {
+    for (std::size_t i = next++; i < count; i = next++)
+    {
+      try
+      {
+        func(i, thread);
+      }
+      catch (...)
+      {
+        std::lock_guard<std::mutex> lock{exception_mutex};
+        if (!exception)
+        {
+          exception = std::current_exception();
+        }
+
+        next = count;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  try
+  {
+    for (std::size_t i = 1; i < num_threads; ++i)
+    {
+      threads.emplace_back(worker, i);
+    }
+  }
+  catch (...)
+  {
+    next = count;
+    for (auto& t : threads)
+    {
+      t.join();
+    }
+
+    throw;
+  }
+
+  worker(0);
+
+  for (auto& t : threads)
+  {
+    t.join();
+  }
+
+  if (exception)
+  {
+    std::rethrow_exception(exception);
+  }
+}
+}
+}
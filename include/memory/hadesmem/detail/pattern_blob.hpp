@@ -0,0 +1,325 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/pattern_data.hpp>
+
+// Compiled pattern files. Everything which is expensive to derive from the XML
+// (needle parsing, anchor selection, manipulator validation) is done once at
+// compile time, so loading a blob is just a linear walk over the buffer.
+
+// Like the pattern search cores, this must not depend on windows.h so that the
+// format can be produced and consumed on any platform.
+
+// Layout (all integers are little endian, strings are a u32 length followed by
+// that many UTF-16 code units):
+//
+// Header:   u8[4] magic, u32 version, u32 num_modules
+// Module:   string name, u32 flags, u32 num_patterns
+// Pattern:  string name, string data, string start, string start_rva,
+//           string start_export, u32 flags, u32 needle_len,
+//           (u8 value, u8 mask)[needle_len], u32 anchor_offset,
+//           u32 anchor_len, u32 code_len, u8[code_len] code
+//
+// Manipulator bytecode is a sequence of an opcode byte followed by its
+// operands (u64 each). Operand counts are fixed per opcode and checked at
+// compile time.
+
+namespace hadesmem
+{
+namespace detail
+{
+std::uint8_t const kPatternBlobMagic[4] = {'H', 'M', 'P', 'B'};
+std::uint32_t const kPatternBlobVersion = 1;
+
+enum class PatternOp : std::uint8_t
+{
+  kAdd,
+  kSub,
+  kRel,
+  kLea,
+  kAnd,
+  kInvalidMaxValue
+};
+
+inline std::size_t GetPatternOpNumOperands(PatternOp op) noexcept
+{
+  switch (op)
+  {
+  case PatternOp::kRel:
+    return 2;
+  case PatternOp::kLea:
+    return 0;
+  default:
+    return 1;
+  }
+}
+
+inline bool IsPatternBlob(void const* data, std::size_t size) noexcept
+{
+  return size >= sizeof(kPatternBlobMagic) &&
+         !std::memcmp(data, kPatternBlobMagic, sizeof(kPatternBlobMagic));
+}
+
+class PatternBlobWriter
+{
+public:
+  PatternBlobWriter()
+  {
+    buf_.assign(std::begin(kPatternBlobMagic), std::end(kPatternBlobMagic));
+    WriteU32(kPatternBlobVersion);
+  }
+
+  void WriteU8(std::uint8_t value)
+  {
+    buf_.push_back(value);
+  }
+
+  void WriteU32(std::uint32_t value)
+  {
+    for (std::size_t i = 0; i < sizeof(value); ++i)
+    {
+      buf_.push_back(static_cast<std::uint8_t>(value >> (i * 8)));
+    }
+  }
+
+  void WriteU64(std::uint64_t value)
+  {
+    for (std::size_t i = 0; i < sizeof(value); ++i)
+    {
+      buf_.push_back(static_cast<std::uint8_t>(value >> (i * 8)));
+    }
+  }
+
+  void WriteString(std::wstring const& value)
+  {
+    WriteU32(static_cast<std::uint32_t>(value.size()));
+    for (auto const c : value)
+    {
+      HADESMEM_DETAIL_ASSERT(static_cast<std::uint32_t>(c) <= 0xFFFFU);
+      buf_.push_back(static_cast<std::uint8_t>(c));
+      buf_.push_back(static_cast<std::uint8_t>(c >> 8));
+    }
+  }
+
+  void WriteBytes(std::vector<std::uint8_t> const& value)
+  {
+    WriteU32(static_cast<std::uint32_t>(value.size()));
+    buf_.insert(std::end(buf_), std::begin(value), std::end(value));
+  }
+
+  void WriteNeedle(std::vector<PatternDataByte> const& needle)
+  {
+    WriteU32(static_cast<std::uint32_t>(needle.size()));
+    for (auto const& b : needle)
+    {
+      buf_.push_back(b.value);
+      buf_.push_back(b.mask);
+    }
+  }
+
+  std::vector<std::uint8_t> const& GetBuffer() const noexcept
+  {
+    return buf_;
+  }
+
+private:
+  std::vector<std::uint8_t> buf_;
+};
+
+// Reads directly from the (typically mapped) blob. Every read is bounds
+// checked, and returns false on truncated or malformed data.
+class PatternBlobReader
+{
+public:
+  explicit PatternBlobReader(void const* data, std::size_t size) noexcept
+    : cur_(static_cast<std::uint8_t const*>(data)),
+      end_(static_cast<std::uint8_t const*>(data) + size)
+  {
+  }
+
+  bool ReadHeader()
+  {
+    std::uint32_t version = 0;
+    if (!IsPatternBlob(cur_, Remaining()))
+    {
+      return false;
+    }
+
+    cur_ += sizeof(kPatternBlobMagic);
+    return ReadU32(version) && version == kPatternBlobVersion;
+  }
+
+  bool ReadU8(std::uint8_t& value) noexcept
+  {
+    if (Remaining() < 1)
+    {
+      return false;
+    }
+
+    value = *cur_++;
+    return true;
+  }
+
+  bool ReadU32(std::uint32_t& value) noexcept
+  {
+    if (Remaining() < sizeof(value))
+    {
+      return false;
+    }
+
+    value = 0;
+    for (std::size_t i = 0; i < sizeof(value); ++i)
+    {
+      value |= static_cast<std::uint32_t>(*cur_++) << (i * 8);
+    }
+
+    return true;
+  }
+
+  bool ReadU64(std::uint64_t& value) noexcept
+  {
+    if (Remaining() < sizeof(value))
+    {
+      return false;
+    }
+
+    value = 0;
+    for (std::size_t i = 0; i < sizeof(value); ++i)
+    {
+      value |= static_cast<std::uint64_t>(*cur_++) << (i * 8);
+    }
+
+    return true;
+  }
+
+  bool ReadString(std::wstring& value)
+  {
+    std::uint32_t len = 0;
+    if (!ReadU32(len) || Remaining() / 2 < len)
+    {
+      return false;
+    }
+
+    value.resize(len);
+    for (std::size_t i = 0; i < len; ++i, cur_ += 2)
+    {
+      value[i] = static_cast<wchar_t>(cur_[0] | (cur_[1] << 8));
+    }
+
+    return true;
+  }
+
+  bool ReadBytes(std::vector<std::uint8_t>& value)
+  {
+    std::uint32_t len = 0;
+    if (!ReadU32(len) || Remaining() < len)
+    {
+      return false;
+    }
+
+    value.assign(cur_, cur_ + len);
+    cur_ += len;
+    return true;
+  }
+
+  bool ReadNeedle(std::vector<PatternDataByte>& needle)
+  {
+    std::uint32_t len = 0;
+    if (!ReadU32(len) || !len || Remaining() / 2 < len)
+    {
+      return false;
+    }
+
+    needle.resize(len);
+    for (auto& b : needle)
+    {
+      b.value = *cur_++;
+      b.mask = *cur_++;
+      if (b.value & ~b.mask)
+      {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  bool IsEnd() const noexcept
+  {
+    return cur_ == end_;
+  }
+
+private:
+  std::size_t Remaining() const noexcept
+  {
+    return static_cast<std::size_t>(end_ - cur_);
+  }
+
+  std::uint8_t const* cur_;
+  std::uint8_t const* end_;
+};
+
+// Checks that the bytecode only contains known opcodes with all of their
+// operands present, so it can be executed without any further checks.
+inline bool IsPatternCodeValid(std::vector<std::uint8_t> const& code) noexcept
+{
+  for (std::size_t i = 0; i < code.size();)
+  {
+    if (code[i] >= static_cast<std::uint8_t>(PatternOp::kInvalidMaxValue))
+    {
+      return false;
+    }
+
+    std::size_t const operands_len =
+      GetPatternOpNumOperands(static_cast<PatternOp>(code[i])) *
+      sizeof(std::uint64_t);
+    ++i;
+    if (code.size() - i < operands_len)
+    {
+      return false;
+    }
+
+    i += operands_len;
+  }
+
+  return true;
+}
+
+inline void AppendPatternOp(std::vector<std::uint8_t>& code,
+                            PatternOp op,
+                            std::uint64_t operand1 = 0,
+                            std::uint64_t operand2 = 0)
+{
+  code.push_back(static_cast<std::uint8_t>(op));
+  std::uint64_t const operands[] = {operand1, operand2};
+  for (std::size_t i = 0; i < GetPatternOpNumOperands(op); ++i)
+  {
+    for (std::size_t j = 0; j < sizeof(std::uint64_t); ++j)
+    {
+      code.push_back(static_cast<std::uint8_t>(operands[i] >> (j * 8)));
+    }
+  }
+}
+
+inline std::uint64_t ReadPatternCodeOperand(std::uint8_t const*& pc) noexcept
+{
+  std::uint64_t value = 0;
+  for (std::size_t i = 0; i < sizeof(value); ++i)
+  {
+    value |= static_cast<std::uint64_t>(*pc++) << (i * 8);
+  }
+
+  return value;
+}
+}
+}
@@ -0,0 +1,294 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include <windows.h>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <pugixml.hpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/pugixml_helpers.hpp>
+#include <hadesmem/detail/str_conv.hpp>
+#include <hadesmem/detail/trace.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/module.hpp>
+#include <hadesmem/pelib/nt_headers.hpp>
+#include <hadesmem/pelib/pe_file.hpp>
+#include <hadesmem/pelib/section.hpp>
+#include <hadesmem/pelib/section_list.hpp>
+#include <hadesmem/process.hpp>
+
+namespace hadesmem
+{
+namespace detail
+{
+struct ModuleIdentity
+{
+  DWORD time_date_stamp;
+  DWORD size_of_image;
+  DWORD check_sum;
+  std::uint64_t section_hash;
+};
+
+inline bool operator==(ModuleIdentity const& lhs,
+                       ModuleIdentity const& rhs) noexcept
+{
+  return lhs.time_date_stamp == rhs.time_date_stamp &&
+         lhs.size_of_image == rhs.size_of_image &&
+         lhs.check_sum == rhs.check_sum &&
+         lhs.section_hash == rhs.section_hash;
+}
+
+inline bool operator!=(ModuleIdentity const& lhs,
+                       ModuleIdentity const& rhs) noexcept
+{
+  return !(lhs == rhs);
+}
+
+std::uint64_t const kFnv1aOffsetBasis64 = 0xCBF29CE484222325ULL;
+
+inline std::uint64_t HashFnv1a(void const* data,
+                               std::size_t len,
+                               std::uint64_t hash = kFnv1aOffsetBasis64)
+{
+  auto const bytes = static_cast<std::uint8_t const*>(data);
+  for (std::size_t i = 0; i < len; ++i)
+  {
+    hash ^= bytes[i];
+    hash *= 0x100000001B3ULL;
+  }
+
+  return hash;
+}
+
+// Only the headers are used, so computing the identity is cheap. Anything
+// which changes the code or data of a module (short of a deliberately crafted
+// patch) will change at least one of these.
+inline ModuleIdentity GetModuleIdentity(Process const& process,
+                                        Module const& module)
+{
+  PeFile const pe_file{process, module.GetHandle(), PeFileType::Image, 0};
+  NtHeaders const nt_headers{process, pe_file};
+  SectionList const sections{process, pe_file};
+
+  std::uint64_t section_hash = kFnv1aOffsetBasis64;
+  for (auto const& s : sections)
+  {
+    auto const name = s.GetName();
+    section_hash = HashFnv1a(name.data(), name.size(), section_hash);
+    DWORD const fields[] = {s.GetVirtualAddress(),
+                            s.GetVirtualSize(),
+                            s.GetSizeOfRawData(),
+                            s.GetPointerToRawData(),
+                            s.GetCharacteristics()};
+    section_hash = HashFnv1a(fields, sizeof(fields), section_hash);
+  }
+
+  return ModuleIdentity{nt_headers.GetTimeDateStamp(),
+                        nt_headers.GetSizeOfImage(),
+                        nt_headers.GetCheckSum(),
+                        section_hash};
+}
+
+// On-disk cache of raw pattern match RVAs (i.e. before manipulators are
+// applied, as those may depend on runtime state). Entries for a module are
+// discarded as soon as its identity changes. The file is read once when the
+// cache is created and overwritten in full by Save, without any locking, so a
+// cache file must not be shared by instances which may be live at the same
+// time (e.g. in multiple processes). Doing so won't produce wrong matches
+// (they are always verified), but updates may be lost.
+class PatternCache
+{
+public:
+  explicit PatternCache(std::wstring const& path) : path_(path)
+  {
+    Load();
+  }
+
+  // Only successful matches are cached. The caller is expected to verify the
+  // needle is still present at the returned RVA before trusting it.
+  bool Lookup(std::wstring const& module,
+              ModuleIdentity const& identity,
+              std::wstring const& name,
+              std::wstring const& data,
+              std::uint32_t flags,
+              std::uintptr_t start_rva,
+              std::uintptr_t& rva) const
+  {
+    auto const module_iter = modules_.find(module);
+    if (module_iter == std::end(modules_) ||
+        module_iter->second.identity != identity)
+    {
+      return false;
+    }
+
+    auto const& patterns = module_iter->second.patterns;
+    auto const pattern_iter = patterns.find(name);
+    if (pattern_iter == std::end(patterns))
+    {
+      return false;
+    }
+
+    auto const& entry = pattern_iter->second;
+    if (entry.data != data || entry.flags != flags ||
+        entry.start_rva != start_rva)
+    {
+      return false;
+    }
+
+    rva = entry.rva;
+    return true;
+  }
+
+  void Store(std::wstring const& module,
+             ModuleIdentity const& identity,
+             std::wstring const& name,
+             std::wstring const& data,
+             std::uint32_t flags,
+             std::uintptr_t start_rva,
+             std::uintptr_t rva)
+  {
+    auto& module_entry = modules_[module];
+    if (module_entry.identity != identity)
+    {
+      module_entry.identity = identity;
+      module_entry.patterns.clear();
+    }
+
+    module_entry.patterns[name] = PatternEntry{data, flags, start_rva, rva};
+    dirty_ = true;
+  }
+
+  void Save()
+  {
+    if (!dirty_)
+    {
+      return;
+    }
+
+    pugi::xml_document doc;
+    auto cache_node = doc.append_child(L"HadesMemPatternCache");
+    for (auto const& module : modules_)
+    {
+      auto const& identity = module.second.identity;
+      auto module_node = cache_node.append_child(L"Module");
+      module_node.append_attribute(L"Name").set_value(module.first.c_str());
+      SetHexAttribute(module_node, L"TimeDateStamp", identity.time_date_stamp);
+      SetHexAttribute(module_node, L"SizeOfImage", identity.size_of_image);
+      SetHexAttribute(module_node, L"CheckSum", identity.check_sum);
+      SetHexAttribute(module_node, L"SectionHash", identity.section_hash);
+
+      for (auto const& pattern : module.second.patterns)
+      {
+        auto const& entry = pattern.second;
+        auto pattern_node = module_node.append_child(L"Pattern");
+        pattern_node.append_attribute(L"Name").set_value(
+          pattern.first.c_str());
+        pattern_node.append_attribute(L"Data").set_value(entry.data.c_str());
+        SetHexAttribute(pattern_node, L"Flags", entry.flags);
+        SetHexAttribute(pattern_node, L"StartRVA", entry.start_rva);
+        SetHexAttribute(pattern_node, L"RVA", entry.rva);
+      }
+    }
+
+    if (!doc.save_file(path_.c_str()))
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Saving pattern cache failed."});
+    }
+
+    dirty_ = false;
+  }
+
+private:
+  struct PatternEntry
+  {
+    std::wstring data;
+    std::uint32_t flags;
+    std::uintptr_t start_rva;
+    std::uintptr_t rva;
+  };
+
+  struct ModuleEntry
+  {
+    ModuleIdentity identity;
+    std::map<std::wstring, PatternEntry> patterns;
+  };
+
+  template <typename T>
+  static void
+    SetHexAttribute(pugi::xml_node& node, wchar_t const* name, T value)
+  {
+    node.append_attribute(name).set_value(
+      (L"0x" + NumToStr<wchar_t>(value, true)).c_str());
+  }
+
+  template <typename T>
+  static T GetHexAttribute(pugi::xml_node const& node, wchar_t const* name)
+  {
+    return StrToNum<T>(pugixml::GetAttributeValue(node, name), true);
+  }
+
+  void Load()
+  {
+    pugi::xml_document doc;
+    auto const load_result = doc.load_file(path_.c_str());
+    if (!load_result)
+    {
+      // A missing or corrupt cache simply means a cold start, and the file
+      // will be rewritten once the patterns have been resolved.
+      HADESMEM_DETAIL_TRACE_FORMAT_A("Failed to load pattern cache. [%s].",
+                                     load_result.description());
+      return;
+    }
+
+    try
+    {
+      auto const cache_node = doc.child(L"HadesMemPatternCache");
+      for (auto const& module_node : cache_node.children(L"Module"))
+      {
+        ModuleEntry module_entry{};
+        module_entry.identity = ModuleIdentity{
+          GetHexAttribute<DWORD>(module_node, L"TimeDateStamp"),
+          GetHexAttribute<DWORD>(module_node, L"SizeOfImage"),
+          GetHexAttribute<DWORD>(module_node, L"CheckSum"),
+          GetHexAttribute<std::uint64_t>(module_node, L"SectionHash")};
+
+        for (auto const& pattern_node : module_node.children(L"Pattern"))
+        {
+          PatternEntry pattern_entry{
+            pugixml::GetAttributeValue(pattern_node, L"Data"),
+            GetHexAttribute<std::uint32_t>(pattern_node, L"Flags"),
+            GetHexAttribute<std::uintptr_t>(pattern_node, L"StartRVA"),
+            GetHexAttribute<std::uintptr_t>(pattern_node, L"RVA")};
+          module_entry.patterns[pugixml::GetAttributeValue(
+            pattern_node, L"Name")] = pattern_entry;
+        }
+
+        modules_[pugixml::GetOptionalAttributeValue(module_node, L"Name")] =
+          module_entry;
+      }
+    }
+    catch (...)
+    {
+      HADESMEM_DETAIL_TRACE_A(
+        boost::current_exception_diagnostic_information().c_str());
+      modules_.clear();
+    }
+  }
+
+  std::wstring path_;
+  std::map<std::wstring, ModuleEntry> modules_;
+  bool dirty_{false};
+};
+}
+}
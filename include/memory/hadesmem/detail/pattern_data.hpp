@@ -0,0 +1,120 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+
+#include <hadesmem/detail/assert.hpp>
+
+// This header (and the pattern search cores built on it) must not depend on
+// windows.h or any of the Process based APIs. The cores operate purely on local
+// byte spans so they can be tested and benchmarked on any platform.
+
+namespace hadesmem
+{
+namespace detail
+{
+// A needle byte matches a haystack byte h when (h & mask) == value. Full
+// wildcards have a zero mask, nibble wildcards mask out the unknown nibble.
+struct PatternDataByte
+{
+  std::uint8_t value;
+  std::uint8_t mask;
+};
+
+inline bool IsWildcard(PatternDataByte const& b) noexcept
+{
+  return !b.mask;
+}
+
+inline bool IsExact(PatternDataByte const& b) noexcept
+{
+  return b.mask == 0xFF;
+}
+
+struct PatternAnchor
+{
+  std::size_t offset;
+  std::size_t length;
+};
+
+// Picks the longest run of bytes accepted by is_anchor_byte in the needle
+// (truncated to max_len). Returns a zero length anchor if there are none.
+template <typename NeedleIterator, typename Pred>
+PatternAnchor GetPatternAnchor(NeedleIterator n_beg,
+                               NeedleIterator n_end,
+                               std::size_t max_len,
+                               Pred is_anchor_byte)
+{
+  HADESMEM_DETAIL_ASSERT(max_len != 0);
+
+  PatternAnchor best{0, 0};
+  std::size_t run_beg = 0;
+  std::size_t run_len = 0;
+  std::size_t i = 0;
+  for (auto iter = n_beg; iter != n_end; ++iter, ++i)
+  {
+    if (!is_anchor_byte(*iter))
+    {
+      run_len = 0;
+      continue;
+    }
+
+    if (!run_len)
+    {
+      run_beg = i;
+    }
+
+    ++run_len;
+
+    if (run_len > best.length)
+    {
+      best = PatternAnchor{run_beg, run_len};
+    }
+  }
+
+  if (best.length > max_len)
+  {
+    best.length = max_len;
+  }
+
+  return best;
+}
+
+// Picks the longest run of exact (i.e. not full or nibble wildcard) bytes in
+// the needle (truncated to max_len).
+template <typename NeedleIterator>
+PatternAnchor GetPatternAnchor(NeedleIterator n_beg,
+                               NeedleIterator n_end,
+                               std::size_t max_len)
+{
+  return GetPatternAnchor(n_beg,
+                          n_end,
+                          max_len,
+                          [](PatternDataByte const& b)
+                          {
+                            return IsExact(b);
+                          });
+}
+
+template <typename NeedleIterator>
+inline bool MatchPatternAt(std::uint8_t const* h_cur,
+                           NeedleIterator n_beg,
+                           NeedleIterator n_end) noexcept
+{
+  for (auto iter = n_beg; iter != n_end; ++iter, ++h_cur)
+  {
+    if ((*h_cur & iter->mask) != iter->value)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+}
+}
@@ -0,0 +1,143 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/pattern_data.hpp>
+#include <hadesmem/detail/pattern_search.hpp>
+
+// Pattern quality analysis and signature generation. Like the search cores
+// this only operates on local copies of the scanned regions and must not
+// depend on windows.h.
+
+namespace hadesmem
+{
+namespace detail
+{
+using PatternSpan = std::pair<std::uint8_t const*, std::uint8_t const*>;
+
+// Counts (possibly overlapping) matches across all spans, stopping as soon as
+// max_count is reached. Use a max_count of 2 to check for uniqueness.
+inline std::size_t CountPatternMatches(PatternSearch const& search,
+                                       std::vector<PatternSpan> const& spans,
+                                       std::size_t max_count)
+{
+  std::size_t count = 0;
+  for (auto const& span : spans)
+  {
+    for (std::uint8_t const* h_cur = span.first; count < max_count; ++h_cur)
+    {
+      h_cur = search.Search(h_cur, span.second);
+      if (!h_cur)
+      {
+        break;
+      }
+
+      ++count;
+    }
+  }
+
+  return count;
+}
+
+// Grows the shortest pattern starting at the target which only matches once
+// across the spans (the target must be inside one of them). masks holds the
+// mask to apply to each byte from the target onwards (0 for bytes which are
+// relocated, relative, etc.), and its size is the maximum pattern length.
+// Returns the number of matches of the generated pattern (capped at 2), so
+// anything other than 1 means no unique pattern exists within that length.
+inline std::size_t GeneratePattern(std::vector<PatternSpan> const& spans,
+                                   std::uint8_t const* target,
+                                   std::vector<std::uint8_t> const& masks,
+                                   std::vector<PatternDataByte>& needle)
+{
+  HADESMEM_DETAIL_ASSERT(!masks.empty());
+
+  std::uint8_t const* target_end = nullptr;
+  for (auto const& span : spans)
+  {
+    if (target >= span.first && target < span.second)
+    {
+      target_end = span.second;
+    }
+  }
+
+  HADESMEM_DETAIL_ASSERT(target_end != nullptr);
+
+  std::size_t const max_len =
+    (std::min)(masks.size(), static_cast<std::size_t>(target_end - target));
+  auto const get_needle = [&](std::size_t len)
+  {
+    std::vector<PatternDataByte> result;
+    for (std::size_t i = 0; i < len; ++i)
+    {
+      result.push_back(PatternDataByte{
+        static_cast<std::uint8_t>(target[i] & masks[i]), masks[i]});
+    }
+
+    return result;
+  };
+  auto const count_matches = [&](std::size_t len)
+  {
+    auto const cur_needle = get_needle(len);
+    PatternSearch const search{std::begin(cur_needle), std::end(cur_needle)};
+    return CountPatternMatches(search, spans, 2);
+  };
+
+  // Adding bytes can only ever remove matches, so we can binary search for
+  // the shortest unique length rather than rescanning for every length.
+  std::size_t lo = 1;
+  std::size_t hi = max_len;
+  std::size_t best_count = count_matches(hi);
+  if (best_count != 1)
+  {
+    needle = get_needle(hi);
+    return best_count;
+  }
+
+  while (lo < hi)
+  {
+    std::size_t const mid = lo + (hi - lo) / 2;
+    if (count_matches(mid) == 1)
+    {
+      hi = mid;
+    }
+    else
+    {
+      lo = mid + 1;
+    }
+  }
+
+  needle = get_needle(hi);
+  return 1;
+}
+
+// Inverse of ConvertData.
+inline std::wstring PatternDataToString(
+  std::vector<PatternDataByte> const& needle)
+{
+  wchar_t const kHexDigits[] = L"0123456789ABCDEF";
+  std::wstring data;
+  for (auto const& b : needle)
+  {
+    if (!data.empty())
+    {
+      data += L' ';
+    }
+
+    data += (b.mask & 0xF0) ? kHexDigits[b.value >> 4] : L'?';
+    data += (b.mask & 0x0F) ? kHexDigits[b.value & 0xF] : L'?';
+  }
+
+  return data;
+}
+}
+}
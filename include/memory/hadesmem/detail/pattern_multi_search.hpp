@@ -0,0 +1,616 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/pattern_data.hpp>
+#include <hadesmem/detail/pattern_search.hpp>
+#include <hadesmem/detail/simd.hpp>
+
+// TODO: Compress the alphabet into byte classes if the trie ever becomes a
+// problem for very large pattern files.
+
+namespace hadesmem
+{
+namespace detail
+{
+// Multi pattern search over a local buffer. Every pattern gets an anchor (a
+// run of exact bytes starting with the rarest pair of them), and the first
+// two bytes of each anchor are added to a bitmap. Positions are only looked up
+// in the trie of anchors if their first two bytes are in the bitmap (where
+// AVX2 is available, blocks of positions are first tested against the sets of
+// first and second anchor bytes), and anchor hits are verified against the
+// full (masked) needle, so every pattern can be resolved in a single pass over
+// the haystack. Patterns without two adjacent exact bytes, or whose pair would
+// let through too much more of the haystack, are searched for one at a time
+// with PatternSearch instead, which can anchor on bytes that are further apart.
+//
+// If fold_case is set, haystack bytes are case folded before the lookups, so
+// that letters which only differ in bit 5 (i.e. needle bytes with a 0xDF
+// mask, as used by case insensitive string scans) can be part of an anchor
+// too.
+class MultiPatternSearch
+{
+public:
+  // Longer anchors only make the trie bigger, the verification step takes care
+  // of the rest of the needle.
+  static std::size_t const kMaxAnchorLen = 8;
+
+  // A pattern is only filtered on if its pair raises the (estimated) share of
+  // haystack positions the byte sets let through by at most 1/kPassRateStep.
+  // Each position that gets through costs about as much as a separate
+  // PatternSearch spends on kPassRateStep bytes.
+  static std::uint64_t const kPassRateStep = 256;
+
+  // The filtered pass costs about as much as a couple of separate
+  // PatternSearch passes, so it is not worth it for just a few patterns.
+  static std::size_t const kMinFilteredPatterns = 4;
+
+  explicit MultiPatternSearch(bool fold_case = false) noexcept
+    : fold_case_{fold_case}
+  {
+  }
+
+  // Maps lower case ASCII and Latin-1 letters to upper case.
+  static std::uint8_t FoldCase(std::uint8_t c) noexcept
+  {
+    bool const is_lower =
+      (c >= 'a' && c <= 'z') || (c >= 0xE0 && c <= 0xFE && c != 0xF7);
+    return is_lower ? static_cast<std::uint8_t>(c & ~0x20) : c;
+  }
+
+  // Every byte the needle byte matches has to fold to the same value.
+  static bool IsAnchorByte(PatternDataByte const& b, bool fold_case) noexcept
+  {
+    auto const other = static_cast<std::uint8_t>(b.value | 0x20);
+    return IsExact(b) || (fold_case && b.mask == 0xDF &&
+                          FoldCase(b.value) == FoldCase(other));
+  }
+
+  // Picks the run of anchor bytes which starts with the rarest pair of them
+  // (so the bitmap rejects as many positions as possible), truncated to
+  // kMaxAnchorLen. Needles without such a pair get a single byte anchor, or a
+  // zero length anchor if they have no anchor bytes at all.
+  template <typename NeedleIterator>
+  static PatternAnchor GetAnchor(NeedleIterator n_beg,
+                                 NeedleIterator n_end,
+                                 bool fold_case)
+  {
+    std::vector<PatternDataByte> const needle(n_beg, n_end);
+    std::vector<std::size_t> run_lens(needle.size() + 1);
+    for (std::size_t i = needle.size(); i--;)
+    {
+      run_lens[i] =
+        IsAnchorByte(needle[i], fold_case) ? run_lens[i + 1] + 1 : 0;
+    }
+
+    PatternAnchor best{0, 0};
+    std::uint32_t best_rank = 0;
+    for (std::size_t i = 0; i + 1 < needle.size(); ++i)
+    {
+      if (run_lens[i] < 2)
+      {
+        continue;
+      }
+
+      std::uint32_t const rank = GetByteFrequencyRank(needle[i].value) +
+                                 GetByteFrequencyRank(needle[i + 1].value);
+      std::size_t const len =
+        run_lens[i] < kMaxAnchorLen ? run_lens[i] : kMaxAnchorLen;
+      if (!best.length || rank < best_rank ||
+          (rank == best_rank && len > best.length))
+      {
+        best = PatternAnchor{i, len};
+        best_rank = rank;
+      }
+    }
+
+    if (best.length)
+    {
+      return best;
+    }
+
+    return GetPatternAnchor(n_beg,
+                            n_end,
+                            1,
+                            [&](PatternDataByte const& b)
+                            {
+                              return IsAnchorByte(b, fold_case);
+                            });
+  }
+
+  template <typename NeedleIterator>
+  std::size_t AddPattern(NeedleIterator n_beg, NeedleIterator n_end)
+  {
+    return AddPattern(n_beg, n_end, GetAnchor(n_beg, n_end, fold_case_));
+  }
+
+  // For callers which have already selected an anchor (e.g. compiled pattern
+  // files). It must be a run of anchor bytes no longer than kMaxAnchorLen.
+  template <typename NeedleIterator>
+  std::size_t AddPattern(NeedleIterator n_beg,
+                         NeedleIterator n_end,
+                         PatternAnchor const& anchor)
+  {
+    HADESMEM_DETAIL_ASSERT(n_beg != n_end);
+    HADESMEM_DETAIL_ASSERT(anchor.length <= kMaxAnchorLen);
+
+    compiled_ = false;
+
+    PatternInfo info;
+    info.needle.assign(n_beg, n_end);
+    info.anchor = anchor;
+    HADESMEM_DETAIL_ASSERT(anchor.offset + anchor.length <=
+                           info.needle.size());
+    patterns_.emplace_back(std::move(info));
+    return patterns_.size() - 1;
+  }
+
+  std::size_t GetNumPatterns() const noexcept
+  {
+    return patterns_.size();
+  }
+
+  std::size_t GetNeedleLength(std::size_t id) const noexcept
+  {
+    HADESMEM_DETAIL_ASSERT(id < patterns_.size());
+    return patterns_[id].needle.size();
+  }
+
+  void Compile()
+  {
+    for (std::size_t c = 0; c < kAlphabetSize; ++c)
+    {
+      auto const byte = static_cast<std::uint8_t>(c);
+      fold_table_[c] = fold_case_ ? FoldCase(byte) : byte;
+    }
+
+    trie_.assign(kAlphabetSize, 0);
+    outputs_.assign(1, std::vector<std::size_t>());
+    bitmap_.assign(kAlphabetSize * kAlphabetSize / 64, 0);
+    byte_sets_.fill(0);
+    searches_.clear();
+    search_ids_.clear();
+    num_filtered_ = 0;
+
+    // Rarest pairs first, so that common ones are the ones left out.
+    std::vector<std::size_t> ids(patterns_.size());
+    for (std::size_t id = 0; id < ids.size(); ++id)
+    {
+      ids[id] = id;
+    }
+
+    std::stable_sort(std::begin(ids),
+                     std::end(ids),
+                     [&](std::size_t lhs, std::size_t rhs)
+                     {
+                       return GetPairRank(lhs) < GetPairRank(rhs);
+                     });
+
+    std::uint64_t total_weight = 0;
+    for (std::size_t c = 0; c < kAlphabetSize; ++c)
+    {
+      total_weight += GetByteWeight(c);
+    }
+
+    std::vector<bool> in_sets[2] = {std::vector<bool>(kAlphabetSize),
+                                    std::vector<bool>(kAlphabetSize)};
+    std::uint64_t set_weights[2] = {0, 0};
+    std::vector<bool> filtered(patterns_.size());
+    std::size_t num_filtered = 0;
+    for (auto const id : ids)
+    {
+      auto const& info = patterns_[id];
+      if (info.anchor.length < 2)
+      {
+        continue;
+      }
+
+      // Every byte which folds to one of the pair bytes gets through.
+      std::uint8_t const pair[2] = {
+        fold_table_[info.needle[info.anchor.offset].value],
+        fold_table_[info.needle[info.anchor.offset + 1].value]};
+      std::uint64_t new_weights[2] = {set_weights[0], set_weights[1]};
+      for (std::size_t j = 0; j < 2; ++j)
+      {
+        for (std::size_t c = 0; c < kAlphabetSize; ++c)
+        {
+          if (fold_table_[c] == pair[j] && !in_sets[j][c])
+          {
+            new_weights[j] += GetByteWeight(c);
+          }
+        }
+      }
+
+      if ((new_weights[0] * new_weights[1] -
+           set_weights[0] * set_weights[1]) *
+            kPassRateStep >
+          total_weight * total_weight)
+      {
+        continue;
+      }
+
+      for (std::size_t j = 0; j < 2; ++j)
+      {
+        for (std::size_t c = 0; c < kAlphabetSize; ++c)
+        {
+          in_sets[j][c] = in_sets[j][c] || fold_table_[c] == pair[j];
+        }
+
+        set_weights[j] = new_weights[j];
+      }
+
+      filtered[id] = true;
+      ++num_filtered;
+    }
+
+    if (num_filtered < kMinFilteredPatterns)
+    {
+      filtered.assign(patterns_.size(), false);
+    }
+
+    for (std::size_t id = 0; id < patterns_.size(); ++id)
+    {
+      if (filtered[id])
+      {
+        AddFilteredPattern(id);
+      }
+      else
+      {
+        auto const& info = patterns_[id];
+        searches_.emplace_back(std::begin(info.needle),
+                               std::end(info.needle));
+        search_ids_.push_back(id);
+      }
+    }
+
+    compiled_ = true;
+  }
+
+  // Reports verified matches in increasing address order (per pattern) to
+  // callback(id, match), which returns true once it is done with that pattern.
+  // Patterns that are already flagged in 'done' are never reported, and the
+  // search stops early once every pattern is done.
+  template <typename Callback>
+  void Search(std::uint8_t const* h_beg,
+              std::uint8_t const* h_end,
+              std::vector<bool>& done,
+              Callback callback) const
+  {
+    HADESMEM_DETAIL_ASSERT(compiled_);
+    HADESMEM_DETAIL_ASSERT(done.size() == patterns_.size());
+    HADESMEM_DETAIL_ASSERT(h_beg <= h_end);
+
+    std::size_t remaining = 0;
+    for (std::size_t id = 0; id < done.size(); ++id)
+    {
+      remaining += !done[id];
+    }
+
+    for (std::size_t i = 0; i < searches_.size(); ++i)
+    {
+      auto const id = search_ids_[i];
+      if (done[id])
+      {
+        continue;
+      }
+
+      auto const& search = searches_[i];
+      auto h_cur = h_beg;
+      while (auto const match = search.Search(h_cur, h_end))
+      {
+        if (callback(id, match))
+        {
+          done[id] = true;
+          --remaining;
+          break;
+        }
+
+        h_cur = match + 1;
+      }
+    }
+
+    if (!remaining || !num_filtered_)
+    {
+      return;
+    }
+
+    if (fold_case_)
+    {
+      SearchFiltered<true>(h_beg, h_end, done, remaining, callback);
+    }
+    else
+    {
+      SearchFiltered<false>(h_beg, h_end, done, remaining, callback);
+    }
+  }
+
+private:
+  static std::size_t const kAlphabetSize = 0x100;
+
+  struct PatternInfo
+  {
+    std::vector<PatternDataByte> needle;
+    PatternAnchor anchor;
+  };
+
+  void AddFilteredPattern(std::size_t id)
+  {
+    auto const& info = patterns_[id];
+    std::uint8_t const pair[2] = {
+      fold_table_[info.needle[info.anchor.offset].value],
+      fold_table_[info.needle[info.anchor.offset + 1].value]};
+    // The vectorized filter looks at the raw haystack bytes, so every byte
+    // which folds to the pair bytes has to be let through.
+    for (std::size_t j = 0; j < 2; ++j)
+    {
+      for (std::size_t c = 0; c < kAlphabetSize; ++c)
+      {
+        if (fold_table_[c] == pair[j])
+        {
+          byte_sets_[j * 32 + (c >> 7) * 16 + (c & 0xF)] |=
+            static_cast<std::uint8_t>(1U << ((c >> 4) & 0x7));
+        }
+      }
+    }
+
+    std::size_t const key = static_cast<std::size_t>(pair[0]) |
+                            (static_cast<std::size_t>(pair[1]) << 8);
+    bitmap_[key / 64] |= 1ULL << (key % 64);
+
+    std::size_t node = 0;
+    for (std::size_t i = 0; i < info.anchor.length; ++i)
+    {
+      std::uint8_t const c =
+        fold_table_[info.needle[info.anchor.offset + i].value];
+      std::uint32_t next = trie_[node * kAlphabetSize + c];
+      if (!next)
+      {
+        next = static_cast<std::uint32_t>(outputs_.size());
+        trie_[node * kAlphabetSize + c] = next;
+        trie_.resize(trie_.size() + kAlphabetSize, 0);
+        outputs_.emplace_back();
+      }
+      node = next;
+    }
+
+    outputs_[node].push_back(id);
+    ++num_filtered_;
+  }
+
+  // Relative frequency of each byte, going by the same ranking the anchors
+  // are picked with.
+  static std::uint64_t GetByteWeight(std::size_t c) noexcept
+  {
+    return 1ULL << GetByteFrequencyRank(static_cast<std::uint8_t>(c));
+  }
+
+  // Patterns without a pair sort last.
+  std::uint32_t GetPairRank(std::size_t id) const noexcept
+  {
+    auto const& info = patterns_[id];
+    if (info.anchor.length < 2)
+    {
+      return 0xFFFFFFFF;
+    }
+
+    return GetByteFrequencyRank(info.needle[info.anchor.offset].value) +
+           GetByteFrequencyRank(info.needle[info.anchor.offset + 1].value);
+  }
+
+  template <bool FoldCaseT>
+  std::uint8_t Fold(std::uint8_t c) const noexcept
+  {
+    return FoldCaseT ? fold_table_[c] : c;
+  }
+
+  template <bool FoldCaseT>
+  bool IsCandidate(std::uint8_t const* h_cur) const noexcept
+  {
+    std::size_t const key =
+      static_cast<std::size_t>(Fold<FoldCaseT>(h_cur[0])) |
+      (static_cast<std::size_t>(Fold<FoldCaseT>(h_cur[1])) << 8);
+    return !!((bitmap_[key / 64] >> (key % 64)) & 1);
+  }
+
+  // Looks up the anchors starting at h_cur and verifies their needles.
+  template <bool FoldCaseT, typename Callback>
+  void VisitCandidate(std::uint8_t const* h_cur,
+                      std::uint8_t const* h_beg,
+                      std::uint8_t const* h_end,
+                      std::vector<bool>& done,
+                      std::size_t& remaining,
+                      Callback& callback) const
+  {
+    std::size_t const h_len = static_cast<std::size_t>(h_end - h_cur);
+    std::size_t const max_len = h_len < kMaxAnchorLen ? h_len : kMaxAnchorLen;
+    std::size_t node = 0;
+    for (std::size_t i = 0; i < max_len; ++i)
+    {
+      node = trie_[node * kAlphabetSize + Fold<FoldCaseT>(h_cur[i])];
+      if (!node)
+      {
+        return;
+      }
+
+      for (auto const id : outputs_[node])
+      {
+        auto const& info = patterns_[id];
+        if (done[id] ||
+            static_cast<std::size_t>(h_cur - h_beg) < info.anchor.offset)
+        {
+          continue;
+        }
+
+        auto const match = h_cur - info.anchor.offset;
+        if (static_cast<std::size_t>(h_end - match) >= info.needle.size() &&
+            MatchPatternAt(
+              match, std::begin(info.needle), std::end(info.needle)) &&
+            callback(id, match))
+        {
+          done[id] = true;
+          --remaining;
+        }
+      }
+    }
+  }
+
+  template <bool FoldCaseT, typename Callback>
+  void SearchFiltered(std::uint8_t const* h_beg,
+                      std::uint8_t const* h_end,
+                      std::vector<bool>& done,
+                      std::size_t& remaining,
+                      Callback& callback) const
+  {
+    if (h_end - h_beg < 2)
+    {
+      return;
+    }
+
+    // Last position with a pair of bytes to look at.
+    std::uint8_t const* const h_last = h_end - 2;
+    std::uint8_t const* h_cur = h_beg;
+
+#if defined(HADESMEM_DETAIL_SIMD_AVX2)
+    if (IsAvx2Supported())
+    {
+      SearchAvx2<FoldCaseT>(
+        h_cur, h_last, h_beg, h_end, done, remaining, callback);
+    }
+#endif // #if defined(HADESMEM_DETAIL_SIMD_AVX2)
+
+    for (; h_cur <= h_last && remaining; ++h_cur)
+    {
+      if (IsCandidate<FoldCaseT>(h_cur))
+      {
+        VisitCandidate<FoldCaseT>(
+          h_cur, h_beg, h_end, done, remaining, callback);
+      }
+    }
+  }
+
+#if defined(HADESMEM_DETAIL_SIMD_AVX2)
+  // Tests each byte of the block against one of the byte sets, leaving a
+  // non-zero byte wherever it is in the set.
+  static HADESMEM_DETAIL_TARGET_AVX2 __m256i
+    TestByteSetAvx2(__m256i block, __m256i set_lo, __m256i set_hi) noexcept
+  {
+    __m256i const low_nibbles = _mm256_set1_epi8(0x0F);
+    __m256i const bits = _mm256_setr_epi8(1,
+                                          2,
+                                          4,
+                                          8,
+                                          16,
+                                          32,
+                                          64,
+                                          -128,
+                                          1,
+                                          2,
+                                          4,
+                                          8,
+                                          16,
+                                          32,
+                                          64,
+                                          -128,
+                                          1,
+                                          2,
+                                          4,
+                                          8,
+                                          16,
+                                          32,
+                                          64,
+                                          -128,
+                                          1,
+                                          2,
+                                          4,
+                                          8,
+                                          16,
+                                          32,
+                                          64,
+                                          -128);
+    __m256i const lo = _mm256_and_si256(block, low_nibbles);
+    __m256i const hi =
+      _mm256_and_si256(_mm256_srli_epi16(block, 4), low_nibbles);
+    // The top bit of each byte picks the half of the set to look in.
+    __m256i const row = _mm256_blendv_epi8(_mm256_shuffle_epi8(set_lo, lo),
+                                           _mm256_shuffle_epi8(set_hi, lo),
+                                           block);
+    return _mm256_and_si256(row, _mm256_shuffle_epi8(bits, hi));
+  }
+
+  // Tests blocks of positions against the sets of first and second anchor
+  // bytes (the positions which pass still have to be checked against the
+  // bitmap) and leaves h_cur at the first position it did not test.
+  template <bool FoldCaseT, typename Callback>
+  HADESMEM_DETAIL_TARGET_AVX2 void
+    SearchAvx2(std::uint8_t const*& h_cur,
+               std::uint8_t const* h_last,
+               std::uint8_t const* h_beg,
+               std::uint8_t const* h_end,
+               std::vector<bool>& done,
+               std::size_t& remaining,
+               Callback& callback) const
+  {
+    auto const sets = reinterpret_cast<__m128i const*>(byte_sets_.data());
+    __m256i const set_0_lo =
+      _mm256_broadcastsi128_si256(_mm_loadu_si128(sets));
+    __m256i const set_0_hi =
+      _mm256_broadcastsi128_si256(_mm_loadu_si128(sets + 1));
+    __m256i const set_1_lo =
+      _mm256_broadcastsi128_si256(_mm_loadu_si128(sets + 2));
+    __m256i const set_1_hi =
+      _mm256_broadcastsi128_si256(_mm_loadu_si128(sets + 3));
+    __m256i const zero = _mm256_setzero_si256();
+    for (; h_last - h_cur >= 31 && remaining; h_cur += 32)
+    {
+      __m256i const block_0 =
+        _mm256_loadu_si256(reinterpret_cast<__m256i const*>(h_cur));
+      __m256i const block_1 =
+        _mm256_loadu_si256(reinterpret_cast<__m256i const*>(h_cur + 1));
+      __m256i const miss = _mm256_or_si256(
+        _mm256_cmpeq_epi8(TestByteSetAvx2(block_0, set_0_lo, set_0_hi), zero),
+        _mm256_cmpeq_epi8(TestByteSetAvx2(block_1, set_1_lo, set_1_hi),
+                          zero));
+      auto mask = ~static_cast<std::uint32_t>(_mm256_movemask_epi8(miss));
+      for (; mask; mask &= mask - 1)
+      {
+        std::uint8_t const* const candidate = h_cur + CountTrailingZeros(mask);
+        if (IsCandidate<FoldCaseT>(candidate))
+        {
+          VisitCandidate<FoldCaseT>(
+            candidate, h_beg, h_end, done, remaining, callback);
+        }
+      }
+    }
+  }
+#endif // #if defined(HADESMEM_DETAIL_SIMD_AVX2)
+
+  std::vector<PatternInfo> patterns_;
+  bool fold_case_;
+  std::array<std::uint8_t, kAlphabetSize> fold_table_;
+  // Child nodes of each node (zero if there is none), indexed by node and
+  // then by (folded) byte. Node zero is the root.
+  std::vector<std::uint32_t> trie_;
+  // The patterns whose anchor ends at each node.
+  std::vector<std::vector<std::size_t>> outputs_;
+  // One bit for each (folded) pair of anchor start bytes.
+  std::vector<std::uint64_t> bitmap_;
+  // The sets of first and second anchor start bytes. Each is indexed by the
+  // low nibble of the byte, with one bit for each possible high nibble (the
+  // first 16 entries for bytes below 0x80, the next 16 for the rest).
+  std::array<std::uint8_t, 64> byte_sets_;
+  std::vector<PatternSearch> searches_;
+  std::vector<std::size_t> search_ids_;
+  std::size_t num_filtered_{0};
+  bool compiled_{false};
+};
+}
+}
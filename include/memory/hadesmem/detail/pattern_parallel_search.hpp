@@ -0,0 +1,207 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/parallel_for.hpp>
+#include <hadesmem/detail/pattern_multi_search.hpp>
+#include <hadesmem/detail/pattern_search.hpp>
+
+// Like the other pattern search cores, this only operates on local buffers and
+// must not depend on windows.h.
+
+namespace hadesmem
+{
+namespace detail
+{
+// Chunks are handed out to the workers one at a time, so they need to be big
+// enough to amortize that but small enough to balance the load.
+std::size_t const kParallelSearchChunkSize = 1024 * 1024;
+
+// Calls callback(index, thread, c_beg, c_end) for each chunk of the haystack
+// on num_threads threads using ParallelFor (see there for 'thread'). Chunks
+// overlap by 'overlap' bytes (the longest needle length minus one, so no match
+// can straddle two chunks). Once a callback returns true, chunks with a higher
+// index are skipped, but every chunk with a lower index is still guaranteed to
+// be processed. The haystack pointers are only used for arithmetic, so they
+// can also refer to memory in another process which the callback reads itself.
+template <typename Pointer, typename ChunkCallback>
+void ParallelForEachChunk(Pointer h_beg,
+                          Pointer h_end,
+                          std::size_t overlap,
+                          std::size_t chunk_size,
+                          std::size_t num_threads,
+                          ChunkCallback callback)
+{
+  HADESMEM_DETAIL_ASSERT(h_beg <= h_end);
+  HADESMEM_DETAIL_ASSERT(chunk_size != 0);
+
+  auto const h_len = static_cast<std::size_t>(h_end - h_beg);
+  std::size_t const num_chunks = (h_len + chunk_size - 1) / chunk_size;
+  std::atomic<std::size_t> stop_chunk{num_chunks};
+  ParallelFor(num_chunks,
+              num_threads,
+              [&](std::size_t i, std::size_t thread)
+              {
+                if (i >= stop_chunk.load())
+                {
+                  return;
+                }
+
+                Pointer const c_beg = h_beg + i * chunk_size;
+                Pointer const c_end =
+                  h_beg + (std::min)(h_len, (i + 1) * chunk_size + overlap);
+                if (callback(i, thread, c_beg, c_end))
+                {
+                  std::size_t cur = stop_chunk.load();
+                  while (i + 1 < cur &&
+                         !stop_chunk.compare_exchange_weak(cur, i + 1))
+                  {
+                  }
+                }
+              });
+}
+
+// Parallel equivalent of PatternSearch::Search. Always returns the lowest
+// match, regardless of the order in which the chunks complete.
+inline std::uint8_t const*
+  ParallelPatternSearch(PatternSearch const& search,
+                        std::uint8_t const* h_beg,
+                        std::uint8_t const* h_end,
+                        std::size_t chunk_size,
+                        std::size_t num_threads)
+{
+  auto const h_len = static_cast<std::size_t>(h_end - h_beg);
+  if (num_threads < 2 || h_len <= chunk_size)
+  {
+    return search.Search(h_beg, h_end);
+  }
+
+  std::vector<std::uint8_t const*> matches((h_len + chunk_size - 1) /
+                                           chunk_size);
+  ParallelForEachChunk(
+    h_beg,
+    h_end,
+    search.GetNeedleLength() - 1,
+    chunk_size,
+    num_threads,
+    [&](std::size_t i,
+        std::size_t /*thread*/,
+        std::uint8_t const* c_beg,
+        std::uint8_t const* c_end)
+    {
+      matches[i] = search.Search(c_beg, c_end);
+      return matches[i] != nullptr;
+    });
+
+  auto const match = std::find_if(std::begin(matches),
+                                  std::end(matches),
+                                  [](std::uint8_t const* m)
+                                  {
+                                    return m != nullptr;
+                                  });
+  return match != std::end(matches) ? *match : nullptr;
+}
+
+// Parallel equivalent of MultiPatternSearch::Search. The predicate
+// accept(id, match) decides whether a match counts (e.g. because it is before
+// a custom start address) and is called concurrently, so it must not have side
+// effects. Accepted matches are stored in 'matches' and flagged in 'done'.
+// The result is always the lowest accepted match for each pattern.
+template <typename Predicate>
+void ParallelMultiPatternSearch(MultiPatternSearch const& search,
+                                std::uint8_t const* h_beg,
+                                std::uint8_t const* h_end,
+                                std::vector<bool>& done,
+                                std::vector<std::uint8_t const*>& matches,
+                                Predicate accept,
+                                std::size_t chunk_size,
+                                std::size_t num_threads)
+{
+  HADESMEM_DETAIL_ASSERT(done.size() == search.GetNumPatterns());
+
+  matches.resize(search.GetNumPatterns());
+
+  auto const h_len = static_cast<std::size_t>(h_end - h_beg);
+  if (num_threads < 2 || h_len <= chunk_size)
+  {
+    search.Search(h_beg,
+                  h_end,
+                  done,
+                  [&](std::size_t id, std::uint8_t const* match)
+                  {
+                    if (!accept(id, match))
+                    {
+                      return false;
+                    }
+
+                    matches[id] = match;
+                    return true;
+                  });
+    return;
+  }
+
+  std::size_t max_needle_len = 1;
+  for (std::size_t id = 0; id < search.GetNumPatterns(); ++id)
+  {
+    max_needle_len = (std::max)(max_needle_len, search.GetNeedleLength(id));
+  }
+
+  // Everything is allocated up front so the workers can't throw.
+  std::size_t const num_chunks = (h_len + chunk_size - 1) / chunk_size;
+  std::vector<std::vector<std::uint8_t const*>> chunk_matches(
+    num_chunks, std::vector<std::uint8_t const*>(done.size()));
+  std::vector<std::vector<bool>> chunk_dones(num_chunks, done);
+  ParallelForEachChunk(
+    h_beg,
+    h_end,
+    max_needle_len - 1,
+    chunk_size,
+    num_threads,
+    [&](std::size_t i,
+        std::size_t /*thread*/,
+        std::uint8_t const* c_beg,
+        std::uint8_t const* c_end)
+    {
+      auto& cur_matches = chunk_matches[i];
+      auto& chunk_done = chunk_dones[i];
+      search.Search(c_beg,
+                    c_end,
+                    chunk_done,
+                    [&](std::size_t id, std::uint8_t const* match)
+                    {
+                      if (!accept(id, match))
+                      {
+                        return false;
+                      }
+
+                      cur_matches[id] = match;
+                      return true;
+                    });
+      // No later chunk can improve on a chunk which matched everything.
+      return std::find(std::begin(chunk_done), std::end(chunk_done), false) ==
+             std::end(chunk_done);
+    });
+
+  // Chunks which were skipped have no matches, so they're harmless here.
+  for (auto const& cur_matches : chunk_matches)
+  {
+    for (std::size_t id = 0; id < done.size(); ++id)
+    {
+      if (!done[id] && cur_matches[id])
+      {
+        matches[id] = cur_matches[id];
+        done[id] = true;
+      }
+    }
+  }
+}
+}
+}
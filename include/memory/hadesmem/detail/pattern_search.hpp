@@ -0,0 +1,285 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/pattern_data.hpp>
+#include <hadesmem/detail/simd.hpp>
+
+namespace hadesmem
+{
+namespace detail
+{
+// Rough ranking of how common a byte is in x86/x64 code and data (higher is
+// more common). Anything not listed is assumed to be rare.
+inline std::uint32_t GetByteFrequencyRank(std::uint8_t value) noexcept
+{
+  switch (value)
+  {
+  case 0x00:
+    return 8;
+  case 0xFF:
+  case 0xCC:
+    return 7;
+  case 0x48:
+  case 0x8B:
+  case 0x89:
+    return 6;
+  case 0x90:
+  case 0x24:
+  case 0x4C:
+  case 0x0F:
+  case 0xE8:
+  case 0x83:
+  case 0x8D:
+  case 0x01:
+    return 5;
+  case 0x44:
+  case 0x85:
+  case 0x74:
+  case 0x75:
+  case 0xC3:
+  case 0xC0:
+  case 0x45:
+  case 0x4D:
+  case 0x08:
+  case 0x10:
+  case 0x20:
+  case 0x40:
+  case 0x04:
+  case 0x02:
+  case 0x03:
+    return 4;
+  case 0x33:
+  case 0x49:
+  case 0xEB:
+  case 0x50:
+  case 0x5C:
+  case 0x30:
+  case 0x18:
+  case 0x28:
+  case 0x38:
+  case 0x80:
+  case 0xF8:
+  case 0xFE:
+    return 3;
+  default:
+    return (value >= 0x20 && value < 0x7F) ? 2 : 1;
+  }
+}
+
+// Nibble wildcards match 16 different bytes, so we have no idea how common
+// they are. Prefer any exact byte over them.
+inline std::uint32_t GetByteFrequencyRank(PatternDataByte const& b) noexcept
+{
+  return IsExact(b) ? GetByteFrequencyRank(b.value) : 9;
+}
+
+// Single pattern search over a local buffer. Scans for the two rarest
+// non-wildcard bytes of the needle using a masked compare (with SSE2/AVX2
+// where available) and only verifies the full needle at the candidate
+// offsets.
+class PatternSearch
+{
+public:
+  template <typename NeedleIterator>
+  explicit PatternSearch(NeedleIterator n_beg, NeedleIterator n_end)
+    : needle_(n_beg, n_end)
+  {
+    HADESMEM_DETAIL_ASSERT(!needle_.empty());
+
+    for (std::size_t i = 0; i < needle_.size(); ++i)
+    {
+      if (IsWildcard(needle_[i]))
+      {
+        continue;
+      }
+
+      std::uint32_t const rank = GetByteFrequencyRank(needle_[i]);
+      if (!num_anchors_ || rank < GetByteFrequencyRank(needle_[anchor_1_]))
+      {
+        anchor_2_ = anchor_1_;
+        anchor_1_ = i;
+      }
+      else if (num_anchors_ == 1 ||
+               rank < GetByteFrequencyRank(needle_[anchor_2_]))
+      {
+        anchor_2_ = i;
+      }
+
+      ++num_anchors_;
+    }
+
+    if (num_anchors_ == 1)
+    {
+      anchor_2_ = anchor_1_;
+    }
+  }
+
+  std::size_t GetNeedleLength() const noexcept
+  {
+    return needle_.size();
+  }
+
+  std::vector<PatternDataByte> const& GetNeedle() const noexcept
+  {
+    return needle_;
+  }
+
+  // Returns nullptr if there is no match.
+  std::uint8_t const* Search(std::uint8_t const* h_beg,
+                             std::uint8_t const* h_end) const
+  {
+    HADESMEM_DETAIL_ASSERT(h_beg <= h_end);
+
+    if (static_cast<std::size_t>(h_end - h_beg) < needle_.size())
+    {
+      return nullptr;
+    }
+
+    if (!num_anchors_)
+    {
+      return h_beg;
+    }
+
+    // Last valid starting position for a match.
+    std::uint8_t const* const h_last = h_end - needle_.size();
+    std::uint8_t const* h_cur = h_beg;
+
+#if defined(HADESMEM_DETAIL_SIMD_AVX2)
+    if (IsAvx2Supported())
+    {
+      if (auto const match = SearchAvx2(h_cur, h_last))
+      {
+        return match;
+      }
+    }
+#endif // #if defined(HADESMEM_DETAIL_SIMD_AVX2)
+
+#if defined(HADESMEM_DETAIL_SIMD_SSE2)
+    if (auto const match = SearchSse2(h_cur, h_last))
+    {
+      return match;
+    }
+#endif // #if defined(HADESMEM_DETAIL_SIMD_SSE2)
+
+    return SearchScalar(h_cur, h_last);
+  }
+
+private:
+  bool IsMatch(std::uint8_t const* h_cur) const noexcept
+  {
+    return MatchPatternAt(h_cur, std::begin(needle_), std::end(needle_));
+  }
+
+  // The vectorized searches test blocks of candidate starting positions and
+  // leave h_cur at the first position they did not test.
+
+  std::uint8_t const* SearchScalar(std::uint8_t const*& h_cur,
+                                   std::uint8_t const* h_last) const noexcept
+  {
+    auto const& anchor_1 = needle_[anchor_1_];
+    auto const& anchor_2 = needle_[anchor_2_];
+    for (; h_cur <= h_last; ++h_cur)
+    {
+      if ((h_cur[anchor_1_] & anchor_1.mask) == anchor_1.value &&
+          (h_cur[anchor_2_] & anchor_2.mask) == anchor_2.value &&
+          IsMatch(h_cur))
+      {
+        return h_cur;
+      }
+    }
+
+    return nullptr;
+  }
+
+#if defined(HADESMEM_DETAIL_SIMD_SSE2)
+  std::uint8_t const* SearchSse2(std::uint8_t const*& h_cur,
+                                 std::uint8_t const* h_last) const noexcept
+  {
+    __m128i const value_1 =
+      _mm_set1_epi8(static_cast<char>(needle_[anchor_1_].value));
+    __m128i const mask_1 =
+      _mm_set1_epi8(static_cast<char>(needle_[anchor_1_].mask));
+    __m128i const value_2 =
+      _mm_set1_epi8(static_cast<char>(needle_[anchor_2_].value));
+    __m128i const mask_2 =
+      _mm_set1_epi8(static_cast<char>(needle_[anchor_2_].mask));
+    for (; h_last - h_cur >= 15; h_cur += 16)
+    {
+      __m128i const block_1 =
+        _mm_loadu_si128(reinterpret_cast<__m128i const*>(h_cur + anchor_1_));
+      __m128i const block_2 =
+        _mm_loadu_si128(reinterpret_cast<__m128i const*>(h_cur + anchor_2_));
+      __m128i const eq_1 =
+        _mm_cmpeq_epi8(_mm_and_si128(block_1, mask_1), value_1);
+      __m128i const eq_2 =
+        _mm_cmpeq_epi8(_mm_and_si128(block_2, mask_2), value_2);
+      auto mask = static_cast<std::uint32_t>(
+        _mm_movemask_epi8(_mm_and_si128(eq_1, eq_2)));
+      for (; mask; mask &= mask - 1)
+      {
+        std::uint8_t const* const candidate = h_cur + CountTrailingZeros(mask);
+        if (IsMatch(candidate))
+        {
+          return candidate;
+        }
+      }
+    }
+
+    return nullptr;
+  }
+#endif // #if defined(HADESMEM_DETAIL_SIMD_SSE2)
+
+#if defined(HADESMEM_DETAIL_SIMD_AVX2)
+  HADESMEM_DETAIL_TARGET_AVX2 std::uint8_t const*
+    SearchAvx2(std::uint8_t const*& h_cur,
+               std::uint8_t const* h_last) const noexcept
+  {
+    __m256i const value_1 =
+      _mm256_set1_epi8(static_cast<char>(needle_[anchor_1_].value));
+    __m256i const mask_1 =
+      _mm256_set1_epi8(static_cast<char>(needle_[anchor_1_].mask));
+    __m256i const value_2 =
+      _mm256_set1_epi8(static_cast<char>(needle_[anchor_2_].value));
+    __m256i const mask_2 =
+      _mm256_set1_epi8(static_cast<char>(needle_[anchor_2_].mask));
+    for (; h_last - h_cur >= 31; h_cur += 32)
+    {
+      __m256i const block_1 = _mm256_loadu_si256(
+        reinterpret_cast<__m256i const*>(h_cur + anchor_1_));
+      __m256i const block_2 = _mm256_loadu_si256(
+        reinterpret_cast<__m256i const*>(h_cur + anchor_2_));
+      __m256i const eq_1 =
+        _mm256_cmpeq_epi8(_mm256_and_si256(block_1, mask_1), value_1);
+      __m256i const eq_2 =
+        _mm256_cmpeq_epi8(_mm256_and_si256(block_2, mask_2), value_2);
+      auto mask = static_cast<std::uint32_t>(
+        _mm256_movemask_epi8(_mm256_and_si256(eq_1, eq_2)));
+      for (; mask; mask &= mask - 1)
+      {
+        std::uint8_t const* const candidate = h_cur + CountTrailingZeros(mask);
+        if (IsMatch(candidate))
+        {
+          return candidate;
+        }
+      }
+    }
+
+    return nullptr;
+  }
+#endif // #if defined(HADESMEM_DETAIL_SIMD_AVX2)
+
+  std::vector<PatternDataByte> needle_;
+  std::size_t num_anchors_{0};
+  std::size_t anchor_1_{0};
+  std::size_t anchor_2_{0};
+};
+}
+}
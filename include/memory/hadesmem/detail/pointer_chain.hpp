@@ -0,0 +1,181 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/read_batch.hpp>
+
+// Pointer chain walking core used by PointerChain. Chains are walked in
+// lockstep, one level at a time, so that every level's reads across all of
+// the chains go through a single read batch. Like the scanning cores, this
+// must not depend on windows.h.
+
+namespace hadesmem
+{
+namespace detail
+{
+// The chain resolves to the address obtained by starting at base and, for
+// each offset, reading a pointer from the current address and adding the
+// offset to it.
+struct PointerChainState
+{
+  std::uintptr_t base;
+  std::vector<std::ptrdiff_t> offsets;
+  // values[i] is the pointer read at level i.
+  std::vector<std::uintptr_t> values;
+  // Whether values are from a previous walk, and so can be checked with a
+  // single batch instead of walked again level by level.
+  bool cached;
+};
+
+inline std::uintptr_t GetPointerChainAddress(PointerChainState const& chain,
+                                             std::size_t level) noexcept
+{
+  HADESMEM_DETAIL_ASSERT(level <= chain.offsets.size());
+  // Negative offsets wrap around, as they would with pointer arithmetic.
+  return level ? chain.values[level - 1] +
+                   static_cast<std::uintptr_t>(chain.offsets[level - 1])
+               : chain.base;
+}
+
+// Sets results[i] to the address chain i resolves to, or zero if a read
+// failed or a null pointer was read. read(address, buf, len) returns whether
+// the read succeeded. Cached chains are checked first, and are only walked
+// again from the first level whose pointer changed. Chains are left cached if
+// they were resolved.
+template <typename ReadFunc>
+void ResolvePointerChainStates(std::vector<PointerChainState*> const& chains,
+                               std::size_t max_gap,
+                               std::vector<std::uintptr_t>& results,
+                               ReadFunc read)
+{
+  std::size_t const npos = static_cast<std::size_t>(-1);
+  std::vector<std::size_t> next(chains.size());
+  std::vector<ReadBatchRequest> requests;
+  std::vector<std::size_t> order;
+  std::vector<ReadBatchSpan> spans;
+  std::vector<std::uint8_t> buf;
+  std::vector<std::uint8_t> valid;
+
+  std::vector<std::size_t> fresh_offsets(chains.size());
+  std::size_t fresh_size = 0;
+  for (std::size_t i = 0; i < chains.size(); ++i)
+  {
+    auto& chain = *chains[i];
+    chain.values.resize(chain.offsets.size());
+    fresh_offsets[i] = fresh_size;
+    if (chain.cached)
+    {
+      fresh_size += chain.offsets.size();
+    }
+  }
+
+  // Check the cached chains. Their addresses are all known up front, so this
+  // only takes one batch.
+  std::vector<std::uintptr_t> fresh(fresh_size);
+  for (std::size_t i = 0; i < chains.size(); ++i)
+  {
+    auto const& chain = *chains[i];
+    for (std::size_t j = 0; chain.cached && j < chain.offsets.size(); ++j)
+    {
+      requests.push_back(ReadBatchRequest{
+        reinterpret_cast<std::uint8_t*>(GetPointerChainAddress(chain, j)),
+        reinterpret_cast<std::uint8_t*>(&fresh[fresh_offsets[i] + j]),
+        sizeof(std::uintptr_t)});
+    }
+  }
+
+  PlanReadBatch(requests, max_gap, order, spans);
+  ExecuteReadBatch(requests, order, spans, buf, valid, read);
+
+  // Requests were added in the same order as fresh was laid out.
+  for (std::size_t i = 0; i < chains.size(); ++i)
+  {
+    auto& chain = *chains[i];
+    if (!chain.cached)
+    {
+      continue;
+    }
+
+    std::size_t const first = fresh_offsets[i];
+    std::size_t const num_levels = chain.offsets.size();
+    std::size_t level = 0;
+    while (level < num_levels && valid[first + level] &&
+           fresh[first + level] == chain.values[level])
+    {
+      ++level;
+    }
+
+    if (level == num_levels)
+    {
+      next[i] = num_levels;
+    }
+    else if (valid[first + level] && fresh[first + level])
+    {
+      // Everything up to here is unchanged, so the address this was read
+      // from is still right.
+      chain.values[level] = fresh[first + level];
+      next[i] = level + 1;
+    }
+    else
+    {
+      next[i] = npos;
+    }
+  }
+
+  // Walk everything else in lockstep.
+  std::vector<std::size_t> active;
+  for (;;)
+  {
+    requests.clear();
+    active.clear();
+    for (std::size_t i = 0; i < chains.size(); ++i)
+    {
+      auto& chain = *chains[i];
+      if (next[i] == npos || next[i] == chain.offsets.size())
+      {
+        continue;
+      }
+
+      auto const address = GetPointerChainAddress(chain, next[i]);
+      requests.push_back(ReadBatchRequest{
+        reinterpret_cast<std::uint8_t*>(address),
+        reinterpret_cast<std::uint8_t*>(&chain.values[next[i]]),
+        sizeof(std::uintptr_t)});
+      active.push_back(i);
+    }
+
+    if (requests.empty())
+    {
+      break;
+    }
+
+    PlanReadBatch(requests, max_gap, order, spans);
+    ExecuteReadBatch(requests, order, spans, buf, valid, read);
+
+    for (std::size_t j = 0; j < active.size(); ++j)
+    {
+      std::size_t const i = active[j];
+      bool const succeeded = valid[j] && chains[i]->values[next[i]];
+      next[i] = succeeded ? next[i] + 1 : npos;
+    }
+  }
+
+  results.assign(chains.size(), 0);
+  for (std::size_t i = 0; i < chains.size(); ++i)
+  {
+    auto& chain = *chains[i];
+    chain.cached = next[i] != npos;
+    if (chain.cached)
+    {
+      results[i] = GetPointerChainAddress(chain, chain.offsets.size());
+    }
+  }
+}
+}
+}
@@ -0,0 +1,545 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <iterator>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/parallel_for.hpp>
+
+// Reverse pointer map used by the pointer scanner. Every pointer sized value
+// in the scanned regions which points into one of them is recorded, sorted by
+// value, so the pointers to any address range can be found with a binary
+// search. Paths are then found by walking backwards from the target until a
+// static (module relative) address is reached.
+
+// Like the other scanning cores, this only operates on local buffers and must
+// not depend on windows.h. Addresses are always stored as 64-bit so that maps
+// can be shared between 32-bit and 64-bit builds.
+
+// Layout (all integers are little endian, strings are a u32 length followed by
+// that many UTF-16 code units):
+//
+// Header:  u8[4] magic, u32 version, u32 pointer_size, u32 num_modules,
+//          u64 num_entries
+// Module:  string name, u64 base, u64 size
+// Entry:   u64 value, u64 address (sorted by value, then address)
+
+namespace hadesmem
+{
+namespace detail
+{
+std::uint8_t const kPointerMapMagic[4] = {'H', 'M', 'P', 'M'};
+std::uint32_t const kPointerMapVersion = 1;
+
+// Entries are serialized in blocks of this many.
+std::size_t const kPointerMapBlockSize = 0x10000;
+
+// Longest module name (in characters) accepted when reading, which is the
+// longest path Windows supports. Anything larger is treated as malformed
+// rather than trusted as an allocation size.
+std::uint32_t const kPointerMapMaxNameLength = 0x7FFF;
+
+struct PointerMapEntry
+{
+  std::uint64_t value;
+  std::uint64_t address;
+};
+
+inline bool operator<(PointerMapEntry const& lhs,
+                      PointerMapEntry const& rhs) noexcept
+{
+  return lhs.value < rhs.value ||
+         (lhs.value == rhs.value && lhs.address < rhs.address);
+}
+
+struct PointerMapModule
+{
+  std::wstring name;
+  std::uint64_t base;
+  std::uint64_t size;
+};
+
+// A path from a static address to the target. The pointer at module base +
+// rva is read, then each offset but the last is added and the pointer there is
+// read, and the last offset is added to get the target.
+struct PointerPathData
+{
+  std::size_t module;
+  std::uint64_t rva;
+  std::vector<std::uint64_t> offsets;
+};
+
+// Sorted, non-overlapping [first, second) ranges.
+using PointerMapRanges = std::vector<std::pair<std::uint64_t, std::uint64_t>>;
+
+inline bool IsInPointerMapRanges(PointerMapRanges const& ranges,
+                                 std::uint64_t value) noexcept
+{
+  auto const iter = std::upper_bound(
+    std::begin(ranges),
+    std::end(ranges),
+    value,
+    [](std::uint64_t lhs, std::pair<std::uint64_t, std::uint64_t> const& rhs)
+    {
+      return lhs < rhs.first;
+    });
+  return iter != std::begin(ranges) && value < std::prev(iter)->second;
+}
+
+// Appends an entry for every aligned pointer in the first scan_len bytes of
+// the buffer (which starts at address in the target) which points into one of
+// the ranges.
+template <typename Pointer>
+void CollectPointers(std::uint8_t const* buf,
+                     std::size_t len,
+                     std::size_t scan_len,
+                     std::uint64_t address,
+                     PointerMapRanges const& ranges,
+                     std::vector<PointerMapEntry>& entries)
+{
+  if (ranges.empty())
+  {
+    return;
+  }
+
+  // Most values (small integers, floats, etc.) fall outside the address
+  // space entirely, so reject them before the binary search.
+  std::uint64_t const lo = ranges.front().first;
+  std::uint64_t const hi = ranges.back().second;
+  for (std::size_t offset = 0;
+       offset < scan_len && len - offset >= sizeof(Pointer);
+       offset += sizeof(Pointer))
+  {
+    Pointer value;
+    std::memcpy(&value, buf + offset, sizeof(value));
+    if (value < lo || value >= hi ||
+        !IsInPointerMapRanges(ranges, static_cast<std::uint64_t>(value)))
+    {
+      continue;
+    }
+
+    entries.push_back(
+      PointerMapEntry{static_cast<std::uint64_t>(value), address + offset});
+  }
+}
+
+// Sorts each part and merges them into entries, in parallel. The parts are
+// consumed.
+inline void SortPointerMap(std::vector<std::vector<PointerMapEntry>>& parts,
+                           std::vector<PointerMapEntry>& entries,
+                           std::size_t num_threads)
+{
+  ParallelFor(parts.size(),
+              num_threads,
+              [&](std::size_t i, std::size_t /*thread*/)
+              {
+                std::sort(std::begin(parts[i]), std::end(parts[i]));
+              });
+
+  while (parts.size() > 1)
+  {
+    std::vector<std::vector<PointerMapEntry>> merged((parts.size() + 1) / 2);
+    ParallelFor(merged.size(),
+                num_threads,
+                [&](std::size_t i, std::size_t /*thread*/)
+                {
+                  if (2 * i + 1 == parts.size())
+                  {
+                    merged[i].swap(parts[2 * i]);
+                    return;
+                  }
+
+                  auto& lhs = parts[2 * i];
+                  auto& rhs = parts[2 * i + 1];
+                  merged[i].reserve(lhs.size() + rhs.size());
+                  std::merge(std::begin(lhs),
+                             std::end(lhs),
+                             std::begin(rhs),
+                             std::end(rhs),
+                             std::back_inserter(merged[i]));
+                  std::vector<PointerMapEntry>().swap(lhs);
+                  std::vector<PointerMapEntry>().swap(rhs);
+                });
+    parts.swap(merged);
+  }
+
+  entries.clear();
+  if (!parts.empty())
+  {
+    entries.swap(parts[0]);
+  }
+}
+
+// Entries whose value is in [target - max_offset, target], i.e. pointers to
+// anything which target could be a member of.
+inline std::pair<std::vector<PointerMapEntry>::const_iterator,
+                 std::vector<PointerMapEntry>::const_iterator>
+  FindPointerReferrers(std::vector<PointerMapEntry> const& entries,
+                       std::uint64_t target,
+                       std::uint64_t max_offset) noexcept
+{
+  std::uint64_t const lo = target < max_offset ? 0 : target - max_offset;
+  auto const beg = std::lower_bound(
+    std::begin(entries),
+    std::end(entries),
+    lo,
+    [](PointerMapEntry const& lhs, std::uint64_t rhs)
+    {
+      return lhs.value < rhs;
+    });
+  auto const end = std::upper_bound(
+    beg,
+    std::end(entries),
+    target,
+    [](std::uint64_t lhs, PointerMapEntry const& rhs)
+    {
+      return lhs < rhs.value;
+    });
+  return {beg, end};
+}
+
+// Index of the module containing the address, or the number of modules if
+// there isn't one. Modules must be sorted by base.
+inline std::size_t FindPointerMapModule(
+  std::vector<PointerMapModule> const& modules, std::uint64_t address) noexcept
+{
+  auto const iter = std::upper_bound(
+    std::begin(modules),
+    std::end(modules),
+    address,
+    [](std::uint64_t lhs, PointerMapModule const& rhs)
+    {
+      return lhs < rhs.base;
+    });
+  if (iter == std::begin(modules) ||
+      address - std::prev(iter)->base >= std::prev(iter)->size)
+  {
+    return modules.size();
+  }
+
+  return static_cast<std::size_t>(std::prev(iter) - std::begin(modules));
+}
+
+// Breadth first search backwards from the target, one level per pointer
+// dereference, with each level expanded in parallel. Every address is only
+// expanded once (via the shortest route to it), which keeps cycles and
+// converging paths from blowing up the search. The shortest paths are
+// returned first.
+inline std::vector<PointerPathData>
+  FindPointerPaths(std::vector<PointerMapEntry> const& entries,
+                   std::vector<PointerMapModule> const& modules,
+                   std::uint64_t target,
+                   std::size_t max_depth,
+                   std::uint64_t max_offset,
+                   std::size_t max_results,
+                   std::size_t num_threads)
+{
+  struct Node
+  {
+    std::uint64_t address;
+    std::size_t parent;
+    std::uint64_t offset;
+  };
+
+  struct Found
+  {
+    std::size_t parent;
+    std::size_t module;
+    std::uint64_t address;
+    std::uint64_t offset;
+  };
+
+  std::vector<Node> nodes{
+    Node{target, (std::numeric_limits<std::size_t>::max)(), 0}};
+  std::unordered_set<std::uint64_t> visited{target};
+  std::vector<PointerPathData> paths;
+  std::vector<std::vector<Found>> found(num_threads);
+  std::vector<std::vector<Node>> next(num_threads);
+  std::size_t level_beg = 0;
+  for (std::size_t depth = 1;
+       depth <= max_depth && level_beg != nodes.size() &&
+         paths.size() < max_results;
+       ++depth)
+  {
+    std::size_t const level_end = nodes.size();
+    ParallelFor(
+      level_end - level_beg,
+      num_threads,
+      [&](std::size_t i, std::size_t thread)
+      {
+        std::size_t const index = level_beg + i;
+        Node const& node = nodes[index];
+        auto const range =
+          FindPointerReferrers(entries, node.address, max_offset);
+        for (auto iter = range.first; iter != range.second; ++iter)
+        {
+          std::uint64_t const offset = node.address - iter->value;
+          std::size_t const module =
+            FindPointerMapModule(modules, iter->address);
+          if (module != modules.size())
+          {
+            found[thread].push_back(
+              Found{index, module, iter->address, offset});
+          }
+          else if (depth < max_depth)
+          {
+            next[thread].push_back(Node{iter->address, index, offset});
+          }
+        }
+      });
+
+    for (auto& cur : found)
+    {
+      for (auto const& f : cur)
+      {
+        PointerPathData path{
+          f.module, f.address - modules[f.module].base, {f.offset}};
+        for (std::size_t i = f.parent; nodes[i].parent != nodes[0].parent;
+             i = nodes[i].parent)
+        {
+          path.offsets.push_back(nodes[i].offset);
+        }
+
+        paths.push_back(std::move(path));
+      }
+
+      cur.clear();
+    }
+
+    for (auto& cur : next)
+    {
+      for (auto const& node : cur)
+      {
+        if (visited.insert(node.address).second)
+        {
+          nodes.push_back(node);
+        }
+      }
+
+      cur.clear();
+    }
+
+    level_beg = level_end;
+  }
+
+  // Paths are found in a nondeterministic order within each level.
+  std::sort(std::begin(paths),
+            std::end(paths),
+            [](PointerPathData const& lhs, PointerPathData const& rhs)
+            {
+              if (lhs.offsets.size() != rhs.offsets.size())
+              {
+                return lhs.offsets.size() < rhs.offsets.size();
+              }
+
+              if (lhs.module != rhs.module)
+              {
+                return lhs.module < rhs.module;
+              }
+
+              if (lhs.rva != rhs.rva)
+              {
+                return lhs.rva < rhs.rva;
+              }
+
+              return lhs.offsets < rhs.offsets;
+            });
+  if (paths.size() > max_results)
+  {
+    paths.resize(max_results);
+  }
+
+  return paths;
+}
+
+inline void AppendPointerMapU32(std::vector<std::uint8_t>& buf,
+                                std::uint32_t value)
+{
+  for (std::size_t i = 0; i < sizeof(value); ++i)
+  {
+    buf.push_back(static_cast<std::uint8_t>(value >> (i * 8)));
+  }
+}
+
+inline void AppendPointerMapU64(std::vector<std::uint8_t>& buf,
+                                std::uint64_t value)
+{
+  for (std::size_t i = 0; i < sizeof(value); ++i)
+  {
+    buf.push_back(static_cast<std::uint8_t>(value >> (i * 8)));
+  }
+}
+
+inline std::uint32_t GetPointerMapU32(std::uint8_t const* p) noexcept
+{
+  std::uint32_t value = 0;
+  for (std::size_t i = 0; i < sizeof(value); ++i)
+  {
+    value |= static_cast<std::uint32_t>(p[i]) << (i * 8);
+  }
+
+  return value;
+}
+
+inline std::uint64_t GetPointerMapU64(std::uint8_t const* p) noexcept
+{
+  std::uint64_t value = 0;
+  for (std::size_t i = 0; i < sizeof(value); ++i)
+  {
+    value |= static_cast<std::uint64_t>(p[i]) << (i * 8);
+  }
+
+  return value;
+}
+
+// Returns false if the stream fails.
+inline bool WritePointerMap(std::ostream& out,
+                            std::uint32_t pointer_size,
+                            std::vector<PointerMapModule> const& modules,
+                            std::vector<PointerMapEntry> const& entries)
+{
+  std::vector<std::uint8_t> buf(std::begin(kPointerMapMagic),
+                                std::end(kPointerMapMagic));
+  AppendPointerMapU32(buf, kPointerMapVersion);
+  AppendPointerMapU32(buf, pointer_size);
+  AppendPointerMapU32(buf, static_cast<std::uint32_t>(modules.size()));
+  AppendPointerMapU64(buf, entries.size());
+  for (auto const& module : modules)
+  {
+    AppendPointerMapU32(buf, static_cast<std::uint32_t>(module.name.size()));
+    for (auto const c : module.name)
+    {
+      buf.push_back(static_cast<std::uint8_t>(c));
+      buf.push_back(static_cast<std::uint8_t>(c >> 8));
+    }
+
+    AppendPointerMapU64(buf, module.base);
+    AppendPointerMapU64(buf, module.size);
+  }
+
+  for (std::size_t i = 0; i < entries.size(); i += kPointerMapBlockSize)
+  {
+    std::size_t const end =
+      (std::min)(i + kPointerMapBlockSize, entries.size());
+    for (std::size_t j = i; j < end; ++j)
+    {
+      AppendPointerMapU64(buf, entries[j].value);
+      AppendPointerMapU64(buf, entries[j].address);
+    }
+
+    out.write(reinterpret_cast<char const*>(buf.data()),
+              static_cast<std::streamsize>(buf.size()));
+    buf.clear();
+  }
+
+  if (!buf.empty())
+  {
+    out.write(reinterpret_cast<char const*>(buf.data()),
+              static_cast<std::streamsize>(buf.size()));
+  }
+
+  return !!out;
+}
+
+// Returns false on truncated or malformed data (including entries which
+// aren't sorted, since the searches depend on that).
+inline bool ReadPointerMap(std::istream& in,
+                           std::uint32_t& pointer_size,
+                           std::vector<PointerMapModule>& modules,
+                           std::vector<PointerMapEntry>& entries)
+{
+  std::vector<std::uint8_t> buf;
+  auto const read = [&](std::size_t len)
+  {
+    buf.resize(len);
+    in.read(reinterpret_cast<char*>(buf.data()),
+            static_cast<std::streamsize>(len));
+    return static_cast<std::size_t>(in.gcount()) == len;
+  };
+
+  if (!read(24) || std::memcmp(buf.data(), kPointerMapMagic, 4) ||
+      GetPointerMapU32(&buf[4]) != kPointerMapVersion)
+  {
+    return false;
+  }
+
+  pointer_size = GetPointerMapU32(&buf[8]);
+  std::uint32_t const num_modules = GetPointerMapU32(&buf[12]);
+  std::uint64_t const num_entries = GetPointerMapU64(&buf[16]);
+  if ((pointer_size != 4 && pointer_size != 8) ||
+      num_entries > (std::numeric_limits<std::size_t>::max)())
+  {
+    return false;
+  }
+
+  modules.clear();
+  for (std::uint32_t i = 0; i < num_modules; ++i)
+  {
+    if (!read(4))
+    {
+      return false;
+    }
+
+    std::uint32_t const len = GetPointerMapU32(buf.data());
+    if (len > kPointerMapMaxNameLength || !read(len * std::size_t(2) + 16))
+    {
+      return false;
+    }
+
+    PointerMapModule module;
+    module.name.resize(len);
+    for (std::size_t j = 0; j < len; ++j)
+    {
+      module.name[j] = static_cast<wchar_t>(buf[j * 2] | (buf[j * 2 + 1] << 8));
+    }
+
+    module.base = GetPointerMapU64(&buf[len * std::size_t(2)]);
+    module.size = GetPointerMapU64(&buf[len * std::size_t(2) + 8]);
+    if (!modules.empty() && module.base < modules.back().base)
+    {
+      return false;
+    }
+
+    modules.push_back(std::move(module));
+  }
+
+  entries.clear();
+  for (std::uint64_t i = 0; i < num_entries; i += kPointerMapBlockSize)
+  {
+    std::size_t const count = static_cast<std::size_t>(
+      (std::min)(num_entries - i, std::uint64_t(kPointerMapBlockSize)));
+    if (!read(count * 16))
+    {
+      return false;
+    }
+
+    for (std::size_t j = 0; j < count; ++j)
+    {
+      PointerMapEntry const entry{GetPointerMapU64(&buf[j * 16]),
+                                  GetPointerMapU64(&buf[j * 16 + 8])};
+      if (!entries.empty() && entry < entries.back())
+      {
+        return false;
+      }
+
+      entries.push_back(entry);
+    }
+  }
+
+  return true;
+}
+}
+}
@@ -30,6 +30,11 @@ inline DWORD Protect(Process const& process,
                                     << ErrorCodeWinLast{last_error});
   }
 
+  if (auto const cache = process.GetRegionCache())
+  {
+    cache->Erase(mbi.BaseAddress, mbi.RegionSize);
+  }
+
   return old_protect;
 }
 }
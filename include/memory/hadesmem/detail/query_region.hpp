@@ -76,5 +76,42 @@ inline bool
 {
   return !!(mbi.Protect & PAGE_WRITECOMBINE);
 }
+
+// Like Query, but uses the region cache of the process if it's enabled.
+// Cached regions are only returned if they can be accessed as-is, so they are
+// never used to decide what to reprotect. cached is set if the region came
+// from the cache, in which case it may be out of date, and the caller should
+// invalidate the cache and query again if accessing it fails.
+inline MEMORY_BASIC_INFORMATION
+  QueryCached(Process const& process,
+              LPCVOID address,
+              bool (*can_access)(MEMORY_BASIC_INFORMATION const&),
+              bool& cached)
+{
+  cached = false;
+
+  auto const cache = process.GetRegionCache();
+  if (!cache)
+  {
+    return Query(process, address);
+  }
+
+  MEMORY_BASIC_INFORMATION mbi{};
+  if (cache->Find(address, mbi) && can_access(mbi) && !IsBadProtect(mbi))
+  {
+    cached = true;
+    return mbi;
+  }
+
+  // Regions which can't be used from the cache aren't worth caching.
+  auto const generation = cache->GetGeneration();
+  mbi = Query(process, address);
+  if (can_access(mbi) && !IsBadProtect(mbi))
+  {
+    cache->Insert(mbi.BaseAddress, mbi.RegionSize, mbi, generation);
+  }
+
+  return mbi;
+}
 }
 }
@@ -0,0 +1,147 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+#include <hadesmem/detail/assert.hpp>
+
+// Planning and scattering core used by ReadBatch. Requests are sorted and
+// merged into spans so that each span can be read with a single call. Like
+// the scanning cores, this must not depend on windows.h.
+
+namespace hadesmem
+{
+namespace detail
+{
+struct ReadBatchRequest
+{
+  std::uint8_t* address;
+  std::uint8_t* data;
+  std::size_t size;
+};
+
+struct ReadBatchSpan
+{
+  std::uint8_t* address;
+  std::size_t size;
+  // Range of the plan order covered by the span.
+  std::size_t first;
+  std::size_t last;
+  // Set once the span has failed to read as a whole.
+  bool split;
+};
+
+// Requests which are at most max_gap bytes apart (or overlap) are merged into
+// the same span. order is filled with the indices of the non-empty requests,
+// sorted by address, and spans index into it.
+inline void PlanReadBatch(std::vector<ReadBatchRequest> const& requests,
+                          std::size_t max_gap,
+                          std::vector<std::size_t>& order,
+                          std::vector<ReadBatchSpan>& spans)
+{
+  order.clear();
+  spans.clear();
+
+  for (std::size_t i = 0; i < requests.size(); ++i)
+  {
+    if (requests[i].size)
+    {
+      order.push_back(i);
+    }
+  }
+
+  std::stable_sort(std::begin(order),
+                   std::end(order),
+                   [&](std::size_t lhs, std::size_t rhs)
+                   {
+                     return requests[lhs].address < requests[rhs].address;
+                   });
+
+  for (std::size_t i = 0; i < order.size(); ++i)
+  {
+    auto const& request = requests[order[i]];
+    auto const end = reinterpret_cast<std::uintptr_t>(request.address) +
+                     request.size;
+    HADESMEM_DETAIL_ASSERT(end > reinterpret_cast<std::uintptr_t>(
+                                   request.address));
+
+    if (!spans.empty())
+    {
+      auto& span = spans.back();
+      auto const span_end =
+        reinterpret_cast<std::uintptr_t>(span.address) + span.size;
+      auto const address = reinterpret_cast<std::uintptr_t>(request.address);
+      if (address <= span_end || address - span_end <= max_gap)
+      {
+        span.size = static_cast<std::size_t>(
+          (std::max)(span_end, end) -
+          reinterpret_cast<std::uintptr_t>(span.address));
+        span.last = i + 1;
+        continue;
+      }
+    }
+
+    spans.push_back(
+      ReadBatchSpan{request.address, request.size, i, i + 1, false});
+  }
+}
+
+// Calls read(address, buf, len) once per span, where read returns whether
+// all of the bytes could be read, and copies the results out to the
+// requests. If a span which covers more than one request can't be read, its
+// requests are read one at a time instead (now and in later calls), so that
+// a bad request or gap doesn't take its neighbours with it. valid is set for
+// each request which was read. buf is scratch space.
+template <typename ReadFunc>
+void ExecuteReadBatch(std::vector<ReadBatchRequest> const& requests,
+                      std::vector<std::size_t> const& order,
+                      std::vector<ReadBatchSpan>& spans,
+                      std::vector<std::uint8_t>& buf,
+                      std::vector<std::uint8_t>& valid,
+                      ReadFunc read)
+{
+  // Empty requests are trivially successful.
+  valid.assign(requests.size(), 1);
+
+  for (auto& span : spans)
+  {
+    if (span.last - span.first > 1 && !span.split)
+    {
+      if (buf.size() < span.size)
+      {
+        buf.resize(span.size);
+      }
+
+      if (read(span.address, buf.data(), span.size))
+      {
+        for (std::size_t i = span.first; i < span.last; ++i)
+        {
+          auto const& request = requests[order[i]];
+          std::memcpy(request.data,
+                      buf.data() + (request.address - span.address),
+                      request.size);
+        }
+
+        continue;
+      }
+
+      span.split = true;
+    }
+
+    for (std::size_t i = span.first; i < span.last; ++i)
+    {
+      auto const& request = requests[order[i]];
+      valid[order[i]] =
+        read(request.address, request.data, request.size) ? 1 : 0;
+    }
+  }
+}
+}
+}
@@ -30,6 +30,53 @@ struct ReadFlags
 
 namespace detail
 {
+// Reads without querying or reprotecting any regions, and returns whether the
+// whole range was read instead of throwing.
+inline bool TryReadUnchecked(Process const& process,
+                             void* address,
+                             void* data,
+                             std::size_t len) noexcept
+{
+  SIZE_T bytes_read = 0;
+  return ::ReadProcessMemory(
+           process.GetHandle(), address, data, len, &bytes_read) &&
+         bytes_read == len;
+}
+
+// Like TryReadUnchecked, but only reads if every region in the range can be
+// read as-is (going by QueryCached), so guard pages and the like are never
+// touched. With the region cache enabled, this relies on the cache being
+// invalidated whenever the target changes its protections.
+inline bool TryReadAsIs(Process const& process,
+                        void* address,
+                        void* data,
+                        std::size_t len)
+{
+  auto const end = static_cast<std::uint8_t*>(address) + len;
+  for (auto cur = static_cast<std::uint8_t*>(address); cur < end;)
+  {
+    MEMORY_BASIC_INFORMATION mbi{};
+    try
+    {
+      bool cached = false;
+      mbi = QueryCached(process, cur, &CanRead, cached);
+    }
+    catch (Error const&)
+    {
+      return false;
+    }
+
+    if (!CanRead(mbi) || IsBadProtect(mbi))
+    {
+      return false;
+    }
+
+    cur = static_cast<std::uint8_t*>(mbi.BaseAddress) + mbi.RegionSize;
+  }
+
+  return TryReadUnchecked(process, address, data, len);
+}
+
 inline void ReadUnchecked(Process const& process,
                           void* address,
                           void* data,
@@ -44,10 +91,7 @@ inline void ReadUnchecked(Process const& process,
     return;
   }
 
-  SIZE_T bytes_read = 0;
-  if (!::ReadProcessMemory(
-        process.GetHandle(), address, data, len, &bytes_read) ||
-      bytes_read != len)
+  if (!TryReadUnchecked(process, address, data, len))
   {
     DWORD const last_error = ::GetLastError();
     HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
@@ -72,7 +116,9 @@ inline void ReadImpl(Process const& process,
 
   for (;;)
   {
-    MEMORY_BASIC_INFORMATION const mbi = detail::Query(process, address);
+    bool cached = false;
+    MEMORY_BASIC_INFORMATION const mbi =
+      detail::QueryCached(process, address, &CanRead, cached);
 
     void* const address_end = static_cast<std::uint8_t*>(address) + len;
     void* const region_next =
@@ -81,46 +127,49 @@ inline void ReadImpl(Process const& process,
     bool const should_zero_fill =
       (mbi.State == MEM_RESERVE && !!(flags & ReadFlags::kZeroFillReserved));
 
-    if (address_end <= region_next)
-    {
-      if (should_zero_fill)
-      {
-        std::fill(static_cast<std::uint8_t*>(data),
-                  static_cast<std::uint8_t*>(data) + len,
-                  0);
-      }
-      else
-      {
-        ProtectGuard protect_guard{process, mbi, ProtectGuardType::kRead};
-        ReadUnchecked(process, address, data, len, flags);
-        protect_guard.Restore();
-      }
+    std::size_t const len_new =
+      address_end <= region_next
+        ? len
+        : reinterpret_cast<std::uintptr_t>(region_next) -
+            reinterpret_cast<std::uintptr_t>(address);
 
-      return;
+    if (should_zero_fill)
+    {
+      std::fill(static_cast<std::uint8_t*>(data),
+                static_cast<std::uint8_t*>(data) + len_new,
+                0);
     }
     else
     {
-      std::size_t const len_new =
-        reinterpret_cast<std::uintptr_t>(region_next) -
-        reinterpret_cast<std::uintptr_t>(address);
-
-      if (should_zero_fill)
-      {
-        std::fill(static_cast<std::uint8_t*>(data),
-                  static_cast<std::uint8_t*>(data) + len_new,
-                  0);
-      }
-      else
+      // A cached region is trusted as-is, so if it has since become a guard
+      // page this read touches it (see Process::SetRegionCacheEnabled).
+      try
       {
         ProtectGuard protect_guard{process, mbi, ProtectGuardType::kRead};
         ReadUnchecked(process, address, data, len_new, flags);
         protect_guard.Restore();
       }
+      catch (Error const&)
+      {
+        if (!cached)
+        {
+          throw;
+        }
+
+        // The cached region is out of date, so try again with a fresh one.
+        process.InvalidateRegionCache();
+        continue;
+      }
+    }
 
-      address = static_cast<std::uint8_t*>(address) + len_new;
-      data = static_cast<std::uint8_t*>(data) + len_new;
-      len -= len_new;
+    if (len_new == len)
+    {
+      return;
     }
+
+    address = static_cast<std::uint8_t*>(address) + len_new;
+    data = static_cast<std::uint8_t*>(data) + len_new;
+    len -= len_new;
   }
 }
 
@@ -0,0 +1,168 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <mutex>
+#include <vector>
+
+#include <hadesmem/detail/assert.hpp>
+
+// Region info cache used by Process (when enabled) so that small reads and
+// writes don't need to query the region they touch every time. Info is
+// MEMORY_BASIC_INFORMATION in practice, but this must not depend on
+// windows.h.
+
+namespace hadesmem
+{
+namespace detail
+{
+template <typename Info> class RegionCache
+{
+public:
+  explicit RegionCache(std::size_t max_entries = 4096)
+    : max_entries_{max_entries}
+  {
+    HADESMEM_DETAIL_ASSERT(max_entries_ != 0);
+  }
+
+  RegionCache(RegionCache const& other) = delete;
+
+  RegionCache& operator=(RegionCache const& other) = delete;
+
+  // Returns whether address is inside a cached region, and copies its info
+  // to info if it is.
+  bool Find(void const* address, Info& info) const
+  {
+    auto const address_num = reinterpret_cast<std::uintptr_t>(address);
+
+    std::lock_guard<std::mutex> lock{mutex_};
+
+    if (entries_generation_ != generation_.load())
+    {
+      return false;
+    }
+
+    auto const iter = std::upper_bound(std::begin(entries_),
+                                       std::end(entries_),
+                                       address_num,
+                                       [](std::uintptr_t lhs,
+                                          Entry const& rhs)
+                                       {
+                                         return lhs < rhs.begin;
+                                       });
+    if (iter == std::begin(entries_))
+    {
+      return false;
+    }
+
+    auto const& entry = *std::prev(iter);
+    if (address_num >= entry.end)
+    {
+      return false;
+    }
+
+    info = entry.info;
+    return true;
+  }
+
+  // Replaces any cached regions overlapping [base, base + size). generation
+  // must be the result of GetGeneration from before the info was queried, so
+  // that info which was queried before an invalidation is dropped instead of
+  // ending up in the fresh cache.
+  void Insert(void const* base,
+              std::size_t size,
+              Info const& info,
+              std::uint64_t generation)
+  {
+    auto const begin = reinterpret_cast<std::uintptr_t>(base);
+    if (!size)
+    {
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock{mutex_};
+
+    if (generation != generation_.load())
+    {
+      return;
+    }
+
+    if (entries_generation_ != generation ||
+        entries_.size() >= max_entries_)
+    {
+      entries_.clear();
+      entries_generation_ = generation;
+    }
+
+    auto const range = EraseUnlocked(begin, begin + size);
+    entries_.insert(range, Entry{begin, begin + size, info});
+  }
+
+  // Removes any cached regions overlapping [base, base + size).
+  void Erase(void const* base, std::size_t size)
+  {
+    auto const begin = reinterpret_cast<std::uintptr_t>(base);
+
+    std::lock_guard<std::mutex> lock{mutex_};
+
+    EraseUnlocked(begin, begin + size);
+  }
+
+  // Drops every cached region. Cheap enough to call whenever the target's
+  // memory layout may have changed.
+  void Invalidate() noexcept
+  {
+    ++generation_;
+  }
+
+  // Changes every time the cache is invalidated.
+  std::uint64_t GetGeneration() const noexcept
+  {
+    return generation_.load();
+  }
+
+private:
+  struct Entry
+  {
+    std::uintptr_t begin;
+    std::uintptr_t end;
+    Info info;
+  };
+
+  typename std::vector<Entry>::iterator EraseUnlocked(std::uintptr_t begin,
+                                                      std::uintptr_t end)
+  {
+    auto const first = std::upper_bound(std::begin(entries_),
+                                        std::end(entries_),
+                                        begin,
+                                        [](std::uintptr_t lhs,
+                                           Entry const& rhs)
+                                        {
+                                          return lhs < rhs.end;
+                                        });
+    auto const last = std::lower_bound(first,
+                                       std::end(entries_),
+                                       end,
+                                       [](Entry const& lhs,
+                                          std::uintptr_t rhs)
+                                       {
+                                         return lhs.begin < rhs;
+                                       });
+    return entries_.erase(first, last);
+  }
+
+  mutable std::mutex mutex_;
+  // Sorted, and none of them overlap.
+  std::vector<Entry> entries_;
+  std::uint64_t entries_generation_{};
+  std::atomic<std::uint64_t> generation_{};
+  std::size_t max_entries_;
+};
+}
+}
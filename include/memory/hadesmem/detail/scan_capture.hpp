@@ -0,0 +1,176 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/parallel_for.hpp>
+
+// Local copy of parts of the target used by Scanner for suspended scans. The
+// target only has to be paused while the memory is copied, and everything
+// else (including allocating the copy) happens before or after that. Like the
+// other scanning cores, this must not depend on windows.h.
+
+namespace hadesmem
+{
+namespace detail
+{
+struct ScanCaptureRange
+{
+  std::uint8_t* address;
+  std::size_t size;
+};
+
+class ScanCapture
+{
+public:
+  // Ranges must be sorted and must not overlap. Each range is copied in
+  // pieces of at most piece_size bytes, so that the pieces can be copied in
+  // parallel and a piece which can't be read doesn't take the rest of its
+  // range with it.
+  ScanCapture(std::vector<ScanCaptureRange> const& ranges,
+              std::size_t piece_size)
+  {
+    HADESMEM_DETAIL_ASSERT(piece_size != 0);
+
+    std::size_t size = 0;
+    for (auto const& range : ranges)
+    {
+      HADESMEM_DETAIL_ASSERT(
+        ranges_.empty() ||
+        ranges_.back().address + ranges_.back().size <= range.address);
+
+      ranges_.push_back(Range{range.address, range.size, size, pieces_.size()});
+      for (std::size_t offset = 0; offset < range.size; offset += piece_size)
+      {
+        pieces_.push_back(
+          Piece{range.address + offset,
+                size + offset,
+                (std::min)(piece_size, range.size - offset)});
+      }
+
+      size += range.size;
+    }
+
+    piece_size_ = piece_size;
+    data_.resize(size);
+    valid_.resize(pieces_.size());
+  }
+
+  // Calls read(address, buf, len) for every piece on up to num_threads
+  // threads (including the calling thread), where read returns whether the
+  // piece could be read. Nothing is allocated when num_threads is one, so
+  // this can be used while threads of the current process are suspended.
+  template <typename ReadFunc>
+  void Fill(std::size_t num_threads, ReadFunc read)
+  {
+    ParallelFor(pieces_.size(),
+                num_threads,
+                [&](std::size_t i, std::size_t /*thread*/)
+                {
+                  auto const& piece = pieces_[i];
+                  valid_[i] = read(piece.address,
+                                   data_.data() + piece.offset,
+                                   piece.size)
+                                ? 1
+                                : 0;
+                });
+  }
+
+  // Returns a pointer to the copy of the len bytes at address, or null if
+  // they weren't all copied.
+  std::uint8_t const* Get(std::uint8_t const* address, std::size_t len) const
+    noexcept
+  {
+    auto const iter = std::upper_bound(std::begin(ranges_),
+                                       std::end(ranges_),
+                                       address,
+                                       [](std::uint8_t const* lhs,
+                                          Range const& rhs)
+                                       {
+                                         return lhs < rhs.address;
+                                       });
+    if (iter == std::begin(ranges_) || !len)
+    {
+      return nullptr;
+    }
+
+    auto const& range = *std::prev(iter);
+    auto const offset = static_cast<std::size_t>(address - range.address);
+    if (offset >= range.size || range.size - offset < len)
+    {
+      return nullptr;
+    }
+
+    std::size_t const first = range.first_piece + offset / piece_size_;
+    std::size_t const last =
+      range.first_piece + (offset + len - 1) / piece_size_;
+    for (std::size_t i = first; i <= last; ++i)
+    {
+      if (!valid_[i])
+      {
+        return nullptr;
+      }
+    }
+
+    return data_.data() + range.offset + offset;
+  }
+
+  std::size_t GetSize() const noexcept
+  {
+    return data_.size();
+  }
+
+private:
+  struct Range
+  {
+    std::uint8_t* address;
+    std::size_t size;
+    // Into data_.
+    std::size_t offset;
+    std::size_t first_piece;
+  };
+
+  struct Piece
+  {
+    std::uint8_t* address;
+    // Into data_.
+    std::size_t offset;
+    std::size_t size;
+  };
+
+  std::vector<Range> ranges_;
+  std::vector<Piece> pieces_;
+  // Not a vector<bool>, because pieces are marked from multiple threads.
+  std::vector<std::uint8_t> valid_;
+  std::vector<std::uint8_t> data_;
+  std::size_t piece_size_{};
+};
+
+// Appends [address, address + size) to ranges, merging it with the last range
+// if they touch. Ranges must be added in address order.
+inline void AddScanCaptureRange(std::vector<ScanCaptureRange>& ranges,
+                                std::uint8_t* address,
+                                std::size_t size)
+{
+  if (!ranges.empty())
+  {
+    auto& last = ranges.back();
+    if (last.address + last.size >= address)
+    {
+      last.size = static_cast<std::size_t>(
+        (std::max)(last.address + last.size, address + size) - last.address);
+      return;
+    }
+  }
+
+  ranges.push_back(ScanCaptureRange{address, size});
+}
+}
+}
@@ -0,0 +1,204 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#include <hadesmem/detail/static_assert.hpp>
+
+// Turns the floating point tolerances supported by Scanner into inclusive
+// [low, high] ranges of T, so they can all be scanned for with the same
+// vectorized range compare. Like the other scanning cores, this must not
+// depend on windows.h.
+
+namespace hadesmem
+{
+namespace detail
+{
+template <typename T> struct ScanFloatBits;
+
+template <> struct ScanFloatBits<float>
+{
+  using Type = std::uint32_t;
+};
+
+template <> struct ScanFloatBits<double>
+{
+  using Type = std::uint64_t;
+};
+
+// Maps values to integers with the same ordering, so that adjacent values
+// (i.e. one ULP apart) map to adjacent integers. -0.0 and +0.0 are one apart.
+template <typename T>
+typename ScanFloatBits<T>::Type GetScanFloatKey(T value) noexcept
+{
+  using Bits = typename ScanFloatBits<T>::Type;
+  Bits const sign = Bits(1) << (sizeof(Bits) * 8 - 1);
+  Bits bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return (bits & sign) ? ~bits : (bits | sign);
+}
+
+template <typename T>
+T GetScanFloatFromKey(typename ScanFloatBits<T>::Type key) noexcept
+{
+  using Bits = typename ScanFloatBits<T>::Type;
+  Bits const sign = Bits(1) << (sizeof(Bits) * 8 - 1);
+  Bits const bits = (key & sign) ? (key & ~sign) : ~key;
+  T value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// Smallest T which is >= value.
+template <typename T> T GetScanFloatLow(double value) noexcept
+{
+  if (value > static_cast<double>((std::numeric_limits<T>::max)()))
+  {
+    return std::numeric_limits<T>::infinity();
+  }
+
+  if (value < static_cast<double>(std::numeric_limits<T>::lowest()))
+  {
+    return -std::numeric_limits<T>::infinity();
+  }
+
+  T result = static_cast<T>(value);
+  if (static_cast<double>(result) < value)
+  {
+    result = std::nextafter(result, std::numeric_limits<T>::infinity());
+  }
+
+  return result;
+}
+
+// Largest T which is <= value (or < value if exclusive).
+template <typename T> T GetScanFloatHigh(double value, bool exclusive) noexcept
+{
+  if (value > static_cast<double>((std::numeric_limits<T>::max)()))
+  {
+    return std::numeric_limits<T>::infinity();
+  }
+
+  if (value < static_cast<double>(std::numeric_limits<T>::lowest()))
+  {
+    return -std::numeric_limits<T>::infinity();
+  }
+
+  T result = static_cast<T>(value);
+  if (static_cast<double>(result) > value ||
+      (exclusive && static_cast<double>(result) == value))
+  {
+    result = std::nextafter(result, -std::numeric_limits<T>::infinity());
+  }
+
+  return result;
+}
+
+// |x - value| <= epsilon
+template <typename T>
+void GetScanFloatAbsoluteRange(T value, double epsilon, T& low, T& high)
+{
+  HADESMEM_DETAIL_STATIC_ASSERT(std::is_floating_point<T>::value);
+  low = GetScanFloatLow<T>(static_cast<double>(value) - epsilon);
+  high = GetScanFloatHigh<T>(static_cast<double>(value) + epsilon, false);
+}
+
+// |x - value| <= epsilon * |value|
+template <typename T>
+void GetScanFloatRelativeRange(T value, double epsilon, T& low, T& high)
+{
+  GetScanFloatAbsoluteRange(
+    value, epsilon * std::fabs(static_cast<double>(value)), low, high);
+}
+
+// x is within ulps representable values of value. Infinities are the ends
+// of the range.
+template <typename T>
+void GetScanFloatUlpRange(T value, std::uint64_t ulps, T& low, T& high)
+{
+  HADESMEM_DETAIL_STATIC_ASSERT(std::is_floating_point<T>::value);
+  using Bits = typename ScanFloatBits<T>::Type;
+  Bits const key = GetScanFloatKey(value);
+  Bits const min_key = GetScanFloatKey(-std::numeric_limits<T>::infinity());
+  Bits const max_key = GetScanFloatKey(std::numeric_limits<T>::infinity());
+  low = GetScanFloatFromKey<T>(
+    key - min_key > ulps ? static_cast<Bits>(key - ulps) : min_key);
+  high = GetScanFloatFromKey<T>(
+    max_key - key > ulps ? static_cast<Bits>(key + ulps) : max_key);
+}
+
+// value * 10^decimals, rounded to an integer. value is rounded first since
+// that's what the user most likely meant (e.g. 12.3 rather than 12.30000019).
+// Bounds are computed from this rather than by adding fractions of
+// 10^-decimals to the rounded value, which is inexact.
+template <typename T>
+double GetScanFloatScaled(T value, std::size_t decimals) noexcept
+{
+  double const scale = std::pow(10.0, static_cast<double>(decimals));
+  return std::round(static_cast<double>(value) * scale);
+}
+
+// x rounded to the given number of decimal places is value. Halves are
+// rounded away from zero (as std::round does), so the bound nearer to zero is
+// inclusive and the other is exclusive.
+template <typename T>
+void GetScanFloatRoundedRange(T value,
+                              std::size_t decimals,
+                              T& low,
+                              T& high)
+{
+  HADESMEM_DETAIL_STATIC_ASSERT(std::is_floating_point<T>::value);
+  double const scale = std::pow(10.0, static_cast<double>(decimals));
+  double const scaled = GetScanFloatScaled(value, decimals);
+  if (scaled > 0)
+  {
+    low = GetScanFloatLow<T>((scaled - 0.5) / scale);
+    high = GetScanFloatHigh<T>((scaled + 0.5) / scale, true);
+  }
+  else if (scaled < 0)
+  {
+    low = -GetScanFloatHigh<T>((-scaled + 0.5) / scale, true);
+    high = -GetScanFloatLow<T>((-scaled - 0.5) / scale);
+  }
+  else
+  {
+    high = GetScanFloatHigh<T>(0.5 / scale, true);
+    low = -high;
+  }
+}
+
+// x truncated (towards zero) to the given number of decimal places is value.
+template <typename T>
+void GetScanFloatTruncatedRange(T value,
+                                std::size_t decimals,
+                                T& low,
+                                T& high)
+{
+  HADESMEM_DETAIL_STATIC_ASSERT(std::is_floating_point<T>::value);
+  double const scale = std::pow(10.0, static_cast<double>(decimals));
+  double const scaled = GetScanFloatScaled(value, decimals);
+  if (scaled > 0)
+  {
+    low = GetScanFloatLow<T>(scaled / scale);
+    high = GetScanFloatHigh<T>((scaled + 1) / scale, true);
+  }
+  else if (scaled < 0)
+  {
+    low = -GetScanFloatHigh<T>((-scaled + 1) / scale, true);
+    high = GetScanFloatHigh<T>(scaled / scale, false);
+  }
+  else
+  {
+    high = GetScanFloatHigh<T>(1 / scale, true);
+    low = -high;
+  }
+}
+}
+}
@@ -0,0 +1,419 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/scan_value.hpp>
+#include <hadesmem/detail/static_assert.hpp>
+
+// Group (structure) search core used by Scanner. One member of the group is
+// used as the anchor and searched for with the vectorized value scan, and the
+// others are only checked at the anchor hits. Like the other scanning cores,
+// this only operates on local buffers and must not depend on windows.h.
+
+namespace hadesmem
+{
+namespace detail
+{
+struct ScanGroupMember
+{
+  std::size_t offset;
+  std::size_t size;
+  std::uint8_t value[8];
+  // Rough estimate of how rarely the value occurs. See
+  // GetScanGroupMemberScore.
+  std::size_t score;
+  void (*find)(std::uint8_t const* beg,
+               std::uint8_t const* end,
+               std::uint8_t const* value,
+               std::size_t alignment,
+               std::vector<std::size_t>& hits);
+  bool (*match)(std::uint8_t const* buf, std::uint8_t const* value);
+};
+
+template <typename T>
+void FindScanGroupMember(std::uint8_t const* beg,
+                         std::uint8_t const* end,
+                         std::uint8_t const* value,
+                         std::size_t alignment,
+                         std::vector<std::size_t>& hits)
+{
+  T cur_value;
+  std::memcpy(&cur_value, value, sizeof(T));
+  ScanValue(beg,
+            end,
+            cur_value,
+            alignment,
+            [&](std::size_t offset)
+            {
+              hits.push_back(offset);
+            });
+}
+
+// Compared as values rather than bytes (like ScanValue), so that e.g. +0.0
+// matches -0.0.
+template <typename T>
+bool MatchScanGroupMember(std::uint8_t const* buf, std::uint8_t const* value)
+{
+  T cur_value;
+  std::memcpy(&cur_value, buf, sizeof(T));
+  T expected;
+  std::memcpy(&expected, value, sizeof(T));
+  return cur_value == expected;
+}
+
+// Bytes which are all zeros or all ones are common in memory (small integers,
+// null pointers, flags, etc.), so they aren't counted. Wider values win ties.
+inline std::size_t GetScanGroupMemberScore(std::uint8_t const* value,
+                                           std::size_t size) noexcept
+{
+  std::size_t score = size;
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    if (value[i] != 0x00 && value[i] != 0xFF)
+    {
+      score += 16;
+    }
+  }
+
+  return score;
+}
+
+template <typename T>
+ScanGroupMember MakeScanGroupMember(std::size_t offset, T value)
+{
+  HADESMEM_DETAIL_STATIC_ASSERT(IsScanValueType<T>::value);
+
+  ScanGroupMember member{};
+  member.offset = offset;
+  member.size = sizeof(T);
+  std::memcpy(member.value, &value, sizeof(T));
+  member.score = GetScanGroupMemberScore(member.value, sizeof(T));
+  member.find = &FindScanGroupMember<T>;
+  member.match = &MatchScanGroupMember<T>;
+  return member;
+}
+
+// The anchor (most selective member) goes first, followed by the rest in the
+// order they should be checked.
+inline void SortScanGroupMembers(std::vector<ScanGroupMember>& members)
+{
+  std::stable_sort(std::begin(members),
+                   std::end(members),
+                   [](ScanGroupMember const& lhs, ScanGroupMember const& rhs)
+                   {
+                     return lhs.score > rhs.score;
+                   });
+}
+
+inline std::size_t
+  GetScanGroupSize(std::vector<ScanGroupMember> const& members) noexcept
+{
+  std::size_t size = 0;
+  for (auto const& member : members)
+  {
+    size = (std::max)(size, member.offset + member.size);
+  }
+
+  return size;
+}
+
+// Calls callback(offset) for every offset in [0, scan_len) which is a
+// multiple of alignment where the group matches. The buffer holds len bytes,
+// so groups starting near the end of the scan range can be checked. hits is
+// scratch space. Members must be sorted.
+template <typename Callback>
+void ScanGroupValues(std::uint8_t const* buf,
+                     std::size_t len,
+                     std::size_t scan_len,
+                     std::vector<ScanGroupMember> const& members,
+                     std::size_t alignment,
+                     std::vector<std::size_t>& hits,
+                     Callback callback)
+{
+  HADESMEM_DETAIL_ASSERT(!members.empty());
+  HADESMEM_DETAIL_ASSERT(alignment != 0);
+
+  auto const& anchor = members.front();
+  std::size_t const group_size = GetScanGroupSize(members);
+  if (!scan_len || len < group_size)
+  {
+    return;
+  }
+
+  // Offsets passed to the anchor scan are group offsets. Naturally aligned
+  // scans are vectorized, so use one if it covers every group offset.
+  std::size_t const anchor_alignment =
+    alignment % anchor.size ? alignment : anchor.size;
+  std::size_t const end =
+    (std::min)(len - group_size, scan_len - 1) + anchor.offset + anchor.size;
+  hits.clear();
+  anchor.find(
+    buf + anchor.offset, buf + end, anchor.value, anchor_alignment, hits);
+
+  for (auto const offset : hits)
+  {
+    if (offset % alignment || offset >= scan_len ||
+        offset + group_size > len)
+    {
+      continue;
+    }
+
+    bool match = true;
+    for (std::size_t i = 1; match && i < members.size(); ++i)
+    {
+      match = members[i].match(buf + offset + members[i].offset,
+                               members[i].value);
+    }
+
+    if (match)
+    {
+      callback(offset);
+    }
+  }
+}
+
+inline void SkipScanGroupSpace(char const*& cur) noexcept
+{
+  while (std::isspace(static_cast<unsigned char>(*cur)))
+  {
+    ++cur;
+  }
+}
+
+inline bool ParseScanGroupSize(char const*& cur, std::size_t& value)
+{
+  SkipScanGroupSpace(cur);
+  if (!std::isdigit(static_cast<unsigned char>(*cur)))
+  {
+    return false;
+  }
+
+  char* end = nullptr;
+  errno = 0;
+  unsigned long long const parsed = std::strtoull(cur, &end, 0);
+  if (errno || parsed > (std::numeric_limits<std::size_t>::max)())
+  {
+    return false;
+  }
+
+  value = static_cast<std::size_t>(parsed);
+  cur = end;
+  return true;
+}
+
+template <typename T>
+bool ParseScanGroupValue(char const*& cur, T& value, std::true_type)
+{
+  char* end = nullptr;
+  double const parsed = std::strtod(cur, &end);
+  if (end == cur || !(std::abs(parsed) <= (std::numeric_limits<T>::max)()))
+  {
+    return false;
+  }
+
+  value = static_cast<T>(parsed);
+  cur = end;
+  return true;
+}
+
+template <typename T>
+bool ParseScanGroupValue(char const*& cur, T& value, std::false_type)
+{
+  char* end = nullptr;
+  errno = 0;
+  if (*cur == '-')
+  {
+    long long const parsed = std::strtoll(cur, &end, 0);
+    if (end == cur || errno || !std::is_signed<T>::value ||
+        parsed < static_cast<long long>((std::numeric_limits<T>::min)()))
+    {
+      return false;
+    }
+
+    value = static_cast<T>(parsed);
+  }
+  else
+  {
+    unsigned long long const parsed = std::strtoull(cur, &end, 0);
+    if (end == cur || errno ||
+        parsed > static_cast<unsigned long long>(
+                   (std::numeric_limits<T>::max)()))
+    {
+      return false;
+    }
+
+    value = static_cast<T>(parsed);
+  }
+
+  cur = end;
+  return true;
+}
+
+template <typename T>
+bool ParseScanGroupMember(char const*& cur,
+                          std::size_t offset,
+                          std::vector<ScanGroupMember>& members)
+{
+  SkipScanGroupSpace(cur);
+  T value{};
+  if (!ParseScanGroupValue(cur, value, std::is_floating_point<T>{}))
+  {
+    return false;
+  }
+
+  SkipScanGroupSpace(cur);
+  if (*cur == '@')
+  {
+    ++cur;
+    SkipScanGroupSpace(cur);
+    if (*cur == '+')
+    {
+      ++cur;
+    }
+
+    if (!ParseScanGroupSize(cur, offset))
+    {
+      return false;
+    }
+  }
+
+  members.push_back(MakeScanGroupMember(offset, value));
+  return true;
+}
+
+// Parses groups like "{u32 100, ?, float 1.5 @+8}". See hadesmem::ScanGroup
+// for the syntax. Returns false on malformed input. Members are sorted.
+inline bool ParseScanGroup(std::string const& str,
+                           std::vector<ScanGroupMember>& members)
+{
+  members.clear();
+
+  char const* cur = str.c_str();
+  SkipScanGroupSpace(cur);
+  bool const braces = *cur == '{';
+  if (braces)
+  {
+    ++cur;
+  }
+
+  std::size_t offset = 0;
+  for (;;)
+  {
+    SkipScanGroupSpace(cur);
+    if (*cur == '?')
+    {
+      ++cur;
+      std::size_t size = 4;
+      SkipScanGroupSpace(cur);
+      if (std::isdigit(static_cast<unsigned char>(*cur)) &&
+          !ParseScanGroupSize(cur, size))
+      {
+        return false;
+      }
+
+      offset += size;
+    }
+    else
+    {
+      char const* const type_beg = cur;
+      while (std::isalnum(static_cast<unsigned char>(*cur)))
+      {
+        ++cur;
+      }
+
+      std::string const type(type_beg, cur);
+      bool parsed = false;
+      if (type == "i8")
+      {
+        parsed = ParseScanGroupMember<std::int8_t>(cur, offset, members);
+      }
+      else if (type == "u8")
+      {
+        parsed = ParseScanGroupMember<std::uint8_t>(cur, offset, members);
+      }
+      else if (type == "i16")
+      {
+        parsed = ParseScanGroupMember<std::int16_t>(cur, offset, members);
+      }
+      else if (type == "u16")
+      {
+        parsed = ParseScanGroupMember<std::uint16_t>(cur, offset, members);
+      }
+      else if (type == "i32")
+      {
+        parsed = ParseScanGroupMember<std::int32_t>(cur, offset, members);
+      }
+      else if (type == "u32")
+      {
+        parsed = ParseScanGroupMember<std::uint32_t>(cur, offset, members);
+      }
+      else if (type == "i64")
+      {
+        parsed = ParseScanGroupMember<std::int64_t>(cur, offset, members);
+      }
+      else if (type == "u64")
+      {
+        parsed = ParseScanGroupMember<std::uint64_t>(cur, offset, members);
+      }
+      else if (type == "float" || type == "f32")
+      {
+        parsed = ParseScanGroupMember<float>(cur, offset, members);
+      }
+      else if (type == "double" || type == "f64")
+      {
+        parsed = ParseScanGroupMember<double>(cur, offset, members);
+      }
+
+      if (!parsed)
+      {
+        return false;
+      }
+
+      offset = members.back().offset + members.back().size;
+    }
+
+    SkipScanGroupSpace(cur);
+    if (*cur != ',')
+    {
+      break;
+    }
+
+    ++cur;
+  }
+
+  if (braces)
+  {
+    if (*cur != '}')
+    {
+      return false;
+    }
+
+    ++cur;
+  }
+
+  SkipScanGroupSpace(cur);
+  if (*cur || members.empty())
+  {
+    return false;
+  }
+
+  SortScanGroupMembers(members);
+  return true;
+}
+}
+}
@@ -0,0 +1,572 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <iterator>
+#include <limits>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/simd.hpp>
+
+// Candidate sets used for progressive scanning. Each region starts out as a
+// bitmap with one bit per aligned slot, and is switched to a sorted array of
+// slot indices once few enough candidates remain that it is smaller.
+
+// Like the other scanning cores, this only operates on local buffers and must
+// not depend on windows.h.
+
+namespace hadesmem
+{
+namespace detail
+{
+std::size_t const kScanBitsPerWord = 64;
+
+inline std::size_t CountScanBits(std::uint64_t value) noexcept
+{
+  value = value - ((value >> 1) & 0x5555555555555555ULL);
+  value = (value & 0x3333333333333333ULL) +
+          ((value >> 2) & 0x3333333333333333ULL);
+  value = (value + (value >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+  return static_cast<std::size_t>((value * 0x0101010101010101ULL) >> 56);
+}
+
+inline std::uint32_t CountTrailingZeros64(std::uint64_t value) noexcept
+{
+  auto const low = static_cast<std::uint32_t>(value);
+  auto const high = static_cast<std::uint32_t>(value >> 32);
+  return low ? CountTrailingZeros(low) : 32 + CountTrailingZeros(high);
+}
+
+// Mask of the bits in [first, last) of a word, where last may be 64.
+inline std::uint64_t GetScanWordMask(std::size_t first,
+                                     std::size_t last) noexcept
+{
+  std::uint64_t const high =
+    last == kScanBitsPerWord ? ~0ULL : ((1ULL << last) - 1);
+  return high & ~((1ULL << first) - 1);
+}
+
+inline void AndScanBitmap(std::uint64_t* dst,
+                          std::uint64_t const* src,
+                          std::size_t num_words) noexcept
+{
+  std::size_t i = 0;
+
+#if defined(HADESMEM_DETAIL_SIMD_SSE2)
+  for (; i + 2 <= num_words; i += 2)
+  {
+    __m128i const lhs = _mm_loadu_si128(reinterpret_cast<__m128i*>(dst + i));
+    __m128i const rhs =
+      _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                     _mm_and_si128(lhs, rhs));
+  }
+#endif // #if defined(HADESMEM_DETAIL_SIMD_SSE2)
+
+  for (; i < num_words; ++i)
+  {
+    dst[i] &= src[i];
+  }
+}
+
+inline void OrScanBitmap(std::uint64_t* dst,
+                         std::uint64_t const* src,
+                         std::size_t num_words) noexcept
+{
+  std::size_t i = 0;
+
+#if defined(HADESMEM_DETAIL_SIMD_SSE2)
+  for (; i + 2 <= num_words; i += 2)
+  {
+    __m128i const lhs = _mm_loadu_si128(reinterpret_cast<__m128i*>(dst + i));
+    __m128i const rhs =
+      _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                     _mm_or_si128(lhs, rhs));
+  }
+#endif // #if defined(HADESMEM_DETAIL_SIMD_SSE2)
+
+  for (; i < num_words; ++i)
+  {
+    dst[i] |= src[i];
+  }
+}
+
+// dst &= ~src
+inline void AndNotScanBitmap(std::uint64_t* dst,
+                             std::uint64_t const* src,
+                             std::size_t num_words) noexcept
+{
+  std::size_t i = 0;
+
+#if defined(HADESMEM_DETAIL_SIMD_SSE2)
+  for (; i + 2 <= num_words; i += 2)
+  {
+    __m128i const lhs = _mm_loadu_si128(reinterpret_cast<__m128i*>(dst + i));
+    __m128i const rhs =
+      _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                     _mm_andnot_si128(rhs, lhs));
+  }
+#endif // #if defined(HADESMEM_DETAIL_SIMD_SSE2)
+
+  for (; i < num_words; ++i)
+  {
+    dst[i] &= ~src[i];
+  }
+}
+
+inline bool IsScanBitmapEmpty(std::uint64_t const* words,
+                              std::size_t num_words) noexcept
+{
+  std::size_t i = 0;
+
+#if defined(HADESMEM_DETAIL_SIMD_SSE2)
+  __m128i acc = _mm_setzero_si128();
+  for (; i + 2 <= num_words; i += 2)
+  {
+    acc = _mm_or_si128(
+      acc, _mm_loadu_si128(reinterpret_cast<__m128i const*>(words + i)));
+  }
+
+  if (_mm_movemask_epi8(_mm_cmpeq_epi8(acc, _mm_setzero_si128())) != 0xFFFF)
+  {
+    return false;
+  }
+#endif // #if defined(HADESMEM_DETAIL_SIMD_SSE2)
+
+  for (; i < num_words; ++i)
+  {
+    if (words[i])
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+class ScanResultSet
+{
+public:
+  // Every slot starts out as a candidate.
+  explicit ScanResultSet(std::size_t num_slots)
+    : num_slots_{num_slots},
+      count_{num_slots},
+      sparse_{false},
+      bitmap_((num_slots + kScanBitsPerWord - 1) / kScanBitsPerWord, ~0ULL)
+  {
+    if (num_slots % kScanBitsPerWord)
+    {
+      bitmap_.back() = GetScanWordMask(0, num_slots % kScanBitsPerWord);
+    }
+  }
+
+  std::size_t GetNumSlots() const noexcept
+  {
+    return num_slots_;
+  }
+
+  // Only accurate after Compact.
+  std::size_t GetCount() const noexcept
+  {
+    return count_;
+  }
+
+  bool IsSparse() const noexcept
+  {
+    return sparse_;
+  }
+
+  std::size_t GetMemoryUsage() const noexcept
+  {
+    return bitmap_.capacity() * sizeof(std::uint64_t) +
+           slots_.capacity() * sizeof(std::uint32_t) + removed_.capacity();
+  }
+
+  bool Any(std::size_t first, std::size_t last) const noexcept
+  {
+    last = (std::min)(last, num_slots_);
+    if (first >= last)
+    {
+      return false;
+    }
+
+    if (sparse_)
+    {
+      auto const range = GetSparseRange(first, last);
+      auto const beg =
+        std::begin(removed_) + static_cast<std::ptrdiff_t>(range.first);
+      auto const end =
+        std::begin(removed_) + static_cast<std::ptrdiff_t>(range.second);
+      return std::find(beg, end, std::uint8_t{0}) != end;
+    }
+
+    std::size_t const first_word = first / kScanBitsPerWord;
+    std::size_t const last_word = (last - 1) / kScanBitsPerWord;
+    if (first_word == last_word)
+    {
+      return !!(bitmap_[first_word] &
+                GetScanWordMask(first % kScanBitsPerWord,
+                                (last - 1) % kScanBitsPerWord + 1));
+    }
+
+    return !!(bitmap_[first_word] &
+              GetScanWordMask(first % kScanBitsPerWord, kScanBitsPerWord)) ||
+           !!(bitmap_[last_word] &
+              GetScanWordMask(0, (last - 1) % kScanBitsPerWord + 1)) ||
+           !IsScanBitmapEmpty(bitmap_.data() + first_word + 1,
+                              last_word - first_word - 1);
+  }
+
+  // Calls func(slot) for every candidate in [first, last) in order.
+  template <typename Func>
+  void ForEach(std::size_t first, std::size_t last, Func func) const
+  {
+    last = (std::min)(last, num_slots_);
+    if (first >= last)
+    {
+      return;
+    }
+
+    if (sparse_)
+    {
+      auto const range = GetSparseRange(first, last);
+      for (std::size_t i = range.first; i != range.second; ++i)
+      {
+        if (!removed_[i])
+        {
+          func(static_cast<std::size_t>(slots_[i]));
+        }
+      }
+
+      return;
+    }
+
+    for (std::size_t word = first / kScanBitsPerWord;
+         word <= (last - 1) / kScanBitsPerWord;
+         ++word)
+    {
+      std::size_t const base = word * kScanBitsPerWord;
+      std::uint64_t bits =
+        bitmap_[word] &
+        GetScanWordMask(base < first ? first - base : 0,
+                        (std::min)(last - base, kScanBitsPerWord));
+      for (; bits; bits &= bits - 1)
+      {
+        func(base + CountTrailingZeros64(bits));
+      }
+    }
+  }
+
+  // Calls keep(slot) for every candidate in [first, last) in order, and
+  // removes those for which it returns false. Disjoint ranges can be filtered
+  // concurrently as long as they don't share a bitmap word.
+  template <typename Func>
+  void Filter(std::size_t first, std::size_t last, Func keep)
+  {
+    last = (std::min)(last, num_slots_);
+    if (first >= last)
+    {
+      return;
+    }
+
+    if (sparse_)
+    {
+      auto const range = GetSparseRange(first, last);
+      for (std::size_t i = range.first; i != range.second; ++i)
+      {
+        if (!removed_[i] && !keep(static_cast<std::size_t>(slots_[i])))
+        {
+          removed_[i] = 1;
+        }
+      }
+
+      return;
+    }
+
+    ForEach(first,
+            last,
+            [&](std::size_t slot)
+            {
+              if (!keep(slot))
+              {
+                bitmap_[slot / kScanBitsPerWord] &=
+                  ~(1ULL << (slot % kScanBitsPerWord));
+              }
+            });
+  }
+
+  // Bitmap sets only. Keeps the candidates in [first, first + num_slots)
+  // which are set in mask (bit i of mask is slot first + i). first must be on
+  // a word boundary.
+  void And(std::size_t first,
+           std::uint64_t const* mask,
+           std::size_t num_slots) noexcept
+  {
+    HADESMEM_DETAIL_ASSERT(!sparse_);
+    HADESMEM_DETAIL_ASSERT(first % kScanBitsPerWord == 0);
+
+    HADESMEM_DETAIL_ASSERT(first <= num_slots_);
+
+    num_slots = (std::min)(num_slots, num_slots_ - first);
+    AndScanBitmap(bitmap_.data() + first / kScanBitsPerWord,
+                  mask,
+                  (num_slots + kScanBitsPerWord - 1) / kScanBitsPerWord);
+  }
+
+  void Clear(std::size_t first, std::size_t last)
+  {
+    Filter(first,
+           last,
+           [](std::size_t)
+           {
+             return false;
+           });
+  }
+
+  // Must be called once modifications are done to update the count, drop
+  // removed entries, and switch to a sparse set if that's now smaller.
+  void Compact()
+  {
+    if (sparse_)
+    {
+      std::size_t count = 0;
+      for (std::size_t i = 0; i < slots_.size(); ++i)
+      {
+        if (!removed_[i])
+        {
+          slots_[count++] = slots_[i];
+        }
+      }
+
+      slots_.resize(count);
+      removed_.assign(count, 0);
+      count_ = count;
+      return;
+    }
+
+    count_ = 0;
+    for (auto const word : bitmap_)
+    {
+      count_ += CountScanBits(word);
+    }
+
+    // Sparse sets use 32-bit slot indices and a byte per entry to mark
+    // removals (so that concurrent filters never write to the same word).
+    if (count_ * 40 >= num_slots_ || num_slots_ > 0xFFFFFFFFULL)
+    {
+      return;
+    }
+
+    std::vector<std::uint32_t> slots;
+    slots.reserve(count_);
+    ForEach(0,
+            num_slots_,
+            [&](std::size_t slot)
+            {
+              slots.push_back(static_cast<std::uint32_t>(slot));
+            });
+    slots_.swap(slots);
+    removed_.assign(count_, 0);
+    std::vector<std::uint64_t>().swap(bitmap_);
+    sparse_ = true;
+  }
+
+  // The candidates which are in this set but not in newer, which must be a
+  // refinement of this set. Both sets must be compacted. Used to store scan
+  // history as deltas.
+  ScanResultSet Diff(ScanResultSet const& newer) const
+  {
+    HADESMEM_DETAIL_ASSERT(newer.num_slots_ == num_slots_);
+
+    ScanResultSet removed{0};
+    removed.num_slots_ = num_slots_;
+    if (sparse_)
+    {
+      // Sets are only ever switched from bitmaps to sparse sets, so a
+      // refinement of a sparse set is sparse too.
+      HADESMEM_DETAIL_ASSERT(newer.sparse_);
+
+      removed.sparse_ = true;
+      std::set_difference(std::begin(slots_),
+                          std::end(slots_),
+                          std::begin(newer.slots_),
+                          std::end(newer.slots_),
+                          std::back_inserter(removed.slots_));
+      removed.removed_.assign(removed.slots_.size(), 0);
+      removed.count_ = removed.slots_.size();
+      return removed;
+    }
+
+    removed.bitmap_ = bitmap_;
+    if (newer.sparse_)
+    {
+      newer.ForEach(0,
+                    num_slots_,
+                    [&](std::size_t slot)
+                    {
+                      removed.bitmap_[slot / kScanBitsPerWord] &=
+                        ~(1ULL << (slot % kScanBitsPerWord));
+                    });
+    }
+    else
+    {
+      AndNotScanBitmap(
+        removed.bitmap_.data(), newer.bitmap_.data(), bitmap_.size());
+    }
+
+    removed.Compact();
+    return removed;
+  }
+
+  // Adds back the candidates in a set returned by Diff.
+  void Merge(ScanResultSet const& removed)
+  {
+    HADESMEM_DETAIL_ASSERT(removed.num_slots_ == num_slots_);
+
+    if (sparse_ && removed.sparse_ &&
+        (count_ + removed.count_) * 40 < num_slots_)
+    {
+      std::vector<std::uint32_t> slots;
+      slots.reserve(count_ + removed.count_);
+      std::merge(std::begin(slots_),
+                 std::end(slots_),
+                 std::begin(removed.slots_),
+                 std::end(removed.slots_),
+                 std::back_inserter(slots));
+      slots_.swap(slots);
+      removed_.assign(slots_.size(), 0);
+      count_ = slots_.size();
+      return;
+    }
+
+    if (sparse_)
+    {
+      bitmap_.assign((num_slots_ + kScanBitsPerWord - 1) / kScanBitsPerWord,
+                     0);
+      SetBits(*this);
+      std::vector<std::uint32_t>().swap(slots_);
+      std::vector<std::uint8_t>().swap(removed_);
+      sparse_ = false;
+    }
+
+    if (removed.sparse_)
+    {
+      SetBits(removed);
+    }
+    else
+    {
+      OrScanBitmap(bitmap_.data(), removed.bitmap_.data(), bitmap_.size());
+    }
+
+    Compact();
+  }
+
+  // The format is only meant to be read back by the same build (e.g. when
+  // spilling history to a temporary file), so values are written as is. Sets
+  // must be compacted. Returns false if the stream fails.
+  bool Write(std::ostream& out) const
+  {
+    std::uint64_t const header[3] = {num_slots_, count_, sparse_};
+    out.write(reinterpret_cast<char const*>(header), sizeof(header));
+    if (sparse_)
+    {
+      out.write(reinterpret_cast<char const*>(slots_.data()),
+                static_cast<std::streamsize>(slots_.size() *
+                                             sizeof(std::uint32_t)));
+    }
+    else
+    {
+      out.write(reinterpret_cast<char const*>(bitmap_.data()),
+                static_cast<std::streamsize>(bitmap_.size() *
+                                             sizeof(std::uint64_t)));
+    }
+
+    return !!out;
+  }
+
+  // Returns false on truncated or malformed data.
+  bool Read(std::istream& in)
+  {
+    std::uint64_t header[3] = {};
+    in.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (static_cast<std::size_t>(in.gcount()) != sizeof(header) ||
+        header[0] > (std::numeric_limits<std::size_t>::max)() ||
+        header[1] > header[0] || header[2] > 1)
+    {
+      return false;
+    }
+
+    ScanResultSet set{0};
+    set.num_slots_ = static_cast<std::size_t>(header[0]);
+    set.count_ = static_cast<std::size_t>(header[1]);
+    set.sparse_ = !!header[2];
+    char* data = nullptr;
+    std::size_t len = 0;
+    if (set.sparse_)
+    {
+      set.slots_.resize(set.count_);
+      set.removed_.assign(set.count_, 0);
+      data = reinterpret_cast<char*>(set.slots_.data());
+      len = set.slots_.size() * sizeof(std::uint32_t);
+    }
+    else
+    {
+      set.bitmap_.resize((set.num_slots_ + kScanBitsPerWord - 1) /
+                         kScanBitsPerWord);
+      data = reinterpret_cast<char*>(set.bitmap_.data());
+      len = set.bitmap_.size() * sizeof(std::uint64_t);
+    }
+
+    in.read(data, static_cast<std::streamsize>(len));
+    if (static_cast<std::size_t>(in.gcount()) != len)
+    {
+      return false;
+    }
+
+    *this = std::move(set);
+    return true;
+  }
+
+private:
+  void SetBits(ScanResultSet const& other)
+  {
+    other.ForEach(0,
+                  num_slots_,
+                  [&](std::size_t slot)
+                  {
+                    bitmap_[slot / kScanBitsPerWord] |=
+                      1ULL << (slot % kScanBitsPerWord);
+                  });
+  }
+
+  // Indices into slots_ of the candidates in [first, last).
+  std::pair<std::size_t, std::size_t>
+    GetSparseRange(std::size_t first, std::size_t last) const noexcept
+  {
+    auto const beg = std::lower_bound(
+      std::begin(slots_), std::end(slots_), static_cast<std::uint32_t>(first));
+    auto const end = std::lower_bound(
+      beg, std::end(slots_), static_cast<std::uint32_t>(last));
+    return {static_cast<std::size_t>(beg - std::begin(slots_)),
+            static_cast<std::size_t>(end - std::begin(slots_))};
+  }
+
+  std::size_t num_slots_;
+  std::size_t count_;
+  bool sparse_;
+  std::vector<std::uint64_t> bitmap_;
+  std::vector<std::uint32_t> slots_;
+  std::vector<std::uint8_t> removed_;
+};
+}
+}
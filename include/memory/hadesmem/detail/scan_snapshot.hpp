@@ -0,0 +1,456 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include <hadesmem/detail/assert.hpp>
+
+// Page store used for scanner snapshots. Pages are stored once no matter how
+// many times they occur (zero pages aren't stored at all), and optionally
+// compressed with a simple LZ4 style block format. Each page is compressed
+// independently so that random access only ever has to decompress one page.
+
+// Like the other scanning cores, this only operates on local buffers and must
+// not depend on windows.h.
+
+// Compressed page layout (a sequence of LZ4 style sequences):
+//
+// Sequence: u8 token (literal length << 4 | match length - 4),
+//           [u8 extra literal length...], u8[literal length] literals,
+//           u16 match offset, [u8 extra match length...]
+//
+// A nibble of 15 is followed by extra length bytes which are added to it,
+// where 255 means another byte follows. The last sequence only has literals.
+
+namespace hadesmem
+{
+namespace detail
+{
+std::size_t const kScanPageSize = 0x1000;
+
+std::size_t const kScanLzMinMatch = 4;
+
+std::size_t const kScanLzHashBits = 12;
+
+// Stored pages are appended to blocks of this size.
+std::size_t const kScanStoreBlockSize = 16 * 1024 * 1024;
+
+// Id of the (implicit) page of all zeroes.
+std::uint32_t const kScanPageZero = 0;
+
+// Id of a page which couldn't be read.
+std::uint32_t const kScanPageMissing = 0xFFFFFFFFUL;
+
+inline std::uint32_t ReadScanLzU32(std::uint8_t const* p) noexcept
+{
+  std::uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+inline std::uint32_t HashScanLz(std::uint32_t value) noexcept
+{
+  return static_cast<std::uint32_t>(value * 2654435761U) >>
+         (32 - kScanLzHashBits);
+}
+
+inline std::size_t GetScanLzLengthSize(std::size_t len) noexcept
+{
+  return len < 15 ? 0 : (len - 15) / 255 + 1;
+}
+
+inline void WriteScanLzLength(std::uint8_t*& out, std::size_t len) noexcept
+{
+  for (len -= 15; len >= 255; len -= 255)
+  {
+    *out++ = 255;
+  }
+
+  *out++ = static_cast<std::uint8_t>(len);
+}
+
+inline bool ReadScanLzLength(std::uint8_t const*& in,
+                             std::uint8_t const* in_end,
+                             std::size_t& len) noexcept
+{
+  std::uint8_t b = 0;
+  do
+  {
+    if (in == in_end)
+    {
+      return false;
+    }
+
+    b = *in++;
+    len += b;
+  } while (b == 255);
+
+  return true;
+}
+
+// Returns the compressed size, or zero if it would be larger than dst_cap
+// (in which case the page should be stored as is). Pages are small enough
+// that every match offset fits in 16 bits.
+inline std::size_t CompressScanPage(std::uint8_t const* src,
+                                    std::size_t len,
+                                    std::uint8_t* dst,
+                                    std::size_t dst_cap) noexcept
+{
+  HADESMEM_DETAIL_ASSERT(len < 0x10000);
+
+  // Positions are stored plus one so that zero means empty.
+  std::uint16_t table[1 << kScanLzHashBits] = {};
+  std::uint8_t* out = dst;
+  std::uint8_t* const out_end = dst + dst_cap;
+  std::size_t anchor = 0;
+
+  auto const emit = [&](std::size_t lit_len, std::size_t offset,
+                        std::size_t match_len)
+  {
+    std::size_t const extra = match_len ? match_len - kScanLzMinMatch : 0;
+    std::size_t const size = 1 + GetScanLzLengthSize(lit_len) + lit_len +
+                             (match_len ? 2 + GetScanLzLengthSize(extra) : 0);
+    if (size > static_cast<std::size_t>(out_end - out))
+    {
+      return false;
+    }
+
+    *out++ = static_cast<std::uint8_t>(((std::min)(lit_len, std::size_t(15))
+                                        << 4) |
+                                       (std::min)(extra, std::size_t(15)));
+    if (lit_len >= 15)
+    {
+      WriteScanLzLength(out, lit_len);
+    }
+
+    std::memcpy(out, src + anchor, lit_len);
+    out += lit_len;
+
+    if (match_len)
+    {
+      *out++ = static_cast<std::uint8_t>(offset);
+      *out++ = static_cast<std::uint8_t>(offset >> 8);
+      if (extra >= 15)
+      {
+        WriteScanLzLength(out, extra);
+      }
+    }
+
+    return true;
+  };
+
+  std::size_t i = 0;
+  while (i + kScanLzMinMatch <= len)
+  {
+    std::uint32_t const cur = ReadScanLzU32(src + i);
+    std::uint32_t const hash = HashScanLz(cur);
+    std::size_t const candidate = table[hash];
+    table[hash] = static_cast<std::uint16_t>(i + 1);
+    if (!candidate || ReadScanLzU32(src + candidate - 1) != cur)
+    {
+      // Skip ahead faster the longer we go without a match, so incompressible
+      // data is rejected quickly.
+      i += 1 + ((i - anchor) >> 6);
+      continue;
+    }
+
+    std::size_t const match = candidate - 1;
+    std::size_t match_len = kScanLzMinMatch;
+    while (i + match_len < len && src[match + match_len] == src[i + match_len])
+    {
+      ++match_len;
+    }
+
+    if (!emit(i - anchor, i - match, match_len))
+    {
+      return 0;
+    }
+
+    i += match_len;
+    anchor = i;
+  }
+
+  if (!emit(len - anchor, 0, 0))
+  {
+    return 0;
+  }
+
+  return static_cast<std::size_t>(out - dst);
+}
+
+// Returns false if the data is corrupt or doesn't decompress to exactly
+// dst_len bytes.
+inline bool DecompressScanPage(std::uint8_t const* src,
+                               std::size_t src_len,
+                               std::uint8_t* dst,
+                               std::size_t dst_len) noexcept
+{
+  std::uint8_t const* in = src;
+  std::uint8_t const* const in_end = src + src_len;
+  std::size_t out = 0;
+  for (;;)
+  {
+    if (in == in_end)
+    {
+      return false;
+    }
+
+    std::uint8_t const token = *in++;
+    std::size_t lit_len = token >> 4;
+    if (lit_len == 15 && !ReadScanLzLength(in, in_end, lit_len))
+    {
+      return false;
+    }
+
+    if (lit_len > static_cast<std::size_t>(in_end - in) ||
+        lit_len > dst_len - out)
+    {
+      return false;
+    }
+
+    std::memcpy(dst + out, in, lit_len);
+    in += lit_len;
+    out += lit_len;
+
+    if (in == in_end)
+    {
+      return out == dst_len;
+    }
+
+    if (in_end - in < 2)
+    {
+      return false;
+    }
+
+    std::size_t const offset = in[0] | (static_cast<std::size_t>(in[1]) << 8);
+    in += 2;
+    if (!offset || offset > out)
+    {
+      return false;
+    }
+
+    std::size_t match_len = token & 0xF;
+    if (match_len == 15 && !ReadScanLzLength(in, in_end, match_len))
+    {
+      return false;
+    }
+
+    match_len += kScanLzMinMatch;
+    if (match_len > dst_len - out)
+    {
+      return false;
+    }
+
+    // Matches can overlap themselves (e.g. runs), so this has to be a
+    // forward byte copy.
+    for (std::size_t j = 0; j < match_len; ++j, ++out)
+    {
+      dst[out] = dst[out - offset];
+    }
+  }
+}
+
+inline bool IsScanPageZero(std::uint8_t const* page) noexcept
+{
+  std::uint64_t acc = 0;
+  for (std::size_t i = 0; i < kScanPageSize; i += sizeof(std::uint64_t))
+  {
+    std::uint64_t value;
+    std::memcpy(&value, page + i, sizeof(value));
+    acc |= value;
+  }
+
+  return !acc;
+}
+
+// Only used to find duplicate candidates (which are then compared in full),
+// so it just needs to be fast and reasonably well distributed.
+inline std::uint64_t HashScanPage(std::uint8_t const* data,
+                                  std::size_t len) noexcept
+{
+  std::uint64_t const kMul = 0x9E3779B97F4A7C15ULL;
+  std::uint64_t lanes[4] = {
+    kMul, kMul ^ 0x1234567ULL, kMul ^ 0x89ABCDEFULL, kMul ^ len};
+  std::size_t i = 0;
+  for (; i + 32 <= len; i += 32)
+  {
+    for (std::size_t j = 0; j < 4; ++j)
+    {
+      std::uint64_t value;
+      std::memcpy(&value, data + i + j * 8, sizeof(value));
+      lanes[j] = (lanes[j] ^ value) * kMul;
+      lanes[j] ^= lanes[j] >> 29;
+    }
+  }
+
+  std::uint64_t hash = lanes[0] ^ (lanes[1] << 1) ^ (lanes[2] << 2) ^
+                       (lanes[3] << 3);
+  for (; i < len; ++i)
+  {
+    hash = (hash ^ data[i]) * kMul;
+  }
+
+  return hash ^ (hash >> 32);
+}
+
+// A page prepared for insertion into a ScanPageStore. This is the expensive
+// part (hashing and compression), so it is done on the worker threads and
+// only the insertion itself needs to be serialized.
+struct ScanPackedPage
+{
+  bool zero;
+  std::uint64_t hash;
+  std::uint8_t const* data;
+  std::size_t size;
+};
+
+// scratch must be at least kScanPageSize bytes and outlive the packed page.
+inline ScanPackedPage PackScanPage(std::uint8_t const* page,
+                                   bool compress,
+                                   std::uint8_t* scratch) noexcept
+{
+  if (IsScanPageZero(page))
+  {
+    return ScanPackedPage{true, 0, nullptr, 0};
+  }
+
+  std::size_t const size =
+    compress ? CompressScanPage(page, kScanPageSize, scratch, kScanPageSize - 1)
+             : 0;
+  std::uint8_t const* const data = size ? scratch : page;
+  std::size_t const data_size = size ? size : kScanPageSize;
+  return ScanPackedPage{
+    false, HashScanPage(data, data_size), data, data_size};
+}
+
+class ScanPageStore
+{
+public:
+  ScanPageStore()
+  {
+    // The zero page is implicit and has no data.
+    entries_.push_back(Entry{0, 0, 0});
+  }
+
+  // Not thread-safe. Returns the id of an existing page if it has the same
+  // contents. Compression is deterministic, so equal compressed data means
+  // equal pages.
+  std::uint32_t Add(ScanPackedPage const& packed)
+  {
+    ++num_pages_;
+
+    if (packed.zero)
+    {
+      ++num_zero_pages_;
+      return kScanPageZero;
+    }
+
+    auto const range = hashes_.equal_range(packed.hash);
+    for (auto iter = range.first; iter != range.second; ++iter)
+    {
+      Entry const& entry = entries_[iter->second];
+      if (entry.size == packed.size &&
+          !std::memcmp(GetData(entry), packed.data, packed.size))
+      {
+        ++num_duplicate_pages_;
+        return iter->second;
+      }
+    }
+
+    if (blocks_.empty() ||
+        blocks_.back().capacity() - blocks_.back().size() < packed.size)
+    {
+      blocks_.emplace_back();
+      blocks_.back().reserve((std::max)(kScanStoreBlockSize, packed.size));
+    }
+
+    auto& block = blocks_.back();
+    Entry const entry{static_cast<std::uint32_t>(blocks_.size() - 1),
+                      static_cast<std::uint32_t>(block.size()),
+                      static_cast<std::uint32_t>(packed.size)};
+    block.insert(std::end(block), packed.data, packed.data + packed.size);
+    stored_size_ += packed.size;
+
+    HADESMEM_DETAIL_ASSERT(entries_.size() < kScanPageMissing);
+    auto const id = static_cast<std::uint32_t>(entries_.size());
+    entries_.push_back(entry);
+    hashes_.emplace(packed.hash, id);
+    return id;
+  }
+
+  // Returns false if the page is missing or corrupt.
+  bool Get(std::uint32_t id, std::uint8_t* page) const noexcept
+  {
+    if (id == kScanPageZero)
+    {
+      std::memset(page, 0, kScanPageSize);
+      return true;
+    }
+
+    if (id >= entries_.size())
+    {
+      return false;
+    }
+
+    Entry const& entry = entries_[id];
+    if (entry.size == kScanPageSize)
+    {
+      std::memcpy(page, GetData(entry), kScanPageSize);
+      return true;
+    }
+
+    return DecompressScanPage(GetData(entry), entry.size, page, kScanPageSize);
+  }
+
+  std::size_t GetNumPages() const noexcept
+  {
+    return num_pages_;
+  }
+
+  std::size_t GetNumZeroPages() const noexcept
+  {
+    return num_zero_pages_;
+  }
+
+  std::size_t GetNumDuplicatePages() const noexcept
+  {
+    return num_duplicate_pages_;
+  }
+
+  std::size_t GetStoredSize() const noexcept
+  {
+    return stored_size_;
+  }
+
+private:
+  struct Entry
+  {
+    std::uint32_t block;
+    std::uint32_t offset;
+    std::uint32_t size;
+  };
+
+  std::uint8_t const* GetData(Entry const& entry) const noexcept
+  {
+    return blocks_[entry.block].data() + entry.offset;
+  }
+
+  // Blocks are never reallocated once created, so entries stay valid without
+  // having to move everything stored so far.
+  std::vector<std::vector<std::uint8_t>> blocks_;
+  std::vector<Entry> entries_;
+  std::unordered_multimap<std::uint64_t, std::uint32_t> hashes_;
+  std::size_t num_pages_{};
+  std::size_t num_zero_pages_{};
+  std::size_t num_duplicate_pages_{};
+  std::size_t stored_size_{};
+};
+}
+}
@@ -0,0 +1,279 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <regex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/pattern_data.hpp>
+#include <hadesmem/detail/pattern_search.hpp>
+
+// String scanning core used by Scanner. Strings are turned into masked byte
+// needles for the pattern search cores, so case insensitivity and wildcards
+// cost nothing extra in the vectorized compares. Narrow strings are matched
+// as ASCII and wide strings as UTF-16LE. Like the other scanning cores, this
+// only operates on local buffers and must not depend on windows.h.
+
+namespace hadesmem
+{
+namespace detail
+{
+template <typename CharT> struct ScanStringUnitSize
+{
+  static std::size_t const value = sizeof(CharT) == 1 ? 1 : 2;
+};
+
+// Letters whose cases only differ in bit 5, so that a masked compare against
+// 0xDF matches both. Narrow strings only fold ASCII (anything higher depends
+// on the code page), wide strings also fold Latin-1.
+template <typename CharT>
+inline bool IsScanStringFoldable(std::uint32_t unit) noexcept
+{
+  std::uint32_t const upper = unit & ~0x20U;
+  if (upper >= 'A' && upper <= 'Z')
+  {
+    return true;
+  }
+
+  return ScanStringUnitSize<CharT>::value == 2 && upper >= 0xC0 &&
+         upper <= 0xDE && upper != 0xD7;
+}
+
+// A wildcard matches any single character.
+template <typename CharT>
+std::vector<PatternDataByte>
+  MakeScanStringNeedle(std::basic_string<CharT> const& str,
+                       bool case_insensitive,
+                       bool wildcard)
+{
+  std::vector<PatternDataByte> needle;
+  needle.reserve(str.size() * ScanStringUnitSize<CharT>::value);
+  for (auto const c : str)
+  {
+    auto const unit = static_cast<std::uint32_t>(
+      static_cast<typename std::make_unsigned<CharT>::type>(c));
+    HADESMEM_DETAIL_ASSERT(unit <= 0xFFFF);
+
+    std::uint8_t const mask =
+      wildcard && c == static_cast<CharT>('?')
+        ? 0x00
+        : case_insensitive && IsScanStringFoldable<CharT>(unit) ? 0xDF : 0xFF;
+    needle.push_back(PatternDataByte{
+      static_cast<std::uint8_t>(unit & mask), mask});
+    if (ScanStringUnitSize<CharT>::value == 2)
+    {
+      std::uint8_t const high_mask = mask ? 0xFF : 0x00;
+      needle.push_back(PatternDataByte{
+        static_cast<std::uint8_t>((unit >> 8) & high_mask), high_mask});
+    }
+  }
+
+  return needle;
+}
+
+template <typename CharT>
+void LoadScanStringUnits(std::uint8_t const* buf,
+                         std::size_t count,
+                         std::vector<CharT>& units)
+{
+  units.resize(count);
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    if (ScanStringUnitSize<CharT>::value == 1)
+    {
+      units[i] = static_cast<CharT>(buf[i]);
+    }
+    else
+    {
+      units[i] = static_cast<CharT>(buf[i * 2] | (buf[i * 2 + 1] << 8));
+    }
+  }
+}
+
+// Finds the longest run of literal characters (ECMAScript syntax) which every
+// match of the regex must contain, so that it can be used as a prefilter.
+// This is deliberately conservative: anything inside a group or class,
+// anything quantified, and any regex with an alternation is ignored. Returns
+// an empty string if there is no such run.
+template <typename CharT>
+std::basic_string<CharT>
+  GetScanRegexLiteral(std::basic_string<CharT> const& regex)
+{
+  std::basic_string<CharT> best;
+  std::basic_string<CharT> run;
+  auto const flush = [&]()
+  {
+    if (run.size() > best.size())
+    {
+      best = run;
+    }
+
+    run.clear();
+  };
+
+  std::size_t depth = 0;
+  for (std::size_t i = 0; i < regex.size(); ++i)
+  {
+    CharT const c = regex[i];
+    switch (c)
+    {
+    case '|':
+      return std::basic_string<CharT>();
+
+    case '\\':
+      flush();
+      if (i + 1 < regex.size())
+      {
+        CharT const e = regex[++i];
+        if (e == 'x')
+        {
+          i += 2;
+        }
+        else if (e == 'u')
+        {
+          i += 4;
+        }
+        else if (e == 'c')
+        {
+          i += 1;
+        }
+        else
+        {
+          while (e >= '0' && e <= '9' && i + 1 < regex.size() &&
+                 regex[i + 1] >= '0' && regex[i + 1] <= '9')
+          {
+            ++i;
+          }
+        }
+      }
+      break;
+
+    case '[':
+      flush();
+      // A ] right after the [ (or [^) is a literal.
+      if (i + 1 < regex.size() && regex[i + 1] == '^')
+      {
+        ++i;
+      }
+
+      if (i + 1 < regex.size() && regex[i + 1] == ']')
+      {
+        ++i;
+      }
+
+      for (++i; i < regex.size() && regex[i] != ']'; ++i)
+      {
+        if (regex[i] == '\\')
+        {
+          ++i;
+        }
+      }
+      break;
+
+    case '(':
+      flush();
+      ++depth;
+      break;
+
+    case ')':
+      flush();
+      depth -= !!depth;
+      break;
+
+    case '*':
+    case '?':
+    case '{':
+      // The previous character is optional.
+      if (!run.empty())
+      {
+        run.pop_back();
+      }
+
+      flush();
+      if (c == '{')
+      {
+        while (i < regex.size() && regex[i] != '}')
+        {
+          ++i;
+        }
+      }
+      break;
+
+    case '+':
+      // The previous character is required, but what follows isn't next to
+      // it.
+      flush();
+      break;
+
+    case '.':
+    case '^':
+    case '$':
+      flush();
+      break;
+
+    default:
+      if (!depth)
+      {
+        run.push_back(c);
+      }
+      break;
+    }
+  }
+
+  flush();
+  return best;
+}
+
+// Calls callback(offset, len) for matches of the regex around a prefilter hit
+// at hit (a byte offset into the len byte buffer), in a window of max_length
+// characters either side of it. Only matches which start in [0, scan_len),
+// include the hit, and are no longer than max_length characters are
+// reported. Matches are found like std::regex_iterator would within the
+// window, and can be reported more than once for nearby hits.
+template <typename CharT, typename Callback>
+void MatchScanRegex(std::basic_regex<CharT> const& regex,
+                    std::uint8_t const* buf,
+                    std::size_t len,
+                    std::size_t scan_len,
+                    std::size_t hit,
+                    std::size_t max_length,
+                    std::vector<CharT>& units,
+                    Callback callback)
+{
+  std::size_t const unit_size = ScanStringUnitSize<CharT>::value;
+  std::size_t const before = (std::min)(hit / unit_size, max_length);
+  std::size_t const after = (std::min)((len - hit) / unit_size, max_length);
+  std::size_t const beg = hit - before * unit_size;
+  LoadScanStringUnits(buf + beg, before + after, units);
+
+  using Iterator = typename std::vector<CharT>::const_iterator;
+  std::regex_iterator<Iterator> const end;
+  for (std::regex_iterator<Iterator> iter{
+         std::begin(units), std::end(units), regex};
+       iter != end;
+       ++iter)
+  {
+    auto const position = static_cast<std::size_t>(iter->position());
+    auto const length = static_cast<std::size_t>(iter->length());
+    std::size_t const offset = beg + position * unit_size;
+    if (position > before)
+    {
+      break;
+    }
+
+    if (offset < scan_len && position + length > before &&
+        length <= max_length)
+    {
+      callback(offset, length * unit_size);
+    }
+  }
+}
+}
+}
@@ -0,0 +1,965 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/simd.hpp>
+#include <hadesmem/detail/static_assert.hpp>
+
+// Value scanning core used by Scanner. Like the pattern search cores, this
+// only operates on local buffers and must not depend on windows.h.
+
+namespace hadesmem
+{
+namespace detail
+{
+template <typename T> struct IsScanValueType
+{
+  static bool const value = std::is_arithmetic<T>::value &&
+                            (sizeof(T) == 1 || sizeof(T) == 2 ||
+                             sizeof(T) == 4 || sizeof(T) == 8);
+};
+
+// The vectorized compares produce one bit per byte (as per movemask). A lane
+// matches when all of its bits are set, and is reported at its first bit.
+inline std::uint32_t GetScanLaneMask(std::uint32_t byte_mask,
+                                     std::size_t lane_size) noexcept
+{
+  std::uint32_t const kLaneStarts[] = {
+    0xFFFFFFFFUL, 0x55555555UL, 0, 0x11111111UL, 0, 0, 0, 0x01010101UL};
+  std::uint32_t lanes = byte_mask;
+  for (std::size_t i = 1; i < lane_size; ++i)
+  {
+    lanes &= byte_mask >> i;
+  }
+
+  return lanes & kLaneStarts[lane_size - 1];
+}
+
+#if defined(HADESMEM_DETAIL_SIMD_SSE2)
+template <typename T> inline __m128i SetScanValueSse2(T value) noexcept
+{
+  std::uint8_t buf[16];
+  for (std::size_t i = 0; i < sizeof(buf); i += sizeof(T))
+  {
+    std::memcpy(&buf[i], &value, sizeof(T));
+  }
+
+  return _mm_loadu_si128(reinterpret_cast<__m128i const*>(buf));
+}
+
+// Integers are compared bytewise. Floating point values need a real compare
+// so that +0.0 matches -0.0 and NaN never matches, like the scalar path.
+template <typename T>
+inline std::uint32_t CompareScanValueSse2(__m128i block,
+                                          __m128i value,
+                                          T* /*tag*/) noexcept
+{
+  return static_cast<std::uint32_t>(
+    _mm_movemask_epi8(_mm_cmpeq_epi8(block, value)));
+}
+
+inline std::uint32_t CompareScanValueSse2(__m128i block,
+                                          __m128i value,
+                                          float* /*tag*/) noexcept
+{
+  return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_castps_si128(
+    _mm_cmpeq_ps(_mm_castsi128_ps(block), _mm_castsi128_ps(value)))));
+}
+
+inline std::uint32_t CompareScanValueSse2(__m128i block,
+                                          __m128i value,
+                                          double* /*tag*/) noexcept
+{
+  return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_castpd_si128(
+    _mm_cmpeq_pd(_mm_castsi128_pd(block), _mm_castsi128_pd(value)))));
+}
+
+template <typename T, typename Callback>
+void ScanValueSse2(std::uint8_t const* buf,
+                   std::size_t len,
+                   T value,
+                   std::size_t& offset,
+                   Callback& callback)
+{
+  __m128i const value_vec = SetScanValueSse2(value);
+  for (; len - offset >= 16; offset += 16)
+  {
+    __m128i const block =
+      _mm_loadu_si128(reinterpret_cast<__m128i const*>(buf + offset));
+    std::uint32_t lanes = GetScanLaneMask(
+      CompareScanValueSse2(block, value_vec, static_cast<T*>(nullptr)),
+      sizeof(T));
+    for (; lanes; lanes &= lanes - 1)
+    {
+      callback(offset + CountTrailingZeros(lanes));
+    }
+  }
+}
+#endif // #if defined(HADESMEM_DETAIL_SIMD_SSE2)
+
+#if defined(HADESMEM_DETAIL_SIMD_AVX2)
+template <typename T>
+HADESMEM_DETAIL_TARGET_AVX2 inline std::uint32_t
+  CompareScanValueAvx2(__m256i block, __m256i value, T* /*tag*/) noexcept
+{
+  return static_cast<std::uint32_t>(
+    _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, value)));
+}
+
+HADESMEM_DETAIL_TARGET_AVX2 inline std::uint32_t
+  CompareScanValueAvx2(__m256i block, __m256i value, float* /*tag*/) noexcept
+{
+  return static_cast<std::uint32_t>(
+    _mm256_movemask_epi8(_mm256_castps_si256(_mm256_cmp_ps(
+      _mm256_castsi256_ps(block), _mm256_castsi256_ps(value), _CMP_EQ_OQ))));
+}
+
+HADESMEM_DETAIL_TARGET_AVX2 inline std::uint32_t
+  CompareScanValueAvx2(__m256i block, __m256i value, double* /*tag*/) noexcept
+{
+  return static_cast<std::uint32_t>(
+    _mm256_movemask_epi8(_mm256_castpd_si256(_mm256_cmp_pd(
+      _mm256_castsi256_pd(block), _mm256_castsi256_pd(value), _CMP_EQ_OQ))));
+}
+
+template <typename T, typename Callback>
+HADESMEM_DETAIL_TARGET_AVX2 void ScanValueAvx2(std::uint8_t const* buf,
+                                               std::size_t len,
+                                               T value,
+                                               std::size_t& offset,
+                                               Callback& callback)
+{
+  __m128i const value_half = SetScanValueSse2(value);
+  __m256i const value_vec = _mm256_set_m128i(value_half, value_half);
+  for (; len - offset >= 32; offset += 32)
+  {
+    __m256i const block =
+      _mm256_loadu_si256(reinterpret_cast<__m256i const*>(buf + offset));
+    std::uint32_t lanes = GetScanLaneMask(
+      CompareScanValueAvx2(block, value_vec, static_cast<T*>(nullptr)),
+      sizeof(T));
+    for (; lanes; lanes &= lanes - 1)
+    {
+      callback(offset + CountTrailingZeros(lanes));
+    }
+  }
+}
+#endif // #if defined(HADESMEM_DETAIL_SIMD_AVX2)
+
+// Calls callback(offset) for every offset in the buffer which is a multiple of
+// alignment and holds the value. The buffer is assumed to start at an address
+// which is suitably aligned in the target. Naturally aligned scans (the
+// common case) are vectorized.
+template <typename T, typename Callback>
+void ScanValue(std::uint8_t const* beg,
+               std::uint8_t const* end,
+               T value,
+               std::size_t alignment,
+               Callback callback)
+{
+  HADESMEM_DETAIL_STATIC_ASSERT(IsScanValueType<T>::value);
+  HADESMEM_DETAIL_ASSERT(beg <= end);
+  HADESMEM_DETAIL_ASSERT(alignment != 0);
+
+  auto const len = static_cast<std::size_t>(end - beg);
+  std::size_t offset = 0;
+
+  if (alignment == sizeof(T))
+  {
+#if defined(HADESMEM_DETAIL_SIMD_AVX2)
+    if (IsAvx2Supported())
+    {
+      ScanValueAvx2(beg, len, value, offset, callback);
+    }
+#endif // #if defined(HADESMEM_DETAIL_SIMD_AVX2)
+
+#if defined(HADESMEM_DETAIL_SIMD_SSE2)
+    ScanValueSse2(beg, len, value, offset, callback);
+#endif // #if defined(HADESMEM_DETAIL_SIMD_SSE2)
+  }
+
+  for (; len >= sizeof(T) && offset <= len - sizeof(T); offset += alignment)
+  {
+    T cur;
+    std::memcpy(&cur, beg + offset, sizeof(T));
+    if (cur == value)
+    {
+      callback(offset);
+    }
+  }
+}
+
+// Integer ranges are checked as (x - low) <= (high - low) (unsigned), which
+// only needs one compare. Floating point ranges need two, so the vectors hold
+// low and high.
+template <typename T>
+inline T GetScanRangeSpan(T low, T high, std::false_type /*floating*/) noexcept
+{
+  using Unsigned = typename std::make_unsigned<T>::type;
+  return static_cast<T>(static_cast<Unsigned>(high) -
+                        static_cast<Unsigned>(low));
+}
+
+template <typename T>
+inline T
+  GetScanRangeSpan(T /*low*/, T high, std::true_type /*floating*/) noexcept
+{
+  return high;
+}
+
+template <typename T> struct IsScanRangeVectorized
+{
+  static bool const value =
+    std::is_floating_point<T>::value ||
+    (std::is_integral<T>::value && !std::is_same<T, bool>::value);
+};
+
+#if defined(HADESMEM_DETAIL_SIMD_SSE2)
+inline __m128i SubScanValuesSse2(__m128i lhs,
+                                 __m128i rhs,
+                                 std::integral_constant<std::size_t, 1>)
+{
+  return _mm_sub_epi8(lhs, rhs);
+}
+
+inline __m128i SubScanValuesSse2(__m128i lhs,
+                                 __m128i rhs,
+                                 std::integral_constant<std::size_t, 2>)
+{
+  return _mm_sub_epi16(lhs, rhs);
+}
+
+inline __m128i SubScanValuesSse2(__m128i lhs,
+                                 __m128i rhs,
+                                 std::integral_constant<std::size_t, 4>)
+{
+  return _mm_sub_epi32(lhs, rhs);
+}
+
+inline __m128i SubScanValuesSse2(__m128i lhs,
+                                 __m128i rhs,
+                                 std::integral_constant<std::size_t, 8>)
+{
+  return _mm_sub_epi64(lhs, rhs);
+}
+
+// Unsigned lhs > rhs.
+inline __m128i CompareScanGreaterSse2(__m128i lhs,
+                                      __m128i rhs,
+                                      std::integral_constant<std::size_t, 1>)
+{
+  return _mm_xor_si128(
+    _mm_cmpeq_epi8(_mm_subs_epu8(lhs, rhs), _mm_setzero_si128()),
+    _mm_set1_epi8(-1));
+}
+
+inline __m128i CompareScanGreaterSse2(__m128i lhs,
+                                      __m128i rhs,
+                                      std::integral_constant<std::size_t, 2>)
+{
+  return _mm_xor_si128(
+    _mm_cmpeq_epi16(_mm_subs_epu16(lhs, rhs), _mm_setzero_si128()),
+    _mm_set1_epi8(-1));
+}
+
+inline __m128i CompareScanGreaterSse2(__m128i lhs,
+                                      __m128i rhs,
+                                      std::integral_constant<std::size_t, 4>)
+{
+  __m128i const sign = _mm_set1_epi32(static_cast<int>(0x80000000UL));
+  return _mm_cmpgt_epi32(_mm_xor_si128(lhs, sign), _mm_xor_si128(rhs, sign));
+}
+
+// SSE2 has no 64-bit compares, so compare the high halves and fall back to
+// the low halves if they're equal.
+inline __m128i CompareScanGreaterSse2(__m128i lhs,
+                                      __m128i rhs,
+                                      std::integral_constant<std::size_t, 8>)
+{
+  __m128i const sign = _mm_set1_epi32(static_cast<int>(0x80000000UL));
+  __m128i const lhs_flipped = _mm_xor_si128(lhs, sign);
+  __m128i const rhs_flipped = _mm_xor_si128(rhs, sign);
+  __m128i const greater = _mm_cmpgt_epi32(lhs_flipped, rhs_flipped);
+  __m128i const equal = _mm_cmpeq_epi32(lhs_flipped, rhs_flipped);
+  __m128i const greater_low =
+    _mm_shuffle_epi32(greater, _MM_SHUFFLE(2, 2, 0, 0));
+  __m128i const greater_high =
+    _mm_shuffle_epi32(greater, _MM_SHUFFLE(3, 3, 1, 1));
+  __m128i const equal_high = _mm_shuffle_epi32(equal, _MM_SHUFFLE(3, 3, 1, 1));
+  return _mm_or_si128(greater_high, _mm_and_si128(equal_high, greater_low));
+}
+
+template <typename T>
+inline std::uint32_t CompareScanRangeSse2(__m128i block,
+                                          __m128i low,
+                                          __m128i span,
+                                          T* /*tag*/) noexcept
+{
+  std::integral_constant<std::size_t, sizeof(T)> const size{};
+  return static_cast<std::uint32_t>(
+    _mm_movemask_epi8(CompareScanGreaterSse2(
+      SubScanValuesSse2(block, low, size), span, size))) ^
+         0xFFFFU;
+}
+
+inline std::uint32_t CompareScanRangeSse2(__m128i block,
+                                          __m128i low,
+                                          __m128i high,
+                                          float* /*tag*/) noexcept
+{
+  __m128 const value = _mm_castsi128_ps(block);
+  return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_castps_si128(
+    _mm_and_ps(_mm_cmpge_ps(value, _mm_castsi128_ps(low)),
+               _mm_cmple_ps(value, _mm_castsi128_ps(high))))));
+}
+
+inline std::uint32_t CompareScanRangeSse2(__m128i block,
+                                          __m128i low,
+                                          __m128i high,
+                                          double* /*tag*/) noexcept
+{
+  __m128d const value = _mm_castsi128_pd(block);
+  return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_castpd_si128(
+    _mm_and_pd(_mm_cmpge_pd(value, _mm_castsi128_pd(low)),
+               _mm_cmple_pd(value, _mm_castsi128_pd(high))))));
+}
+
+template <typename T, typename Callback>
+void ScanValueRangeSse2(std::uint8_t const* buf,
+                        std::size_t len,
+                        T low,
+                        T span,
+                        std::size_t& offset,
+                        Callback& callback)
+{
+  __m128i const low_vec = SetScanValueSse2(low);
+  __m128i const span_vec = SetScanValueSse2(span);
+  for (; len - offset >= 16; offset += 16)
+  {
+    __m128i const block =
+      _mm_loadu_si128(reinterpret_cast<__m128i const*>(buf + offset));
+    std::uint32_t lanes = GetScanLaneMask(
+      CompareScanRangeSse2(
+        block, low_vec, span_vec, static_cast<T*>(nullptr)),
+      sizeof(T));
+    for (; lanes; lanes &= lanes - 1)
+    {
+      callback(offset + CountTrailingZeros(lanes));
+    }
+  }
+}
+#endif // #if defined(HADESMEM_DETAIL_SIMD_SSE2)
+
+#if defined(HADESMEM_DETAIL_SIMD_AVX2)
+HADESMEM_DETAIL_TARGET_AVX2 inline __m256i
+  SubScanValuesAvx2(__m256i lhs,
+                    __m256i rhs,
+                    std::integral_constant<std::size_t, 1>)
+{
+  return _mm256_sub_epi8(lhs, rhs);
+}
+
+HADESMEM_DETAIL_TARGET_AVX2 inline __m256i
+  SubScanValuesAvx2(__m256i lhs,
+                    __m256i rhs,
+                    std::integral_constant<std::size_t, 2>)
+{
+  return _mm256_sub_epi16(lhs, rhs);
+}
+
+HADESMEM_DETAIL_TARGET_AVX2 inline __m256i
+  SubScanValuesAvx2(__m256i lhs,
+                    __m256i rhs,
+                    std::integral_constant<std::size_t, 4>)
+{
+  return _mm256_sub_epi32(lhs, rhs);
+}
+
+HADESMEM_DETAIL_TARGET_AVX2 inline __m256i
+  SubScanValuesAvx2(__m256i lhs,
+                    __m256i rhs,
+                    std::integral_constant<std::size_t, 8>)
+{
+  return _mm256_sub_epi64(lhs, rhs);
+}
+
+// Unsigned lhs > rhs.
+HADESMEM_DETAIL_TARGET_AVX2 inline __m256i
+  CompareScanGreaterAvx2(__m256i lhs,
+                         __m256i rhs,
+                         std::integral_constant<std::size_t, 1>)
+{
+  return _mm256_xor_si256(
+    _mm256_cmpeq_epi8(_mm256_subs_epu8(lhs, rhs), _mm256_setzero_si256()),
+    _mm256_set1_epi8(-1));
+}
+
+HADESMEM_DETAIL_TARGET_AVX2 inline __m256i
+  CompareScanGreaterAvx2(__m256i lhs,
+                         __m256i rhs,
+                         std::integral_constant<std::size_t, 2>)
+{
+  return _mm256_xor_si256(
+    _mm256_cmpeq_epi16(_mm256_subs_epu16(lhs, rhs), _mm256_setzero_si256()),
+    _mm256_set1_epi8(-1));
+}
+
+HADESMEM_DETAIL_TARGET_AVX2 inline __m256i
+  CompareScanGreaterAvx2(__m256i lhs,
+                         __m256i rhs,
+                         std::integral_constant<std::size_t, 4>)
+{
+  __m256i const sign = _mm256_set1_epi32(static_cast<int>(0x80000000UL));
+  return _mm256_cmpgt_epi32(_mm256_xor_si256(lhs, sign),
+                            _mm256_xor_si256(rhs, sign));
+}
+
+HADESMEM_DETAIL_TARGET_AVX2 inline __m256i
+  CompareScanGreaterAvx2(__m256i lhs,
+                         __m256i rhs,
+                         std::integral_constant<std::size_t, 8>)
+{
+  __m256i const sign =
+    _mm256_set1_epi64x(static_cast<long long>(0x8000000000000000ULL));
+  return _mm256_cmpgt_epi64(_mm256_xor_si256(lhs, sign),
+                            _mm256_xor_si256(rhs, sign));
+}
+
+template <typename T>
+HADESMEM_DETAIL_TARGET_AVX2 inline std::uint32_t
+  CompareScanRangeAvx2(__m256i block,
+                       __m256i low,
+                       __m256i span,
+                       T* /*tag*/) noexcept
+{
+  std::integral_constant<std::size_t, sizeof(T)> const size{};
+  return ~static_cast<std::uint32_t>(_mm256_movemask_epi8(
+    CompareScanGreaterAvx2(SubScanValuesAvx2(block, low, size), span, size)));
+}
+
+HADESMEM_DETAIL_TARGET_AVX2 inline std::uint32_t
+  CompareScanRangeAvx2(__m256i block,
+                       __m256i low,
+                       __m256i high,
+                       float* /*tag*/) noexcept
+{
+  __m256 const value = _mm256_castsi256_ps(block);
+  return static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_castps_si256(
+    _mm256_and_ps(_mm256_cmp_ps(value, _mm256_castsi256_ps(low), _CMP_GE_OQ),
+                  _mm256_cmp_ps(
+                    value, _mm256_castsi256_ps(high), _CMP_LE_OQ)))));
+}
+
+HADESMEM_DETAIL_TARGET_AVX2 inline std::uint32_t
+  CompareScanRangeAvx2(__m256i block,
+                       __m256i low,
+                       __m256i high,
+                       double* /*tag*/) noexcept
+{
+  __m256d const value = _mm256_castsi256_pd(block);
+  return static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_castpd_si256(
+    _mm256_and_pd(_mm256_cmp_pd(value, _mm256_castsi256_pd(low), _CMP_GE_OQ),
+                  _mm256_cmp_pd(
+                    value, _mm256_castsi256_pd(high), _CMP_LE_OQ)))));
+}
+
+template <typename T, typename Callback>
+HADESMEM_DETAIL_TARGET_AVX2 void ScanValueRangeAvx2(std::uint8_t const* buf,
+                                                    std::size_t len,
+                                                    T low,
+                                                    T span,
+                                                    std::size_t& offset,
+                                                    Callback& callback)
+{
+  __m128i const low_half = SetScanValueSse2(low);
+  __m128i const span_half = SetScanValueSse2(span);
+  __m256i const low_vec = _mm256_set_m128i(low_half, low_half);
+  __m256i const span_vec = _mm256_set_m128i(span_half, span_half);
+  for (; len - offset >= 32; offset += 32)
+  {
+    __m256i const block =
+      _mm256_loadu_si256(reinterpret_cast<__m256i const*>(buf + offset));
+    std::uint32_t lanes = GetScanLaneMask(
+      CompareScanRangeAvx2(
+        block, low_vec, span_vec, static_cast<T*>(nullptr)),
+      sizeof(T));
+    for (; lanes; lanes &= lanes - 1)
+    {
+      callback(offset + CountTrailingZeros(lanes));
+    }
+  }
+}
+#endif // #if defined(HADESMEM_DETAIL_SIMD_AVX2)
+
+#if defined(HADESMEM_DETAIL_SIMD_SSE2)
+template <typename T, typename Callback>
+void ScanValueRangeSimd(std::uint8_t const* /*buf*/,
+                        std::size_t /*len*/,
+                        T /*low*/,
+                        T /*high*/,
+                        std::size_t& /*offset*/,
+                        Callback& /*callback*/,
+                        std::false_type /*vectorized*/)
+{
+}
+
+template <typename T, typename Callback>
+void ScanValueRangeSimd(std::uint8_t const* buf,
+                        std::size_t len,
+                        T low,
+                        T high,
+                        std::size_t& offset,
+                        Callback& callback,
+                        std::true_type /*vectorized*/)
+{
+  T const span =
+    GetScanRangeSpan(low, high, typename std::is_floating_point<T>::type{});
+
+#if defined(HADESMEM_DETAIL_SIMD_AVX2)
+  if (IsAvx2Supported())
+  {
+    ScanValueRangeAvx2(buf, len, low, span, offset, callback);
+  }
+#endif // #if defined(HADESMEM_DETAIL_SIMD_AVX2)
+
+  ScanValueRangeSse2(buf, len, low, span, offset, callback);
+}
+#endif // #if defined(HADESMEM_DETAIL_SIMD_SSE2)
+
+// Like ScanValue, but for values in [low, high]. NaN never matches.
+// Naturally aligned scans are vectorized.
+template <typename T, typename Callback>
+void ScanValueRange(std::uint8_t const* beg,
+                    std::uint8_t const* end,
+                    T low,
+                    T high,
+                    std::size_t alignment,
+                    Callback callback)
+{
+  HADESMEM_DETAIL_STATIC_ASSERT(IsScanValueType<T>::value);
+  HADESMEM_DETAIL_ASSERT(beg <= end);
+  HADESMEM_DETAIL_ASSERT(alignment != 0);
+
+  if (!(low <= high))
+  {
+    return;
+  }
+
+  auto const len = static_cast<std::size_t>(end - beg);
+  std::size_t offset = 0;
+
+#if defined(HADESMEM_DETAIL_SIMD_SSE2)
+  if (alignment == sizeof(T))
+  {
+    ScanValueRangeSimd(
+      beg,
+      len,
+      low,
+      high,
+      offset,
+      callback,
+      std::integral_constant<bool, IsScanRangeVectorized<T>::value>{});
+  }
+#endif // #if defined(HADESMEM_DETAIL_SIMD_SSE2)
+
+  for (; len >= sizeof(T) && offset <= len - sizeof(T); offset += alignment)
+  {
+    T cur;
+    std::memcpy(&cur, beg + offset, sizeof(T));
+    if (low <= cur && cur <= high)
+    {
+      callback(offset);
+    }
+  }
+}
+
+#if defined(HADESMEM_DETAIL_SIMD_SSE2)
+template <typename T, typename Callback>
+void ScanValueMaskedSse2(std::uint8_t const* buf,
+                         std::size_t len,
+                         T mask,
+                         T value,
+                         std::size_t& offset,
+                         Callback& callback)
+{
+  __m128i const mask_vec = SetScanValueSse2(mask);
+  __m128i const value_vec = SetScanValueSse2(value);
+  for (; len - offset >= 16; offset += 16)
+  {
+    __m128i const block =
+      _mm_loadu_si128(reinterpret_cast<__m128i const*>(buf + offset));
+    std::uint32_t lanes = GetScanLaneMask(
+      static_cast<std::uint32_t>(_mm_movemask_epi8(
+        _mm_cmpeq_epi8(_mm_and_si128(block, mask_vec), value_vec))),
+      sizeof(T));
+    for (; lanes; lanes &= lanes - 1)
+    {
+      callback(offset + CountTrailingZeros(lanes));
+    }
+  }
+}
+#endif // #if defined(HADESMEM_DETAIL_SIMD_SSE2)
+
+#if defined(HADESMEM_DETAIL_SIMD_AVX2)
+template <typename T, typename Callback>
+HADESMEM_DETAIL_TARGET_AVX2 void ScanValueMaskedAvx2(std::uint8_t const* buf,
+                                                     std::size_t len,
+                                                     T mask,
+                                                     T value,
+                                                     std::size_t& offset,
+                                                     Callback& callback)
+{
+  __m128i const mask_half = SetScanValueSse2(mask);
+  __m128i const value_half = SetScanValueSse2(value);
+  __m256i const mask_vec = _mm256_set_m128i(mask_half, mask_half);
+  __m256i const value_vec = _mm256_set_m128i(value_half, value_half);
+  for (; len - offset >= 32; offset += 32)
+  {
+    __m256i const block =
+      _mm256_loadu_si256(reinterpret_cast<__m256i const*>(buf + offset));
+    std::uint32_t lanes = GetScanLaneMask(
+      static_cast<std::uint32_t>(_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(_mm256_and_si256(block, mask_vec), value_vec))),
+      sizeof(T));
+    for (; lanes; lanes &= lanes - 1)
+    {
+      callback(offset + CountTrailingZeros(lanes));
+    }
+  }
+}
+#endif // #if defined(HADESMEM_DETAIL_SIMD_AVX2)
+
+// Like ScanValue, but for integers where (x & mask) == value. Naturally
+// aligned scans are vectorized.
+template <typename T, typename Callback>
+void ScanValueMasked(std::uint8_t const* beg,
+                     std::uint8_t const* end,
+                     T mask,
+                     T value,
+                     std::size_t alignment,
+                     Callback callback)
+{
+  HADESMEM_DETAIL_STATIC_ASSERT(IsScanValueType<T>::value &&
+                                std::is_integral<T>::value);
+  HADESMEM_DETAIL_ASSERT(beg <= end);
+  HADESMEM_DETAIL_ASSERT(alignment != 0);
+
+  auto const len = static_cast<std::size_t>(end - beg);
+  std::size_t offset = 0;
+
+  if (alignment == sizeof(T))
+  {
+#if defined(HADESMEM_DETAIL_SIMD_AVX2)
+    if (IsAvx2Supported())
+    {
+      ScanValueMaskedAvx2(beg, len, mask, value, offset, callback);
+    }
+#endif // #if defined(HADESMEM_DETAIL_SIMD_AVX2)
+
+#if defined(HADESMEM_DETAIL_SIMD_SSE2)
+    ScanValueMaskedSse2(beg, len, mask, value, offset, callback);
+#endif // #if defined(HADESMEM_DETAIL_SIMD_SSE2)
+  }
+
+  for (; len >= sizeof(T) && offset <= len - sizeof(T); offset += alignment)
+  {
+    T cur;
+    std::memcpy(&cur, beg + offset, sizeof(T));
+    if ((cur & mask) == value)
+    {
+      callback(offset);
+    }
+  }
+}
+
+// Predicates which ScanValueIf dispatches to the vectorized scans above.
+template <typename T> struct ScanEqualPred
+{
+  bool operator()(T cur_value) const noexcept
+  {
+    return cur_value == value;
+  }
+
+  T value;
+};
+
+template <typename T> struct ScanRangePred
+{
+  bool operator()(T cur_value) const noexcept
+  {
+    return low <= cur_value && cur_value <= high;
+  }
+
+  T low;
+  T high;
+};
+
+template <typename T> struct ScanBitmaskPred
+{
+  bool operator()(T cur_value) const noexcept
+  {
+    HADESMEM_DETAIL_STATIC_ASSERT(std::is_integral<T>::value);
+    return (cur_value & mask) == value;
+  }
+
+  T mask;
+  T value;
+};
+
+// Calls callback(offset) for every offset in the buffer which is a multiple of
+// alignment and holds a value for which pred(value) holds. pred is inlined
+// into the loop, and the predicates above are vectorized.
+template <typename T, typename Pred, typename Callback>
+void ScanValueIf(std::uint8_t const* beg,
+                 std::uint8_t const* end,
+                 Pred pred,
+                 std::size_t alignment,
+                 Callback callback)
+{
+  HADESMEM_DETAIL_STATIC_ASSERT(IsScanValueType<T>::value);
+  HADESMEM_DETAIL_ASSERT(beg <= end);
+  HADESMEM_DETAIL_ASSERT(alignment != 0);
+
+  auto const len = static_cast<std::size_t>(end - beg);
+  for (std::size_t offset = 0; len >= sizeof(T) && offset <= len - sizeof(T);
+       offset += alignment)
+  {
+    T cur;
+    std::memcpy(&cur, beg + offset, sizeof(T));
+    if (pred(cur))
+    {
+      callback(offset);
+    }
+  }
+}
+
+template <typename T, typename Callback>
+void ScanValueIf(std::uint8_t const* beg,
+                 std::uint8_t const* end,
+                 ScanEqualPred<T> pred,
+                 std::size_t alignment,
+                 Callback callback)
+{
+  ScanValue(beg, end, pred.value, alignment, callback);
+}
+
+template <typename T, typename Callback>
+void ScanValueIf(std::uint8_t const* beg,
+                 std::uint8_t const* end,
+                 ScanRangePred<T> pred,
+                 std::size_t alignment,
+                 Callback callback)
+{
+  ScanValueRange(beg, end, pred.low, pred.high, alignment, callback);
+}
+
+template <typename T, typename Callback>
+void ScanValueIf(std::uint8_t const* beg,
+                 std::uint8_t const* end,
+                 ScanBitmaskPred<T> pred,
+                 std::size_t alignment,
+                 Callback callback)
+{
+  ScanValueMasked(beg, end, pred.mask, pred.value, alignment, callback);
+}
+
+// Predicates for comparing values against their values in a snapshot, called
+// as pred(old_value, cur_value). Changed and unchanged compare the raw bytes.
+struct ScanChangedPred
+{
+  template <typename T>
+  bool operator()(T const& old_value, T const& cur_value) const noexcept
+  {
+    return !!std::memcmp(&old_value, &cur_value, sizeof(T));
+  }
+};
+
+struct ScanUnchangedPred
+{
+  template <typename T>
+  bool operator()(T const& old_value, T const& cur_value) const noexcept
+  {
+    return !std::memcmp(&old_value, &cur_value, sizeof(T));
+  }
+};
+
+struct ScanIncreasedPred
+{
+  template <typename T>
+  bool operator()(T const& old_value, T const& cur_value) const noexcept
+  {
+    return cur_value > old_value;
+  }
+};
+
+struct ScanDecreasedPred
+{
+  template <typename T>
+  bool operator()(T const& old_value, T const& cur_value) const noexcept
+  {
+    return cur_value < old_value;
+  }
+};
+
+// Whether pred(x, x) is known to be equal_result for every x, so that blocks
+// which haven't changed at all can be handled as a whole, and whether pred
+// only compares raw bytes, so that it can be vectorized. Nothing is known
+// about user supplied predicates.
+template <typename Pred> struct ScanCompareTraits
+{
+  static bool const has_equal_result = false;
+  static bool const equal_result = false;
+  static bool const is_bytewise = false;
+};
+
+template <> struct ScanCompareTraits<ScanChangedPred>
+{
+  static bool const has_equal_result = true;
+  static bool const equal_result = false;
+  static bool const is_bytewise = true;
+};
+
+template <> struct ScanCompareTraits<ScanUnchangedPred>
+{
+  static bool const has_equal_result = true;
+  static bool const equal_result = true;
+  static bool const is_bytewise = true;
+};
+
+template <> struct ScanCompareTraits<ScanIncreasedPred>
+{
+  static bool const has_equal_result = true;
+  static bool const equal_result = false;
+  static bool const is_bytewise = false;
+};
+
+template <> struct ScanCompareTraits<ScanDecreasedPred>
+{
+  static bool const has_equal_result = true;
+  static bool const equal_result = false;
+  static bool const is_bytewise = false;
+};
+
+// Size of the blocks which are checked for changes as a whole before
+// comparing individual values.
+std::size_t const kScanCompareBlockSize = 256;
+
+#if defined(HADESMEM_DETAIL_SIMD_SSE2)
+// Compares the raw bytes of the naturally aligned values starting in
+// [offset, end), and reports the ones which are equal (or the ones which
+// aren't). Both buffers must hold the values starting before end in full.
+template <typename T, typename Callback>
+void ScanCompareBytesSse2(std::uint8_t const* old_buf,
+                          std::uint8_t const* cur_buf,
+                          std::size_t& offset,
+                          std::size_t end,
+                          bool equal,
+                          Callback& callback)
+{
+  std::uint32_t const lane_starts = GetScanLaneMask(0xFFFFU, sizeof(T));
+  for (; offset + 16 <= end + sizeof(T) - 1; offset += 16)
+  {
+    __m128i const old_block =
+      _mm_loadu_si128(reinterpret_cast<__m128i const*>(old_buf + offset));
+    __m128i const cur_block =
+      _mm_loadu_si128(reinterpret_cast<__m128i const*>(cur_buf + offset));
+    std::uint32_t lanes = GetScanLaneMask(
+      static_cast<std::uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(old_block, cur_block))),
+      sizeof(T));
+    if (!equal)
+    {
+      lanes ^= lane_starts;
+    }
+
+    for (; lanes; lanes &= lanes - 1)
+    {
+      callback(offset + CountTrailingZeros(lanes));
+    }
+  }
+}
+#endif // #if defined(HADESMEM_DETAIL_SIMD_SSE2)
+
+// Calls callback(offset) for every offset in [0, scan_len) which is a multiple
+// of alignment where pred(old_value, cur_value) holds. Both buffers hold len
+// bytes (so values starting near the end of the scan range can be read).
+// pred is inlined into the loop. If ScanCompareTraits knows what pred returns
+// for identical values, the (usually vast majority of) blocks which haven't
+// changed at all are handled with a memcmp, and raw byte compares are
+// vectorized.
+template <typename T, typename Pred, typename Callback>
+void ScanCompareValues(std::uint8_t const* old_buf,
+                       std::uint8_t const* cur_buf,
+                       std::size_t len,
+                       std::size_t scan_len,
+                       std::size_t alignment,
+                       Pred pred,
+                       Callback callback)
+{
+  HADESMEM_DETAIL_STATIC_ASSERT(IsScanValueType<T>::value);
+  HADESMEM_DETAIL_ASSERT(scan_len <= len);
+  HADESMEM_DETAIL_ASSERT(alignment != 0 &&
+                         kScanCompareBlockSize % alignment == 0);
+
+  using Traits = ScanCompareTraits<Pred>;
+
+  if (len < sizeof(T))
+  {
+    return;
+  }
+
+  std::size_t const last = len - sizeof(T);
+  for (std::size_t block = 0; block < scan_len && block <= last;
+       block += kScanCompareBlockSize)
+  {
+    std::size_t const block_end =
+      (std::min)(block + kScanCompareBlockSize, (std::min)(scan_len, last + 1));
+    std::size_t const block_len = block_end - block + sizeof(T) - 1;
+    if (Traits::has_equal_result &&
+        !std::memcmp(old_buf + block, cur_buf + block, block_len))
+    {
+      if (Traits::equal_result)
+      {
+        for (std::size_t offset = block; offset < block_end;
+             offset += alignment)
+        {
+          callback(offset);
+        }
+      }
+
+      continue;
+    }
+
+    std::size_t offset = block;
+
+#if defined(HADESMEM_DETAIL_SIMD_SSE2)
+    if (Traits::is_bytewise && alignment == sizeof(T))
+    {
+      ScanCompareBytesSse2<T>(
+        old_buf, cur_buf, offset, block_end, Traits::equal_result, callback);
+    }
+#endif // #if defined(HADESMEM_DETAIL_SIMD_SSE2)
+
+    for (; offset < block_end; offset += alignment)
+    {
+      T old_value;
+      std::memcpy(&old_value, old_buf + offset, sizeof(T));
+      T cur_value;
+      std::memcpy(&cur_value, cur_buf + offset, sizeof(T));
+      if (pred(old_value, cur_value))
+      {
+        callback(offset);
+      }
+    }
+  }
+}
+}
+}
@@ -0,0 +1,91 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cstdint>
+
+// Like the pattern search cores, this must not depend on windows.h so that
+// the SIMD code paths can be built and tested on any platform.
+
+// Define HADESMEM_NO_SIMD to force the scalar code paths (e.g. for testing or
+// benchmarking them against the vectorized ones).
+
+#if !defined(HADESMEM_NO_SIMD)
+#if defined(_M_AMD64) || defined(_M_X64) ||                                    \
+  (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define HADESMEM_DETAIL_SIMD_SSE2
+#endif // defined(_M_AMD64) || defined(_M_X64) ||
+// (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#endif // #if !defined(HADESMEM_NO_SIMD)
+
+#if defined(HADESMEM_DETAIL_SIMD_SSE2)
+// AVX2 code is only ever executed after a runtime check, so it is compiled
+// regardless of the baseline architecture flags.
+#define HADESMEM_DETAIL_SIMD_AVX2
+#if defined(_MSC_VER)
+#define HADESMEM_DETAIL_TARGET_AVX2
+#else // #if defined(_MSC_VER)
+#define HADESMEM_DETAIL_TARGET_AVX2 __attribute__((target("avx2")))
+#endif // #if defined(_MSC_VER)
+#endif // #if defined(HADESMEM_DETAIL_SIMD_SSE2)
+
+#if defined(HADESMEM_DETAIL_SIMD_SSE2)
+#include <emmintrin.h>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif // #if defined(_MSC_VER)
+#endif // #if defined(HADESMEM_DETAIL_SIMD_SSE2)
+
+namespace hadesmem
+{
+namespace detail
+{
+// Undefined for zero.
+inline std::uint32_t CountTrailingZeros(std::uint32_t value) noexcept
+{
+#if defined(_MSC_VER)
+  unsigned long index = 0;
+  ::_BitScanForward(&index, value);
+  return static_cast<std::uint32_t>(index);
+#else // #if defined(_MSC_VER)
+  return static_cast<std::uint32_t>(__builtin_ctz(value));
+#endif // #if defined(_MSC_VER)
+}
+
+inline bool IsAvx2Supported() noexcept
+{
+#if defined(HADESMEM_DETAIL_SIMD_AVX2)
+#if defined(_MSC_VER)
+  static bool const supported = []()
+  {
+    int info[4] = {};
+    ::__cpuid(info, 0);
+    if (info[0] < 7)
+    {
+      return false;
+    }
+
+    // OSXSAVE and AVX, then check the OS actually saves the YMM state.
+    ::__cpuid(info, 1);
+    bool const os_avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) &&
+                        (::_xgetbv(0) & 0x6) == 0x6;
+    if (!os_avx)
+    {
+      return false;
+    }
+
+    ::__cpuidex(info, 7, 0);
+    return !!(info[1] & (1 << 5));
+  }();
+  return supported;
+#else // #if defined(_MSC_VER)
+  return !!__builtin_cpu_supports("avx2");
+#endif // #if defined(_MSC_VER)
+#else // #if defined(HADESMEM_DETAIL_SIMD_AVX2)
+  return false;
+#endif // #if defined(HADESMEM_DETAIL_SIMD_AVX2)
+}
+}
+}
@@ -4,6 +4,7 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 
 #include <windows.h>
 
@@ -51,35 +52,45 @@ inline void WriteImpl(Process const& process,
 
   for (;;)
   {
-    ProtectGuard protect_guard{process, address, ProtectGuardType::kWrite};
-
-    MEMORY_BASIC_INFORMATION const mbi = detail::Query(process, address);
+    bool cached = false;
+    MEMORY_BASIC_INFORMATION const mbi =
+      detail::QueryCached(process, address, &CanWrite, cached);
     void* const region_next =
       static_cast<std::uint8_t*>(mbi.BaseAddress) + mbi.RegionSize;
 
     void* const address_end = static_cast<std::uint8_t*>(address) + len;
-    if (address_end <= region_next)
-    {
-      WriteUnchecked(process, address, data, len);
-
-      protect_guard.Restore();
+    std::size_t const len_new =
+      address_end <= region_next
+        ? len
+        : reinterpret_cast<std::uintptr_t>(region_next) -
+            reinterpret_cast<std::uintptr_t>(address);
 
-      return;
-    }
-    else
+    try
     {
-      std::size_t const len_new =
-        reinterpret_cast<std::uintptr_t>(region_next) -
-        reinterpret_cast<std::uintptr_t>(address);
-
+      ProtectGuard protect_guard{process, mbi, ProtectGuardType::kWrite};
       WriteUnchecked(process, address, data, len_new);
-
       protect_guard.Restore();
+    }
+    catch (Error const&)
+    {
+      if (!cached)
+      {
+        throw;
+      }
+
+      // The cached region is out of date, so try again with a fresh one.
+      process.InvalidateRegionCache();
+      continue;
+    }
 
-      address = static_cast<std::uint8_t*>(address) + len_new;
-      data = static_cast<std::uint8_t const*>(data) + len_new;
-      len -= len_new;
+    if (len_new == len)
+    {
+      return;
     }
+
+    address = static_cast<std::uint8_t*>(address) + len_new;
+    data = static_cast<std::uint8_t const*>(data) + len_new;
+    len -= len_new;
   }
 }
 
@@ -5,10 +5,13 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <exception>
 #include <iterator>
 #include <limits>
 #include <locale>
 #include <map>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <utility>
@@ -23,13 +26,22 @@
 
 #include <hadesmem/config.hpp>
 #include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/parallel_for.hpp>
+#include <hadesmem/detail/pattern_blob.hpp>
+#include <hadesmem/detail/pattern_cache.hpp>
+#include <hadesmem/detail/pattern_data.hpp>
+#include <hadesmem/detail/pattern_multi_search.hpp>
+#include <hadesmem/detail/pattern_parallel_search.hpp>
+#include <hadesmem/detail/pattern_search.hpp>
 #include <hadesmem/detail/pugixml_helpers.hpp>
 #include <hadesmem/detail/smart_handle.hpp>
 #include <hadesmem/detail/static_assert.hpp>
 #include <hadesmem/detail/str_conv.hpp>
 #include <hadesmem/detail/to_upper_ordinal.hpp>
+#include <hadesmem/detail/trace.hpp>
 #include <hadesmem/error.hpp>
 #include <hadesmem/find_procedure.hpp>
+#include <hadesmem/memory_source.hpp>
 #include <hadesmem/module.hpp>
 #include <hadesmem/module_list.hpp>
 #include <hadesmem/pelib/dos_header.hpp>
@@ -40,10 +52,8 @@
 #include <hadesmem/process.hpp>
 #include <hadesmem/read.hpp>
 
-// TODO: Standalone app/example for FindPattern. For dumping results,
-// experimenting with patterns, automatically generating new patterns, etc.
-
-// TODO: Support nibble wildcards. (e.g. FF D? EB)
+// TODO: Support dumping the results of a pattern file in the
+// find_pattern_tool example.
 
 // TODO: Handle the case where after resolving a pattern, the result lives
 // outside the module (the heap, a different module, etc) and we want to use
@@ -63,7 +73,8 @@ struct PatternFlags
     kThrowOnUnmatch = 1 << 0,
     kRelativeAddress = 1 << 1,
     kScanData = 1 << 2,
-    kInvalidFlagMaxValue = 1 << 3
+    kParallel = 1 << 3,
+    kInvalidFlagMaxValue = 1 << 4
   };
 };
 
@@ -147,12 +158,6 @@ inline void* Rel(Process const& process,
   }
 }
 
-struct PatternDataByte
-{
-  std::uint8_t data;
-  bool wildcard;
-};
-
 inline std::vector<PatternDataByte> ConvertData(std::wstring const& data)
 {
   HADESMEM_DETAIL_ASSERT(!data.empty());
@@ -174,9 +179,42 @@ inline std::vector<PatternDataByte> ConvertData(std::wstring const& data)
                                       << ErrorString{"Data parsing failed."});
     }
 
-    bool const is_wildcard = (data_cur_str == L"??");
     std::uint32_t current = 0U;
-    if (!is_wildcard)
+    std::uint32_t mask = 0xFFU;
+    // Full (??) or nibble (e.g. D? or ?D) wildcard.
+    if (data_cur_str.find(L'?') != std::wstring::npos)
+    {
+      if (data_cur_str.size() != 2)
+      {
+        HADESMEM_DETAIL_THROW_EXCEPTION(Error()
+                                        << ErrorString("Invalid wildcard."));
+      }
+
+      mask = 0U;
+      for (auto const c : data_cur_str)
+      {
+        current <<= 4;
+        mask <<= 4;
+
+        if (c == L'?')
+        {
+          continue;
+        }
+
+        std::wstring::size_type const nibble =
+          std::wstring(L"0123456789ABCDEF").find(static_cast<wchar_t>(
+            std::toupper(c, std::locale::classic())));
+        if (nibble == std::wstring::npos)
+        {
+          HADESMEM_DETAIL_THROW_EXCEPTION(
+            Error{} << ErrorString{"Data conversion failed."});
+        }
+
+        current |= static_cast<std::uint32_t>(nibble);
+        mask |= 0xFU;
+      }
+    }
+    else
     {
       std::wistringstream conv{data_cur_str};
       conv.imbue(std::locale::classic());
@@ -193,46 +231,166 @@ inline std::vector<PatternDataByte> ConvertData(std::wstring const& data)
       }
     }
 
-    data_real.emplace_back(
-      PatternDataByte{static_cast<std::uint8_t>(current), is_wildcard});
+    data_real.emplace_back(PatternDataByte{static_cast<std::uint8_t>(current),
+                                           static_cast<std::uint8_t>(mask)});
   } while (!data_str.eof());
 
   return data_real;
 }
 
+// Regions are read and searched in chunks of this size, so memory use is
+// bounded and we can stop reading as soon as we find a match.
+std::size_t const kFindRawChunkSize = 1024 * 1024;
+
+// Reads and searches the chunks of a region on one set of workers, each
+// reading into a buffer of its own. Matches and read errors only count for
+// the lowest chunk they occur in, so the result is the same as for a serial
+// search.
+inline void* FindRawParallel(Process const& process,
+                             PatternSearch const& search,
+                             std::uint8_t* s_beg,
+                             std::uint8_t* s_end,
+                             std::size_t chunk_size)
+{
+  auto const region_size = static_cast<std::size_t>(s_end - s_beg);
+  std::size_t const num_chunks = (region_size + chunk_size - 1) / chunk_size;
+  std::size_t const num_threads =
+    (std::min)(GetDefaultThreadCount(), num_chunks);
+  std::vector<std::vector<std::uint8_t>> bufs(num_threads);
+  std::vector<std::uint8_t*> matches(num_chunks);
+  std::vector<std::exception_ptr> errors(num_chunks);
+  ParallelForEachChunk(
+    s_beg,
+    s_end,
+    search.GetNeedleLength() - 1,
+    chunk_size,
+    num_threads,
+    [&](std::size_t i,
+        std::size_t thread,
+        std::uint8_t* c_beg,
+        std::uint8_t* c_end)
+    {
+      auto& buf = bufs[thread];
+      try
+      {
+        buf.resize(static_cast<std::size_t>(c_end - c_beg));
+        ReadImpl(process, c_beg, buf.data(), buf.size());
+      }
+      catch (...)
+      {
+        errors[i] = std::current_exception();
+        return true;
+      }
+
+      auto const h_beg = buf.data();
+      if (std::uint8_t const* const match =
+            search.Search(h_beg, h_beg + buf.size()))
+      {
+        matches[i] = c_beg + (match - h_beg);
+        return true;
+      }
+
+      return false;
+    });
+
+  for (std::size_t i = 0; i < num_chunks; ++i)
+  {
+    if (errors[i])
+    {
+      std::rethrow_exception(errors[i]);
+    }
+
+    if (matches[i])
+    {
+      return matches[i];
+    }
+  }
+
+  return nullptr;
+}
+
 template <typename NeedleIterator>
 void* FindRaw(Process const& process,
               std::uint8_t* s_beg,
               std::uint8_t* s_end,
               NeedleIterator n_beg,
-              NeedleIterator n_end)
+              NeedleIterator n_end,
+              std::uint32_t flags,
+              std::size_t chunk_size = kFindRawChunkSize)
 {
   HADESMEM_DETAIL_ASSERT(s_beg < s_end);
+  HADESMEM_DETAIL_ASSERT(chunk_size != 0);
 
-  std::ptrdiff_t const mem_size = s_end - s_beg;
-  std::vector<std::uint8_t> const haystack{ReadVector<std::uint8_t>(
-    process, s_beg, static_cast<std::size_t>(mem_size))};
+  PatternSearch const search{n_beg, n_end};
+  if (!!(flags & PatternFlags::kParallel))
+  {
+    return FindRawParallel(process, search, s_beg, s_end, chunk_size);
+  }
 
-  auto const h_beg = std::begin(haystack);
-  auto const h_end = std::end(haystack);
-  auto const iter =
-    std::search(h_beg,
-                h_end,
-                n_beg,
-                n_end,
-                [](std::uint8_t h_cur, detail::PatternDataByte const& n_cur)
-                {
-                  return n_cur.wildcard || h_cur == n_cur.data;
-                });
+  // The last needle length - 1 bytes of each chunk are carried over to the
+  // start of the next one so matches spanning two chunks are still found.
+  auto const region_size = static_cast<std::size_t>(s_end - s_beg);
+  std::size_t const overlap = search.GetNeedleLength() - 1;
+  std::vector<std::uint8_t> buf(
+    (std::min)(region_size, chunk_size + overlap));
+  std::size_t carried = 0;
+  for (std::uint8_t* r_cur = s_beg; r_cur != s_end;)
+  {
+    std::size_t const read_len = (std::min)(
+      static_cast<std::size_t>(s_end - r_cur), buf.size() - carried);
+    ReadImpl(process, r_cur, buf.data() + carried, read_len);
+    std::uint8_t* const buf_address = r_cur - carried;
+    r_cur += read_len;
+
+    std::uint8_t const* const h_beg = buf.data();
+    std::uint8_t const* const h_end = h_beg + carried + read_len;
+    if (std::uint8_t const* const match = search.Search(h_beg, h_end))
+    {
+      return buf_address + (match - h_beg);
+    }
 
-  if (iter != h_end)
-  {
-    return s_beg + std::distance(h_beg, iter);
+    carried = (std::min)(overlap, static_cast<std::size_t>(h_end - h_beg));
+    std::memmove(buf.data(), h_end - carried, carried);
   }
 
   return nullptr;
 }
 
+// Regions which the source can read directly are searched in place, without
+// copying them out first.
+template <typename NeedleIterator>
+void* FindRaw(MemorySource const& source,
+              std::uint8_t* s_beg,
+              std::uint8_t* s_end,
+              NeedleIterator n_beg,
+              NeedleIterator n_end,
+              std::uint32_t flags,
+              std::size_t chunk_size = kFindRawChunkSize)
+{
+  HADESMEM_DETAIL_ASSERT(s_beg < s_end);
+
+  auto const region_size = static_cast<std::size_t>(s_end - s_beg);
+  std::uint8_t const* const h_beg = source.GetPointer(s_beg, region_size);
+  if (!h_beg)
+  {
+    return FindRaw(
+      source.GetProcess(), s_beg, s_end, n_beg, n_end, flags, chunk_size);
+  }
+
+  PatternSearch const search{n_beg, n_end};
+  std::uint8_t const* const h_end = h_beg + region_size;
+  std::size_t const num_threads =
+    !!(flags & PatternFlags::kParallel) ? GetDefaultThreadCount() : 1;
+  std::uint8_t const* const match =
+    num_threads > 1 ? ParallelPatternSearch(search,
+                                            h_beg,
+                                            h_end,
+                                            kParallelSearchChunkSize,
+                                            num_threads)
+                    : search.Search(h_beg, h_end);
+  return match ? s_beg + (match - h_beg) : nullptr;
+}
+
 struct ModuleRegionInfo
 {
   std::shared_ptr<Module> module;
@@ -303,11 +461,12 @@ inline ModuleRegionInfo GetModuleInfo(Process const& process,
 }
 
 template <typename NeedleIterator>
-void* Find(Process const& process,
+void* Find(MemorySource const& source,
            ModuleRegionInfo::ScanRegion const& region,
            void* start,
            NeedleIterator n_beg,
-           NeedleIterator n_end)
+           NeedleIterator n_end,
+           std::uint32_t flags)
 {
   std::uint8_t* s_beg = region.first;
   std::uint8_t* const s_end = region.second;
@@ -334,7 +493,7 @@ void* Find(Process const& process,
     }
   }
 
-  return FindRaw(process, s_beg, s_end, n_beg, n_end);
+  return FindRaw(source, s_beg, s_end, n_beg, n_end, flags);
 }
 
 template <typename NeedleIterator>
@@ -348,12 +507,14 @@ void* Find(Process const& process,
 {
   HADESMEM_DETAIL_ASSERT(n_beg != n_end);
 
+  MemorySource const source{process};
   bool const scan_data_secs = !!(flags & PatternFlags::kScanData);
   auto const& scan_regions =
     scan_data_secs ? mod_info.data_regions : mod_info.code_regions;
   for (auto const& region : scan_regions)
   {
-    if (void* const address = Find(process, region, start, n_beg, n_end))
+    if (void* const address =
+          Find(source, region, start, n_beg, n_end, flags))
     {
       return !!(flags & PatternFlags::kRelativeAddress)
                ? static_cast<std::uint8_t*>(address) -
@@ -374,8 +535,280 @@ void* Find(Process const& process,
   return nullptr;
 }
 
+// Multi pattern equivalent of FindRaw. The predicate accept(id, address)
+// decides whether a match counts (e.g. because it is before a custom start
+// address). Accepted matches are stored in 'addresses' and flagged in 'done'.
+// The overlap between chunks has to be at least the longest needle length
+// minus one.
+template <typename Predicate>
+void FindMultiRaw(Process const& process,
+                  MultiPatternSearch const& search,
+                  std::uint8_t* s_beg,
+                  std::uint8_t* s_end,
+                  std::vector<bool>& done,
+                  std::vector<std::uint8_t*>& addresses,
+                  Predicate accept,
+                  std::size_t overlap,
+                  std::size_t chunk_size)
+{
+  auto const region_size = static_cast<std::size_t>(s_end - s_beg);
+  std::vector<std::uint8_t> buf((std::min)(region_size, chunk_size + overlap));
+  std::size_t carried = 0;
+  for (std::uint8_t* r_cur = s_beg;
+       r_cur != s_end &&
+       std::find(std::begin(done), std::end(done), false) != std::end(done);)
+  {
+    std::size_t const read_len = (std::min)(
+      static_cast<std::size_t>(s_end - r_cur), buf.size() - carried);
+    ReadImpl(process, r_cur, buf.data() + carried, read_len);
+    std::uint8_t* const buf_address = r_cur - carried;
+    r_cur += read_len;
+
+    std::uint8_t const* const h_beg = buf.data();
+    std::uint8_t const* const h_end = h_beg + carried + read_len;
+    search.Search(h_beg,
+                  h_end,
+                  done,
+                  [&](std::size_t id, std::uint8_t const* match)
+                  {
+                    auto const address = buf_address + (match - h_beg);
+                    if (!accept(id, address))
+                    {
+                      return false;
+                    }
+
+                    addresses[id] = address;
+                    return true;
+                  });
+
+    carried = (std::min)(overlap, static_cast<std::size_t>(h_end - h_beg));
+    std::memmove(buf.data(), h_end - carried, carried);
+  }
+}
+
+// Parallel equivalent of FindMultiRaw, in the same way as FindRawParallel. The
+// predicate is called concurrently, so it must not have side effects.
+template <typename Predicate>
+void FindMultiRawParallel(Process const& process,
+                          MultiPatternSearch const& search,
+                          std::uint8_t* s_beg,
+                          std::uint8_t* s_end,
+                          std::vector<bool>& done,
+                          std::vector<std::uint8_t*>& addresses,
+                          Predicate accept,
+                          std::size_t overlap,
+                          std::size_t chunk_size)
+{
+  auto const region_size = static_cast<std::size_t>(s_end - s_beg);
+  std::size_t const num_chunks = (region_size + chunk_size - 1) / chunk_size;
+  std::size_t const num_threads =
+    (std::min)(GetDefaultThreadCount(), num_chunks);
+  std::vector<std::vector<std::uint8_t>> bufs(num_threads);
+  std::vector<std::vector<std::uint8_t*>> chunk_addresses(
+    num_chunks, std::vector<std::uint8_t*>(done.size()));
+  std::vector<std::vector<bool>> chunk_dones(num_chunks, done);
+  std::vector<std::exception_ptr> errors(num_chunks);
+  ParallelForEachChunk(
+    s_beg,
+    s_end,
+    overlap,
+    chunk_size,
+    num_threads,
+    [&](std::size_t i,
+        std::size_t thread,
+        std::uint8_t* c_beg,
+        std::uint8_t* c_end)
+    {
+      auto& buf = bufs[thread];
+      try
+      {
+        buf.resize(static_cast<std::size_t>(c_end - c_beg));
+        ReadImpl(process, c_beg, buf.data(), buf.size());
+      }
+      catch (...)
+      {
+        errors[i] = std::current_exception();
+        return true;
+      }
+
+      auto const h_beg = buf.data();
+      auto& cur_addresses = chunk_addresses[i];
+      auto& chunk_done = chunk_dones[i];
+      search.Search(h_beg,
+                    h_beg + buf.size(),
+                    chunk_done,
+                    [&](std::size_t id, std::uint8_t const* match)
+                    {
+                      auto const address = c_beg + (match - h_beg);
+                      if (!accept(id, address))
+                      {
+                        return false;
+                      }
+
+                      cur_addresses[id] = address;
+                      return true;
+                    });
+      // No later chunk can improve on a chunk which matched everything.
+      return std::find(std::begin(chunk_done), std::end(chunk_done), false) ==
+             std::end(chunk_done);
+    });
+
+  // Chunks which were skipped have no matches, so they're harmless here.
+  for (std::size_t i = 0; i < num_chunks; ++i)
+  {
+    if (errors[i] &&
+        std::find(std::begin(done), std::end(done), false) != std::end(done))
+    {
+      std::rethrow_exception(errors[i]);
+    }
+
+    for (std::size_t id = 0; id < done.size(); ++id)
+    {
+      if (!done[id] && chunk_addresses[i][id])
+      {
+        addresses[id] = chunk_addresses[i][id];
+        done[id] = true;
+      }
+    }
+  }
+}
+
+struct MultiFindInfo
+{
+  std::vector<PatternDataByte> const* needle;
+  // Optional, selected automatically if null.
+  PatternAnchor const* anchor;
+  std::uint32_t flags;
+  void* start;
+  void* address;
+};
+
+// Equivalent to calling Find for each entry individually, except that each
+// region is read and scanned at most once.
+inline void FindMulti(Process const& process,
+                      ModuleRegionInfo const& mod_info,
+                      std::vector<MultiFindInfo>& find_infos,
+                      std::size_t chunk_size = kFindRawChunkSize)
+{
+  HADESMEM_DETAIL_ASSERT(chunk_size != 0);
+
+  for (bool const scan_data_secs : {false, true})
+  {
+    MultiPatternSearch search;
+    std::vector<std::size_t> ids;
+    std::size_t max_needle_len = 0;
+    bool parallel = false;
+    for (std::size_t i = 0; i < find_infos.size(); ++i)
+    {
+      auto const& info = find_infos[i];
+      HADESMEM_DETAIL_ASSERT(!info.needle->empty());
+      if (!!(info.flags & PatternFlags::kScanData) == scan_data_secs)
+      {
+        if (info.anchor)
+        {
+          search.AddPattern(
+            std::begin(*info.needle), std::end(*info.needle), *info.anchor);
+        }
+        else
+        {
+          search.AddPattern(std::begin(*info.needle), std::end(*info.needle));
+        }
+        ids.push_back(i);
+        max_needle_len = (std::max)(max_needle_len, info.needle->size());
+        parallel = parallel || !!(info.flags & PatternFlags::kParallel);
+      }
+    }
+
+    if (ids.empty())
+    {
+      continue;
+    }
+
+    search.Compile();
+
+    std::vector<bool> resolved(ids.size());
+    auto const& scan_regions =
+      scan_data_secs ? mod_info.data_regions : mod_info.code_regions;
+    for (auto const& region : scan_regions)
+    {
+      // Same semantics as Find. Patterns with a custom start address only scan
+      // the region containing it (from the byte after it onwards).
+      std::vector<bool> done(resolved);
+      bool any_pending = false;
+      for (std::size_t id = 0; id < ids.size(); ++id)
+      {
+        auto const start =
+          static_cast<std::uint8_t*>(find_infos[ids[id]].start);
+        if (!done[id] && start)
+        {
+          if (start >= region.first && start < region.second)
+          {
+            if (start + 1 == region.second)
+            {
+              HADESMEM_DETAIL_THROW_EXCEPTION(
+                Error() << ErrorString("Invalid start address."));
+            }
+          }
+          else
+          {
+            done[id] = true;
+          }
+        }
+
+        any_pending = any_pending || !done[id];
+      }
+
+      if (!any_pending)
+      {
+        continue;
+      }
+
+      std::vector<bool> const was_done(done);
+      std::vector<std::uint8_t*> addresses(ids.size());
+      auto const accept = [&](std::size_t id, std::uint8_t* address)
+      {
+        auto const start = find_infos[ids[id]].start;
+        return !start || address > start;
+      };
+      if (parallel)
+      {
+        FindMultiRawParallel(process,
+                             search,
+                             region.first,
+                             region.second,
+                             done,
+                             addresses,
+                             accept,
+                             max_needle_len - 1,
+                             chunk_size);
+      }
+      else
+      {
+        FindMultiRaw(process,
+                     search,
+                     region.first,
+                     region.second,
+                     done,
+                     addresses,
+                     accept,
+                     max_needle_len - 1,
+                     chunk_size);
+      }
+
+      for (std::size_t id = 0; id < ids.size(); ++id)
+      {
+        if (done[id] && !was_done[id])
+        {
+          find_infos[ids[id]].address = addresses[id];
+          resolved[id] = true;
+        }
+      }
+    }
+  }
+}
+
 template <typename NeedleIterator>
-void* Find(Process const& process,
+void* Find(MemorySource const& source,
            std::pair<std::uint8_t*, std::uint8_t*> const& region,
            NeedleIterator n_beg,
            NeedleIterator n_end,
@@ -385,7 +818,8 @@ void* Find(Process const& process,
 {
   HADESMEM_DETAIL_ASSERT(n_beg != n_end);
 
-  if (void* const address = Find(process, region, start, n_beg, n_end))
+  if (void* const address =
+        Find(source, region, start, n_beg, n_end, flags))
   {
     return !!(flags & PatternFlags::kRelativeAddress)
              ? static_cast<std::uint8_t*>(address) -
@@ -430,7 +864,8 @@ inline void* Find(Process const& process,
                       name);
 }
 
-inline void* Find(Process const& process,
+// Local memory (e.g. a MappedFile) is searched in place.
+inline void* Find(MemorySource const& source,
                   void* base,
                   std::size_t size,
                   std::wstring const& data,
@@ -445,7 +880,7 @@ inline void* Find(Process const& process,
                                      static_cast<std::uint8_t*>(base) + size);
   auto const needle = detail::ConvertData(data);
   void* const start_abs = start ? region.first + start : nullptr;
-  return detail::Find(process,
+  return detail::Find(source,
                       region,
                       std::begin(needle),
                       std::end(needle),
@@ -454,6 +889,18 @@ inline void* Find(Process const& process,
                       name);
 }
 
+inline void* Find(Process const& process,
+                  void* base,
+                  std::size_t size,
+                  std::wstring const& data,
+                  std::uint32_t flags,
+                  std::uintptr_t start,
+                  std::wstring const* name = nullptr)
+{
+  return Find(MemorySource{process}, base, size, data, flags, start, name);
+}
+
+// The file is mapped into this process and searched in place.
 inline void* FindInFile(Process const& process,
                         std::wstring const& path,
                         std::wstring const& data,
@@ -464,44 +911,276 @@ inline void* FindInFile(Process const& process,
   HADESMEM_DETAIL_ASSERT(
     !(flags & ~(PatternFlags::kInvalidFlagMaxValue - 1UL)));
 
-  detail::SmartFileHandle const file{::CreateFileW(path.c_str(),
-                                                   GENERIC_READ,
-                                                   FILE_SHARE_READ,
-                                                   nullptr,
-                                                   OPEN_EXISTING,
-                                                   0,
-                                                   nullptr)};
-  if (!file.IsValid())
+  MappedFile const file{path};
+  auto const base = file.GetBase();
+  // The rest of the last page is zero filled, and searched too.
+  auto const size = detail::GetRegionAllocSize(process, base);
+  MemorySource const source{process, base, size};
+  return Find(source, base, size, data, flags, start, name);
+}
+
+// PatternMatchIterator satisfies the requirements of an input iterator
+// (C++ Standard, 24.2.1, Input Iterators [input.iterators]).
+class PatternMatchIterator
+  : public std::iterator<std::input_iterator_tag, void*>
+{
+public:
+  using BaseIteratorT = std::iterator<std::input_iterator_tag, void*>;
+  using value_type = BaseIteratorT::value_type;
+  using difference_type = BaseIteratorT::difference_type;
+  using pointer = BaseIteratorT::pointer;
+  using reference = BaseIteratorT::reference;
+  using iterator_category = BaseIteratorT::iterator_category;
+
+  constexpr PatternMatchIterator() noexcept
   {
-    DWORD const last_error = ::GetLastError();
-    HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
-                                    << ErrorString{"CreateFileW failed."}
-                                    << ErrorCodeWinLast{last_error});
   }
 
-  detail::SmartHandle const file_mapping{::CreateFileMappingW(
-    file.GetHandle(), nullptr, PAGE_READONLY, 0, 0, nullptr)};
-  if (!file_mapping.IsValid())
+  explicit PatternMatchIterator(
+    Process const& process,
+    std::shared_ptr<std::vector<detail::ModuleRegionInfo::ScanRegion> const>
+      regions,
+    std::shared_ptr<detail::PatternSearch const> search,
+    std::uintptr_t base,
+    std::uint32_t flags)
+    : impl_{std::make_shared<Impl>(
+        process, std::move(regions), std::move(search), base, flags)}
+  {
+    if (!impl_->Next())
+    {
+      impl_.reset();
+    }
+  }
+
+  explicit PatternMatchIterator(
+    Process&& process,
+    std::shared_ptr<std::vector<detail::ModuleRegionInfo::ScanRegion> const>
+      regions,
+    std::shared_ptr<detail::PatternSearch const> search,
+    std::uintptr_t base,
+    std::uint32_t flags) = delete;
+
+  reference operator*() const noexcept
   {
-    DWORD const last_error = ::GetLastError();
-    HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
-                                    << ErrorString{"CreateFileMappingW failed."}
-                                    << ErrorCodeWinLast{last_error});
+    HADESMEM_DETAIL_ASSERT(impl_.get());
+    return impl_->address_;
   }
 
-  detail::SmartMappedFileHandle const file_view{
-    ::MapViewOfFile(file_mapping.GetHandle(), FILE_MAP_READ, 0, 0, 0)};
-  if (!file_view.IsValid())
+  pointer operator->() const noexcept
   {
-    DWORD const last_error = ::GetLastError();
-    HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
-                                    << ErrorString{"MapViewOfFile failed."}
-                                    << ErrorCodeWinLast{last_error});
+    HADESMEM_DETAIL_ASSERT(impl_.get());
+    return &impl_->address_;
   }
 
-  auto const base = file_view.GetHandle();
-  auto const size = detail::GetRegionAllocSize(process, base);
-  return Find(process, base, size, data, flags, start, name);
+  PatternMatchIterator& operator++()
+  {
+    HADESMEM_DETAIL_ASSERT(impl_.get());
+
+    if (!impl_->Next())
+    {
+      impl_.reset();
+    }
+
+    return *this;
+  }
+
+  PatternMatchIterator operator++(int)
+  {
+    PatternMatchIterator const iter{*this};
+    ++*this;
+    return iter;
+  }
+
+  bool operator==(PatternMatchIterator const& other) const noexcept
+  {
+    return impl_ == other.impl_;
+  }
+
+  bool operator!=(PatternMatchIterator const& other) const noexcept
+  {
+    return !(*this == other);
+  }
+
+private:
+  struct Impl
+  {
+    explicit Impl(
+      Process const& process,
+      std::shared_ptr<std::vector<detail::ModuleRegionInfo::ScanRegion> const>
+        regions,
+      std::shared_ptr<detail::PatternSearch const> search,
+      std::uintptr_t base,
+      std::uint32_t flags) noexcept
+      : process_{&process},
+        regions_{std::move(regions)},
+        search_{std::move(search)},
+        base_{base},
+        flags_{flags}
+    {
+    }
+
+    // Each region is read exactly once, into a buffer which is reused for
+    // the next region once all of its matches have been consumed.
+    bool Next()
+    {
+      for (;;)
+      {
+        if (h_cur_)
+        {
+          std::uint8_t const* const h_end = buffer_.data() + buffer_.size();
+          if (auto const match = search_->Search(h_cur_, h_end))
+          {
+            auto const region_beg = (*regions_)[region_index_].first;
+            std::uint8_t* const address =
+              region_beg + (match - buffer_.data());
+            address_ = !!(flags_ & PatternFlags::kRelativeAddress)
+                         ? address - base_
+                         : address;
+            h_cur_ = match + 1;
+            return true;
+          }
+
+          h_cur_ = nullptr;
+          ++region_index_;
+        }
+
+        if (region_index_ == regions_->size())
+        {
+          return false;
+        }
+
+        auto const& region = (*regions_)[region_index_];
+        if (region.first == region.second)
+        {
+          ++region_index_;
+          continue;
+        }
+
+        buffer_.resize(static_cast<std::size_t>(region.second - region.first));
+        detail::ReadImpl(
+          *process_, region.first, buffer_.data(), buffer_.size());
+        h_cur_ = buffer_.data();
+      }
+    }
+
+    Process const* process_;
+    std::shared_ptr<std::vector<detail::ModuleRegionInfo::ScanRegion> const>
+      regions_;
+    std::shared_ptr<detail::PatternSearch const> search_;
+    std::uintptr_t base_;
+    std::uint32_t flags_;
+    std::size_t region_index_{0};
+    std::vector<std::uint8_t> buffer_;
+    std::uint8_t const* h_cur_{nullptr};
+    void* address_{nullptr};
+  };
+
+  // Shallow copy semantics, as required by InputIterator.
+  std::shared_ptr<Impl> impl_;
+};
+
+// Lazily enumerates every (possibly overlapping) match of a pattern. Flags
+// have the same meaning as for Find, with kThrowOnUnmatch applying only when
+// there are no matches at all.
+class PatternMatchList
+{
+public:
+  using value_type = void*;
+  using iterator = PatternMatchIterator;
+  using const_iterator = PatternMatchIterator;
+
+  explicit PatternMatchList(
+    Process const& process,
+    std::vector<detail::ModuleRegionInfo::ScanRegion> regions,
+    std::uintptr_t base,
+    std::wstring const& data,
+    std::uint32_t flags)
+    : process_{&process},
+      regions_{
+        std::make_shared<std::vector<detail::ModuleRegionInfo::ScanRegion>>(
+          std::move(regions))},
+      base_{base},
+      flags_{flags}
+  {
+    HADESMEM_DETAIL_ASSERT(
+      !(flags & ~(PatternFlags::kInvalidFlagMaxValue - 1UL)));
+
+    auto const needle = detail::ConvertData(data);
+    search_ = std::make_shared<detail::PatternSearch>(std::begin(needle),
+                                                      std::end(needle));
+  }
+
+  explicit PatternMatchList(
+    Process&& process,
+    std::vector<detail::ModuleRegionInfo::ScanRegion> regions,
+    std::uintptr_t base,
+    std::wstring const& data,
+    std::uint32_t flags) = delete;
+
+  iterator begin() const
+  {
+    iterator iter{*process_, regions_, search_, base_, flags_};
+    if (iter == end() && !!(flags_ & PatternFlags::kThrowOnUnmatch))
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Could not match pattern."});
+    }
+
+    return iter;
+  }
+
+  const_iterator cbegin() const
+  {
+    return begin();
+  }
+
+  iterator end() const noexcept
+  {
+    return iterator();
+  }
+
+  const_iterator cend() const noexcept
+  {
+    return const_iterator();
+  }
+
+private:
+  Process const* process_;
+  std::shared_ptr<std::vector<detail::ModuleRegionInfo::ScanRegion> const>
+    regions_;
+  std::shared_ptr<detail::PatternSearch const> search_;
+  std::uintptr_t base_;
+  std::uint32_t flags_;
+};
+
+inline PatternMatchList FindAll(Process const& process,
+                                std::wstring const& module,
+                                std::wstring const& data,
+                                std::uint32_t flags)
+{
+  auto const mod_info = detail::GetModuleInfo(process, module);
+  bool const scan_data_secs = !!(flags & PatternFlags::kScanData);
+  return PatternMatchList{
+    process,
+    scan_data_secs ? mod_info.data_regions : mod_info.code_regions,
+    reinterpret_cast<std::uintptr_t>(mod_info.module->GetHandle()),
+    data,
+    flags};
+}
+
+inline PatternMatchList FindAll(Process const& process,
+                                void* base,
+                                std::size_t size,
+                                std::wstring const& data,
+                                std::uint32_t flags)
+{
+  auto const region = std::make_pair(static_cast<std::uint8_t*>(base),
+                                     static_cast<std::uint8_t*>(base) + size);
+  return PatternMatchList{process,
+                          {region},
+                          reinterpret_cast<std::uintptr_t>(base),
+                          data,
+                          flags};
 }
 
 class Pattern
@@ -715,21 +1394,108 @@ public:
   explicit FindPattern(Process const& process,
                        std::wstring const& pattern_file,
                        bool in_memory_file)
+    : FindPattern{process, pattern_file, in_memory_file, std::wstring{}}
+  {
+  }
+
+  explicit FindPattern(Process const&& process,
+                       std::wstring const& pattern,
+                       bool in_memory_file) = delete;
+
+  // Results are cached on disk at cache_path (if non-empty), keyed by the
+  // identity of each module, so subsequent runs against the same binaries only
+  // need to verify the cached matches instead of scanning. The cache file is
+  // not locked, so it must not be used by multiple processes (or instances)
+  // at once.
+  explicit FindPattern(Process const& process,
+                       std::wstring const& pattern_file,
+                       bool in_memory_file,
+                       std::wstring const& cache_path)
     : process_{&process}, find_pattern_datas_{}
   {
+    LoadWithCache(cache_path,
+                  [&](detail::PatternCache* cache)
+                  {
+                    if (in_memory_file)
+                    {
+                      LoadPatternFileMemory(pattern_file, cache);
+                    }
+                    else
+                    {
+                      LoadPatternFile(pattern_file, cache);
+                    }
+                  });
+  }
+
+  explicit FindPattern(Process const&& process,
+                       std::wstring const& pattern,
+                       bool in_memory_file,
+                       std::wstring const& cache_path) = delete;
+
+  // Loads a pattern file compiled with CompilePatternFile. The blob is parsed
+  // in place and is not referenced after the constructor returns. Compiled
+  // files on disk can also be passed to the other constructors directly.
+  explicit FindPattern(Process const& process,
+                       void const* blob,
+                       std::size_t blob_size,
+                       std::wstring const& cache_path)
+    : process_{&process}, find_pattern_datas_{}
+  {
+    LoadWithCache(cache_path,
+                  [&](detail::PatternCache* cache)
+                  {
+                    LoadPatternBlob(blob, blob_size, cache);
+                  });
+  }
+
+  explicit FindPattern(Process const&& process,
+                       void const* blob,
+                       std::size_t blob_size,
+                       std::wstring const& cache_path) = delete;
+
+  // Converts a pattern file to the binary format, doing all the parsing and
+  // validation up front.
+  static std::vector<std::uint8_t>
+    CompilePatternFile(std::wstring const& pattern_file, bool in_memory_file)
+  {
+    pugi::xml_document doc;
     if (in_memory_file)
     {
-      LoadPatternFileMemory(pattern_file);
+      LoadXmlMemory(doc, pattern_file);
     }
     else
     {
-      LoadPatternFile(pattern_file);
+      LoadXmlFile(doc, pattern_file);
     }
-  }
 
-  explicit FindPattern(Process const&& process,
-                       std::wstring const& pattern,
-                       bool in_memory_file) = delete;
+    auto const patterns_info_full_list = ReadPatternsFromXml(doc);
+
+    detail::PatternBlobWriter writer;
+    writer.WriteU32(static_cast<std::uint32_t>(patterns_info_full_list.size()));
+    for (auto const& patterns_info_full_pair : patterns_info_full_list)
+    {
+      auto const& patterns_info_full = patterns_info_full_pair.second;
+      writer.WriteString(patterns_info_full_pair.first);
+      writer.WriteU32(patterns_info_full.flags);
+      writer.WriteU32(
+        static_cast<std::uint32_t>(patterns_info_full.patterns.size()));
+      for (auto const& p : patterns_info_full.patterns)
+      {
+        writer.WriteString(p.pattern.name);
+        writer.WriteString(p.pattern.data);
+        writer.WriteString(p.pattern.start);
+        writer.WriteString(p.pattern.start_rva);
+        writer.WriteString(p.pattern.start_export);
+        writer.WriteU32(p.pattern.flags);
+        writer.WriteNeedle(p.needle);
+        writer.WriteU32(static_cast<std::uint32_t>(p.anchor.offset));
+        writer.WriteU32(static_cast<std::uint32_t>(p.anchor.length));
+        writer.WriteBytes(p.code);
+      }
+    }
+
+    return writer.GetBuffer();
+  }
 
   ModuleMap const& GetModuleMap() const noexcept
   {
@@ -766,9 +1532,34 @@ public:
   }
 
 private:
-  void LoadPatternFile(std::wstring const& path)
+  template <typename Loader>
+  void LoadWithCache(std::wstring const& cache_path, Loader load)
+  {
+    std::unique_ptr<detail::PatternCache> cache;
+    if (!cache_path.empty())
+    {
+      cache = std::make_unique<detail::PatternCache>(cache_path);
+    }
+
+    load(cache.get());
+
+    if (cache)
+    {
+      // Failing to write the cache only costs us a rescan next time.
+      try
+      {
+        cache->Save();
+      }
+      catch (...)
+      {
+        HADESMEM_DETAIL_TRACE_A(
+          boost::current_exception_diagnostic_information().c_str());
+      }
+    }
+  }
+
+  static void LoadXmlFile(pugi::xml_document& doc, std::wstring const& path)
   {
-    pugi::xml_document doc;
     auto const load_result = doc.load_file(path.c_str());
     if (!load_result)
     {
@@ -777,13 +1568,10 @@ private:
                 << ErrorCodeOther{static_cast<DWORD_PTR>(load_result.status)}
                 << ErrorStringOther{load_result.description()});
     }
-
-    LoadPatternFileImpl(doc);
   }
 
-  void LoadPatternFileMemory(std::wstring const& data)
+  static void LoadXmlMemory(pugi::xml_document& doc, std::wstring const& data)
   {
-    pugi::xml_document doc;
     auto const load_result = doc.load(data.c_str());
     if (!load_result)
     {
@@ -792,8 +1580,70 @@ private:
                 << ErrorCodeOther{static_cast<DWORD_PTR>(load_result.status)}
                 << ErrorStringOther{load_result.description()});
     }
+  }
+
+  void LoadPatternFile(std::wstring const& path, detail::PatternCache* cache)
+  {
+    // Compiled pattern files are parsed straight out of a view of the file.
+    detail::SmartFileHandle const file{::CreateFileW(path.c_str(),
+                                                     GENERIC_READ,
+                                                     FILE_SHARE_READ,
+                                                     nullptr,
+                                                     OPEN_EXISTING,
+                                                     0,
+                                                     nullptr)};
+    LARGE_INTEGER file_size{};
+    if (file.IsValid() && ::GetFileSizeEx(file.GetHandle(), &file_size) &&
+        file_size.QuadPart >=
+          static_cast<LONGLONG>(sizeof(detail::kPatternBlobMagic)))
+    {
+      detail::SmartHandle const file_mapping{::CreateFileMappingW(
+        file.GetHandle(), nullptr, PAGE_READONLY, 0, 0, nullptr)};
+      if (!file_mapping.IsValid())
+      {
+        DWORD const last_error = ::GetLastError();
+        HADESMEM_DETAIL_THROW_EXCEPTION(
+          Error{} << ErrorString{"CreateFileMappingW failed."}
+                  << ErrorCodeWinLast{last_error});
+      }
+
+      detail::SmartMappedFileHandle const file_view{
+        ::MapViewOfFile(file_mapping.GetHandle(), FILE_MAP_READ, 0, 0, 0)};
+      if (!file_view.IsValid())
+      {
+        DWORD const last_error = ::GetLastError();
+        HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                        << ErrorString{"MapViewOfFile failed."}
+                                        << ErrorCodeWinLast{last_error});
+      }
+
+      auto const size = static_cast<std::size_t>(file_size.QuadPart);
+      if (detail::IsPatternBlob(file_view.GetHandle(), size))
+      {
+        LoadPatternBlob(file_view.GetHandle(), size, cache);
+        return;
+      }
+    }
+
+    // Let pugixml report any errors opening the file.
+    pugi::xml_document doc;
+    LoadXmlFile(doc, path);
+    LoadPatternFileImpl(ReadPatternsFromXml(doc), cache);
+  }
+
+  void LoadPatternFileMemory(std::wstring const& data,
+                             detail::PatternCache* cache)
+  {
+    pugi::xml_document doc;
+    LoadXmlMemory(doc, data);
+    LoadPatternFileImpl(ReadPatternsFromXml(doc), cache);
+  }
 
-    LoadPatternFileImpl(doc);
+  void LoadPatternBlob(void const* blob,
+                       std::size_t blob_size,
+                       detail::PatternCache* cache)
+  {
+    LoadPatternFileImpl(ReadPatternsFromBlob(blob, blob_size), cache);
   }
 
   Pattern LookupEx(std::wstring const& module, std::wstring const& name) const
@@ -820,28 +1670,13 @@ private:
     std::uint32_t flags;
   };
 
-  struct ManipInfo
-  {
-    enum class Manipulator
-    {
-      kAdd,
-      kSub,
-      kRel,
-      kLea,
-      kAnd
-    };
-
-    Manipulator type;
-    bool has_operand1;
-    std::uintptr_t operand1;
-    bool has_operand2;
-    std::uintptr_t operand2;
-  };
-
   struct PatternInfoFull
   {
     PatternInfo pattern;
-    std::vector<ManipInfo> manipulators;
+    std::vector<detail::PatternDataByte> needle;
+    detail::PatternAnchor anchor;
+    // Manipulators, as validated bytecode (see pattern_blob.hpp).
+    std::vector<std::uint8_t> code;
   };
 
   struct FindPatternInfo
@@ -850,7 +1685,7 @@ private:
     std::vector<PatternInfoFull> patterns;
   };
 
-  std::uint32_t ReadFlags(pugi::xml_node const& node) const
+  static std::uint32_t ReadFlags(pugi::xml_node const& node)
   {
     std::uint32_t flags = PatternFlags::kNone;
     for (auto const& flag : node.children(L"Flag"))
@@ -873,6 +1708,10 @@ private:
       {
         flags |= PatternFlags::kScanData;
       }
+      else if (flag_name == L"Parallel")
+      {
+        flags |= PatternFlags::kParallel;
+      }
       else
       {
         HADESMEM_DETAIL_THROW_EXCEPTION(
@@ -883,8 +1722,8 @@ private:
     return flags;
   }
 
-  std::map<std::wstring, FindPatternInfo>
-    ReadPatternsFromXml(pugi::xml_document const& doc) const
+  static std::map<std::wstring, FindPatternInfo>
+    ReadPatternsFromXml(pugi::xml_document const& doc)
   {
     auto const hadesmem_root = doc.child(L"HadesMem");
     if (!hadesmem_root)
@@ -930,33 +1769,33 @@ private:
                                  pattern_start_export,
                                  pattern_flags};
 
-        std::vector<ManipInfo> pattern_manips;
+        std::vector<std::uint8_t> pattern_code;
 
         for (auto const& manipulator : pattern.children(L"Manipulator"))
         {
           auto const manipulator_name =
             detail::pugixml::GetAttributeValue(manipulator, L"Name");
 
-          ManipInfo::Manipulator type = ManipInfo::Manipulator::kAdd;
+          detail::PatternOp op = detail::PatternOp::kAdd;
           if (manipulator_name == L"Add")
           {
-            type = ManipInfo::Manipulator::kAdd;
+            op = detail::PatternOp::kAdd;
           }
           else if (manipulator_name == L"Sub")
           {
-            type = ManipInfo::Manipulator::kSub;
+            op = detail::PatternOp::kSub;
           }
           else if (manipulator_name == L"Rel")
           {
-            type = ManipInfo::Manipulator::kRel;
+            op = detail::PatternOp::kRel;
           }
           else if (manipulator_name == L"Lea")
           {
-            type = ManipInfo::Manipulator::kLea;
+            op = detail::PatternOp::kLea;
           }
           else if (manipulator_name == L"And")
           {
-            type = ManipInfo::Manipulator::kAnd;
+            op = detail::PatternOp::kAnd;
           }
           else
           {
@@ -977,12 +1816,28 @@ private:
             has_operand2 ? detail::HexStrToPtr(manipulator_operand2.value())
                          : 0U;
 
-          pattern_manips.emplace_back(
-            ManipInfo{type, has_operand1, operand1, has_operand2, operand2});
+          std::size_t const num_operands = detail::GetPatternOpNumOperands(op);
+          if (has_operand1 != (num_operands > 0) ||
+              has_operand2 != (num_operands > 1))
+          {
+            HADESMEM_DETAIL_THROW_EXCEPTION(
+              Error{} << ErrorString{"Invalid manipulator operands for '" +
+                                     detail::WideCharToMultiByte(
+                                       manipulator_name) +
+                                     "'."});
+          }
+
+          detail::AppendPatternOp(pattern_code, op, operand1, operand2);
         }
 
-        pattern_infos.emplace_back(
-          PatternInfoFull{pattern_info, pattern_manips});
+        auto pattern_needle = detail::ConvertData(pattern_data);
+        auto const pattern_anchor = detail::MultiPatternSearch::GetAnchor(
+          std::begin(pattern_needle), std::end(pattern_needle), false);
+
+        pattern_infos.emplace_back(PatternInfoFull{pattern_info,
+                                                   std::move(pattern_needle),
+                                                   pattern_anchor,
+                                                   std::move(pattern_code)});
       }
 
       HADESMEM_DETAIL_ASSERT(pattern_infos_full.find(module_name) ==
@@ -993,69 +1848,113 @@ private:
     return pattern_infos_full;
   }
 
-  void* ApplyManipulators(void* address,
-                          std::uint32_t flags,
-                          std::uintptr_t base,
-                          std::vector<ManipInfo> const& manip_list) const
+  static std::map<std::wstring, FindPatternInfo>
+    ReadPatternsFromBlob(void const* blob, std::size_t blob_size)
   {
-    for (auto const& m : manip_list)
+    detail::PatternBlobReader reader{blob, blob_size};
+    auto const check = [](bool valid)
+    {
+      if (!valid)
+      {
+        HADESMEM_DETAIL_THROW_EXCEPTION(
+          Error{} << ErrorString{"Invalid compiled pattern file."});
+      }
+    };
+    auto const check_flags = [&](std::uint32_t flags)
+    {
+      check(!(flags & ~(PatternFlags::kInvalidFlagMaxValue - 1UL)));
+    };
+
+    check(reader.ReadHeader());
+
+    std::map<std::wstring, FindPatternInfo> pattern_infos_full;
+    std::uint32_t num_modules = 0;
+    check(reader.ReadU32(num_modules));
+    for (std::uint32_t i = 0; i < num_modules; ++i)
     {
-      switch (m.type)
+      std::wstring module_name;
+      FindPatternInfo find_pattern_info{};
+      std::uint32_t num_patterns = 0;
+      check(reader.ReadString(module_name) &&
+            reader.ReadU32(find_pattern_info.flags) &&
+            reader.ReadU32(num_patterns));
+      check_flags(find_pattern_info.flags);
+      check(pattern_infos_full.find(module_name) ==
+            std::end(pattern_infos_full));
+
+      for (std::uint32_t j = 0; j < num_patterns; ++j)
       {
-      case ManipInfo::Manipulator::kAdd:
-        if (!m.has_operand1 || m.has_operand2)
+        PatternInfoFull p{};
+        std::uint32_t anchor_offset = 0;
+        std::uint32_t anchor_length = 0;
+        check(reader.ReadString(p.pattern.name) &&
+              reader.ReadString(p.pattern.data) &&
+              reader.ReadString(p.pattern.start) &&
+              reader.ReadString(p.pattern.start_rva) &&
+              reader.ReadString(p.pattern.start_export) &&
+              reader.ReadU32(p.pattern.flags) && reader.ReadNeedle(p.needle) &&
+              reader.ReadU32(anchor_offset) && reader.ReadU32(anchor_length) &&
+              reader.ReadBytes(p.code));
+        check_flags(p.pattern.flags);
+        check(detail::IsPatternCodeValid(p.code));
+
+        // The anchor must be a run of exact bytes within the needle.
+        check(anchor_length <= detail::MultiPatternSearch::kMaxAnchorLen &&
+              anchor_offset <= p.needle.size() &&
+              anchor_length <= p.needle.size() - anchor_offset);
+        p.anchor = detail::PatternAnchor{anchor_offset, anchor_length};
+        for (std::size_t k = 0; k < anchor_length; ++k)
         {
-          HADESMEM_DETAIL_THROW_EXCEPTION(
-            Error{} << ErrorString{"Invalid manipulator operands for 'Add'."});
+          check(detail::IsExact(p.needle[anchor_offset + k]));
         }
 
-        address = detail::Add(*process_, base, address, flags, m.operand1);
+        find_pattern_info.patterns.emplace_back(std::move(p));
+      }
 
-        break;
+      pattern_infos_full[module_name] = std::move(find_pattern_info);
+    }
 
-      case ManipInfo::Manipulator::kSub:
-        if (!m.has_operand1 || m.has_operand2)
-        {
-          HADESMEM_DETAIL_THROW_EXCEPTION(
-            Error{} << ErrorString{"Invalid manipulator operands for 'Sub'."});
-        }
+    check(reader.IsEnd());
 
-        address = detail::Sub(*process_, base, address, flags, m.operand1);
+    return pattern_infos_full;
+  }
 
+  void* ApplyManipulators(void* address,
+                          std::uint32_t flags,
+                          std::uintptr_t base,
+                          std::vector<std::uint8_t> const& code) const
+  {
+    // The bytecode is validated when it is compiled (or loaded), so we don't
+    // need to check operand counts here.
+    std::uint8_t const* pc = code.data();
+    std::uint8_t const* const end = pc + code.size();
+    while (pc != end)
+    {
+      switch (static_cast<detail::PatternOp>(*pc++))
+      {
+      case detail::PatternOp::kAdd:
+        address = detail::Add(*process_, base, address, flags, Operand(pc));
         break;
 
-      case ManipInfo::Manipulator::kRel:
-        if (!m.has_operand1 || !m.has_operand2)
-        {
-          HADESMEM_DETAIL_THROW_EXCEPTION(
-            Error{} << ErrorString{"Invalid manipulator operands for 'Rel'."});
-        }
+      case detail::PatternOp::kSub:
+        address = detail::Sub(*process_, base, address, flags, Operand(pc));
+        break;
 
+      case detail::PatternOp::kRel:
+      {
+        std::uintptr_t const operand1 = Operand(pc);
+        std::uintptr_t const operand2 = Operand(pc);
         address =
-          detail::Rel(*process_, base, address, flags, m.operand1, m.operand2);
-
+          detail::Rel(*process_, base, address, flags, operand1, operand2);
         break;
+      }
 
-      case ManipInfo::Manipulator::kLea:
-        if (m.has_operand1 || m.has_operand2)
-        {
-          HADESMEM_DETAIL_THROW_EXCEPTION(
-            Error{} << ErrorString{"Invalid manipulator operands for 'Lea'."});
-        }
-
+      case detail::PatternOp::kLea:
         address = detail::Lea(*process_, base, address, flags);
-
         break;
 
-      case ManipInfo::Manipulator::kAnd:
-        if (!m.has_operand1 || m.has_operand2)
-        {
-          HADESMEM_DETAIL_THROW_EXCEPTION(
-            Error{} << ErrorString{"Invalid manipulator operands for 'And'."});
-        }
-
-        address = detail::And(*process_, base, address, flags, m.operand1);
-
+      case detail::PatternOp::kAnd:
+        address = detail::And(*process_, base, address, flags, Operand(pc));
         break;
 
       default:
@@ -1069,6 +1968,11 @@ private:
     return address;
   }
 
+  static std::uintptr_t Operand(std::uint8_t const*& pc) noexcept
+  {
+    return static_cast<std::uintptr_t>(detail::ReadPatternCodeOperand(pc));
+  }
+
   std::uintptr_t GetStartRvaFromPattern(std::wstring const& module,
                                         std::uintptr_t base,
                                         std::wstring const& start) const
@@ -1111,9 +2015,38 @@ private:
     return start_rva;
   }
 
-  void LoadPatternFileImpl(pugi::xml_document const& doc)
+  bool IsPatternResolved(std::wstring const& module,
+                         std::wstring const& name) const
+  {
+    auto const pattern_map = find_pattern_datas_.find(module);
+    return pattern_map != std::end(find_pattern_datas_) &&
+           pattern_map->second.find(name) != std::end(pattern_map->second);
+  }
+
+  // Only the raw match is verified, manipulators are always reapplied as they
+  // may read memory which changes at runtime.
+  bool IsCachedMatchValid(std::uintptr_t base,
+                          std::uintptr_t rva,
+                          std::vector<detail::PatternDataByte> const& needle)
+    const
+  {
+    try
+    {
+      auto const buf = ReadVector<std::uint8_t>(
+        *process_, reinterpret_cast<void*>(base + rva), needle.size());
+      return detail::MatchPatternAt(
+        buf.data(), std::begin(needle), std::end(needle));
+    }
+    catch (...)
+    {
+      return false;
+    }
+  }
+
+  void LoadPatternFileImpl(
+    std::map<std::wstring, FindPatternInfo> const& patterns_info_full_list,
+    detail::PatternCache* cache)
   {
-    auto const patterns_info_full_list = ReadPatternsFromXml(doc);
     for (auto const& patterns_info_full_pair : patterns_info_full_list)
     {
       HADESMEM_DETAIL_ASSERT(
@@ -1127,37 +2060,154 @@ private:
       auto const& module = patterns_info_full_pair.first;
       auto const& patterns_info_full = patterns_info_full_pair.second;
       auto const& pattern_infos = patterns_info_full.patterns;
-      for (auto const& p : pattern_infos)
+      auto const identity = cache
+                              ? detail::GetModuleIdentity(*process_,
+                                                          *mod_info.module)
+                              : detail::ModuleIdentity{};
+
+      // Patterns using another pattern as their start address can't be
+      // scanned for until that pattern has been resolved, so the patterns are
+      // resolved in 'waves'. Each wave only reads and scans the module once.
+      std::vector<bool> resolved(pattern_infos.size());
+      std::size_t num_resolved = 0;
+      while (num_resolved != pattern_infos.size())
       {
-        std::uint32_t const flags = patterns_info_full.flags | p.pattern.flags;
-        void* address = nullptr;
-        std::uintptr_t const start_rva = [&]() -> std::uintptr_t
+        std::vector<std::size_t> wave;
+        std::vector<std::uintptr_t> wave_start_rvas;
+        std::vector<detail::MultiFindInfo> find_infos;
+        for (std::size_t i = 0; i < pattern_infos.size(); ++i)
         {
-          if (!p.pattern.start_rva.empty())
+          auto const& p = pattern_infos[i];
+          bool const depends_on_pattern = p.pattern.start_rva.empty() &&
+                                          p.pattern.start_export.empty() &&
+                                          !p.pattern.start.empty();
+          if (resolved[i] ||
+              (depends_on_pattern &&
+               !IsPatternResolved(module, p.pattern.start)))
           {
-            return detail::HexStrToPtr(p.pattern.start_rva);
+            continue;
           }
-          else if (!p.pattern.start_export.empty())
+
+          std::uint32_t const flags =
+            patterns_info_full.flags | p.pattern.flags;
+          HADESMEM_DETAIL_ASSERT(
+            !(flags & ~(PatternFlags::kInvalidFlagMaxValue - 1UL)));
+          std::uintptr_t const start_rva = [&]() -> std::uintptr_t
           {
-            return GetStartRvaFromExport(*mod_info.module,
-                                         p.pattern.start_export);
-          }
-          else
+            if (!p.pattern.start_rva.empty())
+            {
+              return detail::HexStrToPtr(p.pattern.start_rva);
+            }
+            else if (!p.pattern.start_export.empty())
+            {
+              return GetStartRvaFromExport(*mod_info.module,
+                                           p.pattern.start_export);
+            }
+            else
+            {
+              return GetStartRvaFromPattern(module, base, p.pattern.start);
+            }
+          }();
+          void* const start_abs =
+            start_rva ? reinterpret_cast<std::uint8_t*>(base) + start_rva
+                      : nullptr;
+
+          wave.push_back(i);
+          wave_start_rvas.push_back(start_rva);
+          find_infos.emplace_back(
+            detail::MultiFindInfo{
+              &p.needle, &p.anchor, flags, start_abs, nullptr});
+        }
+
+        // Everything left depends on a pattern that doesn't exist (or on
+        // each other), so let the lookup report the error.
+        if (wave.empty())
+        {
+          auto const unresolved =
+            std::find(std::begin(resolved), std::end(resolved), false);
+          auto const& p = pattern_infos[static_cast<std::size_t>(
+            std::distance(std::begin(resolved), unresolved))];
+          GetStartRvaFromPattern(module, base, p.pattern.start);
+          HADESMEM_DETAIL_THROW_EXCEPTION(
+            Error{} << ErrorString{"Invalid pattern start dependency."});
+        }
+
+        // Anything with a valid cached match can skip the scan entirely.
+        std::vector<std::size_t> scan_indices;
+        std::vector<detail::MultiFindInfo> scan_infos;
+        for (std::size_t j = 0; j < wave.size(); ++j)
+        {
+          auto const& p = pattern_infos[wave[j]];
+          std::uintptr_t rva = 0;
+          if (cache &&
+              cache->Lookup(module,
+                            identity,
+                            p.pattern.name,
+                            p.pattern.data,
+                            find_infos[j].flags,
+                            wave_start_rvas[j],
+                            rva) &&
+              IsCachedMatchValid(base, rva, p.needle))
           {
-            return GetStartRvaFromPattern(module, base, p.pattern.start);
+            find_infos[j].address = reinterpret_cast<void*>(base + rva);
+            continue;
           }
-        }();
 
-        address = ::hadesmem::Find(
-          *process_, module, p.pattern.data, flags, start_rva, &p.pattern.name);
+          scan_indices.push_back(j);
+          scan_infos.push_back(find_infos[j]);
+        }
+
+        if (!scan_infos.empty())
+        {
+          detail::FindMulti(*process_, mod_info, scan_infos);
+        }
 
-        if (address)
+        for (std::size_t k = 0; k < scan_indices.size(); ++k)
         {
-          address = ApplyManipulators(address, flags, base, p.manipulators);
+          auto const j = scan_indices[k];
+          find_infos[j].address = scan_infos[k].address;
+          if (cache && find_infos[j].address)
+          {
+            auto const& p = pattern_infos[wave[j]];
+            cache->Store(
+              module,
+              identity,
+              p.pattern.name,
+              p.pattern.data,
+              find_infos[j].flags,
+              wave_start_rvas[j],
+              reinterpret_cast<std::uintptr_t>(find_infos[j].address) - base);
+          }
         }
 
-        find_pattern_datas_[patterns_info_full_pair.first][p.pattern.name] =
-          Pattern{address, flags};
+        for (std::size_t j = 0; j < wave.size(); ++j)
+        {
+          auto const& p = pattern_infos[wave[j]];
+          std::uint32_t const flags = find_infos[j].flags;
+          void* address = find_infos[j].address;
+          if (address && !!(flags & PatternFlags::kRelativeAddress))
+          {
+            address = static_cast<std::uint8_t*>(address) - base;
+          }
+
+          if (!address && !!(flags & PatternFlags::kThrowOnUnmatch))
+          {
+            HADESMEM_DETAIL_THROW_EXCEPTION(
+              Error{} << ErrorString{"Could not match pattern."}
+                      << ErrorStringOther{
+                           detail::WideCharToMultiByte(p.pattern.name)});
+          }
+
+          if (address)
+          {
+            address = ApplyManipulators(address, flags, base, p.code);
+          }
+
+          find_pattern_datas_[module][p.pattern.name] = Pattern{address, flags};
+
+          resolved[wave[j]] = true;
+          ++num_resolved;
+        }
       }
     }
   }
@@ -0,0 +1,258 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/memory_source.hpp>
+#include <hadesmem/detail/read_impl.hpp>
+#include <hadesmem/detail/smart_handle.hpp>
+#include <hadesmem/detail/static_assert.hpp>
+#include <hadesmem/detail/type_traits.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/process.hpp>
+#include <hadesmem/read.hpp>
+
+namespace hadesmem
+{
+// Where PeLib and the pattern scanner get their memory from. A remote source
+// reads everything from a process. A local source also has a span of memory
+// in this process (e.g. a file which has been read into a buffer, or a
+// MappedFile) which is read directly with plain loads. Anything outside the
+// span is read from the process as usual, so for a local source the process
+// should normally be the current one. Read, ReadVector, ReadString and
+// ReadStringBounded accept a source in place of a process.
+class MemorySource
+{
+public:
+  explicit MemorySource(Process const& process) noexcept : process_{&process}
+  {
+  }
+
+  explicit MemorySource(Process&& process) = delete;
+
+  explicit MemorySource(Process const& process,
+                        void const* base,
+                        std::size_t size) noexcept
+    : process_{&process}, local_{base, size}
+  {
+    HADESMEM_DETAIL_ASSERT(size ? base != nullptr : true);
+  }
+
+  explicit MemorySource(Process&& process,
+                        void const* base,
+                        std::size_t size) = delete;
+
+  Process const& GetProcess() const noexcept
+  {
+    return *process_;
+  }
+
+  bool IsLocal() const noexcept
+  {
+    return !local_.IsEmpty();
+  }
+
+  detail::LocalMemorySource const& GetLocal() const noexcept
+  {
+    return local_;
+  }
+
+  // Returns a pointer to the len bytes at address if they can be read
+  // directly, or nullptr otherwise.
+  std::uint8_t const* GetPointer(void const* address,
+                                 std::size_t len) const noexcept
+  {
+    return local_.GetPointer(address, len);
+  }
+
+private:
+  Process const* process_;
+  detail::LocalMemorySource local_;
+};
+
+// A file mapped read-only into this process, for use as a local memory
+// source.
+class MappedFile
+{
+public:
+  explicit MappedFile(std::wstring const& path)
+    : file_{::CreateFileW(path.c_str(),
+                          GENERIC_READ,
+                          FILE_SHARE_READ,
+                          nullptr,
+                          OPEN_EXISTING,
+                          0,
+                          nullptr)}
+  {
+    if (!file_.IsValid())
+    {
+      DWORD const last_error = ::GetLastError();
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"CreateFileW failed."}
+                                      << ErrorCodeWinLast{last_error});
+    }
+
+    LARGE_INTEGER file_size{};
+    if (!::GetFileSizeEx(file_.GetHandle(), &file_size))
+    {
+      DWORD const last_error = ::GetLastError();
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"GetFileSizeEx failed."}
+                                      << ErrorCodeWinLast{last_error});
+    }
+
+    if (static_cast<unsigned long long>(file_size.QuadPart) >
+        (std::numeric_limits<std::size_t>::max)())
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"File too large."});
+    }
+
+    size_ = static_cast<std::size_t>(file_size.QuadPart);
+
+    mapping_ = detail::SmartHandle{::CreateFileMappingW(
+      file_.GetHandle(), nullptr, PAGE_READONLY, 0, 0, nullptr)};
+    if (!mapping_.IsValid())
+    {
+      DWORD const last_error = ::GetLastError();
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"CreateFileMappingW failed."}
+                << ErrorCodeWinLast{last_error});
+    }
+
+    view_ = detail::SmartMappedFileHandle{
+      ::MapViewOfFile(mapping_.GetHandle(), FILE_MAP_READ, 0, 0, 0)};
+    if (!view_.IsValid())
+    {
+      DWORD const last_error = ::GetLastError();
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"MapViewOfFile failed."}
+                                      << ErrorCodeWinLast{last_error});
+    }
+  }
+
+  void* GetBase() const noexcept
+  {
+    return view_.GetHandle();
+  }
+
+  std::size_t GetSize() const noexcept
+  {
+    return size_;
+  }
+
+private:
+  detail::SmartFileHandle file_;
+  detail::SmartHandle mapping_;
+  detail::SmartMappedFileHandle view_;
+  std::size_t size_{};
+};
+
+template <typename T>
+inline T Read(MemorySource const& source, PVOID address)
+{
+  HADESMEM_DETAIL_STATIC_ASSERT(detail::IsTriviallyCopyable<T>::value);
+  HADESMEM_DETAIL_STATIC_ASSERT(std::is_default_constructible<T>::value);
+
+  HADESMEM_DETAIL_ASSERT(address != nullptr);
+
+  T data;
+  if (!source.GetLocal().Read(address, std::addressof(data), sizeof(data)))
+  {
+    detail::ReadImpl(
+      source.GetProcess(), address, std::addressof(data), sizeof(data));
+  }
+
+  return data;
+}
+
+template <typename T, std::size_t N>
+inline std::array<T, N> Read(MemorySource const& source, PVOID address)
+{
+  HADESMEM_DETAIL_ASSERT(address != nullptr);
+
+  return Read<std::array<T, N>>(source, address);
+}
+
+template <typename T, typename Alloc = std::allocator<T>>
+inline std::vector<T, Alloc>
+  ReadVector(MemorySource const& source, PVOID address, std::size_t count)
+{
+  HADESMEM_DETAIL_STATIC_ASSERT(detail::IsTriviallyCopyable<T>::value);
+  HADESMEM_DETAIL_STATIC_ASSERT(std::is_default_constructible<T>::value);
+
+  HADESMEM_DETAIL_ASSERT(count ? address != nullptr : true);
+
+  if (!count)
+  {
+    return {};
+  }
+
+  std::vector<T, Alloc> data(count);
+  if (!source.GetLocal().Read(address, data.data(), sizeof(T) * count))
+  {
+    detail::ReadImpl(
+      source.GetProcess(), address, data.data(), sizeof(T) * count);
+  }
+
+  return data;
+}
+
+template <typename T,
+          typename Traits = std::char_traits<T>,
+          typename Alloc = std::allocator<T>>
+std::basic_string<T, Traits, Alloc> ReadStringBounded(
+  MemorySource const& source, PVOID address, void* upper_bound)
+{
+  HADESMEM_DETAIL_STATIC_ASSERT(detail::IsCharType<T>::value);
+
+  HADESMEM_DETAIL_ASSERT(address != nullptr);
+
+  std::size_t len = 0;
+  if (!source.GetLocal().GetStringLength<T>(address, upper_bound, len))
+  {
+    return ReadStringBounded<T, Traits, Alloc>(
+      source.GetProcess(), address, upper_bound);
+  }
+
+  std::basic_string<T, Traits, Alloc> data(len, T());
+  std::memcpy(&data[0], address, len * sizeof(T));
+  return data;
+}
+
+template <typename T,
+          typename Traits = std::char_traits<T>,
+          typename Alloc = std::allocator<T>>
+std::basic_string<T, Traits, Alloc> ReadString(MemorySource const& source,
+                                               PVOID address)
+{
+  HADESMEM_DETAIL_STATIC_ASSERT(detail::IsCharType<T>::value);
+
+  HADESMEM_DETAIL_ASSERT(address != nullptr);
+
+  std::size_t len = 0;
+  if (!source.GetLocal().GetStringLength<T>(address, nullptr, len))
+  {
+    return ReadString<T, Traits, Alloc>(source.GetProcess(), address);
+  }
+
+  std::basic_string<T, Traits, Alloc> data(len, T());
+  std::memcpy(&data[0], address, len * sizeof(T));
+  return data;
+}
+}
@@ -103,7 +103,8 @@ public:
 
   void UpdateRead()
   {
-    data_ = Read<IMAGE_BOUND_IMPORT_DESCRIPTOR>(*process_, base_);
+    data_ = Read<IMAGE_BOUND_IMPORT_DESCRIPTOR>(pe_file_->GetMemorySource(),
+                                                base_);
   }
 
   void UpdateWrite()
@@ -68,7 +68,7 @@ public:
 
   void UpdateRead()
   {
-    data_ = Read<IMAGE_BOUND_FORWARDER_REF>(*process_, base_);
+    data_ = Read<IMAGE_BOUND_FORWARDER_REF>(pe_file_->GetMemorySource(), base_);
   }
 
   void UpdateWrite()
@@ -27,7 +27,9 @@ class DosHeader
 {
 public:
   explicit DosHeader(Process const& process, PeFile const& pe_file)
-    : process_{&process}, base_{static_cast<std::uint8_t*>(pe_file.GetBase())}
+    : process_{&process},
+      pe_file_{&pe_file},
+      base_{static_cast<std::uint8_t*>(pe_file.GetBase())}
   {
     UpdateRead();
 
@@ -61,7 +63,7 @@ public:
 
   void UpdateRead()
   {
-    data_ = Read<IMAGE_DOS_HEADER>(*process_, base_);
+    data_ = Read<IMAGE_DOS_HEADER>(pe_file_->GetMemorySource(), base_);
   }
 
   void UpdateWrite()
@@ -270,6 +272,7 @@ public:
 
 private:
   Process const* process_;
+  PeFile const* pe_file_;
   PBYTE base_;
   IMAGE_DOS_HEADER data_ = IMAGE_DOS_HEADER{};
 };
@@ -66,14 +66,14 @@ public:
       if (ptr_ordinals && ptr_names)
       {
         std::vector<WORD> const name_ordinals =
-          ReadVector<WORD>(process, ptr_ordinals, num_names);
+          ReadVector<WORD>(pe_file.GetMemorySource(), ptr_ordinals, num_names);
         auto const name_ord_iter = std::find(
           std::begin(name_ordinals), std::end(name_ordinals), ordinal_number_);
         if (name_ord_iter != std::end(name_ordinals))
         {
           by_name_ = true;
           DWORD const name_rva =
-            Read<DWORD>(process,
+            Read<DWORD>(pe_file.GetMemorySource(),
                         ptr_names + std::distance(std::begin(name_ordinals),
                                                   name_ord_iter));
           name_ = detail::CheckedReadString<char>(
@@ -90,7 +90,7 @@ public:
         Error{} << ErrorString{"AddressOfFunctions invalid."});
     }
     rva_ptr_ = reinterpret_cast<DWORD*>(ptr_functions + ordinal_number_);
-    DWORD const func_rva = Read<DWORD>(process, rva_ptr_);
+    DWORD const func_rva = Read<DWORD>(pe_file.GetMemorySource(), rva_ptr_);
 
     NtHeaders const nt_headers{process, pe_file};
 
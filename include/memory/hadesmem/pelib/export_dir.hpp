@@ -67,7 +67,7 @@ public:
 
   void UpdateRead()
   {
-    data_ = Read<IMAGE_EXPORT_DIRECTORY>(*process_, base_);
+    data_ = Read<IMAGE_EXPORT_DIRECTORY>(pe_file_->GetMemorySource(), base_);
   }
 
   void UpdateWrite()
@@ -181,7 +181,8 @@ public:
     }
 
     std::string const current_name =
-      ReadString<char>(*process_, RvaToVa(*process_, *pe_file_, name_rva));
+      ReadString<char>(pe_file_->GetMemorySource(),
+                       RvaToVa(*process_, *pe_file_, name_rva));
 
     if (name.size() > current_name.size())
     {
@@ -96,7 +96,8 @@ public:
       DWORD const num_funcs = export_dir.GetNumberOfFunctions();
 
       for (; ((ordinal_number + ordinal_base) >= ordinal_base) &&
-             !Read<DWORD>(*impl_->process_, ptr_functions + ordinal_number) &&
+             !Read<DWORD>(impl_->pe_file_->GetMemorySource(),
+                          ptr_functions + ordinal_number) &&
              ordinal_number < num_funcs;
            ++ordinal_number)
       {
@@ -83,7 +83,9 @@ public:
           auto const offset = sizeof(DWORD) * (i + 1);
           auto const len = sizeof(IMAGE_IMPORT_DESCRIPTOR) - offset;
           auto const buf =
-            ReadVector<std::uint8_t>(*process_, desc_raw_beg, len);
+            ReadVector<std::uint8_t>(pe_file_->GetMemorySource(),
+                                     desc_raw_beg,
+                                     len);
           auto const data_beg =
             reinterpret_cast<std::uint8_t*>(&data_) + offset;
           ::ZeroMemory(&data_, sizeof(data_));
@@ -123,7 +125,7 @@ public:
   // we're reading garbage.
   void UpdateRead()
   {
-    data_ = Read<IMAGE_IMPORT_DESCRIPTOR>(*process_, base_);
+    data_ = Read<IMAGE_IMPORT_DESCRIPTOR>(pe_file_->GetMemorySource(), base_);
   }
 
   void UpdateWrite()
@@ -251,7 +253,8 @@ public:
   void SetName(std::string const& name)
   {
     DWORD name_rva =
-      Read<DWORD>(*process_, base_ + offsetof(IMAGE_IMPORT_DESCRIPTOR, Name));
+      Read<DWORD>(pe_file_->GetMemorySource(),
+                  base_ + offsetof(IMAGE_IMPORT_DESCRIPTOR, Name));
     if (!name_rva)
     {
       HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
@@ -265,7 +268,8 @@ public:
                                       << ErrorString{"Name VA is null."});
     }
 
-    std::string const cur_name = ReadString<char>(*process_, name_ptr);
+    std::string const cur_name =
+      ReadString<char>(pe_file_->GetMemorySource(), name_ptr);
 
     if (name.size() > cur_name.size())
     {
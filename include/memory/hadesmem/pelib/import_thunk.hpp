@@ -58,11 +58,11 @@ public:
   {
     if (pe_file_->Is64())
     {
-      data_64_ = Read<IMAGE_THUNK_DATA64>(*process_, base_);
+      data_64_ = Read<IMAGE_THUNK_DATA64>(pe_file_->GetMemorySource(), base_);
     }
     else
     {
-      data_32_ = Read<IMAGE_THUNK_DATA32>(*process_, base_);
+      data_32_ = Read<IMAGE_THUNK_DATA32>(pe_file_->GetMemorySource(), base_);
     }
   }
 
@@ -161,7 +161,7 @@ public:
       HADESMEM_DETAIL_THROW_EXCEPTION(
         Error{} << ErrorString{"Invalid import name and hint."});
     }
-    return Read<WORD>(*process_,
+    return Read<WORD>(pe_file_->GetMemorySource(),
                       name_import + offsetof(IMAGE_IMPORT_BY_NAME, Hint));
   }
 
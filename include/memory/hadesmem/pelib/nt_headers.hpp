@@ -74,11 +74,11 @@ public:
   {
     if (pe_file_->Is64())
     {
-      data_64_ = Read<IMAGE_NT_HEADERS64>(*process_, base_);
+      data_64_ = Read<IMAGE_NT_HEADERS64>(pe_file_->GetMemorySource(), base_);
     }
     else
     {
-      data_32_ = Read<IMAGE_NT_HEADERS32>(*process_, base_);
+      data_32_ = Read<IMAGE_NT_HEADERS32>(pe_file_->GetMemorySource(), base_);
     }
   }
 
@@ -111,7 +111,7 @@ public:
 
   void UpdateRead()
   {
-    data_ = ReadVector<std::uint8_t>(*process_, base_, size_);
+    data_ = ReadVector<std::uint8_t>(pe_file_->GetMemorySource(), base_, size_);
   }
 
   void UpdateWrite()
@@ -17,6 +17,7 @@
 #include <hadesmem/detail/assert.hpp>
 #include <hadesmem/detail/region_alloc_size.hpp>
 #include <hadesmem/error.hpp>
+#include <hadesmem/memory_source.hpp>
 #include <hadesmem/module.hpp>
 #include <hadesmem/process.hpp>
 #include <hadesmem/region.hpp>
@@ -40,11 +41,11 @@
 // pretty sure it's different in some cases... Add warning in Dump for this and
 // run a full scan.
 
-// TODO: Decouple PeLib from Process so we can operate directly on
-// files/memory/etc. Need some sort of abstraction to replace Process (and the
-// accompanying calls to Read/Write/etc.). Dependency on hadesmem APIs in
-// general should be removed, as ideally we could make the PeFile code
-// OS-independent as all we're doing is parsing files.
+// TODO: Finish decoupling PeLib from Process. Reads now go through the
+// PeFile's MemorySource (so local buffers and mapped files are parsed
+// directly), but the types still take a Process for writes. Dependency on
+// hadesmem APIs in general should be removed, as ideally we could make the
+// PeFile code OS-independent as all we're doing is parsing files.
 
 // TODO: Move to an attribute based system for warning on malformed or
 // suspicious files. Also important for testing, so we can ensure certain
@@ -117,7 +118,18 @@ public:
                   void* address,
                   PeFileType type,
                   DWORD size)
-    : process_{&process},
+    : PeFile{MemorySource{process}, address, type, size}
+  {
+  }
+
+  // Everything is read through source, so a file which has been read or
+  // mapped into this process can be parsed with plain loads by passing a
+  // local source covering it.
+  explicit PeFile(MemorySource const& source,
+                  void* address,
+                  PeFileType type,
+                  DWORD size)
+    : source_{source},
       base_{static_cast<std::uint8_t*>(address)},
       type_{type},
       size_{size}
@@ -133,13 +145,14 @@ public:
     {
       try
       {
-        Module const module{process, reinterpret_cast<HMODULE>(address)};
+        Module const module{source.GetProcess(),
+                            reinterpret_cast<HMODULE>(address)};
         size_ = module.GetSize();
       }
       catch (...)
       {
         auto const region_alloc_size =
-          detail::GetRegionAllocSize(*process_, base_);
+          detail::GetRegionAllocSize(source.GetProcess(), base_);
         HADESMEM_DETAIL_ASSERT(region_alloc_size <
                                (std::numeric_limits<DWORD>::max)());
         size_ = static_cast<DWORD>(region_alloc_size);
@@ -153,11 +166,11 @@ public:
       if (size_ > sizeof(IMAGE_DOS_HEADER))
       {
         auto const nt_hdrs_ofs =
-          Read<IMAGE_DOS_HEADER>(process, address).e_lfanew;
+          Read<IMAGE_DOS_HEADER>(source, address).e_lfanew;
         if (size_ >= nt_hdrs_ofs + sizeof(DWORD) + sizeof(IMAGE_FILE_HEADER))
         {
           auto const nt_hdrs = Read<IMAGE_NT_HEADERS>(
-            process, static_cast<std::uint8_t*>(address) + nt_hdrs_ofs);
+            source, static_cast<std::uint8_t*>(address) + nt_hdrs_ofs);
           if (nt_hdrs.Signature == IMAGE_NT_SIGNATURE &&
               nt_hdrs.FileHeader.Machine == IMAGE_FILE_MACHINE_AMD64)
           {
@@ -176,6 +189,11 @@ public:
                   PeFileType type,
                   DWORD size) = delete;
 
+  MemorySource const& GetMemorySource() const noexcept
+  {
+    return source_;
+  }
+
   PVOID GetBase() const noexcept
   {
     return base_;
@@ -197,7 +215,7 @@ public:
   }
 
 private:
-  Process const* process_;
+  MemorySource source_;
   PBYTE base_;
   PeFileType type_;
   DWORD size_;
@@ -257,7 +275,7 @@ inline std::wostream& operator<<(std::wostream& lhs, PeFile const& rhs)
 // tests to ensure full coverage. Then add attributes and regression tests.
 // TODO: Consider if there is a better way to handle virtual VAs other than an
 // out param. Attributes?
-inline PVOID RvaToVa(Process const& process,
+inline PVOID RvaToVa(Process const& /*process*/,
                      PeFile const& pe_file,
                      DWORD rva,
                      bool* virtual_va = nullptr)
@@ -269,6 +287,7 @@ inline PVOID RvaToVa(Process const& process,
 
   PeFileType const type = pe_file.GetType();
   PBYTE base = static_cast<PBYTE>(pe_file.GetBase());
+  MemorySource const& source = pe_file.GetMemorySource();
 
   if (type == PeFileType::Data)
   {
@@ -277,7 +296,7 @@ inline PVOID RvaToVa(Process const& process,
       return nullptr;
     }
 
-    IMAGE_DOS_HEADER dos_header = Read<IMAGE_DOS_HEADER>(process, base);
+    IMAGE_DOS_HEADER dos_header = Read<IMAGE_DOS_HEADER>(source, base);
     if (dos_header.e_magic != IMAGE_DOS_SIGNATURE)
     {
       HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
@@ -285,25 +304,25 @@ inline PVOID RvaToVa(Process const& process,
     }
 
     BYTE* ptr_nt_headers = base + dos_header.e_lfanew;
-    if (Read<DWORD>(process, ptr_nt_headers) != IMAGE_NT_SIGNATURE)
+    if (Read<DWORD>(source, ptr_nt_headers) != IMAGE_NT_SIGNATURE)
     {
       HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
                                       << ErrorString{"Invalid NT headers."});
     }
 
     auto const file_header =
-      Read<IMAGE_FILE_HEADER>(process, ptr_nt_headers + sizeof(DWORD));
+      Read<IMAGE_FILE_HEADER>(source, ptr_nt_headers + sizeof(DWORD));
 
     auto const optional_header_32 =
       pe_file.Is64()
         ? IMAGE_OPTIONAL_HEADER32{}
-        : Read<IMAGE_OPTIONAL_HEADER32>(process,
+        : Read<IMAGE_OPTIONAL_HEADER32>(source,
                                         ptr_nt_headers + sizeof(DWORD) +
                                           sizeof(IMAGE_FILE_HEADER));
     auto const optional_header_64 =
       pe_file.Is64()
         ? Read<IMAGE_OPTIONAL_HEADER64>(
-            process, ptr_nt_headers + sizeof(DWORD) + sizeof(IMAGE_FILE_HEADER))
+            source, ptr_nt_headers + sizeof(DWORD) + sizeof(IMAGE_FILE_HEADER))
         : IMAGE_OPTIONAL_HEADER64{};
 
     DWORD const size_of_headers = pe_file.Is64()
@@ -389,7 +408,7 @@ inline PVOID RvaToVa(Process const& process,
       }
 
       auto const section_header =
-        Read<IMAGE_SECTION_HEADER>(process, ptr_section_header);
+        Read<IMAGE_SECTION_HEADER>(source, ptr_section_header);
 
       DWORD const virtual_beg = section_header.VirtualAddress;
       DWORD const virtual_size = section_header.Misc.VirtualSize;
@@ -496,16 +515,17 @@ inline PVOID RvaToVa(Process const& process,
 
 // TODO: 'Harden' this function against malicious/malformed PE files like is
 // done for RvaToVa.
-inline DWORD FileOffsetToRva(Process const& process,
+inline DWORD FileOffsetToRva(Process const& /*process*/,
                              PeFile const& pe_file,
                              DWORD file_offset)
 {
   PeFileType const type = pe_file.GetType();
   PBYTE base = static_cast<PBYTE>(pe_file.GetBase());
+  MemorySource const& source = pe_file.GetMemorySource();
 
   if (type == PeFileType::Data)
   {
-    IMAGE_DOS_HEADER dos_header = Read<IMAGE_DOS_HEADER>(process, base);
+    IMAGE_DOS_HEADER dos_header = Read<IMAGE_DOS_HEADER>(source, base);
     if (dos_header.e_magic != IMAGE_DOS_SIGNATURE)
     {
       HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
@@ -513,14 +533,14 @@ inline DWORD FileOffsetToRva(Process const& process,
     }
 
     BYTE* ptr_nt_headers = base + dos_header.e_lfanew;
-    if (Read<DWORD>(process, ptr_nt_headers) != IMAGE_NT_SIGNATURE)
+    if (Read<DWORD>(source, ptr_nt_headers) != IMAGE_NT_SIGNATURE)
     {
       HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
                                       << ErrorString{"Invalid NT headers."});
     }
 
     auto const file_header =
-      Read<IMAGE_FILE_HEADER>(process, ptr_nt_headers + sizeof(DWORD));
+      Read<IMAGE_FILE_HEADER>(source, ptr_nt_headers + sizeof(DWORD));
 
     auto ptr_section_header = reinterpret_cast<PIMAGE_SECTION_HEADER>(
       ptr_nt_headers + offsetof(IMAGE_NT_HEADERS, OptionalHeader) +
@@ -530,7 +550,7 @@ inline DWORD FileOffsetToRva(Process const& process,
     for (WORD i = 0; i < num_sections; ++i)
     {
       auto const section_header =
-        Read<IMAGE_SECTION_HEADER>(process, ptr_section_header);
+        Read<IMAGE_SECTION_HEADER>(source, ptr_section_header);
 
       DWORD const raw_beg = section_header.PointerToRawData;
       DWORD const raw_size = section_header.SizeOfRawData;
@@ -564,16 +584,17 @@ namespace detail
 // TODO: Warn in tools when EOF/Virtual/etc. termination is detected.
 // TODO: Move this somewhere more appropriate.
 template <typename CharT>
-std::basic_string<CharT> CheckedReadString(Process const& process,
+std::basic_string<CharT> CheckedReadString(Process const& /*process*/,
                                            PeFile const& pe_file,
                                            void* address)
 {
+  MemorySource const& source = pe_file.GetMemorySource();
   if (pe_file.GetType() == PeFileType::Image)
   {
     // TODO: Extra bounds checking to ensure we don't read outside the image in
     // the case that we're reading a string at the end of the file which is not
     // null terminated, and we're on a region boundary.
-    return ReadString<CharT>(process, address);
+    return ReadString<CharT>(source, address);
   }
   else if (pe_file.GetType() == PeFileType::Data)
   {
@@ -585,7 +606,7 @@ std::basic_string<CharT> CheckedReadString(Process const& process,
     }
     // Handle EOF termination.
     // Sample: maxsecXP.exe (Corkami PE Corpus)
-    return ReadStringBounded<CharT>(process, address, file_end);
+    return ReadStringBounded<CharT>(source, address, file_end);
   }
   else
   {
@@ -55,7 +55,8 @@ public:
 
   void UpdateRead()
   {
-    auto const data_tmp = Read<std::uint16_t>(*process_, base_);
+    auto const data_tmp =
+      Read<std::uint16_t>(pe_file_->GetMemorySource(), base_);
     type_ = static_cast<std::uint8_t>(data_tmp >> 12);
     offset_ = data_tmp & 0x0FFF;
   }
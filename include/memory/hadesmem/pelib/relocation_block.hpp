@@ -59,7 +59,7 @@ public:
 
   void UpdateRead()
   {
-    data_ = Read<IMAGE_BASE_RELOCATION>(*process_, base_);
+    data_ = Read<IMAGE_BASE_RELOCATION>(pe_file_->GetMemorySource(), base_);
   }
 
   void UpdateWrite()
@@ -158,7 +158,7 @@ public:
   // reading garbage.
   void UpdateRead()
   {
-    data_ = Read<IMAGE_SECTION_HEADER>(*process_, base_);
+    data_ = Read<IMAGE_SECTION_HEADER>(pe_file_->GetMemorySource(), base_);
   }
 
   void UpdateWrite()
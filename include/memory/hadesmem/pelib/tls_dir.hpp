@@ -62,11 +62,13 @@ public:
   {
     if (pe_file_->Is64())
     {
-      data_64_ = Read<IMAGE_TLS_DIRECTORY64>(*process_, base_);
+      data_64_ =
+        Read<IMAGE_TLS_DIRECTORY64>(pe_file_->GetMemorySource(), base_);
     }
     else
     {
-      data_32_ = Read<IMAGE_TLS_DIRECTORY32>(*process_, base_);
+      data_32_ =
+        Read<IMAGE_TLS_DIRECTORY32>(pe_file_->GetMemorySource(), base_);
     }
   }
 
@@ -149,9 +151,10 @@ public:
         Error{} << ErrorString{"TLS callbacks are invalid."});
     }
 
-    for (auto callback = Read<PIMAGE_TLS_CALLBACK>(*process_, callbacks_raw);
+    MemorySource const& source = pe_file_->GetMemorySource();
+    for (auto callback = Read<PIMAGE_TLS_CALLBACK>(source, callbacks_raw);
          callback;
-         callback = Read<PIMAGE_TLS_CALLBACK>(*process_, ++callbacks_raw))
+         callback = Read<PIMAGE_TLS_CALLBACK>(source, ++callbacks_raw))
     {
       auto const callback_offset =
         reinterpret_cast<ULONGLONG>(callback) - image_base;
@@ -0,0 +1,329 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/cached_process_view.hpp>
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/pointer_chain.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/find_pattern.hpp>
+#include <hadesmem/module.hpp>
+#include <hadesmem/process.hpp>
+#include <hadesmem/read.hpp>
+#include <hadesmem/read_batch.hpp>
+
+namespace hadesmem
+{
+class PointerChain;
+
+std::vector<PVOID> ResolvePointerChains(std::vector<PointerChain>& chains);
+
+std::vector<PVOID> ResolvePointerChains(std::vector<PointerChain>& chains,
+                                        CachedProcessView& view);
+
+// A base address and a list of offsets, resolved by reading a pointer from
+// the current address and adding the next offset to it, for each offset in
+// turn (starting at the base). For example, a base of &g_player with offsets
+// {0x10, 0x4} resolves to &g_player->inventory->count.
+//
+// The base can be given directly, as an RVA into a module, or as an offset
+// from the first match of a pattern in a module (an empty module name means
+// the main module). Module and pattern bases are only looked up once, on
+// first use.
+//
+// If caching is enabled (the default) the pointers read by the last walk are
+// kept, and the next resolve checks them all with a single batched read,
+// only walking again from the first level which changed. Resolving a number
+// of chains at once with ResolvePointerChains batches the reads for each
+// level across all of the chains. Null pointers are treated as failures.
+class PointerChain
+{
+public:
+  explicit PointerChain(Process const& process,
+                        PVOID base,
+                        std::vector<std::ptrdiff_t> const& offsets)
+    : process_{&process},
+      base_resolved_{true},
+      state_{reinterpret_cast<std::uintptr_t>(base), offsets, {}, false}
+  {
+  }
+
+  explicit PointerChain(Process&& process,
+                        PVOID base,
+                        std::vector<std::ptrdiff_t> const& offsets) = delete;
+
+  explicit PointerChain(Process const& process,
+                        std::wstring const& module,
+                        std::uintptr_t rva,
+                        std::vector<std::ptrdiff_t> const& offsets)
+    : process_{&process},
+      module_(module),
+      rva_{rva},
+      state_{0, offsets, {}, false}
+  {
+  }
+
+  explicit PointerChain(Process&& process,
+                        std::wstring const& module,
+                        std::uintptr_t rva,
+                        std::vector<std::ptrdiff_t> const& offsets) = delete;
+
+  explicit PointerChain(Process const& process,
+                        std::wstring const& module,
+                        std::wstring const& pattern,
+                        std::ptrdiff_t pattern_offset,
+                        std::vector<std::ptrdiff_t> const& offsets)
+    : process_{&process},
+      module_(module),
+      pattern_(pattern),
+      pattern_offset_{pattern_offset},
+      state_{0, offsets, {}, false}
+  {
+  }
+
+  explicit PointerChain(Process&& process,
+                        std::wstring const& module,
+                        std::wstring const& pattern,
+                        std::ptrdiff_t pattern_offset,
+                        std::vector<std::ptrdiff_t> const& offsets) = delete;
+
+  PVOID GetBase()
+  {
+    if (!base_resolved_)
+    {
+      if (pattern_.empty())
+      {
+        HMODULE const handle =
+          module_.empty() ? Module(*process_, nullptr).GetHandle()
+                          : Module(*process_, module_).GetHandle();
+        state_.base = reinterpret_cast<std::uintptr_t>(handle) + rva_;
+      }
+      else
+      {
+        void* const match = Find(*process_,
+                                 module_,
+                                 pattern_,
+                                 PatternFlags::kThrowOnUnmatch,
+                                 0);
+        state_.base = reinterpret_cast<std::uintptr_t>(match) + pattern_offset_;
+      }
+
+      base_resolved_ = true;
+    }
+
+    return reinterpret_cast<PVOID>(state_.base);
+  }
+
+  std::vector<std::ptrdiff_t> GetOffsets() const
+  {
+    return state_.offsets;
+  }
+
+  bool IsCacheEnabled() const noexcept
+  {
+    return cache_enabled_;
+  }
+
+  void SetCacheEnabled(bool enabled) noexcept
+  {
+    cache_enabled_ = enabled;
+    state_.cached = state_.cached && enabled;
+  }
+
+  // Forgets the pointers read by the last walk, so the next resolve walks
+  // the whole chain again.
+  void Invalidate() noexcept
+  {
+    state_.cached = false;
+  }
+
+  PVOID Resolve()
+  {
+    std::vector<PointerChain*> const chains{this};
+    return ResolveAll(chains, *process_, true).front();
+  }
+
+  // Reads through view, so chains which are resolved every frame (with the
+  // view ticked once per frame) only touch each page once.
+  PVOID Resolve(CachedProcessView& view)
+  {
+    HADESMEM_DETAIL_ASSERT(view.GetProcess() == *process_);
+
+    std::vector<PointerChain*> const chains{this};
+    return ResolveAll(chains, view, true).front();
+  }
+
+private:
+  friend std::vector<PVOID> ResolvePointerChains(
+    std::vector<PointerChain>& chains);
+  friend std::vector<PVOID>
+    ResolvePointerChains(std::vector<PointerChain>& chains,
+                         CachedProcessView& view);
+
+  static bool TryRead(Process const& process,
+                      std::uint8_t* address,
+                      std::uint8_t* data,
+                      std::size_t len)
+  {
+    return detail::TryReadAsIs(process, address, data, len);
+  }
+
+  static bool TryRead(CachedProcessView& view,
+                      std::uint8_t* address,
+                      std::uint8_t* data,
+                      std::size_t len)
+  {
+    return view.TryRead(address, data, len);
+  }
+
+  // Walks the chain one level at a time with the regular checked reads, so
+  // that failures which the as-is reads can't deal with (e.g. guard
+  // pages) are handled, and other failures are reported properly.
+  template <typename Source> PVOID WalkChecked(Source& source)
+  {
+    auto& values = state_.values;
+    values.resize(state_.offsets.size());
+    state_.cached = false;
+    for (std::size_t i = 0; i < values.size(); ++i)
+    {
+      auto const address = detail::GetPointerChainAddress(state_, i);
+      values[i] =
+        Read<std::uintptr_t>(source, reinterpret_cast<PVOID>(address));
+      if (!values[i])
+      {
+        HADESMEM_DETAIL_THROW_EXCEPTION(
+          Error{} << ErrorString{"Null pointer in pointer chain."});
+      }
+    }
+
+    state_.cached = cache_enabled_;
+    return reinterpret_cast<PVOID>(
+      detail::GetPointerChainAddress(state_, values.size()));
+  }
+
+  // Chains which fail are either walked again with checked reads and allowed
+  // to throw, or set to nullptr.
+  template <typename Source>
+  static std::vector<PVOID>
+    ResolveAll(std::vector<PointerChain*> const& chains,
+               Source& source,
+               bool throw_on_failure)
+  {
+    std::vector<PVOID> results(chains.size());
+    std::vector<detail::PointerChainState*> states;
+    std::vector<std::size_t> indices;
+    for (std::size_t i = 0; i < chains.size(); ++i)
+    {
+      try
+      {
+        chains[i]->GetBase();
+      }
+      catch (Error const&)
+      {
+        if (throw_on_failure)
+        {
+          throw;
+        }
+
+        continue;
+      }
+
+      states.push_back(&chains[i]->state_);
+      indices.push_back(i);
+    }
+
+    std::vector<std::uintptr_t> addresses;
+    detail::ResolvePointerChainStates(
+      states,
+      kMaxGap,
+      addresses,
+      [&](std::uint8_t* address, std::uint8_t* data, std::size_t len)
+      {
+        return TryRead(source, address, data, len);
+      });
+
+    for (std::size_t i = 0; i < states.size(); ++i)
+    {
+      auto const chain = chains[indices[i]];
+      chain->state_.cached = chain->state_.cached && chain->cache_enabled_;
+      if (addresses[i])
+      {
+        results[indices[i]] = reinterpret_cast<PVOID>(addresses[i]);
+      }
+      else if (throw_on_failure)
+      {
+        results[indices[i]] = chain->WalkChecked(source);
+      }
+      else
+      {
+        try
+        {
+          results[indices[i]] = chain->WalkChecked(source);
+        }
+        catch (Error const&)
+        {
+        }
+      }
+    }
+
+    return results;
+  }
+
+  static std::size_t const kMaxGap = 0x100;
+
+  Process const* process_;
+  std::wstring module_;
+  std::uintptr_t rva_{};
+  std::wstring pattern_;
+  std::ptrdiff_t pattern_offset_{};
+  bool base_resolved_{false};
+  bool cache_enabled_{true};
+  detail::PointerChainState state_;
+};
+
+// Returns the address each chain resolves to, or nullptr for chains which
+// couldn't be resolved. All of the chains must be for the same process.
+inline std::vector<PVOID>
+  ResolvePointerChains(std::vector<PointerChain>& chains)
+{
+  if (chains.empty())
+  {
+    return {};
+  }
+
+  std::vector<PointerChain*> pointers;
+  pointers.reserve(chains.size());
+  for (auto& chain : chains)
+  {
+    HADESMEM_DETAIL_ASSERT(*chain.process_ == *chains.front().process_);
+    pointers.push_back(&chain);
+  }
+
+  return PointerChain::ResolveAll(
+    pointers, *chains.front().process_, false);
+}
+
+inline std::vector<PVOID>
+  ResolvePointerChains(std::vector<PointerChain>& chains,
+                       CachedProcessView& view)
+{
+  std::vector<PointerChain*> pointers;
+  pointers.reserve(chains.size());
+  for (auto& chain : chains)
+  {
+    HADESMEM_DETAIL_ASSERT(*chain.process_ == view.GetProcess());
+    pointers.push_back(&chain);
+  }
+
+  return PointerChain::ResolveAll(pointers, view, false);
+}
+}
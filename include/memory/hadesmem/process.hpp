@@ -13,6 +13,7 @@
 
 #include <hadesmem/config.hpp>
 #include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/region_cache.hpp>
 #include <hadesmem/detail/smart_handle.hpp>
 #include <hadesmem/detail/trace.hpp>
 #include <hadesmem/detail/winapi.hpp>
@@ -43,7 +44,8 @@ public:
 
   Process(Process const& other)
     : handle_{DuplicateHandle(other.id_, other.handle_.GetHandle())},
-      id_{other.id_}
+      id_{other.id_},
+      region_cache_{other.region_cache_}
   {
   }
 
@@ -55,8 +57,10 @@ public:
     return *this;
   }
 
-  Process(Process&& other) noexcept : handle_{std::move(other.handle_)},
-                                      id_{other.id_}
+  Process(Process&& other) noexcept
+    : handle_{std::move(other.handle_)},
+      id_{other.id_},
+      region_cache_{std::move(other.region_cache_)}
   {
     other.id_ = 0;
   }
@@ -67,6 +71,7 @@ public:
 
     handle_ = std::move(other.handle_);
     id_ = other.id_;
+    region_cache_ = std::move(other.region_cache_);
 
     other.id_ = 0;
 
@@ -88,6 +93,48 @@ public:
     return handle_.GetHandle();
   }
 
+  // When enabled, the region info used by Read, Write, etc. is cached rather
+  // than queried for every call. Copies of the process share the cache.
+  // Changes made through hadesmem (Alloc, Free, Protect) are accounted for,
+  // but anything else which changes the memory layout of the target should be
+  // followed by a call to InvalidateRegionCache. Accesses which fail because
+  // of an out of date region are retried, but 'bad' protections (e.g. guard
+  // pages) are only detected when a region is queried. In particular, if the
+  // target turns a cached region into guard pages without the cache being
+  // invalidated, a read through the stale entry isn't reprotected and will
+  // touch the guard page, clearing PAGE_GUARD in the target.
+  void SetRegionCacheEnabled(bool enabled)
+  {
+    if (!enabled)
+    {
+      region_cache_.reset();
+    }
+    else if (!region_cache_)
+    {
+      region_cache_ = std::make_shared<
+        detail::RegionCache<MEMORY_BASIC_INFORMATION>>();
+    }
+  }
+
+  bool IsRegionCacheEnabled() const noexcept
+  {
+    return !!region_cache_;
+  }
+
+  void InvalidateRegionCache() const noexcept
+  {
+    if (region_cache_)
+    {
+      region_cache_->Invalidate();
+    }
+  }
+
+  detail::RegionCache<MEMORY_BASIC_INFORMATION>* GetRegionCache() const
+    noexcept
+  {
+    return region_cache_.get();
+  }
+
   void Cleanup()
   {
     if (id_ != ::GetCurrentProcessId())
@@ -100,6 +147,7 @@ public:
     }
 
     id_ = 0;
+    region_cache_.reset();
   }
 
 private:
@@ -153,6 +201,8 @@ private:
 
   detail::SmartHandle handle_;
   DWORD id_;
+  std::shared_ptr<detail::RegionCache<MEMORY_BASIC_INFORMATION>>
+    region_cache_;
 };
 
 inline bool operator==(Process const& lhs, Process const& rhs) noexcept
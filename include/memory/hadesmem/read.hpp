@@ -99,10 +99,9 @@ void ReadStringEx(Process const& process,
 
   for (;;)
   {
-    detail::ProtectGuard protect_guard{
-      process, address, detail::ProtectGuardType::kRead};
-
-    MEMORY_BASIC_INFORMATION const mbi = detail::Query(process, address);
+    bool cached = false;
+    MEMORY_BASIC_INFORMATION const mbi =
+      detail::QueryCached(process, address, &detail::CanRead, cached);
     PVOID const region_next_real =
       static_cast<PBYTE>(mbi.BaseAddress) + mbi.RegionSize;
     void* const region_next = upper_bound
@@ -110,33 +109,54 @@ void ReadStringEx(Process const& process,
                                 : region_next_real;
 
     T* cur = static_cast<T*>(address);
-    while (cur + 1 <= region_next)
+    try
     {
-      std::size_t const len_to_end = reinterpret_cast<DWORD_PTR>(region_next) -
-                                     reinterpret_cast<DWORD_PTR>(cur);
-      std::size_t const buf_len_bytes =
-        (std::min)(chunk_len * sizeof(T), len_to_end);
-      std::size_t const buf_len = buf_len_bytes / sizeof(T);
-
-      std::vector<T> buf(buf_len);
-      detail::ReadUnchecked(process, cur, buf.data(), buf.size() * sizeof(T));
+      detail::ProtectGuard protect_guard{
+        process, mbi, detail::ProtectGuardType::kRead};
 
-      auto const iter = std::find(std::begin(buf), std::end(buf), T());
-      std::copy(std::begin(buf), iter, data);
+      while (cur + 1 <= region_next)
+      {
+        std::size_t const len_to_end =
+          reinterpret_cast<DWORD_PTR>(region_next) -
+          reinterpret_cast<DWORD_PTR>(cur);
+        std::size_t const buf_len_bytes =
+          (std::min)(chunk_len * sizeof(T), len_to_end);
+        std::size_t const buf_len = buf_len_bytes / sizeof(T);
+
+        std::vector<T> buf(buf_len);
+        detail::ReadUnchecked(
+          process, cur, buf.data(), buf.size() * sizeof(T));
+
+        auto const iter = std::find(std::begin(buf), std::end(buf), T());
+        std::copy(std::begin(buf), iter, data);
+
+        if (iter != std::end(buf) || region_next == upper_bound)
+        {
+          protect_guard.Restore();
+          return;
+        }
+
+        cur += buf_len;
+      }
 
-      if (iter != std::end(buf) || region_next == upper_bound)
+      protect_guard.Restore();
+    }
+    catch (Error const&)
+    {
+      if (!cached)
       {
-        protect_guard.Restore();
-        return;
+        throw;
       }
 
-      cur += buf_len;
+      // The cached region is out of date, so try again with a fresh one
+      // (starting from the first character which hasn't been read yet).
+      process.InvalidateRegionCache();
+      address = cur;
+      continue;
     }
 
     address = region_next;
 
-    protect_guard.Restore();
-
     if (upper_bound && cur >= upper_bound)
     {
       return;
@@ -184,7 +204,7 @@ template <typename T, typename OutputIterator>
 void ReadString(Process const& process, PVOID address, OutputIterator data)
 {
   return ReadStringEx<T>(
-    process, address, data, detail::ReadStringTraits<T>::kChunkLen);
+    process, address, data, detail::ReadStringTraits<T>::kChunkLen, nullptr);
 }
 
 template <typename T,
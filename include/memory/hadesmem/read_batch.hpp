@@ -0,0 +1,139 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/read_batch.hpp>
+#include <hadesmem/detail/read_impl.hpp>
+#include <hadesmem/detail/static_assert.hpp>
+#include <hadesmem/detail/type_traits.hpp>
+#include <hadesmem/process.hpp>
+
+namespace hadesmem
+{
+enum class ReadBatchStatus
+{
+  kSuccess,
+  kFailed
+};
+
+// Scatter/gather reads. Requests are sorted and those which are at most
+// max_gap bytes apart are coalesced, so reading lots of small nearby values
+// (e.g. the members of every entry in an array) only takes a handful of
+// ReadProcessMemory calls. The plan is kept until requests are added or
+// cleared, so the same batch can cheaply be read over and over again.
+//
+// Unlike Read, no regions are reprotected, and failures are reported per
+// request rather than by throwing. Coalesced spans are only read if every
+// region they touch can be read as-is (see TryReadAsIs), so guard pages are
+// never touched. Enabling the region cache of the process avoids querying
+// those regions again on every read. The contents of the destination of a
+// request which failed are unspecified.
+class ReadBatch
+{
+public:
+  explicit ReadBatch(Process const& process, std::size_t max_gap = 0x100)
+    : process_{&process}, max_gap_{max_gap}
+  {
+  }
+
+  explicit ReadBatch(Process&& process, std::size_t max_gap = 0x100) = delete;
+
+  // Returns the index of the request in the array returned by Read. data
+  // must stay valid until the request is cleared.
+  std::size_t Add(PVOID address, void* data, std::size_t len)
+  {
+    HADESMEM_DETAIL_ASSERT(len ? address != nullptr : true);
+    HADESMEM_DETAIL_ASSERT(len ? data != nullptr : true);
+
+    requests_.push_back(
+      detail::ReadBatchRequest{static_cast<std::uint8_t*>(address),
+                               static_cast<std::uint8_t*>(data),
+                               len});
+    planned_ = false;
+    return requests_.size() - 1;
+  }
+
+  template <typename T> std::size_t Add(PVOID address, T& data)
+  {
+    HADESMEM_DETAIL_STATIC_ASSERT(detail::IsTriviallyCopyable<T>::value);
+
+    return Add(address, std::addressof(data), sizeof(T));
+  }
+
+  void Clear() noexcept
+  {
+    requests_.clear();
+    statuses_.clear();
+    planned_ = false;
+  }
+
+  std::size_t GetSize() const noexcept
+  {
+    return requests_.size();
+  }
+
+  std::size_t GetMaxGap() const noexcept
+  {
+    return max_gap_;
+  }
+
+  void SetMaxGap(std::size_t max_gap) noexcept
+  {
+    max_gap_ = max_gap;
+    planned_ = false;
+  }
+
+  // Returns the status of each request, which stays valid until the next
+  // call to Read or Clear.
+  std::vector<ReadBatchStatus> const& Read()
+  {
+    if (!planned_)
+    {
+      detail::PlanReadBatch(requests_, max_gap_, order_, spans_);
+      planned_ = true;
+    }
+
+    Process const& process = *process_;
+    detail::ExecuteReadBatch(
+      requests_,
+      order_,
+      spans_,
+      buf_,
+      valid_,
+      [&](std::uint8_t* address, std::uint8_t* data, std::size_t len)
+      {
+        return detail::TryReadAsIs(process, address, data, len);
+      });
+
+    statuses_.resize(valid_.size());
+    for (std::size_t i = 0; i < valid_.size(); ++i)
+    {
+      statuses_[i] =
+        valid_[i] ? ReadBatchStatus::kSuccess : ReadBatchStatus::kFailed;
+    }
+
+    return statuses_;
+  }
+
+private:
+  Process const* process_;
+  std::size_t max_gap_;
+  std::vector<detail::ReadBatchRequest> requests_;
+  std::vector<std::size_t> order_;
+  std::vector<detail::ReadBatchSpan> spans_;
+  std::vector<std::uint8_t> buf_;
+  std::vector<std::uint8_t> valid_;
+  std::vector<ReadBatchStatus> statuses_;
+  bool planned_{false};
+};
+}
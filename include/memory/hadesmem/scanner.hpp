@@ -3,26 +3,2155 @@
 
 #pragma once
 
-// TODO: Implement this.
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ios>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/filesystem.hpp>
+#include <hadesmem/detail/parallel_for.hpp>
+#include <hadesmem/detail/pattern_multi_search.hpp>
+#include <hadesmem/detail/pattern_search.hpp>
+#include <hadesmem/detail/pointer_map.hpp>
+#include <hadesmem/detail/query_region.hpp>
+#include <hadesmem/detail/read_impl.hpp>
+#include <hadesmem/detail/scan_capture.hpp>
+#include <hadesmem/detail/scan_float.hpp>
+#include <hadesmem/detail/scan_group.hpp>
+#include <hadesmem/detail/scan_results.hpp>
+#include <hadesmem/detail/scan_snapshot.hpp>
+#include <hadesmem/detail/scan_string.hpp>
+#include <hadesmem/detail/scan_value.hpp>
+#include <hadesmem/detail/static_assert.hpp>
+#include <hadesmem/detail/trace.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/module.hpp>
+#include <hadesmem/module_list.hpp>
+#include <hadesmem/process.hpp>
+#include <hadesmem/region.hpp>
+#include <hadesmem/region_list.hpp>
+#include <hadesmem/thread_helpers.hpp>
+
 // TODO: Use process reflection on Windows 7 + for scanning while process is suspended. (RtlCreateProcessReflection)
 //  Requires extra privileges though Make it optional?
 //  There's newer and better APIs available on W8+. PSS? ProcDump supports them all I think...
 //  PSS doesn't support large pages, so can't be used against e.g.SQL.
 // TODO: Use a file view with a small memory cache rather than consuming large amounts of RAM.
-// TODO: Multi-threaded scanning options.
-// TODO: Wildcard support for vector/string scanning.
-// TODO: Regex support for string scanning.
-// TODO: Memory protection filters(read, write, exec).
-// TODO: Memory type filters(private, mapped, image).
-// TODO: Support pausing target while scanning.
 // TODO: Support injected scanning.
-// TODO: Configurable scan buffer size.
-// TODO: Pointer scanner.
-// TODO: Unknown value scan.
-// TODO: Progressive scan filtering based on either value or criteria.
-// TODO: Scan history and undo.
-// TODO: Support case insensitive string scanning.
+// TODO: Wildcard support for vector scanning.
 // TODO: Binary scanning.
-// TODO: Custom scanning via user supplied predicate.
-// TODO: Improved floating point support (configurable or 'smart' epsilon).
-// TODO: Group search support.
+
+namespace hadesmem
+{
+// Regions must have all of these. Regions which can't be read are always
+// skipped, so kRead is implied.
+struct ScanProtectFlags
+{
+  enum : std::uint32_t
+  {
+    kNone = 0,
+    kRead = 1 << 0,
+    kWrite = 1 << 1,
+    kExecute = 1 << 2,
+    kInvalidFlagMaxValue = 1 << 3
+  };
+};
+
+// Regions must be one of these.
+struct ScanTypeFlags
+{
+  enum : std::uint32_t
+  {
+    kNone = 0,
+    kPrivate = 1 << 0,
+    kMapped = 1 << 1,
+    kImage = 1 << 2,
+    kAll = kPrivate | kMapped | kImage,
+    kInvalidFlagMaxValue = 1 << 3
+  };
+};
+
+// kSuspend suspends the target while the memory needed for each scan is
+// copied, and then scans the copy once the target has been resumed. The
+// target sees a consistent image of its memory, and is only paused for as
+// long as the copy takes rather than for the whole scan. The copy needs as
+// much memory as the regions (or candidates) being scanned.
+struct ScanModeFlags
+{
+  enum : std::uint32_t
+  {
+    kNone = 0,
+    kSuspend = 1 << 0,
+    kInvalidFlagMaxValue = 1 << 1
+  };
+};
+
+// Narrow strings are matched as ASCII and wide strings as UTF-16LE. Case
+// insensitive matching folds ASCII letters (and Latin-1 letters in wide
+// strings). Wildcards are ? and match any single character.
+struct ScanStringFlags
+{
+  enum : std::uint32_t
+  {
+    kNone = 0,
+    kCaseInsensitive = 1 << 0,
+    kWildcard = 1 << 1,
+    kInvalidFlagMaxValue = 1 << 2
+  };
+};
+
+struct ScanStringMatch
+{
+  void* address;
+  // In bytes.
+  std::size_t length;
+  // Index of the string (for multi-string scans).
+  std::size_t index;
+};
+
+struct ScanRegion
+{
+  std::uint8_t* base;
+  std::size_t size;
+};
+
+// How a value must relate to its value in a snapshot. Changed and unchanged
+// compare the raw bytes (so e.g. a NaN which hasn't been touched is
+// unchanged), increased and decreased compare values.
+enum class ScanCompare
+{
+  kChanged,
+  kUnchanged,
+  kIncreased,
+  kDecreased
+};
+
+// How a floating point value must relate to the one being scanned for. The
+// meaning of the tolerance depends on the mode:
+// kAbsolute - |x - value| <= tolerance.
+// kRelative - |x - value| <= tolerance * |value|.
+// kUlp - x is within tolerance representable values of value.
+// kRounded - x rounded to tolerance decimal places is value (e.g. 12.3 with
+// one decimal place matches [12.25, 12.35)).
+// kTruncated - x truncated to tolerance decimal places is value (e.g. 12.3
+// with one decimal place matches [12.3, 12.4)).
+enum class ScanFloatMode
+{
+  kAbsolute,
+  kRelative,
+  kUlp,
+  kRounded,
+  kTruncated
+};
+
+// Predicates for Scanner::FindIf, ScanIf and RefineIf which have vectorized
+// scans. Any other callable taking a T works too. e.g.
+// ScanBitmask<std::uint32_t>{0xFF00, 0x100} matches values where
+// (value & 0xFF00) == 0x100.
+template <typename T> using ScanEqual = detail::ScanEqualPred<T>;
+template <typename T> using ScanInRange = detail::ScanRangePred<T>;
+template <typename T> using ScanBitmask = detail::ScanBitmaskPred<T>;
+
+// Predicates for Scanner::CompareIf, ScanIf and RefineIf with snapshots,
+// called as pred(old_value, cur_value). See ScanCompare.
+using ScanChanged = detail::ScanChangedPred;
+using ScanUnchanged = detail::ScanUnchangedPred;
+using ScanIncreased = detail::ScanIncreasedPred;
+using ScanDecreased = detail::ScanDecreasedPred;
+
+// Contents of all the scanned regions at a point in time, for unknown initial
+// value scans. Zero and duplicate pages are only stored once, and the rest are
+// optionally compressed.
+class ScanSnapshot
+{
+public:
+  std::vector<ScanRegion> const& GetRegions() const noexcept
+  {
+    return regions_;
+  }
+
+  // Copies the snapshotted contents of [address, address + len), which must
+  // be inside a single region. Returns false if that isn't the case or any of
+  // it couldn't be read when the snapshot was taken.
+  bool Read(std::uint8_t const* address,
+            std::uint8_t* buf,
+            std::size_t len) const noexcept
+  {
+    auto const region = std::upper_bound(
+      std::begin(regions_),
+      std::end(regions_),
+      address,
+      [](std::uint8_t const* lhs, ScanRegion const& rhs)
+      {
+        return lhs < rhs.base;
+      });
+    if (region == std::begin(regions_))
+    {
+      return false;
+    }
+
+    auto const index =
+      static_cast<std::size_t>(region - std::begin(regions_)) - 1;
+    auto const& cur_region = regions_[index];
+    auto const offset = static_cast<std::size_t>(address - cur_region.base);
+    if (offset > cur_region.size || len > cur_region.size - offset)
+    {
+      return false;
+    }
+
+    std::uint8_t page[detail::kScanPageSize];
+    for (std::size_t cur = offset; cur < offset + len;)
+    {
+      std::size_t const page_offset = cur % detail::kScanPageSize;
+      std::size_t const page_len = (std::min)(
+        detail::kScanPageSize - page_offset, offset + len - cur);
+      std::uint32_t const id =
+        page_ids_[region_pages_[index] + cur / detail::kScanPageSize];
+      if (id == detail::kScanPageMissing || !store_.Get(id, page))
+      {
+        return false;
+      }
+
+      std::memcpy(buf + (cur - offset), page + page_offset, page_len);
+      cur += page_len;
+    }
+
+    return true;
+  }
+
+  std::size_t GetNumPages() const noexcept
+  {
+    return store_.GetNumPages();
+  }
+
+  std::size_t GetNumZeroPages() const noexcept
+  {
+    return store_.GetNumZeroPages();
+  }
+
+  std::size_t GetNumDuplicatePages() const noexcept
+  {
+    return store_.GetNumDuplicatePages();
+  }
+
+  // Bytes used by the stored pages, not including bookkeeping.
+  std::size_t GetStoredSize() const noexcept
+  {
+    return store_.GetStoredSize();
+  }
+
+private:
+  friend class Scanner;
+
+  std::vector<ScanRegion> regions_;
+  // Index into page_ids_ of the first page of each region.
+  std::vector<std::size_t> region_pages_;
+  std::vector<std::uint32_t> page_ids_;
+  detail::ScanPageStore store_;
+};
+
+// Candidate addresses for progressive scans. Candidates are stored per region
+// as a bitmap with one bit per aligned slot, or as a sorted array of slots
+// once that is smaller, so even a first pass which matches most of the
+// process is cheap to hold on to.
+class ScanResults
+{
+public:
+  std::vector<ScanRegion> const& GetRegions() const noexcept
+  {
+    return regions_;
+  }
+
+  std::size_t GetValueSize() const noexcept
+  {
+    return value_size_;
+  }
+
+  std::size_t GetAlignment() const noexcept
+  {
+    return alignment_;
+  }
+
+  std::size_t GetCount() const noexcept
+  {
+    std::size_t count = 0;
+    for (auto const& set : sets_)
+    {
+      count += set.GetCount();
+    }
+
+    return count;
+  }
+
+  std::size_t GetMemoryUsage() const noexcept
+  {
+    std::size_t usage = 0;
+    for (auto const& set : sets_)
+    {
+      usage += set.GetMemoryUsage();
+    }
+
+    return usage;
+  }
+
+  // Calls func(address) for every candidate in address order.
+  template <typename Func> void ForEach(Func func) const
+  {
+    for (std::size_t i = 0; i < sets_.size(); ++i)
+    {
+      auto const base = regions_[i].base;
+      sets_[i].ForEach(0,
+                       sets_[i].GetNumSlots(),
+                       [&](std::size_t slot)
+                       {
+                         func(static_cast<void*>(base + slot * alignment_));
+                       });
+    }
+  }
+
+  std::vector<void*> GetAddresses() const
+  {
+    std::vector<void*> addresses;
+    addresses.reserve(GetCount());
+    ForEach([&](void* address)
+            {
+              addresses.push_back(address);
+            });
+    return addresses;
+  }
+
+private:
+  friend class Scanner;
+  friend class ScanHistory;
+
+  std::vector<ScanRegion> regions_;
+  std::vector<detail::ScanResultSet> sets_;
+  std::size_t value_size_{};
+  std::size_t alignment_{};
+};
+
+// A layout of values at fixed offsets from the start of a group, e.g. some of
+// the fields of a structure. Groups can also be parsed from strings like
+// "{u32 100, ?, float 1.5 @+8}", where members are separated by commas and
+// each one is placed right after the previous one unless given an offset from
+// the start of the group with @+n. A ? skips n (default 4) bytes. Types are
+// i8, u8, i16, u16, i32, u32, i64, u64, float (or f32) and double (or f64).
+class ScanGroup
+{
+public:
+  ScanGroup() = default;
+
+  explicit ScanGroup(std::string const& str)
+  {
+    if (!detail::ParseScanGroup(str, members_))
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Invalid scan group."});
+    }
+  }
+
+  template <typename T> ScanGroup& Add(std::size_t offset, T value)
+  {
+    HADESMEM_DETAIL_STATIC_ASSERT(detail::IsScanValueType<T>::value);
+    members_.push_back(detail::MakeScanGroupMember(offset, value));
+    detail::SortScanGroupMembers(members_);
+    return *this;
+  }
+
+  // Distance from the start of the group to the end of its last member.
+  std::size_t GetSize() const noexcept
+  {
+    return detail::GetScanGroupSize(members_);
+  }
+
+  bool IsEmpty() const noexcept
+  {
+    return members_.empty();
+  }
+
+private:
+  friend class Scanner;
+
+  std::vector<detail::ScanGroupMember> members_;
+};
+
+// See detail::PointerPathData for how paths are followed. Paths are module
+// relative, so they can be compared across restarts of the target.
+struct PointerPath
+{
+  std::wstring module;
+  std::uint64_t rva;
+  std::vector<std::uint64_t> offsets;
+};
+
+inline bool operator==(PointerPath const& lhs, PointerPath const& rhs)
+{
+  return lhs.module == rhs.module && lhs.rva == rhs.rva &&
+         lhs.offsets == rhs.offsets;
+}
+
+inline bool operator!=(PointerPath const& lhs, PointerPath const& rhs)
+{
+  return !(lhs == rhs);
+}
+
+inline bool operator<(PointerPath const& lhs, PointerPath const& rhs)
+{
+  if (lhs.module != rhs.module)
+  {
+    return lhs.module < rhs.module;
+  }
+
+  if (lhs.rva != rhs.rva)
+  {
+    return lhs.rva < rhs.rva;
+  }
+
+  return lhs.offsets < rhs.offsets;
+}
+
+// Paths found in every run (e.g. before and after restarting the target) are
+// the ones worth keeping.
+inline std::vector<PointerPath> IntersectPointerPaths(
+  std::vector<PointerPath> lhs, std::vector<PointerPath> rhs)
+{
+  std::sort(std::begin(lhs), std::end(lhs));
+  std::sort(std::begin(rhs), std::end(rhs));
+  std::vector<PointerPath> paths;
+  std::set_intersection(std::begin(lhs),
+                        std::end(lhs),
+                        std::begin(rhs),
+                        std::end(rhs),
+                        std::back_inserter(paths));
+  return paths;
+}
+
+// Every pointer in the scanned regions which points into one of them, sorted
+// by value. Building the map is the expensive part of a pointer scan, so it
+// can be saved and searched again (for different targets or depths) later.
+class PointerMap
+{
+public:
+  PointerMap() = default;
+
+  explicit PointerMap(std::wstring const& path)
+  {
+    auto const file =
+      detail::OpenFile<char>(path, std::ios::in | std::ios::binary);
+    if (!*file)
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Failed to open pointer map file."});
+    }
+
+    if (!detail::ReadPointerMap(*file, pointer_size_, modules_, entries_))
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Invalid pointer map file."});
+    }
+  }
+
+  void Save(std::wstring const& path) const
+  {
+    auto const file =
+      detail::OpenFile<char>(path, std::ios::out | std::ios::binary);
+    if (!*file)
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Failed to create pointer map file."});
+    }
+
+    if (!detail::WritePointerMap(*file, pointer_size_, modules_, entries_))
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Failed to write pointer map file."});
+    }
+  }
+
+  std::size_t GetSize() const noexcept
+  {
+    return entries_.size();
+  }
+
+  // Finds up to max_results paths (shortest first) of at most max_depth
+  // pointers, where each pointer can point up to max_offset bytes before the
+  // next one. A thread count of zero means one per core.
+  std::vector<PointerPath> FindPaths(void const* target,
+                                     std::size_t max_depth = 5,
+                                     std::size_t max_offset = 0x1000,
+                                     std::size_t max_results = 1000,
+                                     std::size_t num_threads = 0) const
+  {
+    auto const paths = detail::FindPointerPaths(
+      entries_,
+      modules_,
+      reinterpret_cast<std::uintptr_t>(target),
+      max_depth,
+      max_offset,
+      max_results,
+      num_threads ? num_threads : detail::GetDefaultThreadCount());
+
+    std::vector<PointerPath> result;
+    result.reserve(paths.size());
+    for (auto const& path : paths)
+    {
+      result.push_back(
+        PointerPath{modules_[path.module].name, path.rva, path.offsets});
+    }
+
+    return result;
+  }
+
+private:
+  friend class Scanner;
+
+  std::uint32_t pointer_size_{sizeof(void*)};
+  std::vector<detail::PointerMapModule> modules_;
+  std::vector<detail::PointerMapEntry> entries_;
+};
+
+namespace detail
+{
+// Regions are read and scanned in chunks of this size, and each chunk is a
+// separate work item for the worker pool.
+std::size_t const kScanBufferSize = 1024 * 1024;
+
+// Result sets need every page to start on a bitmap word boundary.
+std::size_t const kScanMaxAlignment = kScanPageSize / kScanBitsPerWord;
+
+inline std::size_t RoundUpScanPage(std::size_t offset) noexcept
+{
+  return (offset + kScanPageSize - 1) & ~(kScanPageSize - 1);
+}
+
+// Matchers used to refine result sets. Load(thread, address, len) is called
+// for every range which is read from the target (and the candidates in it
+// are dropped if it fails), then either Match(thread, buf, len, scan_len,
+// mark) is called to mark every match starting in [0, scan_len) in bitmap
+// sets, or Test(thread, buf, offset) is called for each candidate in sparse
+// sets.
+template <typename T, typename Pred> class ScanPredMatcher
+{
+public:
+  ScanPredMatcher(Pred pred, std::size_t alignment)
+    : pred_(pred), alignment_{alignment}
+  {
+  }
+
+  bool Load(std::size_t /*thread*/,
+            std::uint8_t const* /*address*/,
+            std::size_t /*len*/) const noexcept
+  {
+    return true;
+  }
+
+  template <typename Mark>
+  void Match(std::size_t /*thread*/,
+             std::uint8_t const* buf,
+             std::size_t len,
+             std::size_t scan_len,
+             Mark mark) const
+  {
+    ScanValueIf<T>(buf,
+                   buf + len,
+                   pred_,
+                   alignment_,
+                   [&](std::size_t offset)
+                   {
+                     if (offset < scan_len)
+                     {
+                       mark(offset);
+                     }
+                   });
+  }
+
+  bool Test(std::size_t /*thread*/,
+            std::uint8_t const* buf,
+            std::size_t offset) const
+  {
+    T cur_value;
+    std::memcpy(&cur_value, buf + offset, sizeof(T));
+    return pred_(cur_value);
+  }
+
+private:
+  Pred pred_;
+  std::size_t alignment_;
+};
+
+template <typename T, typename Pred> class ScanSnapshotMatcher
+{
+public:
+  ScanSnapshotMatcher(ScanSnapshot const& snapshot,
+                      std::size_t alignment,
+                      std::size_t num_threads,
+                      Pred pred)
+    : snapshot_{&snapshot},
+      alignment_{alignment},
+      buffers_(num_threads),
+      pred_(pred)
+  {
+  }
+
+  bool Load(std::size_t thread, std::uint8_t const* address, std::size_t len)
+  {
+    auto& buf = buffers_[thread];
+    if (buf.size() < len)
+    {
+      buf.resize(len);
+    }
+
+    return snapshot_->Read(address, buf.data(), len);
+  }
+
+  template <typename Mark>
+  void Match(std::size_t thread,
+             std::uint8_t const* buf,
+             std::size_t len,
+             std::size_t scan_len,
+             Mark mark) const
+  {
+    ScanCompareValues<T>(buffers_[thread].data(),
+                         buf,
+                         len,
+                         scan_len,
+                         alignment_,
+                         pred_,
+                         mark);
+  }
+
+  bool Test(std::size_t thread,
+            std::uint8_t const* buf,
+            std::size_t offset) const
+  {
+    T old_value;
+    std::memcpy(&old_value, buffers_[thread].data() + offset, sizeof(T));
+    T cur_value;
+    std::memcpy(&cur_value, buf + offset, sizeof(T));
+    return pred_(old_value, cur_value);
+  }
+
+private:
+  ScanSnapshot const* snapshot_;
+  std::size_t alignment_;
+  std::vector<std::vector<std::uint8_t>> buffers_;
+  Pred pred_;
+};
+
+inline bool IsScanRegionMatch(Region const& region,
+                              std::uint32_t protect_flags,
+                              std::uint32_t type_flags) noexcept
+{
+  MEMORY_BASIC_INFORMATION mbi{};
+  mbi.State = region.GetState();
+  mbi.Protect = region.GetProtect();
+  if (!CanRead(mbi) || IsBadProtect(mbi))
+  {
+    return false;
+  }
+
+  if ((!!(protect_flags & ScanProtectFlags::kWrite) && !CanWrite(mbi)) ||
+      (!!(protect_flags & ScanProtectFlags::kExecute) && !CanExecute(mbi)))
+  {
+    return false;
+  }
+
+  switch (region.GetType())
+  {
+  case MEM_PRIVATE:
+    return !!(type_flags & ScanTypeFlags::kPrivate);
+  case MEM_MAPPED:
+    return !!(type_flags & ScanTypeFlags::kMapped);
+  case MEM_IMAGE:
+    return !!(type_flags & ScanTypeFlags::kImage);
+  default:
+    return false;
+  }
+}
+
+// Regions can be freed or reprotected while we're scanning, so read failures
+// just mean there's nothing to scan.
+// Used while the target is suspended, so must not throw or allocate (which
+// could deadlock on a lock held by a suspended thread if the target is the
+// current process).
+inline bool ReadScanCapturePiece(Process const& process,
+                                 std::uint8_t* address,
+                                 std::uint8_t* buf,
+                                 std::size_t len) noexcept
+{
+  SIZE_T bytes_read = 0;
+  return ::ReadProcessMemory(
+           process.GetHandle(), address, buf, len, &bytes_read) &&
+         bytes_read == len;
+}
+
+inline bool ReadScanChunk(Process const& process,
+                          std::uint8_t* address,
+                          std::uint8_t* buf,
+                          std::size_t len) noexcept
+{
+  try
+  {
+    ReadUnchecked(process, address, buf, len);
+    return true;
+  }
+  catch (...)
+  {
+    HADESMEM_DETAIL_TRACE_FORMAT_A("Failed to read scan chunk at %p.",
+                                   address);
+    return false;
+  }
+}
+
+// Older generations of scan history are written to a temporary file once
+// the in-memory deltas go over this.
+std::size_t const kScanHistoryMemoryLimit = 256 * 1024 * 1024;
+
+inline std::wstring GetScanHistoryPath()
+{
+  std::vector<wchar_t> dir(MAX_PATH + 1);
+  DWORD const dir_len =
+    ::GetTempPathW(static_cast<DWORD>(dir.size()), dir.data());
+  if (!dir_len || dir_len >= dir.size())
+  {
+    DWORD const last_error = ::GetLastError();
+    HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                    << ErrorString{"GetTempPathW failed."}
+                                    << ErrorCodeWinLast{last_error});
+  }
+
+  std::vector<wchar_t> path(MAX_PATH);
+  if (!::GetTempFileNameW(dir.data(), L"hms", 0, path.data()))
+  {
+    DWORD const last_error = ::GetLastError();
+    HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                    << ErrorString{"GetTempFileNameW failed."}
+                                    << ErrorCodeWinLast{last_error});
+  }
+
+  return path.data();
+}
+
+// Deleted when closed.
+class ScanHistoryFile
+{
+public:
+  explicit ScanHistoryFile(std::wstring const& path)
+    : path_{path.empty() ? GetScanHistoryPath() : path},
+      file_{OpenFile<char>(path_,
+                           std::ios::in | std::ios::out | std::ios::binary |
+                             std::ios::trunc)}
+  {
+    if (!*file_)
+    {
+      ::DeleteFileW(path_.c_str());
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Failed to create scan history file."});
+    }
+  }
+
+  ScanHistoryFile(ScanHistoryFile const&) = delete;
+
+  ScanHistoryFile& operator=(ScanHistoryFile const&) = delete;
+
+  ~ScanHistoryFile()
+  {
+    file_.reset();
+    ::DeleteFileW(path_.c_str());
+  }
+
+  std::fstream& GetStream() noexcept
+  {
+    return *file_;
+  }
+
+private:
+  std::wstring path_;
+  std::unique_ptr<std::fstream> file_;
+};
+}
+
+class Scanner
+{
+public:
+  // A thread count of zero means one per core. The buffer size is rounded up
+  // to a whole number of pages.
+  explicit Scanner(Process const& process,
+                   std::uint32_t protect_flags = ScanProtectFlags::kRead,
+                   std::uint32_t type_flags = ScanTypeFlags::kAll,
+                   std::size_t buffer_size = detail::kScanBufferSize,
+                   std::size_t num_threads = 0,
+                   std::uint32_t mode_flags = ScanModeFlags::kNone)
+    : process_{&process},
+      protect_flags_{protect_flags},
+      type_flags_{type_flags},
+      buffer_size_{(buffer_size + detail::kScanPageSize - 1) &
+                   ~(detail::kScanPageSize - 1)},
+      num_threads_{num_threads ? num_threads
+                               : detail::GetDefaultThreadCount()},
+      mode_flags_{mode_flags}
+  {
+    HADESMEM_DETAIL_ASSERT(
+      !(protect_flags & ~(ScanProtectFlags::kInvalidFlagMaxValue - 1UL)));
+    HADESMEM_DETAIL_ASSERT(
+      !(type_flags & ~(ScanTypeFlags::kInvalidFlagMaxValue - 1UL)));
+    HADESMEM_DETAIL_ASSERT(
+      !(mode_flags & ~(ScanModeFlags::kInvalidFlagMaxValue - 1UL)));
+    HADESMEM_DETAIL_ASSERT(buffer_size != 0);
+  }
+
+  explicit Scanner(Process&& process,
+                   std::uint32_t protect_flags = ScanProtectFlags::kRead,
+                   std::uint32_t type_flags = ScanTypeFlags::kAll,
+                   std::size_t buffer_size = detail::kScanBufferSize,
+                   std::size_t num_threads = 0,
+                   std::uint32_t mode_flags = ScanModeFlags::kNone) = delete;
+
+  // The memory layout can change at any time, so this is rebuilt for every
+  // scan.
+  std::vector<ScanRegion> GetRegions() const
+  {
+    std::vector<ScanRegion> regions;
+    RegionList const region_list{*process_};
+    for (auto const& region : region_list)
+    {
+      if (detail::IsScanRegionMatch(region, protect_flags_, type_flags_))
+      {
+        regions.push_back(
+          ScanRegion{static_cast<std::uint8_t*>(region.GetBase()),
+                     static_cast<std::size_t>(region.GetSize())});
+      }
+    }
+
+    return regions;
+  }
+
+  // Finds every address (which is a multiple of alignment) holding the value.
+  // Values straddling two regions are not found. Results are sorted.
+  template <typename T>
+  std::vector<void*> Find(T value, std::size_t alignment = sizeof(T)) const
+  {
+    return FindIf<T>(ScanEqual<T>{value}, alignment);
+  }
+
+  // Finds every address (which is a multiple of alignment) holding a value in
+  // [low, high]. NaNs never match. Results are sorted.
+  template <typename T>
+  std::vector<void*>
+    FindRange(T low, T high, std::size_t alignment = sizeof(T)) const
+  {
+    return FindIf<T>(ScanInRange<T>{low, high}, alignment);
+  }
+
+  // Finds every address (which is a multiple of alignment) holding a value
+  // which matches value as specified by mode and tolerance. See
+  // ScanFloatMode. Results are sorted.
+  template <typename T>
+  std::vector<void*> FindFloat(T value,
+                               ScanFloatMode mode,
+                               double tolerance,
+                               std::size_t alignment = sizeof(T)) const
+  {
+    T low;
+    T high;
+    GetFloatRange(value, mode, tolerance, low, high);
+    return FindRange(low, high, alignment);
+  }
+
+  // Finds every address (which is a multiple of alignment) holding a value for
+  // which pred(value) holds. pred is inlined into the scan loop, and the
+  // predicates ScanEqual, ScanInRange and ScanBitmask are vectorized. pred is
+  // copied and called from the worker threads. Values straddling two regions
+  // are not found. Results are sorted.
+  template <typename T, typename Pred>
+  std::vector<void*> FindIf(Pred pred, std::size_t alignment = sizeof(T)) const
+  {
+    HADESMEM_DETAIL_STATIC_ASSERT(detail::IsScanValueType<T>::value);
+    HADESMEM_DETAIL_ASSERT(alignment != 0 &&
+                           detail::kScanPageSize % alignment == 0);
+
+    auto const chunks = GetChunks(GetRegions(), sizeof(T));
+    std::vector<std::vector<void*>> chunk_results(chunks.size());
+    ForEachChunk(chunks,
+                 [&](std::size_t i,
+                     std::size_t /*thread*/,
+                     ScanChunk const& chunk,
+                     std::uint8_t const* buf)
+                 {
+                   detail::ScanValueIf<T>(buf,
+                                          buf + chunk.read_len,
+                                          pred,
+                                          alignment,
+                                          [&](std::size_t offset)
+                                          {
+                                            if (offset < chunk.len)
+                                            {
+                                              chunk_results[i].push_back(
+                                                chunk.address + offset);
+                                            }
+                                          });
+                 });
+    return MergeResults(chunk_results);
+  }
+
+  // Finds the start of every group (at a multiple of alignment) whose members
+  // all hold their values. The most selective member is searched for first
+  // and the rest are only checked where it matches, so groups with a
+  // distinctive member are about as fast to find as a single value. Groups
+  // straddling two regions are not found. Results are sorted.
+  std::vector<void*> FindGroup(ScanGroup const& group,
+                               std::size_t alignment = 4) const
+  {
+    HADESMEM_DETAIL_ASSERT(alignment != 0 &&
+                           detail::kScanPageSize % alignment == 0);
+
+    if (group.IsEmpty())
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Scan group is empty."});
+    }
+
+    auto const chunks = GetChunks(GetRegions(), group.GetSize());
+    std::vector<std::vector<std::size_t>> hits(num_threads_);
+    std::vector<std::vector<void*>> chunk_results(chunks.size());
+    ForEachChunk(chunks,
+                 [&](std::size_t i,
+                     std::size_t thread,
+                     ScanChunk const& chunk,
+                     std::uint8_t const* buf)
+                 {
+                   detail::ScanGroupValues(buf,
+                                           chunk.read_len,
+                                           chunk.len,
+                                           group.members_,
+                                           alignment,
+                                           hits[thread],
+                                           [&](std::size_t offset)
+                                           {
+                                             chunk_results[i].push_back(
+                                               chunk.address + offset);
+                                           });
+                 });
+    return MergeResults(chunk_results);
+  }
+
+  // Finds every occurrence of the string. Strings straddling two regions are
+  // not found. Results are sorted.
+  std::vector<void*>
+    FindString(std::string const& str,
+               std::uint32_t flags = ScanStringFlags::kNone) const
+  {
+    return FindStringImpl(str, flags);
+  }
+
+  std::vector<void*>
+    FindString(std::wstring const& str,
+               std::uint32_t flags = ScanStringFlags::kNone) const
+  {
+    return FindStringImpl(str, flags);
+  }
+
+  // Finds every occurrence of any of the strings in a single pass. Results
+  // are sorted by address, then index.
+  std::vector<ScanStringMatch>
+    FindStrings(std::vector<std::string> const& strs,
+                std::uint32_t flags = ScanStringFlags::kNone) const
+  {
+    return FindStringsImpl(strs, flags);
+  }
+
+  std::vector<ScanStringMatch>
+    FindStrings(std::vector<std::wstring> const& strs,
+                std::uint32_t flags = ScanStringFlags::kNone) const
+  {
+    return FindStringsImpl(strs, flags);
+  }
+
+  // Finds matches of an ECMAScript regex of up to max_length characters. The
+  // regex is only evaluated around occurrences of the longest literal which
+  // every match must contain (see detail::GetScanRegexLiteral), so it must
+  // have one. Each hit is searched separately, so overlapping matches can be
+  // found where a single pass over memory would only find one. Wildcards are
+  // not supported. Results are sorted.
+  std::vector<ScanStringMatch>
+    FindRegex(std::string const& regex,
+              std::uint32_t flags = ScanStringFlags::kNone,
+              std::size_t max_length = 256) const
+  {
+    return FindRegexImpl(regex, flags, max_length);
+  }
+
+  std::vector<ScanStringMatch>
+    FindRegex(std::wstring const& regex,
+              std::uint32_t flags = ScanStringFlags::kNone,
+              std::size_t max_length = 256) const
+  {
+    return FindRegexImpl(regex, flags, max_length);
+  }
+
+  // Pages are stored as they are read, so peak memory usage is the size of
+  // the snapshot plus one buffer per thread.
+  ScanSnapshot TakeSnapshot(bool compress = true) const
+  {
+    ScanSnapshot snapshot;
+    snapshot.regions_ = GetRegions();
+    std::size_t num_pages = 0;
+    for (auto const& region : snapshot.regions_)
+    {
+      snapshot.region_pages_.push_back(num_pages);
+      num_pages += region.size / detail::kScanPageSize;
+    }
+
+    snapshot.page_ids_.assign(num_pages, detail::kScanPageMissing);
+
+    auto const chunks = GetChunks(snapshot.regions_, 1);
+    std::vector<std::vector<std::uint8_t>> scratch(num_threads_);
+    std::mutex store_mutex;
+    ForEachChunk(
+      chunks,
+      [&](std::size_t /*i*/,
+          std::size_t thread,
+          ScanChunk const& chunk,
+          std::uint8_t const* buf)
+      {
+        auto& cur_scratch = scratch[thread];
+        cur_scratch.resize(detail::kScanPageSize);
+        std::size_t const first_page =
+          snapshot.region_pages_[chunk.region] +
+          static_cast<std::size_t>(chunk.address -
+                                   snapshot.regions_[chunk.region].base) /
+            detail::kScanPageSize;
+        for (std::size_t offset = 0; offset < chunk.len;
+             offset += detail::kScanPageSize)
+        {
+          auto const packed =
+            detail::PackScanPage(buf + offset, compress, cur_scratch.data());
+          std::lock_guard<std::mutex> lock{store_mutex};
+          snapshot.page_ids_[first_page + offset / detail::kScanPageSize] =
+            snapshot.store_.Add(packed);
+        }
+      });
+
+    return snapshot;
+  }
+
+  // Finds every address (which is a multiple of alignment) in the snapshot
+  // whose value relates to its snapshotted value as specified. Regions which
+  // have been freed since the snapshot was taken are skipped. Results are
+  // sorted.
+  template <typename T>
+  std::vector<void*> Compare(ScanSnapshot const& snapshot,
+                             ScanCompare compare,
+                             std::size_t alignment = sizeof(T)) const
+  {
+    HADESMEM_DETAIL_STATIC_ASSERT(detail::IsScanValueType<T>::value);
+
+    switch (compare)
+    {
+    case ScanCompare::kChanged:
+      return CompareIf<T>(snapshot, ScanChanged{}, alignment);
+    case ScanCompare::kUnchanged:
+      return CompareIf<T>(snapshot, ScanUnchanged{}, alignment);
+    case ScanCompare::kIncreased:
+      return CompareIf<T>(snapshot, ScanIncreased{}, alignment);
+    case ScanCompare::kDecreased:
+      return CompareIf<T>(snapshot, ScanDecreased{}, alignment);
+    }
+
+    HADESMEM_DETAIL_ASSERT(false);
+    return {};
+  }
+
+  // Finds every address (which is a multiple of alignment) in the snapshot
+  // where pred(old_value, cur_value) holds. pred is inlined into the compare
+  // loop. Blocks which haven't changed are skipped and raw byte compares are
+  // vectorized for the predicates ScanChanged, ScanUnchanged, ScanIncreased
+  // and ScanDecreased, but every value is checked for other predicates.
+  // Results are sorted.
+  template <typename T, typename Pred>
+  std::vector<void*> CompareIf(ScanSnapshot const& snapshot,
+                               Pred pred,
+                               std::size_t alignment = sizeof(T)) const
+  {
+    HADESMEM_DETAIL_STATIC_ASSERT(detail::IsScanValueType<T>::value);
+    HADESMEM_DETAIL_ASSERT(alignment != 0 &&
+                           detail::kScanCompareBlockSize % alignment == 0);
+
+    auto const chunks = GetChunks(snapshot.GetRegions(), sizeof(T));
+    std::vector<std::vector<std::uint8_t>> old_buffers(num_threads_);
+    std::vector<std::vector<void*>> chunk_results(chunks.size());
+    ForEachChunk(chunks,
+                 [&](std::size_t i,
+                     std::size_t thread,
+                     ScanChunk const& chunk,
+                     std::uint8_t const* buf)
+                 {
+                   auto& old_buf = old_buffers[thread];
+                   if (old_buf.size() < chunk.read_len)
+                   {
+                     old_buf.resize(chunk.read_len);
+                   }
+
+                   if (!snapshot.Read(
+                         chunk.address, old_buf.data(), chunk.read_len))
+                   {
+                     return;
+                   }
+
+                   detail::ScanCompareValues<T>(
+                     old_buf.data(),
+                     buf,
+                     chunk.read_len,
+                     chunk.len,
+                     alignment,
+                     pred,
+                     [&](std::size_t offset)
+                     {
+                       chunk_results[i].push_back(chunk.address + offset);
+                     });
+                 });
+    return MergeResults(chunk_results);
+  }
+
+  // First pass of a progressive scan. alignment must be a power of two no
+  // larger than 64.
+  template <typename T>
+  ScanResults Scan(T value, std::size_t alignment = sizeof(T)) const
+  {
+    return ScanIf<T>(ScanEqual<T>{value}, alignment);
+  }
+
+  // First pass of a progressive scan with a predicate. See FindIf.
+  template <typename T, typename Pred>
+  ScanResults ScanIf(Pred pred, std::size_t alignment = sizeof(T)) const
+  {
+    ScanResults results = MakeResults(GetRegions(), sizeof(T), alignment);
+    RefineIf<T>(results, pred);
+    return results;
+  }
+
+  // First pass of a progressive range scan.
+  template <typename T>
+  ScanResults ScanRange(T low, T high, std::size_t alignment = sizeof(T)) const
+  {
+    return ScanIf<T>(ScanInRange<T>{low, high}, alignment);
+  }
+
+  // First pass of a progressive floating point scan.
+  template <typename T>
+  ScanResults ScanFloat(T value,
+                        ScanFloatMode mode,
+                        double tolerance,
+                        std::size_t alignment = sizeof(T)) const
+  {
+    ScanResults results = MakeResults(GetRegions(), sizeof(T), alignment);
+    RefineFloat(results, value, mode, tolerance);
+    return results;
+  }
+
+  // First pass of a progressive unknown initial value scan.
+  template <typename T>
+  ScanResults Scan(ScanSnapshot const& snapshot,
+                   ScanCompare compare,
+                   std::size_t alignment = sizeof(T)) const
+  {
+    ScanResults results =
+      MakeResults(snapshot.GetRegions(), sizeof(T), alignment);
+    Refine<T>(results, snapshot, compare);
+    return results;
+  }
+
+  // First pass of a progressive unknown initial value scan with a predicate.
+  // See CompareIf.
+  template <typename T, typename Pred>
+  ScanResults ScanIf(ScanSnapshot const& snapshot,
+                     Pred pred,
+                     std::size_t alignment = sizeof(T)) const
+  {
+    ScanResults results =
+      MakeResults(snapshot.GetRegions(), sizeof(T), alignment);
+    RefineIf<T>(results, snapshot, pred);
+    return results;
+  }
+
+  // Keeps the candidates which hold the value. Only pages which still have
+  // candidates are read.
+  template <typename T> void Refine(ScanResults& results, T value) const
+  {
+    RefineIf<T>(results, ScanEqual<T>{value});
+  }
+
+  // Keeps the candidates which hold a value in [low, high].
+  template <typename T>
+  void RefineRange(ScanResults& results, T low, T high) const
+  {
+    RefineIf<T>(results, ScanInRange<T>{low, high});
+  }
+
+  // Keeps the candidates which match value as specified by mode and
+  // tolerance.
+  template <typename T>
+  void RefineFloat(ScanResults& results,
+                   T value,
+                   ScanFloatMode mode,
+                   double tolerance) const
+  {
+    T low;
+    T high;
+    GetFloatRange(value, mode, tolerance, low, high);
+    RefineRange(results, low, high);
+  }
+
+  // Keeps the candidates whose value relates to their snapshotted value as
+  // specified. Candidates which aren't in the snapshot are dropped.
+  template <typename T>
+  void Refine(ScanResults& results,
+              ScanSnapshot const& snapshot,
+              ScanCompare compare) const
+  {
+    switch (compare)
+    {
+    case ScanCompare::kChanged:
+      return RefineIf<T>(results, snapshot, ScanChanged{});
+    case ScanCompare::kUnchanged:
+      return RefineIf<T>(results, snapshot, ScanUnchanged{});
+    case ScanCompare::kIncreased:
+      return RefineIf<T>(results, snapshot, ScanIncreased{});
+    case ScanCompare::kDecreased:
+      return RefineIf<T>(results, snapshot, ScanDecreased{});
+    }
+
+    HADESMEM_DETAIL_ASSERT(false);
+  }
+
+  // Keeps the candidates for which pred(value) holds. See FindIf.
+  template <typename T, typename Pred>
+  void RefineIf(ScanResults& results, Pred pred) const
+  {
+    HADESMEM_DETAIL_STATIC_ASSERT(detail::IsScanValueType<T>::value);
+    CheckResults(results, sizeof(T));
+
+    detail::ScanPredMatcher<T, Pred> matcher{pred, results.alignment_};
+    RefineImpl(results, matcher);
+  }
+
+  // Keeps the candidates for which pred(old_value, cur_value) holds.
+  // Candidates which aren't in the snapshot are dropped. See CompareIf.
+  template <typename T, typename Pred>
+  void RefineIf(ScanResults& results,
+                ScanSnapshot const& snapshot,
+                Pred pred) const
+  {
+    HADESMEM_DETAIL_STATIC_ASSERT(detail::IsScanValueType<T>::value);
+    CheckResults(results, sizeof(T));
+
+    detail::ScanSnapshotMatcher<T, Pred> matcher{
+      snapshot, results.alignment_, num_threads_, pred};
+    RefineImpl(results, matcher);
+  }
+
+  // Collects every aligned pointer in the scanned regions which points into
+  // one of them. Pointers in modules are the static bases for path searches.
+  // TODO: Support scanning WoW64 processes from x64 builds.
+  PointerMap BuildPointerMap() const
+  {
+    PointerMap map;
+    ModuleList const modules{*process_};
+    for (auto const& module : modules)
+    {
+      map.modules_.push_back(detail::PointerMapModule{
+        module.GetName(),
+        reinterpret_cast<std::uintptr_t>(module.GetHandle()),
+        module.GetSize()});
+    }
+
+    std::sort(std::begin(map.modules_),
+              std::end(map.modules_),
+              [](detail::PointerMapModule const& lhs,
+                 detail::PointerMapModule const& rhs)
+              {
+                return lhs.base < rhs.base;
+              });
+
+    auto const regions = GetRegions();
+    detail::PointerMapRanges ranges;
+    for (auto const& region : regions)
+    {
+      auto const base = reinterpret_cast<std::uintptr_t>(region.base);
+      if (!ranges.empty() && ranges.back().second == base)
+      {
+        ranges.back().second += region.size;
+      }
+      else
+      {
+        ranges.emplace_back(base, base + region.size);
+      }
+    }
+
+    auto const chunks = GetChunks(regions, sizeof(void*));
+    std::vector<std::vector<detail::PointerMapEntry>> parts(chunks.size());
+    ForEachChunk(chunks,
+                 [&](std::size_t i,
+                     std::size_t /*thread*/,
+                     ScanChunk const& chunk,
+                     std::uint8_t const* buf)
+                 {
+                   detail::CollectPointers<std::uintptr_t>(
+                     buf,
+                     chunk.read_len,
+                     chunk.len,
+                     reinterpret_cast<std::uintptr_t>(chunk.address),
+                     ranges,
+                     parts[i]);
+                 });
+
+    detail::SortPointerMap(parts, map.entries_, num_threads_);
+    return map;
+  }
+
+private:
+  // Only matches which start in the first len bytes belong to the chunk. The
+  // rest of the read_len bytes overlap the next chunk, so that values can
+  // straddle chunks.
+  struct ScanChunk
+  {
+    std::size_t region;
+    std::uint8_t* address;
+    std::size_t len;
+    std::size_t read_len;
+  };
+
+  std::vector<ScanChunk> GetChunks(std::vector<ScanRegion> const& regions,
+                                   std::size_t value_size) const
+  {
+    std::vector<ScanChunk> chunks;
+    for (std::size_t i = 0; i < regions.size(); ++i)
+    {
+      auto const& region = regions[i];
+      for (std::size_t offset = 0; offset < region.size;
+           offset += buffer_size_)
+      {
+        std::size_t const len = (std::min)(buffer_size_, region.size - offset);
+        std::size_t const read_len =
+          (std::min)(len + value_size - 1, region.size - offset);
+        chunks.push_back(ScanChunk{i, region.base + offset, len, read_len});
+      }
+    }
+
+    return chunks;
+  }
+
+  // Reads each chunk and calls scan(i, thread, chunk, buf) for it on the
+  // worker pool, where thread can be used to index per-thread state. Chunks
+  // which can't be read are skipped.
+  template <typename ScanFunc>
+  void ForEachChunk(std::vector<ScanChunk> const& chunks, ScanFunc scan) const
+  {
+    std::unique_ptr<detail::ScanCapture> capture;
+    if (mode_flags_ & ScanModeFlags::kSuspend)
+    {
+      std::vector<detail::ScanCaptureRange> ranges;
+      for (auto const& chunk : chunks)
+      {
+        detail::AddScanCaptureRange(ranges, chunk.address, chunk.read_len);
+      }
+
+      capture = Capture(ranges);
+    }
+
+    std::vector<std::vector<std::uint8_t>> buffers(num_threads_);
+    detail::ParallelFor(
+      chunks.size(),
+      num_threads_,
+      [&](std::size_t i, std::size_t thread)
+      {
+        auto const& chunk = chunks[i];
+        if (auto const buf = ReadChunk(
+              capture.get(), chunk.address, chunk.read_len, buffers[thread]))
+        {
+          scan(i, thread, chunk, buf);
+        }
+      });
+  }
+
+  // Suspends the target while the ranges are copied.
+  std::unique_ptr<detail::ScanCapture>
+    Capture(std::vector<detail::ScanCaptureRange> const& ranges) const
+  {
+    auto capture = std::make_unique<detail::ScanCapture>(ranges, buffer_size_);
+    // Threads can't safely be created while the current process is
+    // suspended.
+    std::size_t const num_threads =
+      process_->GetId() == ::GetCurrentProcessId() ? 1 : num_threads_;
+    {
+      SuspendedProcess const suspended_process{process_->GetId()};
+      capture->Fill(num_threads,
+                    [&](std::uint8_t* address,
+                        std::uint8_t* buf,
+                        std::size_t len)
+                    {
+                      return detail::ReadScanCapturePiece(
+                        *process_, address, buf, len);
+                    });
+    }
+
+    return capture;
+  }
+
+  // Returns the len bytes at address, either from the capture (for suspended
+  // scans) or read into buf. Returns null if they can't be read.
+  std::uint8_t const* ReadChunk(detail::ScanCapture const* capture,
+                                std::uint8_t* address,
+                                std::size_t len,
+                                std::vector<std::uint8_t>& buf) const
+  {
+    if (capture)
+    {
+      return capture->Get(address, len);
+    }
+
+    if (buf.size() < len)
+    {
+      buf.resize(len);
+    }
+
+    return detail::ReadScanChunk(*process_, address, buf.data(), len)
+             ? buf.data()
+             : nullptr;
+  }
+
+  template <typename T>
+  static void GetFloatRange(
+    T value, ScanFloatMode mode, double tolerance, T& low, T& high)
+  {
+    HADESMEM_DETAIL_STATIC_ASSERT(std::is_floating_point<T>::value);
+
+    // ULP counts and decimal places must be whole numbers, and anything past
+    // max_digits10 decimal places is meaningless.
+    bool const integral = mode == ScanFloatMode::kUlp ||
+                          mode == ScanFloatMode::kRounded ||
+                          mode == ScanFloatMode::kTruncated;
+    double const max_tolerance =
+      mode == ScanFloatMode::kUlp
+        ? 1e18
+        : integral ? std::numeric_limits<double>::max_digits10
+                   : (std::numeric_limits<double>::max)();
+    if (!std::isfinite(value) || !(tolerance >= 0) ||
+        !(tolerance <= max_tolerance) ||
+        (integral && std::floor(tolerance) != tolerance))
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Invalid floating point tolerance."});
+    }
+
+    switch (mode)
+    {
+    case ScanFloatMode::kAbsolute:
+      return detail::GetScanFloatAbsoluteRange(value, tolerance, low, high);
+    case ScanFloatMode::kRelative:
+      return detail::GetScanFloatRelativeRange(value, tolerance, low, high);
+    case ScanFloatMode::kUlp:
+      return detail::GetScanFloatUlpRange(
+        value, static_cast<std::uint64_t>(tolerance), low, high);
+    case ScanFloatMode::kRounded:
+      return detail::GetScanFloatRoundedRange(
+        value, static_cast<std::size_t>(tolerance), low, high);
+    case ScanFloatMode::kTruncated:
+      return detail::GetScanFloatTruncatedRange(
+        value, static_cast<std::size_t>(tolerance), low, high);
+    }
+
+    HADESMEM_DETAIL_THROW_EXCEPTION(
+      Error{} << ErrorString{"Invalid floating point mode."});
+  }
+
+  template <typename CharT>
+  static std::vector<detail::PatternDataByte>
+    GetStringNeedle(std::basic_string<CharT> const& str, std::uint32_t flags)
+  {
+    HADESMEM_DETAIL_ASSERT(
+      !(flags & ~(ScanStringFlags::kInvalidFlagMaxValue - 1UL)));
+
+    if (str.empty())
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"String is empty."});
+    }
+
+    return detail::MakeScanStringNeedle(
+      str,
+      !!(flags & ScanStringFlags::kCaseInsensitive),
+      !!(flags & ScanStringFlags::kWildcard));
+  }
+
+  template <typename CharT>
+  std::vector<void*> FindStringImpl(std::basic_string<CharT> const& str,
+                                    std::uint32_t flags) const
+  {
+    auto const needle = GetStringNeedle(str, flags);
+    detail::PatternSearch const search{std::begin(needle), std::end(needle)};
+    auto const chunks = GetChunks(GetRegions(), needle.size());
+    std::vector<std::vector<void*>> chunk_results(chunks.size());
+    ForEachChunk(chunks,
+                 [&](std::size_t i,
+                     std::size_t /*thread*/,
+                     ScanChunk const& chunk,
+                     std::uint8_t const* buf)
+                 {
+                   auto cur = buf;
+                   while (auto const match =
+                            search.Search(cur, buf + chunk.read_len))
+                   {
+                     if (static_cast<std::size_t>(match - buf) >= chunk.len)
+                     {
+                       break;
+                     }
+
+                     chunk_results[i].push_back(chunk.address + (match - buf));
+                     cur = match + 1;
+                   }
+                 });
+    return MergeResults(chunk_results);
+  }
+
+  template <typename CharT>
+  std::vector<ScanStringMatch>
+    FindStringsImpl(std::vector<std::basic_string<CharT>> const& strs,
+                    std::uint32_t flags) const
+  {
+    detail::MultiPatternSearch search{
+      !!(flags & ScanStringFlags::kCaseInsensitive)};
+    std::size_t max_size = 1;
+    for (auto const& str : strs)
+    {
+      auto const needle = GetStringNeedle(str, flags);
+      search.AddPattern(std::begin(needle), std::end(needle));
+      max_size = (std::max)(max_size, needle.size());
+    }
+
+    search.Compile();
+
+    auto const chunks = GetChunks(GetRegions(), max_size);
+    std::vector<std::vector<ScanStringMatch>> chunk_results(chunks.size());
+    ForEachChunk(chunks,
+                 [&](std::size_t i,
+                     std::size_t /*thread*/,
+                     ScanChunk const& chunk,
+                     std::uint8_t const* buf)
+                 {
+                   auto& cur_results = chunk_results[i];
+                   std::vector<bool> done(strs.size());
+                   search.Search(
+                     buf,
+                     buf + chunk.read_len,
+                     done,
+                     [&](std::size_t id, std::uint8_t const* match)
+                     {
+                       auto const offset =
+                         static_cast<std::size_t>(match - buf);
+                       if (offset < chunk.len)
+                       {
+                         cur_results.push_back(
+                           ScanStringMatch{chunk.address + offset,
+                                           search.GetNeedleLength(id),
+                                           id});
+                       }
+
+                       return false;
+                     });
+                   std::sort(std::begin(cur_results),
+                             std::end(cur_results),
+                             [](ScanStringMatch const& lhs,
+                                ScanStringMatch const& rhs)
+                             {
+                               return lhs.address < rhs.address ||
+                                      (lhs.address == rhs.address &&
+                                       lhs.index < rhs.index);
+                             });
+                 });
+    return MergeResults(chunk_results);
+  }
+
+  template <typename CharT>
+  std::vector<ScanStringMatch>
+    FindRegexImpl(std::basic_string<CharT> const& regex,
+                  std::uint32_t flags,
+                  std::size_t max_length) const
+  {
+    HADESMEM_DETAIL_ASSERT(!(flags & ScanStringFlags::kWildcard));
+    HADESMEM_DETAIL_ASSERT(max_length != 0);
+
+    auto const literal = detail::GetScanRegexLiteral(regex);
+    if (literal.empty())
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Regex has no literal to search for."});
+    }
+
+    std::basic_regex<CharT> compiled;
+    try
+    {
+      auto regex_flags = std::regex_constants::ECMAScript;
+      if (!!(flags & ScanStringFlags::kCaseInsensitive))
+      {
+        regex_flags |= std::regex_constants::icase;
+      }
+
+      compiled.assign(regex, regex_flags);
+    }
+    catch (std::regex_error const&)
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"Invalid regex."});
+    }
+
+    auto const needle = GetStringNeedle(literal, flags);
+    detail::PatternSearch const search{std::begin(needle), std::end(needle)};
+    auto const chunks = GetChunks(
+      GetRegions(), max_length * detail::ScanStringUnitSize<CharT>::value);
+    std::vector<std::vector<CharT>> units(num_threads_);
+    std::vector<std::vector<ScanStringMatch>> chunk_results(chunks.size());
+    ForEachChunk(
+      chunks,
+      [&](std::size_t i,
+          std::size_t thread,
+          ScanChunk const& chunk,
+          std::uint8_t const* buf)
+      {
+        // Hits past the end of the chunk can still be part of matches which
+        // start in it.
+        auto& cur_results = chunk_results[i];
+        auto cur = buf;
+        while (auto const match = search.Search(cur, buf + chunk.read_len))
+        {
+          detail::MatchScanRegex(
+            compiled,
+            buf,
+            chunk.read_len,
+            chunk.len,
+            static_cast<std::size_t>(match - buf),
+            max_length,
+            units[thread],
+            [&](std::size_t offset, std::size_t length)
+            {
+              cur_results.push_back(
+                ScanStringMatch{chunk.address + offset, length, 0});
+            });
+          cur = match + 1;
+        }
+
+        auto const less = [](ScanStringMatch const& lhs,
+                             ScanStringMatch const& rhs)
+        {
+          return lhs.address < rhs.address ||
+                 (lhs.address == rhs.address && lhs.length < rhs.length);
+        };
+        auto const equal = [](ScanStringMatch const& lhs,
+                              ScanStringMatch const& rhs)
+        {
+          return lhs.address == rhs.address && lhs.length == rhs.length;
+        };
+        std::sort(std::begin(cur_results), std::end(cur_results), less);
+        cur_results.erase(
+          std::unique(std::begin(cur_results), std::end(cur_results), equal),
+          std::end(cur_results));
+      });
+    return MergeResults(chunk_results);
+  }
+
+  static ScanResults MakeResults(std::vector<ScanRegion> regions,
+                                 std::size_t value_size,
+                                 std::size_t alignment)
+  {
+    HADESMEM_DETAIL_ASSERT(alignment != 0 &&
+                           alignment <= detail::kScanMaxAlignment &&
+                           !(alignment & (alignment - 1)));
+
+    ScanResults results;
+    results.value_size_ = value_size;
+    results.alignment_ = alignment;
+    for (auto const& region : regions)
+    {
+      results.sets_.emplace_back(
+        region.size < value_size ? 0
+                                 : (region.size - value_size) / alignment + 1);
+    }
+
+    results.regions_ = std::move(regions);
+    return results;
+  }
+
+  static void CheckResults(ScanResults const& results, std::size_t value_size)
+  {
+    if (results.value_size_ != value_size)
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Value size does not match results."});
+    }
+  }
+
+  template <typename Matcher>
+  void RefineImpl(ScanResults& results, Matcher& matcher) const
+  {
+    auto const chunks = GetChunks(results.regions_, results.value_size_);
+    std::unique_ptr<detail::ScanCapture> capture;
+    if (mode_flags_ & ScanModeFlags::kSuspend)
+    {
+      capture = Capture(GetCandidateRanges(results));
+    }
+
+    std::vector<std::vector<std::uint8_t>> buffers(num_threads_);
+    std::vector<std::vector<std::uint64_t>> masks(num_threads_);
+    std::vector<std::vector<std::size_t>> slots(num_threads_);
+    detail::ParallelFor(chunks.size(),
+                        num_threads_,
+                        [&](std::size_t i, std::size_t thread)
+                        {
+                          auto const& chunk = chunks[i];
+                          if (results.sets_[chunk.region].IsSparse())
+                          {
+                            RefineSparseChunk(results,
+                                              chunk,
+                                              thread,
+                                              matcher,
+                                              capture.get(),
+                                              buffers[thread],
+                                              slots[thread]);
+                          }
+                          else
+                          {
+                            RefineBitmapChunk(results,
+                                              chunk,
+                                              thread,
+                                              matcher,
+                                              capture.get(),
+                                              buffers[thread],
+                                              masks[thread]);
+                          }
+                        });
+
+    for (auto& set : results.sets_)
+    {
+      set.Compact();
+    }
+  }
+
+  // Every page which still has candidates, along with the bytes after it
+  // which values starting in it can straddle into. This covers everything
+  // which RefineBitmapChunk and RefineSparseChunk read.
+  static std::vector<detail::ScanCaptureRange>
+    GetCandidateRanges(ScanResults const& results)
+  {
+    std::vector<detail::ScanCaptureRange> ranges;
+    for (std::size_t i = 0; i < results.sets_.size(); ++i)
+    {
+      auto const& set = results.sets_[i];
+      auto const& region = results.regions_[i];
+      std::size_t const alignment = results.alignment_;
+      auto const add_page = [&](std::size_t page)
+      {
+        std::size_t const end = (std::min)(
+          detail::RoundUpScanPage(page + detail::kScanPageSize +
+                                  results.value_size_ - 1),
+          region.size);
+        detail::AddScanCaptureRange(ranges, region.base + page, end - page);
+      };
+
+      if (set.IsSparse())
+      {
+        std::size_t last_page = region.size;
+        set.ForEach(0,
+                    set.GetNumSlots(),
+                    [&](std::size_t slot)
+                    {
+                      std::size_t const page =
+                        slot * alignment & ~(detail::kScanPageSize - 1);
+                      if (page != last_page)
+                      {
+                        add_page(page);
+                        last_page = page;
+                      }
+                    });
+      }
+      else
+      {
+        for (std::size_t page = 0; page < region.size;
+             page += detail::kScanPageSize)
+        {
+          if (set.Any(page / alignment,
+                      (page + detail::kScanPageSize) / alignment))
+          {
+            add_page(page);
+          }
+        }
+      }
+    }
+
+    return ranges;
+  }
+
+  // Reads each run of pages which still have candidates, and ANDs the
+  // candidates with a bitmap of the matches in it.
+  template <typename Matcher>
+  void RefineBitmapChunk(ScanResults& results,
+                         ScanChunk const& chunk,
+                         std::size_t thread,
+                         Matcher& matcher,
+                         detail::ScanCapture const* capture,
+                         std::vector<std::uint8_t>& buf,
+                         std::vector<std::uint64_t>& mask) const
+  {
+    auto& set = results.sets_[chunk.region];
+    auto const& region = results.regions_[chunk.region];
+    std::size_t const alignment = results.alignment_;
+    auto const has_candidates = [&](std::size_t offset)
+    {
+      return set.Any(offset / alignment,
+                     (offset + detail::kScanPageSize) / alignment);
+    };
+
+    std::size_t const chunk_beg =
+      static_cast<std::size_t>(chunk.address - region.base);
+    std::size_t const chunk_end = chunk_beg + chunk.len;
+    for (std::size_t beg = chunk_beg; beg < chunk_end;)
+    {
+      if (!has_candidates(beg))
+      {
+        beg += detail::kScanPageSize;
+        continue;
+      }
+
+      std::size_t end = beg + detail::kScanPageSize;
+      while (end < chunk_end && has_candidates(end))
+      {
+        end += detail::kScanPageSize;
+      }
+
+      std::size_t const len = end - beg;
+      std::size_t const read_len =
+        (std::min)(len + results.value_size_ - 1, region.size - beg);
+      std::size_t const first = beg / alignment;
+      std::size_t const num_slots = len / alignment;
+      auto const data = ReadChunk(capture, region.base + beg, read_len, buf);
+      if (!data || !matcher.Load(thread, region.base + beg, read_len))
+      {
+        set.Clear(first, first + num_slots);
+        beg = end;
+        continue;
+      }
+
+      mask.assign(
+        (num_slots + detail::kScanBitsPerWord - 1) / detail::kScanBitsPerWord,
+        0);
+      matcher.Match(thread,
+                    data,
+                    read_len,
+                    len,
+                    [&](std::size_t offset)
+                    {
+                      std::size_t const slot = offset / alignment;
+                      mask[slot / detail::kScanBitsPerWord] |=
+                        1ULL << (slot % detail::kScanBitsPerWord);
+                    });
+      set.And(first, mask.data(), num_slots);
+      beg = end;
+    }
+  }
+
+  // Reads the pages spanned by the remaining candidates (coalescing runs of
+  // nearby candidates into a single read) and tests each one.
+  template <typename Matcher>
+  void RefineSparseChunk(ScanResults& results,
+                         ScanChunk const& chunk,
+                         std::size_t thread,
+                         Matcher& matcher,
+                         detail::ScanCapture const* capture,
+                         std::vector<std::uint8_t>& buf,
+                         std::vector<std::size_t>& slots) const
+  {
+    auto& set = results.sets_[chunk.region];
+    auto const& region = results.regions_[chunk.region];
+    std::size_t const alignment = results.alignment_;
+    std::size_t const value_size = results.value_size_;
+    std::size_t const first =
+      static_cast<std::size_t>(chunk.address - region.base) / alignment;
+    std::size_t const last = first + chunk.len / alignment;
+
+    slots.clear();
+    set.ForEach(first,
+                last,
+                [&](std::size_t slot)
+                {
+                  slots.push_back(slot);
+                });
+    if (slots.empty())
+    {
+      return;
+    }
+
+    std::vector<std::uint8_t> keep(slots.size());
+    for (std::size_t i = 0; i < slots.size();)
+    {
+      std::size_t const beg =
+        slots[i] * alignment & ~(detail::kScanPageSize - 1);
+      std::size_t end =
+        detail::RoundUpScanPage(slots[i] * alignment + value_size);
+      std::size_t j = i + 1;
+      for (; j < slots.size(); ++j)
+      {
+        std::size_t const offset = slots[j] * alignment;
+        std::size_t const page_end =
+          detail::RoundUpScanPage(offset + value_size);
+        if ((offset & ~(detail::kScanPageSize - 1)) > end ||
+            page_end - beg > buffer_size_)
+        {
+          break;
+        }
+
+        end = (std::max)(end, page_end);
+      }
+
+      end = (std::min)(end, region.size);
+      auto const data = ReadChunk(capture, region.base + beg, end - beg, buf);
+      bool const loaded =
+        data && matcher.Load(thread, region.base + beg, end - beg);
+      for (; i < j; ++i)
+      {
+        std::size_t const offset = slots[i] * alignment - beg;
+        keep[i] = loaded && matcher.Test(thread, data, offset);
+      }
+    }
+
+    std::size_t k = 0;
+    set.Filter(first,
+               last,
+               [&](std::size_t /*slot*/)
+               {
+                 return !!keep[k++];
+               });
+  }
+
+  template <typename T>
+  static std::vector<T>
+    MergeResults(std::vector<std::vector<T>> const& chunk_results)
+  {
+    std::vector<T> results;
+    std::size_t num_results = 0;
+    for (auto const& cur : chunk_results)
+    {
+      num_results += cur.size();
+    }
+
+    results.reserve(num_results);
+    for (auto const& cur : chunk_results)
+    {
+      results.insert(std::end(results), std::begin(cur), std::end(cur));
+    }
+
+    return results;
+  }
+
+  Process const* process_;
+  std::uint32_t protect_flags_;
+  std::uint32_t type_flags_;
+  std::size_t buffer_size_;
+  std::size_t num_threads_;
+  std::uint32_t mode_flags_;
+};
+
+// Every generation of a progressive scan, so that refinements can be undone
+// without rescanning. Only the current results are stored in full. Each
+// earlier generation is stored as the candidates which were removed from it,
+// and the oldest of those are moved to a temporary file (an empty path means
+// one in the temp directory) once they use more than memory_limit bytes.
+// Undo only touches the newest delta, so its cost doesn't depend on how many
+// generations there are.
+class ScanHistory
+{
+public:
+  explicit ScanHistory(
+    ScanResults results,
+    std::size_t memory_limit = detail::kScanHistoryMemoryLimit,
+    std::wstring const& file_path = std::wstring())
+    : results_(std::move(results)),
+      memory_limit_{memory_limit},
+      file_path_(file_path)
+  {
+  }
+
+  ScanResults const& GetResults() const noexcept
+  {
+    return results_;
+  }
+
+  // Number of refinements which can be undone.
+  std::size_t GetUndoCount() const noexcept
+  {
+    return generations_.size();
+  }
+
+  bool CanUndo() const noexcept
+  {
+    return !generations_.empty();
+  }
+
+  // Bytes used by the deltas which are still in memory.
+  std::size_t GetMemoryUsage() const noexcept
+  {
+    return memory_usage_;
+  }
+
+  // Bytes used by the deltas which have been moved to the history file.
+  std::uint64_t GetFileSize() const noexcept
+  {
+    return file_end_;
+  }
+
+  // Makes a refinement of the current results (e.g. a copy of them which has
+  // since been passed to Scanner::Refine) the current generation.
+  void Push(ScanResults results)
+  {
+    bool match = results.regions_.size() == results_.regions_.size() &&
+                 results.value_size_ == results_.value_size_ &&
+                 results.alignment_ == results_.alignment_;
+    for (std::size_t i = 0; match && i < results.regions_.size(); ++i)
+    {
+      match = results.regions_[i].base == results_.regions_[i].base &&
+              results.regions_[i].size == results_.regions_[i].size;
+    }
+
+    if (!match)
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Results are not a refinement of the current "
+                               "generation."});
+    }
+
+    Generation generation;
+    for (std::size_t i = 0; i < results.sets_.size(); ++i)
+    {
+      generation.removed.push_back(
+        results_.sets_[i].Diff(results.sets_[i]));
+      generation.memory += generation.removed.back().GetMemoryUsage();
+    }
+
+    generations_.push_back(std::move(generation));
+    memory_usage_ += generations_.back().memory;
+    results_ = std::move(results);
+
+    // The newest delta is always kept in memory so that stepping back once
+    // is cheap.
+    while (memory_usage_ > memory_limit_ &&
+           num_stored_ + 1 < generations_.size())
+    {
+      Store(generations_[num_stored_++]);
+    }
+  }
+
+  void Undo()
+  {
+    if (generations_.empty())
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"No scan history to undo."});
+    }
+
+    auto& generation = generations_.back();
+    if (generations_.size() == num_stored_)
+    {
+      Load(generation);
+      --num_stored_;
+    }
+    else
+    {
+      memory_usage_ -= generation.memory;
+    }
+
+    for (std::size_t i = 0; i < results_.sets_.size(); ++i)
+    {
+      results_.sets_[i].Merge(generation.removed[i]);
+    }
+
+    generations_.pop_back();
+  }
+
+private:
+  struct Generation
+  {
+    std::vector<detail::ScanResultSet> removed;
+    std::size_t memory{};
+    std::uint64_t offset{};
+  };
+
+  void Store(Generation& generation)
+  {
+    if (!file_)
+    {
+      file_.reset(new detail::ScanHistoryFile{file_path_});
+    }
+
+    auto& stream = file_->GetStream();
+    stream.clear();
+    stream.seekp(static_cast<std::streamoff>(file_end_));
+    for (auto const& removed : generation.removed)
+    {
+      if (!removed.Write(stream))
+      {
+        HADESMEM_DETAIL_THROW_EXCEPTION(
+          Error{} << ErrorString{"Failed to write scan history file."});
+      }
+    }
+
+    generation.offset = file_end_;
+    file_end_ = static_cast<std::uint64_t>(stream.tellp());
+    memory_usage_ -= generation.memory;
+    std::vector<detail::ScanResultSet>().swap(generation.removed);
+  }
+
+  // Stored generations are always the oldest ones, so the one being loaded
+  // is at the end of the file and its space can be reused.
+  void Load(Generation& generation)
+  {
+    auto& stream = file_->GetStream();
+    stream.clear();
+    stream.seekg(static_cast<std::streamoff>(generation.offset));
+    for (std::size_t i = 0; i < results_.sets_.size(); ++i)
+    {
+      detail::ScanResultSet removed{0};
+      if (!removed.Read(stream))
+      {
+        HADESMEM_DETAIL_THROW_EXCEPTION(
+          Error{} << ErrorString{"Failed to read scan history file."});
+      }
+
+      generation.removed.push_back(std::move(removed));
+    }
+
+    file_end_ = generation.offset;
+  }
+
+  ScanResults results_;
+  std::vector<Generation> generations_;
+  std::size_t memory_limit_;
+  std::size_t memory_usage_{};
+  std::size_t num_stored_{};
+  std::uint64_t file_end_{};
+  std::wstring file_path_;
+  std::unique_ptr<detail::ScanHistoryFile> file_;
+};
+}
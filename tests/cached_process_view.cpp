@@ -0,0 +1,115 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <hadesmem/cached_process_view.hpp>
+#include <hadesmem/cached_process_view.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/alloc.hpp>
+#include <hadesmem/config.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/process.hpp>
+
+void TestCachedProcessView()
+{
+  hadesmem::Process const process(::GetCurrentProcessId());
+  hadesmem::Allocator const alloc(process, 0x4000);
+  auto const mem = static_cast<std::uint8_t*>(alloc.GetBase());
+
+  // A pointer chain across three pages.
+  std::uint8_t* const first = mem + 0x1000 + 0x10;
+  std::uint8_t* const second = mem + 0x2000 + 0x20;
+  std::memcpy(mem + 8, &first, sizeof(first));
+  std::memcpy(first + 4, &second, sizeof(second));
+  std::uint32_t value = 1234;
+  std::memcpy(second + 12, &value, sizeof(value));
+
+  hadesmem::CachedProcessView view(process);
+  BOOST_TEST(&view.GetProcess() == &process);
+  for (std::uint32_t frame = 0; frame < 3; ++frame)
+  {
+    for (std::size_t i = 0; i < 10; ++i)
+    {
+      auto const a = hadesmem::Read<std::uint8_t*>(view, mem + 8);
+      auto const b = hadesmem::Read<std::uint8_t*>(view, a + 4);
+      BOOST_TEST_EQ(hadesmem::Read<std::uint32_t>(view, b + 12), value);
+    }
+
+    // Changes aren't seen until the next tick.
+    std::uint32_t const new_value = value + 1;
+    std::memcpy(second + 12, &new_value, sizeof(new_value));
+    BOOST_TEST_EQ(hadesmem::Read<std::uint32_t>(view, second + 12), value);
+    value = new_value;
+
+    view.Tick();
+  }
+
+  BOOST_TEST_EQ(view.GetNumMisses(), 9UL);
+  BOOST_TEST_EQ(view.GetNumHits(), 84UL);
+
+  auto const straddle = hadesmem::Read<std::uint8_t, 8>(view, mem + 0x1FFC);
+  BOOST_TEST_EQ(std::memcmp(straddle.data(), mem + 0x1FFC, 8), 0);
+
+  auto const vec = hadesmem::ReadVector<std::uint32_t>(view, mem, 0x1000);
+  BOOST_TEST_EQ(std::memcmp(vec.data(), mem, 0x4000), 0);
+
+  std::string const str(0x1800, 'x');
+  auto const str_mem = reinterpret_cast<char*>(mem + 0x1800);
+  std::memcpy(str_mem, str.c_str(), str.size() + 1);
+  view.Tick();
+  BOOST_TEST_EQ(hadesmem::ReadString<char>(view, str_mem), str);
+
+  std::wstring const wide_str = L"Wide test string.";
+  auto const wide_str_mem = reinterpret_cast<wchar_t*>(mem + 0x2FF8);
+  std::memcpy(wide_str_mem,
+              wide_str.c_str(),
+              (wide_str.size() + 1) * sizeof(wchar_t));
+  view.Tick();
+  BOOST_TEST(hadesmem::ReadString<wchar_t>(view, wide_str_mem) == wide_str);
+
+  // Pages which can't be read as-is fall back to a normal read.
+  mem[0x3001] = 0x5A;
+  DWORD old_protect = 0;
+  BOOST_TEST(
+    ::VirtualProtect(mem + 0x3000, 0x1000, PAGE_NOACCESS, &old_protect));
+  view.Tick();
+  BOOST_TEST_EQ(hadesmem::Read<std::uint8_t>(view, mem + 0x3001), 0x5A);
+
+  void* const reserved =
+    ::VirtualAlloc(nullptr, 0x1000, MEM_RESERVE, PAGE_NOACCESS);
+  BOOST_TEST(reserved != nullptr);
+  BOOST_TEST_THROWS(hadesmem::Read<int>(view, reserved), hadesmem::Error);
+  BOOST_TEST(::VirtualFree(reserved, 0, MEM_RELEASE));
+}
+
+void TestCachedProcessViewTimeToLive()
+{
+  hadesmem::Process const process(::GetCurrentProcessId());
+  std::uint32_t value = 1;
+
+  hadesmem::CachedProcessView view(
+    process, 0x1000, std::chrono::milliseconds(50));
+  BOOST_TEST(view.GetTimeToLive() == std::chrono::milliseconds(50));
+  BOOST_TEST_EQ(hadesmem::Read<std::uint32_t>(view, &value), 1UL);
+  value = 2;
+  BOOST_TEST_EQ(hadesmem::Read<std::uint32_t>(view, &value), 1UL);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  BOOST_TEST_EQ(hadesmem::Read<std::uint32_t>(view, &value), 2UL);
+}
+
+int main()
+{
+  TestCachedProcessView();
+  TestCachedProcessViewTimeToLive();
+  return boost::report_errors();
+}
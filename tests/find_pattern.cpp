@@ -9,7 +9,10 @@
 #include <hadesmem/detail/warning_disable_suffix.hpp>
 
 #include <hadesmem/config.hpp>
+#include <hadesmem/detail/filesystem.hpp>
+#include <hadesmem/detail/pattern_generator.hpp>
 #include <hadesmem/detail/self_path.hpp>
+#include <hadesmem/detail/str_conv.hpp>
 #include <hadesmem/error.hpp>
 #include <hadesmem/process.hpp>
 
@@ -272,8 +275,514 @@ void TestFindPattern()
     hadesmem::Error);
 }
 
+void TestMultiPatternSearch()
+{
+  std::uint8_t const haystack[] = {
+    0x90, 0xE8, 0x11, 0x22, 0x33, 0x44, 0xC3, 0x90, 0x90, 0xCC};
+
+  auto const call = hadesmem::detail::ConvertData(L"E8 ?? ?? ?? ?? C3");
+  auto const two_nop = hadesmem::detail::ConvertData(L"90 90");
+  auto const any_two = hadesmem::detail::ConvertData(L"?? ??");
+  auto const unmatched = hadesmem::detail::ConvertData(L"11 33");
+
+  hadesmem::detail::MultiPatternSearch search;
+  auto const call_id = search.AddPattern(std::begin(call), std::end(call));
+  auto const two_nop_id =
+    search.AddPattern(std::begin(two_nop), std::end(two_nop));
+  auto const any_two_id =
+    search.AddPattern(std::begin(any_two), std::end(any_two));
+  auto const unmatched_id =
+    search.AddPattern(std::begin(unmatched), std::end(unmatched));
+  search.Compile();
+
+  std::vector<void const*> results(search.GetNumPatterns());
+  std::vector<bool> done(search.GetNumPatterns());
+  search.Search(std::begin(haystack),
+                std::end(haystack),
+                done,
+                [&](std::size_t id, std::uint8_t const* match)
+                {
+                  // Skip the first match to exercise custom start addresses.
+                  if (id == any_two_id && match == &haystack[0])
+                  {
+                    return false;
+                  }
+
+                  results[id] = match;
+                  return true;
+                });
+
+  BOOST_TEST_EQ(results[call_id], static_cast<void const*>(&haystack[1]));
+  BOOST_TEST_EQ(results[two_nop_id], static_cast<void const*>(&haystack[7]));
+  BOOST_TEST_EQ(results[any_two_id], static_cast<void const*>(&haystack[1]));
+  BOOST_TEST_EQ(results[unmatched_id], static_cast<void const*>(nullptr));
+  BOOST_TEST(done[call_id] && done[two_nop_id] && done[any_two_id]);
+  BOOST_TEST(!done[unmatched_id]);
+}
+
+void TestPatternSearch()
+{
+  // Large enough to exercise the vectorized paths and the scalar tail.
+  std::vector<std::uint8_t> haystack(0x1000, 0xCC);
+  haystack[0x7F0] = 0x8B;
+  haystack[0x7F1] = 0x45;
+  haystack[0x7F3] = 0xE8;
+  haystack[0xFFC] = 0x8B;
+  haystack[0xFFD] = 0x45;
+  haystack[0xFFF] = 0xE8;
+
+  auto const needle = hadesmem::detail::ConvertData(L"8B 45 ?? E8");
+  hadesmem::detail::PatternSearch const search{std::begin(needle),
+                                               std::end(needle)};
+  std::uint8_t const* const h_beg = haystack.data();
+  std::uint8_t const* const h_end = h_beg + haystack.size();
+  BOOST_TEST_EQ(static_cast<void const*>(search.Search(h_beg, h_end)),
+                static_cast<void const*>(h_beg + 0x7F0));
+  BOOST_TEST_EQ(static_cast<void const*>(search.Search(h_beg + 0x7F1, h_end)),
+                static_cast<void const*>(h_beg + 0xFFC));
+  BOOST_TEST_EQ(
+    static_cast<void const*>(search.Search(h_beg + 0x7F1, h_end - 1)),
+    static_cast<void const*>(nullptr));
+}
+
+void TestNibbleWildcards()
+{
+  auto const needle = hadesmem::detail::ConvertData(L"FF D? ?B ??");
+  BOOST_TEST_EQ(needle.size(), 4UL);
+  BOOST_TEST_EQ(needle[0].value, 0xFF);
+  BOOST_TEST_EQ(needle[0].mask, 0xFF);
+  BOOST_TEST_EQ(needle[1].value, 0xD0);
+  BOOST_TEST_EQ(needle[1].mask, 0xF0);
+  BOOST_TEST_EQ(needle[2].value, 0x0B);
+  BOOST_TEST_EQ(needle[2].mask, 0x0F);
+  BOOST_TEST_EQ(needle[3].mask, 0x00);
+
+  BOOST_TEST_THROWS(hadesmem::detail::ConvertData(L"FF D?? EB"),
+                    hadesmem::Error);
+  BOOST_TEST_THROWS(hadesmem::detail::ConvertData(L"FF Z? EB"),
+                    hadesmem::Error);
+
+  std::uint8_t const haystack[] = {
+    0xFF, 0xE0, 0x1B, 0x00, 0xFF, 0xD3, 0x2B, 0x00, 0xFF, 0xD7, 0x3C};
+  std::uint8_t const* const h_end = std::end(haystack);
+  hadesmem::detail::PatternSearch const search{std::begin(needle),
+                                               std::end(needle)};
+  BOOST_TEST_EQ(static_cast<void const*>(search.Search(haystack, h_end)),
+                static_cast<void const*>(&haystack[4]));
+  BOOST_TEST_EQ(static_cast<void const*>(search.Search(&haystack[5], h_end)),
+                static_cast<void const*>(nullptr));
+
+  // Only nibble wildcards, so no exact byte anchor is available.
+  auto const nibbles = hadesmem::detail::ConvertData(L"D? ?C");
+  hadesmem::detail::MultiPatternSearch multi_search;
+  multi_search.AddPattern(std::begin(needle), std::end(needle));
+  multi_search.AddPattern(std::begin(nibbles), std::end(nibbles));
+  multi_search.Compile();
+  std::vector<void const*> results(multi_search.GetNumPatterns());
+  std::vector<bool> done(multi_search.GetNumPatterns());
+  multi_search.Search(haystack,
+                      h_end,
+                      done,
+                      [&](std::size_t id, std::uint8_t const* match)
+                      {
+                        results[id] = match;
+                        return true;
+                      });
+  BOOST_TEST_EQ(results[0], static_cast<void const*>(&haystack[4]));
+  BOOST_TEST_EQ(results[1], static_cast<void const*>(&haystack[9]));
+}
+
+void TestFindAll()
+{
+  hadesmem::Process const process{::GetCurrentProcessId()};
+
+  std::uint8_t buf[] = {0x90, 0xCC, 0x90, 0x90, 0xCC, 0x90};
+  std::vector<void*> matches;
+  auto const buf_matches =
+    hadesmem::FindAll(process,
+                      buf,
+                      sizeof(buf),
+                      L"90 ??",
+                      hadesmem::PatternFlags::kRelativeAddress);
+  for (auto const match : buf_matches)
+  {
+    matches.push_back(match);
+  }
+  BOOST_TEST_EQ(matches.size(), 3UL);
+  BOOST_TEST_EQ(matches[0], reinterpret_cast<void*>(0));
+  BOOST_TEST_EQ(matches[1], reinterpret_cast<void*>(2));
+  BOOST_TEST_EQ(matches[2], reinterpret_cast<void*>(3));
+
+  auto const unmatched = hadesmem::FindAll(
+    process, buf, sizeof(buf), L"11 22", hadesmem::PatternFlags::kNone);
+  BOOST_TEST(unmatched.begin() == unmatched.end());
+  BOOST_TEST_THROWS(hadesmem::FindAll(process,
+                                      buf,
+                                      sizeof(buf),
+                                      L"11 22",
+                                      hadesmem::PatternFlags::kThrowOnUnmatch)
+                      .begin(),
+                    hadesmem::Error);
+
+  void* const nop =
+    hadesmem::Find(process, L"", L"90", hadesmem::PatternFlags::kNone, 0U);
+  auto const nops =
+    hadesmem::FindAll(process, L"", L"90", hadesmem::PatternFlags::kNone);
+  auto iter = nops.begin();
+  BOOST_TEST(iter != nops.end());
+  BOOST_TEST_EQ(*iter, nop);
+  ++iter;
+  BOOST_TEST(iter != nops.end());
+  BOOST_TEST(*iter > nop);
+}
+
+void TestPatternCache()
+{
+  hadesmem::Process const process{::GetCurrentProcessId()};
+
+  std::wstring const pattern_file_data = LR"(
+<?xml version="1.0" encoding="utf-8"?>
+<HadesMem>
+  <FindPattern Module="ntdll.dll">
+    <Flag Name="ThrowOnUnmatch"/>
+    <Pattern Name="Two Nop" Data="90 90"/>
+    <Pattern Name="Two Nop Next" Data="90 90" Start="Two Nop">
+      <Manipulator Name="Add" Operand1="1"/>
+    </Pattern>
+  </FindPattern>
+</HadesMem>
+)";
+
+  auto const cache_path = hadesmem::detail::CombinePath(
+    hadesmem::detail::GetSelfDirPath(), L"find_pattern_cache.xml");
+  hadesmem::detail::BufferToFile(cache_path, nullptr, 0);
+
+  hadesmem::FindPattern const uncached{process, pattern_file_data, true};
+  hadesmem::FindPattern const cold{
+    process, pattern_file_data, true, cache_path};
+  BOOST_TEST(cold == uncached);
+  BOOST_TEST(hadesmem::detail::DoesFileExist(cache_path));
+  hadesmem::FindPattern const warm{
+    process, pattern_file_data, true, cache_path};
+  BOOST_TEST(warm == uncached);
+
+  // Point the cached match for "Two Nop" somewhere else, to tell whether the
+  // cache is actually used.
+  auto const set_cached_rva = [&](std::uintptr_t rva)
+  {
+    pugi::xml_document doc;
+    BOOST_TEST(!!doc.load_file(cache_path.c_str()));
+    auto pattern_node =
+      doc.child(L"HadesMemPatternCache")
+        .child(L"Module")
+        .find_child_by_attribute(L"Pattern", L"Name", L"Two Nop");
+    BOOST_TEST(!!pattern_node);
+    pattern_node.attribute(L"RVA").set_value(
+      (L"0x" + hadesmem::detail::NumToStr<wchar_t>(rva, true)).c_str());
+    BOOST_TEST(doc.save_file(cache_path.c_str()));
+  };
+
+  auto const ntdll_base = reinterpret_cast<std::uintptr_t>(
+    hadesmem::Module{process, L"ntdll.dll"}.GetHandle());
+  auto const first_rva = reinterpret_cast<std::uintptr_t>(
+                           uncached.Lookup(L"ntdll.dll", L"Two Nop")) -
+                         ntdll_base;
+  auto const second_rva =
+    reinterpret_cast<std::uintptr_t>(
+      hadesmem::Find(process,
+                     L"ntdll.dll",
+                     L"90 90",
+                     hadesmem::PatternFlags::kThrowOnUnmatch,
+                     first_rva)) -
+    ntdll_base;
+
+  // A cached match which is still valid is used as-is, even though a scan
+  // would have found an earlier one.
+  set_cached_rva(second_rva);
+  hadesmem::FindPattern const hit{process, pattern_file_data, true, cache_path};
+  BOOST_TEST_EQ(hit.Lookup(L"ntdll.dll", L"Two Nop"),
+                reinterpret_cast<void*>(ntdll_base + second_rva));
+
+  // The DOS header doesn't match, so the cached match is rejected and the
+  // module is scanned again.
+  set_cached_rva(0);
+  hadesmem::FindPattern const stale{
+    process, pattern_file_data, true, cache_path};
+  BOOST_TEST(stale == uncached);
+
+  std::string const corrupt_cache = "<HadesMemPatternCache><Module";
+  hadesmem::detail::BufferToFile(
+    cache_path,
+    corrupt_cache.data(),
+    static_cast<std::streamsize>(corrupt_cache.size()));
+  hadesmem::FindPattern const corrupt{
+    process, pattern_file_data, true, cache_path};
+  BOOST_TEST(corrupt == uncached);
+
+  ::DeleteFileW(cache_path.c_str());
+}
+
+void TestParallelSearch()
+{
+  // Matches straddling the chunk boundaries (and one in every other chunk)
+  // to check the overlap handling and that the lowest match always wins.
+  std::size_t const chunk_size = 0x100;
+  std::vector<std::uint8_t> haystack(chunk_size * 8, 0xCC);
+  for (std::size_t i = 1; i < 8; i += 2)
+  {
+    haystack[i * chunk_size - 1] = 0x8B;
+    haystack[i * chunk_size] = 0x45;
+    haystack[i * chunk_size + 2] = 0xE8;
+  }
+
+  auto const needle = hadesmem::detail::ConvertData(L"8B 45 ?? E8");
+  hadesmem::detail::PatternSearch const search{std::begin(needle),
+                                               std::end(needle)};
+  std::uint8_t const* const h_beg = haystack.data();
+  std::uint8_t const* const h_end = h_beg + haystack.size();
+  auto const first = hadesmem::detail::ParallelPatternSearch(
+    search, h_beg, h_end, chunk_size, 4);
+  BOOST_TEST_EQ(static_cast<void const*>(first),
+                static_cast<void const*>(h_beg + chunk_size - 1));
+  auto const second = hadesmem::detail::ParallelPatternSearch(
+    search, h_beg + chunk_size, h_end, chunk_size, 4);
+  BOOST_TEST_EQ(static_cast<void const*>(second),
+                static_cast<void const*>(h_beg + chunk_size * 3 - 1));
+
+  hadesmem::detail::MultiPatternSearch multi_search;
+  std::size_t const call_id =
+    multi_search.AddPattern(std::begin(needle), std::end(needle));
+  auto const unmatched_needle = hadesmem::detail::ConvertData(L"11 22 33");
+  std::size_t const unmatched_id = multi_search.AddPattern(
+    std::begin(unmatched_needle), std::end(unmatched_needle));
+  multi_search.Compile();
+
+  std::vector<bool> done(multi_search.GetNumPatterns());
+  std::vector<std::uint8_t const*> matches;
+  hadesmem::detail::ParallelMultiPatternSearch(
+    multi_search,
+    h_beg,
+    h_end,
+    done,
+    matches,
+    [&](std::size_t /*id*/, std::uint8_t const* match)
+    {
+      return match > h_beg + chunk_size * 4;
+    },
+    chunk_size,
+    4);
+  BOOST_TEST(done[call_id]);
+  BOOST_TEST(!done[unmatched_id]);
+  BOOST_TEST_EQ(static_cast<void const*>(matches[call_id]),
+                static_cast<void const*>(h_beg + chunk_size * 5 - 1));
+
+  hadesmem::Process const process{::GetCurrentProcessId()};
+  BOOST_TEST_EQ(
+    hadesmem::Find(process, L"", L"90 90", hadesmem::PatternFlags::kNone, 0U),
+    hadesmem::Find(
+      process, L"", L"90 90", hadesmem::PatternFlags::kParallel, 0U));
+}
+
+void TestCompiledPatternFile()
+{
+  hadesmem::Process const process{::GetCurrentProcessId()};
+
+  std::wstring const pattern_file_data = LR"(
+<?xml version="1.0" encoding="utf-8"?>
+<HadesMem>
+  <FindPattern Module="ntdll.dll">
+    <Flag Name="ThrowOnUnmatch"/>
+    <Pattern Name="Two Nop" Data="90 90"/>
+    <Pattern Name="Two Nop Next" Data="90 9?" Start="Two Nop">
+      <Manipulator Name="Add" Operand1="1"/>
+      <Manipulator Name="Sub" Operand1="1"/>
+    </Pattern>
+  </FindPattern>
+  <FindPattern>
+    <Flag Name="RelativeAddress"/>
+    <Pattern Name="Nop" Data="90">
+      <Flag Name="ScanData"/>
+    </Pattern>
+  </FindPattern>
+</HadesMem>
+)";
+
+  hadesmem::FindPattern const uncompiled{process, pattern_file_data, true};
+  auto const blob =
+    hadesmem::FindPattern::CompilePatternFile(pattern_file_data, true);
+  hadesmem::FindPattern const compiled{
+    process, blob.data(), blob.size(), std::wstring{}};
+  BOOST_TEST(compiled == uncompiled);
+
+  auto const blob_path = hadesmem::detail::CombinePath(
+    hadesmem::detail::GetSelfDirPath(), L"find_pattern_compiled.bin");
+  hadesmem::detail::BufferToFile(
+    blob_path, blob.data(), static_cast<std::streamsize>(blob.size()));
+  hadesmem::FindPattern const compiled_file{process, blob_path, false};
+  BOOST_TEST(compiled_file == uncompiled);
+  ::DeleteFileW(blob_path.c_str());
+
+  BOOST_TEST_THROWS(
+    (hadesmem::FindPattern{
+      process, blob.data(), blob.size() - 1, std::wstring{}}),
+    hadesmem::Error);
+
+  std::wstring const pattern_file_data_invalid = LR"(
+<?xml version="1.0" encoding="utf-8"?>
+<HadesMem>
+  <FindPattern>
+    <Pattern Name="Foo" Data="90">
+      <Manipulator Name="Rel" Operand1="1"/>
+    </Pattern>
+  </FindPattern>
+</HadesMem>
+)";
+  BOOST_TEST_THROWS(
+    hadesmem::FindPattern::CompilePatternFile(pattern_file_data_invalid, true),
+    hadesmem::Error);
+}
+
+void TestFindRawChunked()
+{
+  hadesmem::Process const process{::GetCurrentProcessId()};
+
+  // Needle straddling the boundary between the first two chunks.
+  std::vector<std::uint8_t> buf(0x100, 0xCC);
+  buf[0x3E] = 0x8B;
+  buf[0x3F] = 0x45;
+  buf[0x41] = 0xE8;
+  buf[0xFE] = 0x8B;
+  buf[0xFF] = 0x45;
+
+  auto const needle = hadesmem::detail::ConvertData(L"8B 45 ?? E8");
+  auto const s_beg = buf.data();
+  auto const s_end = s_beg + buf.size();
+  BOOST_TEST_EQ(hadesmem::detail::FindRaw(process,
+                                          s_beg,
+                                          s_end,
+                                          std::begin(needle),
+                                          std::end(needle),
+                                          hadesmem::PatternFlags::kNone,
+                                          0x40),
+                static_cast<void*>(s_beg + 0x3E));
+  BOOST_TEST_EQ(hadesmem::detail::FindRaw(process,
+                                          s_beg + 0x3F,
+                                          s_end,
+                                          std::begin(needle),
+                                          std::end(needle),
+                                          hadesmem::PatternFlags::kNone,
+                                          0x10),
+                static_cast<void*>(nullptr));
+
+  // Same again, but with the chunks spread over multiple workers.
+  BOOST_TEST_EQ(hadesmem::detail::FindRaw(process,
+                                          s_beg,
+                                          s_end,
+                                          std::begin(needle),
+                                          std::end(needle),
+                                          hadesmem::PatternFlags::kParallel,
+                                          0x40),
+                static_cast<void*>(s_beg + 0x3E));
+  BOOST_TEST_EQ(hadesmem::detail::FindRaw(process,
+                                          s_beg + 0x3F,
+                                          s_end,
+                                          std::begin(needle),
+                                          std::end(needle),
+                                          hadesmem::PatternFlags::kParallel,
+                                          0x10),
+                static_cast<void*>(nullptr));
+}
+
+void TestFindMultiChunked()
+{
+  hadesmem::Process const process{::GetCurrentProcessId()};
+
+  // Matches straddling the boundaries between the first two chunks and the
+  // last two chunks.
+  std::vector<std::uint8_t> buf(0x100, 0xCC);
+  buf[0x3E] = 0x8B;
+  buf[0x3F] = 0x45;
+  buf[0x41] = 0xE8;
+  buf[0xBE] = 0x8B;
+  buf[0xBF] = 0x45;
+  buf[0xC1] = 0xE8;
+  buf[0xC2] = 0x90;
+
+  auto const needle = hadesmem::detail::ConvertData(L"8B 45 ?? E8");
+  auto const long_needle = hadesmem::detail::ConvertData(L"8B 45 CC E8 90");
+  auto const missing_needle = hadesmem::detail::ConvertData(L"8B 45 ?? E9");
+  hadesmem::detail::ModuleRegionInfo mod_info;
+  mod_info.code_regions.emplace_back(buf.data(), buf.data() + buf.size());
+  std::vector<hadesmem::detail::MultiFindInfo> find_infos{
+    {&needle, nullptr, hadesmem::PatternFlags::kNone, nullptr, nullptr},
+    {&needle, nullptr, hadesmem::PatternFlags::kNone, &buf[0x3E], nullptr},
+    {&long_needle, nullptr, hadesmem::PatternFlags::kNone, nullptr, nullptr},
+    {&missing_needle,
+     nullptr,
+     hadesmem::PatternFlags::kNone,
+     nullptr,
+     nullptr}};
+  hadesmem::detail::FindMulti(process, mod_info, find_infos, 0x40);
+  BOOST_TEST_EQ(find_infos[0].address, static_cast<void*>(&buf[0x3E]));
+  BOOST_TEST_EQ(find_infos[1].address, static_cast<void*>(&buf[0xBE]));
+  BOOST_TEST_EQ(find_infos[2].address, static_cast<void*>(&buf[0xBE]));
+  BOOST_TEST_EQ(find_infos[3].address, static_cast<void*>(nullptr));
+}
+
+void TestPatternGenerator()
+{
+  // 8B 45 08 E8 <rel32> repeated, with only the final copy followed by a
+  // distinct byte.
+  std::vector<std::uint8_t> buf;
+  for (std::size_t i = 0; i < 4; ++i)
+  {
+    std::uint8_t const insns[] = {0x8B, 0x45, 0x08, 0xE8, 0x11, 0x22, 0x33,
+                                  static_cast<std::uint8_t>(i), 0x90};
+    buf.insert(std::end(buf), std::begin(insns), std::end(insns));
+  }
+  buf.back() = 0xC3;
+
+  std::vector<hadesmem::detail::PatternSpan> const spans{
+    std::make_pair(buf.data(), buf.data() + buf.size())};
+  std::vector<std::uint8_t> masks(16, 0xFF);
+  std::fill(std::begin(masks) + 4, std::begin(masks) + 8, 0);
+  std::vector<hadesmem::detail::PatternDataByte> needle;
+  BOOST_TEST_EQ(hadesmem::detail::GeneratePattern(
+                  spans, buf.data() + 27, masks, needle),
+                1U);
+  BOOST_TEST(hadesmem::detail::PatternDataToString(needle) ==
+             L"8B 45 08 E8 ?? ?? ?? ?? C3");
+
+  // Only unique if the relative operand is included.
+  std::vector<std::uint8_t> const exact_masks(8, 0xFF);
+  BOOST_TEST_EQ(hadesmem::detail::GeneratePattern(
+                  spans, buf.data(), exact_masks, needle),
+                1U);
+  BOOST_TEST_EQ(needle.size(), 8U);
+  BOOST_TEST_EQ(hadesmem::detail::GeneratePattern(
+                  spans, buf.data(), masks, needle),
+                2U);
+
+  auto const call_needle = hadesmem::detail::ConvertData(L"8B 45 08 E8");
+  hadesmem::detail::PatternSearch const search{std::begin(call_needle),
+                                               std::end(call_needle)};
+  BOOST_TEST_EQ(hadesmem::detail::CountPatternMatches(search, spans, 100),
+                4U);
+  BOOST_TEST_EQ(hadesmem::detail::CountPatternMatches(search, spans, 2), 2U);
+}
+
 int main()
 {
   TestFindPattern();
+  TestMultiPatternSearch();
+  TestPatternSearch();
+  TestNibbleWildcards();
+  TestFindAll();
+  TestParallelSearch();
+  TestCompiledPatternFile();
+  TestFindRawChunked();
+  TestFindMultiChunked();
+  TestPatternCache();
+  TestPatternGenerator();
   return boost::report_errors();
 }
@@ -0,0 +1,158 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <hadesmem/memory_source.hpp>
+#include <hadesmem/memory_source.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/find_pattern.hpp>
+#include <hadesmem/pelib/nt_headers.hpp>
+#include <hadesmem/pelib/pe_file.hpp>
+#include <hadesmem/pelib/section.hpp>
+#include <hadesmem/pelib/section_list.hpp>
+#include <hadesmem/process.hpp>
+#include <hadesmem/process_helpers.hpp>
+
+void TestMemorySourceRead()
+{
+  hadesmem::Process const process(::GetCurrentProcessId());
+
+  std::array<std::uint8_t, 64> buf{};
+  for (std::size_t i = 0; i < buf.size(); ++i)
+  {
+    buf[i] = static_cast<std::uint8_t>(i + 1);
+  }
+  std::memcpy(&buf[32], "hello", 6);
+
+  hadesmem::MemorySource const remote(process);
+  BOOST_TEST(!remote.IsLocal());
+  BOOST_TEST(remote.GetPointer(buf.data(), 1) == nullptr);
+
+  hadesmem::MemorySource const local(process, buf.data(), buf.size());
+  BOOST_TEST(local.IsLocal());
+  BOOST_TEST(&local.GetProcess() == &process);
+  BOOST_TEST(local.GetPointer(buf.data(), buf.size()) == buf.data());
+  BOOST_TEST(local.GetPointer(&buf[1], buf.size()) == nullptr);
+
+  BOOST_TEST_EQ(hadesmem::Read<std::uint32_t>(local, &buf[1]),
+                hadesmem::Read<std::uint32_t>(remote, &buf[1]));
+  auto const arr = hadesmem::Read<std::uint8_t, 4>(local, &buf[60]);
+  BOOST_TEST_EQ(arr[3], 64);
+  auto const vec = hadesmem::ReadVector<std::uint8_t>(local, &buf[8], 8);
+  BOOST_TEST(vec == std::vector<std::uint8_t>(&buf[8], &buf[16]));
+  BOOST_TEST_EQ(hadesmem::ReadString<char>(local, &buf[32]), "hello");
+  BOOST_TEST_EQ(hadesmem::ReadStringBounded<char>(local, &buf[32], &buf[35]),
+                "hel");
+
+  // Reads which leave the span fall back to the process.
+  std::array<std::uint8_t, 8> other{{1, 2, 3, 4, 5, 6, 7, 8}};
+  hadesmem::MemorySource const partial(process, buf.data(), 16);
+  BOOST_TEST(hadesmem::ReadVector<std::uint8_t>(partial, &buf[12], 8) ==
+             std::vector<std::uint8_t>(&buf[12], &buf[20]));
+  BOOST_TEST_EQ(hadesmem::Read<std::uint64_t>(partial, other.data()),
+                hadesmem::Read<std::uint64_t>(process, other.data()));
+  BOOST_TEST_EQ(hadesmem::ReadString<char>(partial, &buf[32]), "hello");
+}
+
+void TestMemorySourcePeFile()
+{
+  hadesmem::Process const process(::GetCurrentProcessId());
+
+  hadesmem::MappedFile const file(hadesmem::GetPath(process));
+  BOOST_TEST(file.GetBase() != nullptr);
+  BOOST_TEST(file.GetSize() != 0);
+
+  hadesmem::MemorySource const source(
+    process, file.GetBase(), file.GetSize());
+  hadesmem::PeFile const pe_file(source,
+                                 file.GetBase(),
+                                 hadesmem::PeFileType::Data,
+                                 static_cast<DWORD>(file.GetSize()));
+  BOOST_TEST(pe_file.GetMemorySource().IsLocal());
+  hadesmem::PeFile const pe_file_remote(process,
+                                        file.GetBase(),
+                                        hadesmem::PeFileType::Data,
+                                        static_cast<DWORD>(file.GetSize()));
+  BOOST_TEST(!pe_file_remote.GetMemorySource().IsLocal());
+
+  hadesmem::NtHeaders const nt_headers(process, pe_file);
+  hadesmem::NtHeaders const nt_headers_remote(process, pe_file_remote);
+  BOOST_TEST_EQ(nt_headers.GetNumberOfSections(),
+                nt_headers_remote.GetNumberOfSections());
+  BOOST_TEST_EQ(nt_headers.GetAddressOfEntryPoint(),
+                nt_headers_remote.GetAddressOfEntryPoint());
+  BOOST_TEST_EQ(nt_headers.GetSizeOfImage(),
+                nt_headers_remote.GetSizeOfImage());
+
+  std::vector<std::string> names;
+  for (auto const& section : hadesmem::SectionList(process, pe_file))
+  {
+    names.push_back(section.GetName());
+  }
+  std::vector<std::string> names_remote;
+  for (auto const& section : hadesmem::SectionList(process, pe_file_remote))
+  {
+    names_remote.push_back(section.GetName());
+  }
+  BOOST_TEST(!names.empty());
+  BOOST_TEST(names == names_remote);
+
+  BOOST_TEST_THROWS(hadesmem::MappedFile(L"this_file_does_not_exist.exe"),
+                    hadesmem::Error);
+}
+
+void TestMemorySourceFind()
+{
+  hadesmem::Process const process(::GetCurrentProcessId());
+
+  std::vector<std::uint8_t> buf(0x10000, 0xCC);
+  buf[0x1234] = 0x12;
+  buf[0x1235] = 0x34;
+  buf[0x1236] = 0x56;
+
+  hadesmem::MemorySource const local(process, buf.data(), buf.size());
+  BOOST_TEST(hadesmem::Find(local,
+                            buf.data(),
+                            buf.size(),
+                            L"12 ?? 56",
+                            hadesmem::PatternFlags::kNone,
+                            0) == &buf[0x1234]);
+  BOOST_TEST(hadesmem::Find(local,
+                            buf.data(),
+                            buf.size(),
+                            L"12 ?? 56",
+                            hadesmem::PatternFlags::kRelativeAddress,
+                            0) == reinterpret_cast<void*>(0x1234));
+  BOOST_TEST(hadesmem::Find(local,
+                            buf.data(),
+                            buf.size(),
+                            L"12 ?? 56",
+                            hadesmem::PatternFlags::kNone,
+                            0x1234) == nullptr);
+  BOOST_TEST(hadesmem::Find(process,
+                            buf.data(),
+                            buf.size(),
+                            L"12 ?? 56",
+                            hadesmem::PatternFlags::kNone,
+                            0) == &buf[0x1234]);
+}
+
+int main()
+{
+  TestMemorySourceRead();
+  TestMemorySourcePeFile();
+  TestMemorySourceFind();
+  return boost::report_errors();
+}
@@ -0,0 +1,156 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <hadesmem/pointer_chain.hpp>
+#include <hadesmem/pointer_chain.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/cached_process_view.hpp>
+#include <hadesmem/config.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/module.hpp>
+#include <hadesmem/process.hpp>
+
+namespace
+{
+struct Inventory
+{
+  std::uint32_t padding;
+  std::uint32_t count;
+};
+
+struct Player
+{
+  std::uint64_t padding[2];
+  Inventory* inventory;
+};
+
+Player* g_player;
+}
+
+void TestPointerChain()
+{
+  hadesmem::Process const process(::GetCurrentProcessId());
+
+  Inventory inventory{};
+  Player player{};
+  player.inventory = &inventory;
+  g_player = &player;
+
+  std::vector<std::ptrdiff_t> const offsets{
+    offsetof(Player, inventory), offsetof(Inventory, count)};
+  hadesmem::PointerChain chain(process, &g_player, offsets);
+  BOOST_TEST(chain.GetBase() == &g_player);
+  BOOST_TEST(chain.GetOffsets() == offsets);
+  BOOST_TEST(chain.IsCacheEnabled());
+  BOOST_TEST(chain.Resolve() == &inventory.count);
+  BOOST_TEST(chain.Resolve() == &inventory.count);
+
+  // Only the last level changes.
+  Inventory other_inventory{};
+  player.inventory = &other_inventory;
+  BOOST_TEST(chain.Resolve() == &other_inventory.count);
+
+  // The first level changes.
+  Player other_player{};
+  other_player.inventory = &inventory;
+  g_player = &other_player;
+  BOOST_TEST(chain.Resolve() == &inventory.count);
+
+  other_player.inventory = nullptr;
+  BOOST_TEST_THROWS(chain.Resolve(), hadesmem::Error);
+  other_player.inventory = &inventory;
+
+  chain.SetCacheEnabled(false);
+  BOOST_TEST(!chain.IsCacheEnabled());
+  BOOST_TEST(chain.Resolve() == &inventory.count);
+  chain.SetCacheEnabled(true);
+  chain.Invalidate();
+  BOOST_TEST(chain.Resolve() == &inventory.count);
+
+  hadesmem::PointerChain empty_chain(process, &g_player, {});
+  BOOST_TEST(empty_chain.Resolve() == &g_player);
+
+  hadesmem::Module const module(process, nullptr);
+  auto const rva = reinterpret_cast<std::uintptr_t>(&g_player) -
+                   reinterpret_cast<std::uintptr_t>(module.GetHandle());
+  hadesmem::PointerChain module_chain(process, L"", rva, offsets);
+  BOOST_TEST(module_chain.Resolve() == &inventory.count);
+  BOOST_TEST(module_chain.GetBase() == &g_player);
+
+  hadesmem::PointerChain bad_module_chain(
+    process, L"this_module_does_not_exist.dll", rva, offsets);
+  BOOST_TEST_THROWS(bad_module_chain.Resolve(), hadesmem::Error);
+
+  hadesmem::CachedProcessView view(process);
+  BOOST_TEST(chain.Resolve(view) == &inventory.count);
+  other_player.inventory = &other_inventory;
+  view.Tick();
+  BOOST_TEST(chain.Resolve(view) == &other_inventory.count);
+}
+
+void TestResolvePointerChains()
+{
+  hadesmem::Process const process(::GetCurrentProcessId());
+
+  std::vector<Inventory> inventories(32);
+  std::vector<Player> players(inventories.size());
+  std::vector<Player*> player_ptrs(players.size());
+  std::vector<hadesmem::PointerChain> chains;
+  for (std::size_t i = 0; i < players.size(); ++i)
+  {
+    players[i].inventory = &inventories[i];
+    player_ptrs[i] = &players[i];
+    chains.emplace_back(process,
+                        &player_ptrs[i],
+                        std::vector<std::ptrdiff_t>{
+                          offsetof(Player, inventory),
+                          offsetof(Inventory, count)});
+  }
+
+  players[7].inventory = nullptr;
+  void* const reserved =
+    ::VirtualAlloc(nullptr, 0x1000, MEM_RESERVE, PAGE_READWRITE);
+  BOOST_TEST(reserved != nullptr);
+  chains.emplace_back(process, reserved, std::vector<std::ptrdiff_t>{0});
+
+  hadesmem::CachedProcessView view(process);
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    std::swap(players[3].inventory, players[4].inventory);
+    view.Tick();
+
+    auto const addresses = hadesmem::ResolvePointerChains(chains);
+    auto const view_addresses = hadesmem::ResolvePointerChains(chains, view);
+    BOOST_TEST_EQ(addresses.size(), chains.size());
+    BOOST_TEST(addresses == view_addresses);
+    for (std::size_t j = 0; j < players.size(); ++j)
+    {
+      void* const expected =
+        players[j].inventory ? &players[j].inventory->count : nullptr;
+      BOOST_TEST(addresses[j] == expected);
+    }
+
+    BOOST_TEST(addresses.back() == nullptr);
+  }
+
+  BOOST_TEST(::VirtualFree(reserved, 0, MEM_RELEASE));
+
+  std::vector<hadesmem::PointerChain> empty;
+  BOOST_TEST(hadesmem::ResolvePointerChains(empty).empty());
+}
+
+int main()
+{
+  TestPointerChain();
+  TestResolvePointerChains();
+  return boost::report_errors();
+}
@@ -5,6 +5,7 @@
 #include <hadesmem/read.hpp>
 
 #include <array>
+#include <cstdint>
 #include <cstring>
 #include <string>
 #include <vector>
@@ -18,6 +19,7 @@
 #include <hadesmem/detail/winapi.hpp>
 #include <hadesmem/error.hpp>
 #include <hadesmem/process.hpp>
+#include <hadesmem/protect.hpp>
 
 // TODO: Run tests against known data (e.g. Read tests should be done against
 // a memory mapped file with known values).
@@ -152,11 +154,85 @@ void TestReadCrossRegion()
   BOOST_TEST(buf == zero_buf);
 }
 
+void TestReadRegionCache()
+{
+  SYSTEM_INFO const sys_info = hadesmem::detail::GetSystemInfo();
+  DWORD const page_size = sys_info.dwPageSize;
+
+  hadesmem::Process process(::GetCurrentProcessId());
+  BOOST_TEST(!process.IsRegionCacheEnabled());
+  process.SetRegionCacheEnabled(true);
+  BOOST_TEST(process.IsRegionCacheEnabled());
+  hadesmem::Process const process_copy(process);
+  BOOST_TEST(process_copy.GetRegionCache() == process.GetRegionCache());
+
+  hadesmem::Allocator const alloc(process, page_size * 2);
+  auto const mem = static_cast<std::uint8_t*>(alloc.GetBase());
+  for (DWORD i = 0; i < page_size * 2; ++i)
+  {
+    mem[i] = static_cast<std::uint8_t>(i);
+  }
+
+  for (DWORD i = 0; i < page_size * 2; i += 0x100)
+  {
+    BOOST_TEST_EQ(hadesmem::Read<std::uint8_t>(process, mem + i),
+                  static_cast<std::uint8_t>(i));
+  }
+
+  MEMORY_BASIC_INFORMATION mbi{};
+  BOOST_TEST(process.GetRegionCache()->Find(mem, mbi));
+  BOOST_TEST_EQ(mbi.BaseAddress, static_cast<PVOID>(mem));
+
+  // Changes made behind the back of the cache are picked up when the stale
+  // region can't be accessed.
+  DWORD old_protect = 0;
+  BOOST_TEST(::VirtualProtect(mem, page_size, PAGE_NOACCESS, &old_protect));
+  BOOST_TEST_EQ(hadesmem::Read<std::uint8_t>(process, mem + 1), 1);
+  auto const vec = hadesmem::ReadVector<std::uint8_t>(
+    process, mem + page_size - 2, 4);
+  BOOST_TEST_EQ(vec[0], static_cast<std::uint8_t>(page_size - 2));
+  BOOST_TEST_EQ(vec[3], static_cast<std::uint8_t>(page_size + 1));
+
+  // Changes made through hadesmem are picked up immediately.
+  hadesmem::Protect(process, mem, PAGE_READONLY);
+  BOOST_TEST(!process.GetRegionCache()->Find(mem, mbi) ||
+             mbi.Protect == PAGE_READONLY);
+
+  std::string const test_string = "Region cache test string.";
+  std::copy(std::begin(test_string),
+            std::end(test_string),
+            reinterpret_cast<char*>(mem + page_size));
+  mem[page_size + test_string.size()] = '\0';
+  BOOST_TEST_EQ(hadesmem::ReadString<char>(
+                  process, reinterpret_cast<char*>(mem + page_size)),
+                test_string);
+
+  auto const generation = process.GetRegionCache()->GetGeneration();
+  process_copy.InvalidateRegionCache();
+  BOOST_TEST(process.GetRegionCache()->GetGeneration() != generation);
+  BOOST_TEST(!process.GetRegionCache()->Find(mem, mbi));
+
+  // Info queried before an invalidation is not cached.
+  process.GetRegionCache()->Insert(mem, page_size, mbi, generation);
+  BOOST_TEST(!process.GetRegionCache()->Find(mem, mbi));
+
+  // Neither are regions which have to be reprotected to be read.
+  BOOST_TEST(::VirtualProtect(mem, page_size, PAGE_NOACCESS, &old_protect));
+  BOOST_TEST_EQ(hadesmem::Read<std::uint8_t>(process, mem + 3), 3);
+  BOOST_TEST(!process.GetRegionCache()->Find(mem, mbi));
+
+  process.SetRegionCacheEnabled(false);
+  BOOST_TEST(!process.IsRegionCacheEnabled());
+  BOOST_TEST(process.GetRegionCache() == nullptr);
+  BOOST_TEST_EQ(hadesmem::Read<std::uint8_t>(process, mem + 2), 2);
+}
+
 int main()
 {
   TestReadPod();
   TestReadString();
   TestReadVector();
   TestReadCrossRegion();
+  TestReadRegionCache();
   return boost::report_errors();
 }
@@ -0,0 +1,143 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <hadesmem/read_batch.hpp>
+#include <hadesmem/read_batch.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/winapi.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/process.hpp>
+
+void TestReadBatch()
+{
+  hadesmem::Process const process(::GetCurrentProcessId());
+
+  struct Entity
+  {
+    std::uint32_t id;
+    float pos[3];
+    std::uint64_t flags;
+    char name[16];
+  };
+
+  std::vector<Entity> entities(64);
+  for (std::size_t i = 0; i < entities.size(); ++i)
+  {
+    entities[i].id = static_cast<std::uint32_t>(i * 3);
+    entities[i].pos[0] = static_cast<float>(i);
+    entities[i].pos[1] = static_cast<float>(i * 2);
+    entities[i].pos[2] = static_cast<float>(i * 4);
+    entities[i].flags = 0x1234567890ULL + i;
+    std::memset(entities[i].name, 'a' + static_cast<int>(i % 26), 15);
+    entities[i].name[15] = '\0';
+  }
+
+  hadesmem::ReadBatch batch(process);
+  std::vector<std::uint32_t> ids(entities.size());
+  std::vector<std::uint64_t> flags(entities.size());
+  // Queue them out of order, with overlaps.
+  for (std::size_t i = entities.size(); i--;)
+  {
+    BOOST_TEST_EQ(batch.Add(&entities[i].flags, flags[i]),
+                  (entities.size() - 1 - i) * 2);
+    batch.Add(&entities[i], ids[i]);
+  }
+  Entity last{};
+  batch.Add(&entities.back(), &last, sizeof(last));
+  char empty = 0;
+  batch.Add(&entities.front(), &empty, 0);
+  BOOST_TEST_EQ(batch.GetSize(), entities.size() * 2 + 2);
+
+  for (std::size_t frame = 0; frame < 3; ++frame)
+  {
+    for (auto& entity : entities)
+    {
+      entity.flags += frame;
+    }
+
+    auto const& statuses = batch.Read();
+    BOOST_TEST_EQ(statuses.size(), batch.GetSize());
+    for (auto const status : statuses)
+    {
+      BOOST_TEST(status == hadesmem::ReadBatchStatus::kSuccess);
+    }
+
+    for (std::size_t i = 0; i < entities.size(); ++i)
+    {
+      BOOST_TEST_EQ(ids[i], entities[i].id);
+      BOOST_TEST_EQ(flags[i], entities[i].flags);
+    }
+
+    BOOST_TEST_EQ(std::memcmp(&last, &entities.back(), sizeof(last)), 0);
+  }
+
+  batch.SetMaxGap(0);
+  BOOST_TEST_EQ(batch.GetMaxGap(), 0UL);
+  entities[5].id = 1234;
+  batch.Read();
+  BOOST_TEST_EQ(ids[5], 1234UL);
+
+  batch.Clear();
+  BOOST_TEST_EQ(batch.GetSize(), 0UL);
+  BOOST_TEST(batch.Read().empty());
+}
+
+void TestReadBatchFailure()
+{
+  SYSTEM_INFO const sys_info = hadesmem::detail::GetSystemInfo();
+  DWORD const page_size = sys_info.dwPageSize;
+
+  auto const address = static_cast<std::uint8_t*>(VirtualAlloc(
+    nullptr, page_size * 3, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+  BOOST_TEST(address != nullptr);
+  for (DWORD i = 0; i < page_size * 3; ++i)
+  {
+    address[i] = static_cast<std::uint8_t>(i);
+  }
+
+  DWORD old_protect = 0;
+  BOOST_TEST(::VirtualProtect(
+    address + page_size, page_size, PAGE_NOACCESS, &old_protect));
+
+  hadesmem::Process const process(::GetCurrentProcessId());
+  // Large enough for everything to be coalesced into a single read which
+  // fails because of the page in the middle.
+  hadesmem::ReadBatch batch(process, page_size * 3);
+  std::uint8_t first = 0;
+  std::uint8_t middle = 0;
+  std::uint8_t straddle[4] = {};
+  std::uint8_t last = 0;
+  batch.Add(address + 1, first);
+  batch.Add(address + page_size + 1, middle);
+  batch.Add(address + page_size - 2, straddle);
+  batch.Add(address + page_size * 2 + 3, last);
+
+  for (std::size_t i = 0; i < 2; ++i)
+  {
+    auto const& statuses = batch.Read();
+    BOOST_TEST(statuses[0] == hadesmem::ReadBatchStatus::kSuccess);
+    BOOST_TEST(statuses[1] == hadesmem::ReadBatchStatus::kFailed);
+    BOOST_TEST(statuses[2] == hadesmem::ReadBatchStatus::kFailed);
+    BOOST_TEST(statuses[3] == hadesmem::ReadBatchStatus::kSuccess);
+    BOOST_TEST_EQ(first, 1);
+    BOOST_TEST_EQ(last, 3);
+  }
+
+  BOOST_TEST(::VirtualFree(address, 0, MEM_RELEASE));
+}
+
+int main()
+{
+  TestReadBatch();
+  TestReadBatchFailure();
+  return boost::report_errors();
+}
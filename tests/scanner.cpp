@@ -0,0 +1,650 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <hadesmem/scanner.hpp>
+#include <hadesmem/scanner.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/alloc.hpp>
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/filesystem.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/module.hpp>
+#include <hadesmem/process.hpp>
+
+namespace
+{
+// Static base for the pointer scanner test.
+void* volatile g_pointer_root = nullptr;
+
+bool Contains(std::vector<void*> const& results, void* address)
+{
+  return std::find(std::begin(results), std::end(results), address) !=
+         std::end(results);
+}
+
+// Private, zeroed and non-executable, so the default scanners pick it up.
+hadesmem::Allocator AllocateScanMemory(hadesmem::Process const& process,
+                                       std::size_t size)
+{
+  hadesmem::Allocator allocator{process, size};
+  DWORD old_protect = 0;
+  BOOST_TEST(!!::VirtualProtect(
+    allocator.GetBase(), allocator.GetSize(), PAGE_READWRITE, &old_protect));
+  std::memset(allocator.GetBase(), 0, allocator.GetSize());
+  return allocator;
+}
+}
+
+void TestScanner()
+{
+  hadesmem::Process const process{::GetCurrentProcessId()};
+
+  // Two pages long, so values can straddle chunks when the buffer is one
+  // page.
+  hadesmem::Allocator const allocator = AllocateScanMemory(process, 0x2000);
+  auto const base = static_cast<std::uint8_t*>(allocator.GetBase());
+
+  std::uint32_t const u32 = 0xDEADBEEF ^ ::GetCurrentProcessId();
+  std::memcpy(base + 0x10, &u32, sizeof(u32));
+  std::memcpy(base + 0x123, &u32, sizeof(u32));
+  std::memcpy(base + 0xFFE, &u32, sizeof(u32));
+  std::uint64_t const u64 = 0x0123456789ABCDEFULL ^ u32;
+  std::memcpy(base + 0x200, &u64, sizeof(u64));
+  float const f = 1234.5f + static_cast<float>(u32 & 0xFF);
+  std::memcpy(base + 0x300, &f, sizeof(f));
+  double const d = -1.0 / static_cast<double>(u32);
+  std::memcpy(base + 0x400, &d, sizeof(d));
+
+  hadesmem::Scanner const scanner{process};
+  auto const regions = scanner.GetRegions();
+  BOOST_TEST(std::find_if(std::begin(regions),
+                          std::end(regions),
+                          [&](hadesmem::ScanRegion const& r)
+                          {
+                            return r.base == base;
+                          }) != std::end(regions));
+
+  auto const aligned = scanner.Find(u32);
+  BOOST_TEST(std::is_sorted(std::begin(aligned), std::end(aligned)));
+  BOOST_TEST(Contains(aligned, base + 0x10));
+  BOOST_TEST(!Contains(aligned, base + 0x123));
+  BOOST_TEST(!Contains(aligned, base + 0xFFE));
+
+  hadesmem::Scanner const unaligned_scanner{process,
+                                            hadesmem::ScanProtectFlags::kRead,
+                                            hadesmem::ScanTypeFlags::kPrivate,
+                                            0x1000,
+                                            4};
+  auto const unaligned = unaligned_scanner.Find(u32, 1);
+  BOOST_TEST(Contains(unaligned, base + 0x10));
+  BOOST_TEST(Contains(unaligned, base + 0x123));
+  BOOST_TEST(Contains(unaligned, base + 0xFFE));
+
+  BOOST_TEST(Contains(scanner.Find(u64), base + 0x200));
+  BOOST_TEST(Contains(scanner.Find(f), base + 0x300));
+  BOOST_TEST(Contains(scanner.Find(d), base + 0x400));
+
+  hadesmem::Scanner const exec_scanner{
+    process,
+    hadesmem::ScanProtectFlags::kRead | hadesmem::ScanProtectFlags::kExecute};
+  BOOST_TEST(!Contains(exec_scanner.Find(u32), base + 0x10));
+
+  hadesmem::Scanner const image_scanner{process,
+                                        hadesmem::ScanProtectFlags::kRead,
+                                        hadesmem::ScanTypeFlags::kImage};
+  BOOST_TEST(!Contains(image_scanner.Find(u32), base + 0x10));
+}
+
+void TestScanPageStore()
+{
+  std::vector<std::uint8_t> page(hadesmem::detail::kScanPageSize);
+  for (std::size_t i = 0; i < page.size(); ++i)
+  {
+    page[i] = static_cast<std::uint8_t>(i % 7 ? 0 : i / 7);
+  }
+
+  std::vector<std::uint8_t> compressed(page.size());
+  std::size_t const compressed_size = hadesmem::detail::CompressScanPage(
+    page.data(), page.size(), compressed.data(), compressed.size());
+  BOOST_TEST(compressed_size != 0 && compressed_size < page.size());
+  std::vector<std::uint8_t> decompressed(page.size());
+  BOOST_TEST(hadesmem::detail::DecompressScanPage(compressed.data(),
+                                                  compressed_size,
+                                                  decompressed.data(),
+                                                  decompressed.size()));
+  BOOST_TEST(decompressed == page);
+  BOOST_TEST(!hadesmem::detail::DecompressScanPage(compressed.data(),
+                                                   compressed_size - 1,
+                                                   decompressed.data(),
+                                                   decompressed.size()));
+
+  hadesmem::detail::ScanPageStore store;
+  std::vector<std::uint8_t> scratch(page.size());
+  std::vector<std::uint8_t> const zero(page.size());
+  auto const id = store.Add(
+    hadesmem::detail::PackScanPage(page.data(), true, scratch.data()));
+  BOOST_TEST_EQ(store.Add(hadesmem::detail::PackScanPage(
+                  page.data(), true, scratch.data())),
+                id);
+  BOOST_TEST_EQ(store.Add(hadesmem::detail::PackScanPage(
+                  zero.data(), true, scratch.data())),
+                hadesmem::detail::kScanPageZero);
+  BOOST_TEST_EQ(store.GetNumPages(), 3UL);
+  BOOST_TEST_EQ(store.GetNumZeroPages(), 1UL);
+  BOOST_TEST_EQ(store.GetNumDuplicatePages(), 1UL);
+  BOOST_TEST_EQ(store.GetStoredSize(), compressed_size);
+  BOOST_TEST(store.Get(id, decompressed.data()));
+  BOOST_TEST(decompressed == page);
+}
+
+void TestScannerSnapshot()
+{
+  hadesmem::Process const process{::GetCurrentProcessId()};
+
+  hadesmem::Allocator const allocator = AllocateScanMemory(process, 0x3000);
+  auto const base = static_cast<std::uint8_t*>(allocator.GetBase());
+
+  // Only scan private memory to keep the snapshot small.
+  hadesmem::Scanner const scanner{process,
+                                  hadesmem::ScanProtectFlags::kWrite,
+                                  hadesmem::ScanTypeFlags::kPrivate};
+  auto const snapshot = scanner.TakeSnapshot();
+  BOOST_TEST(snapshot.GetNumZeroPages() >= 3);
+  std::vector<std::uint8_t> snapshot_data(0x3000, 0xCC);
+  BOOST_TEST(snapshot.Read(base, snapshot_data.data(), snapshot_data.size()));
+  BOOST_TEST(std::all_of(std::begin(snapshot_data),
+                         std::end(snapshot_data),
+                         [](std::uint8_t b)
+                         {
+                           return b == 0;
+                         }));
+
+  std::uint32_t const increased = 1234;
+  std::memcpy(base + 0x10, &increased, sizeof(increased));
+  std::int32_t const decreased = -1;
+  std::memcpy(base + 0x1000, &decreased, sizeof(decreased));
+  // Straddles two pages, so it's only found by unaligned scans.
+  std::uint32_t const unaligned = 0xFFFFFFFF;
+  std::memcpy(base + 0x1FFE, &unaligned, sizeof(unaligned));
+
+  auto const increased_u32 =
+    scanner.Compare<std::uint32_t>(snapshot, hadesmem::ScanCompare::kIncreased);
+  BOOST_TEST(Contains(increased_u32, base + 0x10));
+  BOOST_TEST(Contains(increased_u32, base + 0x1000));
+  BOOST_TEST(!Contains(increased_u32, base + 0x1FFE));
+
+  auto const decreased_i32 =
+    scanner.Compare<std::int32_t>(snapshot, hadesmem::ScanCompare::kDecreased);
+  BOOST_TEST(Contains(decreased_i32, base + 0x1000));
+  BOOST_TEST(!Contains(decreased_i32, base + 0x10));
+
+  auto const changed = scanner.Compare<std::uint32_t>(
+    snapshot, hadesmem::ScanCompare::kChanged, 1);
+  BOOST_TEST(std::is_sorted(std::begin(changed), std::end(changed)));
+  BOOST_TEST(Contains(changed, base + 0x1FFE));
+
+  auto const unchanged = scanner.Compare<std::uint32_t>(
+    snapshot, hadesmem::ScanCompare::kUnchanged);
+  BOOST_TEST(Contains(unchanged, base + 0x20));
+  BOOST_TEST(!Contains(unchanged, base + 0x10));
+}
+
+void TestScannerResults()
+{
+  hadesmem::Process const process{::GetCurrentProcessId()};
+
+  hadesmem::Allocator const allocator = AllocateScanMemory(process, 0x3000);
+  auto const base = static_cast<std::uint8_t*>(allocator.GetBase());
+
+  std::uint32_t const u32 = 0xCAFEBABE ^ ::GetCurrentProcessId();
+  std::size_t const offsets[] = {0x0, 0x40, 0xFFC, 0x2000, 0x2FFC};
+  for (auto const offset : offsets)
+  {
+    std::memcpy(base + offset, &u32, sizeof(u32));
+  }
+
+  hadesmem::Scanner const scanner{process,
+                                  hadesmem::ScanProtectFlags::kWrite,
+                                  hadesmem::ScanTypeFlags::kPrivate};
+  auto results = scanner.Scan(u32);
+  BOOST_TEST_EQ(results.GetValueSize(), sizeof(u32));
+  BOOST_TEST_EQ(results.GetAlignment(), sizeof(u32));
+  auto addresses = results.GetAddresses();
+  BOOST_TEST(std::is_sorted(std::begin(addresses), std::end(addresses)));
+  BOOST_TEST(addresses == scanner.Find(u32));
+  for (auto const offset : offsets)
+  {
+    BOOST_TEST(Contains(addresses, base + offset));
+  }
+
+  base[0x40] = 0;
+  base[0x2000] = 0;
+  scanner.Refine(results, u32);
+  addresses = results.GetAddresses();
+  BOOST_TEST(Contains(addresses, base));
+  BOOST_TEST(!Contains(addresses, base + 0x40));
+  BOOST_TEST(Contains(addresses, base + 0xFFC));
+  BOOST_TEST(!Contains(addresses, base + 0x2000));
+  BOOST_TEST(Contains(addresses, base + 0x2FFC));
+  BOOST_TEST_EQ(results.GetCount(), addresses.size());
+
+  BOOST_TEST_THROWS(scanner.Refine(results, std::uint64_t{}), hadesmem::Error);
+
+  auto const snapshot = scanner.TakeSnapshot();
+  auto changed = scanner.Scan<std::uint32_t>(
+    snapshot, hadesmem::ScanCompare::kUnchanged);
+  BOOST_TEST(changed.GetCount() >= 0x3000 / sizeof(u32));
+  std::uint32_t const increased = 1;
+  std::memcpy(base + 0x1000, &increased, sizeof(increased));
+  scanner.Refine<std::uint32_t>(
+    changed, snapshot, hadesmem::ScanCompare::kIncreased);
+  BOOST_TEST(Contains(changed.GetAddresses(), base + 0x1000));
+  BOOST_TEST(!Contains(changed.GetAddresses(), base + 0x1004));
+}
+
+void TestPointerScanner()
+{
+  hadesmem::Process const process{::GetCurrentProcessId()};
+
+  hadesmem::Allocator const allocator = AllocateScanMemory(process, 0x2000);
+  auto const base = static_cast<std::uint8_t*>(allocator.GetBase());
+
+  // [[g_pointer_root] + 0x10] + 0x8
+  g_pointer_root = base + 0x100;
+  void* const child = base + 0x1000;
+  std::memcpy(base + 0x110, &child, sizeof(child));
+  void* const target = base + 0x1008;
+
+  hadesmem::Scanner const scanner{process};
+  auto const map = scanner.BuildPointerMap();
+  BOOST_TEST(map.GetSize() != 0);
+
+  hadesmem::Module const self{process, nullptr};
+  hadesmem::PointerPath const expected{
+    self.GetName(),
+    reinterpret_cast<std::uintptr_t>(&g_pointer_root) -
+      reinterpret_cast<std::uintptr_t>(self.GetHandle()),
+    {0x10, 0x8}};
+  auto const paths = map.FindPaths(target, 3, 0x100);
+  BOOST_TEST(std::find(std::begin(paths), std::end(paths), expected) !=
+             std::end(paths));
+  for (auto const& path : paths)
+  {
+    BOOST_TEST(!path.offsets.empty() && path.offsets.size() <= 3);
+  }
+
+  auto const few_paths = map.FindPaths(target, 3, 0x100, 1);
+  BOOST_TEST(few_paths.size() == 1);
+
+  std::wstring const map_path = L"scanner_test.hmpm";
+  map.Save(map_path);
+  hadesmem::PointerMap const loaded{map_path};
+  ::DeleteFileW(map_path.c_str());
+  BOOST_TEST_EQ(loaded.GetSize(), map.GetSize());
+  auto const loaded_paths = loaded.FindPaths(target, 3, 0x100);
+  BOOST_TEST(loaded_paths == paths);
+  BOOST_TEST(hadesmem::IntersectPointerPaths(paths, loaded_paths).size() ==
+             paths.size());
+  BOOST_TEST(hadesmem::IntersectPointerPaths(paths, {}).empty());
+
+  BOOST_TEST_THROWS(hadesmem::PointerMap{L"does_not_exist.hmpm"},
+                    hadesmem::Error);
+
+  // Version 1, 64-bit, one module and no entries, but a module name length
+  // which can't possibly fit in the file.
+  std::uint8_t const bad_map[] = {
+    'H', 'M', 'P', 'M', 1, 0, 0, 0, 8, 0, 0,    0,    1,    0,
+    0,   0,   0,   0,   0, 0, 0, 0, 0, 0, 0xFF, 0xFF, 0xFF, 0xFF};
+  std::wstring const bad_map_path = L"scanner_test_bad.hmpm";
+  hadesmem::detail::BufferToFile(
+    bad_map_path, bad_map, static_cast<std::streamsize>(sizeof(bad_map)));
+  BOOST_TEST_THROWS(hadesmem::PointerMap{bad_map_path}, hadesmem::Error);
+  ::DeleteFileW(bad_map_path.c_str());
+}
+
+void TestScannerHistory()
+{
+  hadesmem::Process const process{::GetCurrentProcessId()};
+
+  hadesmem::Allocator const allocator = AllocateScanMemory(process, 0x2000);
+  auto const base = static_cast<std::uint32_t*>(allocator.GetBase());
+  std::uint32_t const u32 = 0xFEEDFACE ^ ::GetCurrentProcessId();
+  std::fill(base, base + 0x2000 / sizeof(u32), u32);
+
+  hadesmem::Scanner const scanner{process,
+                                  hadesmem::ScanProtectFlags::kWrite,
+                                  hadesmem::ScanTypeFlags::kPrivate};
+
+  // No memory for deltas, so everything but the newest is written to disk.
+  hadesmem::ScanHistory history{scanner.Scan(u32), 0};
+  BOOST_TEST(!history.CanUndo());
+  std::vector<std::vector<void*>> generations{
+    history.GetResults().GetAddresses()};
+  BOOST_TEST(Contains(generations.back(), base));
+  for (std::size_t i = 0; i < 4; ++i)
+  {
+    base[i * 0x100] = 0;
+    auto results = history.GetResults();
+    scanner.Refine(results, u32);
+    history.Push(std::move(results));
+    generations.push_back(history.GetResults().GetAddresses());
+    BOOST_TEST(!Contains(generations.back(), base + i * 0x100));
+  }
+
+  BOOST_TEST_EQ(history.GetUndoCount(), 4UL);
+  BOOST_TEST(history.GetFileSize() != 0);
+
+  while (history.CanUndo())
+  {
+    history.Undo();
+    generations.pop_back();
+    BOOST_TEST(history.GetResults().GetAddresses() == generations.back());
+  }
+
+  BOOST_TEST_EQ(history.GetFileSize(), 0ULL);
+  BOOST_TEST_THROWS(history.Undo(), hadesmem::Error);
+  BOOST_TEST_THROWS(history.Push(scanner.Scan(std::uint64_t{})),
+                    hadesmem::Error);
+}
+
+void TestScannerGroup()
+{
+  hadesmem::Process const process{::GetCurrentProcessId()};
+
+  hadesmem::Allocator const allocator = AllocateScanMemory(process, 0x2000);
+  auto const base = static_cast<std::uint8_t*>(allocator.GetBase());
+
+  std::uint32_t const u32 = 0xC0FFEE00 ^ ::GetCurrentProcessId();
+  float const f = 1.5f;
+  std::size_t const offsets[] = {0x10, 0xFFC, 0x1FF4};
+  for (auto const offset : offsets)
+  {
+    std::memcpy(base + offset, &u32, sizeof(u32));
+    std::memcpy(base + offset + 8, &f, sizeof(f));
+  }
+
+  // Only one of the two members matches.
+  std::memcpy(base + 0x800, &u32, sizeof(u32));
+  std::memcpy(base + 0x900 + 8, &f, sizeof(f));
+
+  hadesmem::Scanner const scanner{process,
+                                  hadesmem::ScanProtectFlags::kWrite,
+                                  hadesmem::ScanTypeFlags::kPrivate};
+  hadesmem::ScanGroup group;
+  group.Add(0, u32).Add(8, f);
+  BOOST_TEST_EQ(group.GetSize(), 12UL);
+  auto const addresses = scanner.FindGroup(group);
+  for (auto const offset : offsets)
+  {
+    BOOST_TEST(Contains(addresses, base + offset));
+  }
+
+  BOOST_TEST(!Contains(addresses, base + 0x800));
+  BOOST_TEST(!Contains(addresses, base + 0x900));
+
+  hadesmem::ScanGroup const parsed{"{u32 " + std::to_string(u32) +
+                                   ", ?, float 1.5 @+8}"};
+  auto const parsed_addresses = scanner.FindGroup(parsed);
+  for (auto const offset : offsets)
+  {
+    BOOST_TEST(Contains(parsed_addresses, base + offset));
+  }
+
+  BOOST_TEST_THROWS(hadesmem::ScanGroup{"{u32 1, ?"}, hadesmem::Error);
+  BOOST_TEST_THROWS(scanner.FindGroup(hadesmem::ScanGroup{}),
+                    hadesmem::Error);
+}
+
+void TestScannerString()
+{
+  hadesmem::Process const process{::GetCurrentProcessId()};
+
+  hadesmem::Allocator const allocator = AllocateScanMemory(process, 0x2000);
+  auto const base = static_cast<std::uint8_t*>(allocator.GetBase());
+
+  char const ascii[] = "hAdEsMeM_ScAnNeR";
+  wchar_t const wide[] = L"hAdEsMeM_ScAnNeR";
+  char const regex[] = "hp=1234;";
+  std::memcpy(base + 0x10, ascii, sizeof(ascii) - 1);
+  std::memcpy(base + 0xFF8, wide, sizeof(wide) - sizeof(wchar_t));
+  std::memcpy(base + 0x1800, regex, sizeof(regex) - 1);
+
+  hadesmem::Scanner const scanner{process,
+                                  hadesmem::ScanProtectFlags::kWrite,
+                                  hadesmem::ScanTypeFlags::kPrivate};
+  BOOST_TEST(Contains(scanner.FindString(std::string{ascii}), base + 0x10));
+  BOOST_TEST(!Contains(scanner.FindString("HADESMEM_SCANNER"), base + 0x10));
+  BOOST_TEST(Contains(
+    scanner.FindString("HADESMEM_SCANNER",
+                       hadesmem::ScanStringFlags::kCaseInsensitive),
+    base + 0x10));
+  BOOST_TEST(Contains(
+    scanner.FindString(L"hadesmem?scanner",
+                       hadesmem::ScanStringFlags::kCaseInsensitive |
+                         hadesmem::ScanStringFlags::kWildcard),
+    base + 0xFF8));
+
+  auto const matches = scanner.FindStrings(
+    std::vector<std::string>{"HADESMEM", "SCANNER", "hp="},
+    hadesmem::ScanStringFlags::kCaseInsensitive);
+  auto const has_match =
+    [](std::vector<hadesmem::ScanStringMatch> const& cur_matches,
+       std::uint8_t* address,
+       std::size_t index)
+  {
+    return std::find_if(std::begin(cur_matches),
+                        std::end(cur_matches),
+                        [&](hadesmem::ScanStringMatch const& match)
+                        {
+                          return match.address == address &&
+                                 match.index == index;
+                        }) != std::end(cur_matches);
+  };
+  BOOST_TEST(has_match(matches, base + 0x10, 0));
+  BOOST_TEST(has_match(matches, base + 0x19, 1));
+  BOOST_TEST(has_match(matches, base + 0x1800, 2));
+
+  auto const wide_matches = scanner.FindStrings(
+    std::vector<std::wstring>{L"HADESMEM", L"scanner", L"hp="},
+    hadesmem::ScanStringFlags::kCaseInsensitive);
+  BOOST_TEST(has_match(wide_matches, base + 0xFF8, 0));
+  BOOST_TEST(has_match(wide_matches, base + 0xFF8 + 9 * sizeof(wchar_t), 1));
+  BOOST_TEST(!has_match(wide_matches, base + 0x1800, 2));
+
+  auto const regex_matches =
+    scanner.FindRegex(std::string{"[a-z]p=[0-9]+;"});
+  BOOST_TEST(std::find_if(std::begin(regex_matches),
+                          std::end(regex_matches),
+                          [&](hadesmem::ScanStringMatch const& match)
+                          {
+                            return match.address == base + 0x1800 &&
+                                   match.length == sizeof(regex) - 1;
+                          }) != std::end(regex_matches));
+
+  BOOST_TEST_THROWS(scanner.FindString(""), hadesmem::Error);
+  BOOST_TEST_THROWS(scanner.FindRegex(std::string{"a|b"}), hadesmem::Error);
+}
+
+void TestScannerFloat()
+{
+  hadesmem::Process const process{::GetCurrentProcessId()};
+
+  hadesmem::Allocator const allocator = AllocateScanMemory(process, 0x2000);
+  auto const base = static_cast<std::uint8_t*>(allocator.GetBase());
+
+  float const values[] = {12.3f, 12.34f, 12.3f + 0.0001f};
+  std::size_t const offsets[] = {0x10, 0xFFC, 0x1000};
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    std::memcpy(base + offsets[i], &values[i], sizeof(values[i]));
+  }
+
+  double const d = 100.0001;
+  std::memcpy(base + 0x1800, &d, sizeof(d));
+
+  // Halves round away from zero, so these are on either side of the bounds
+  // for -12.3 and -12.
+  float const negatives[] = {-12.25f, -12.35f, -11.5f, -12.5f};
+  std::memcpy(base + 0x1900, negatives, sizeof(negatives));
+
+  hadesmem::Scanner const scanner{process,
+                                  hadesmem::ScanProtectFlags::kWrite,
+                                  hadesmem::ScanTypeFlags::kPrivate};
+  auto const rounded =
+    scanner.FindFloat(12.3f, hadesmem::ScanFloatMode::kRounded, 1);
+  for (auto const offset : offsets)
+  {
+    BOOST_TEST(Contains(rounded, base + offset));
+  }
+
+  auto const ulp = scanner.FindFloat(12.3f, hadesmem::ScanFloatMode::kUlp, 0);
+  BOOST_TEST(Contains(ulp, base + 0x10));
+  BOOST_TEST(!Contains(ulp, base + 0xFFC));
+  BOOST_TEST(!Contains(ulp, base + 0x1000));
+
+  auto const absolute =
+    scanner.FindFloat(12.3f, hadesmem::ScanFloatMode::kAbsolute, 0.001);
+  BOOST_TEST(Contains(absolute, base + 0x10));
+  BOOST_TEST(!Contains(absolute, base + 0xFFC));
+  BOOST_TEST(Contains(absolute, base + 0x1000));
+
+  BOOST_TEST(Contains(
+    scanner.FindFloat(100.0, hadesmem::ScanFloatMode::kRelative, 1e-5),
+    base + 0x1800));
+  BOOST_TEST(!Contains(
+    scanner.FindFloat(100.0, hadesmem::ScanFloatMode::kTruncated, 4),
+    base + 0x1800));
+  BOOST_TEST(Contains(scanner.FindRange(100.0, 101.0), base + 0x1800));
+
+  auto const negative =
+    scanner.FindFloat(-12.3f, hadesmem::ScanFloatMode::kRounded, 1);
+  BOOST_TEST(Contains(negative, base + 0x1900));
+  BOOST_TEST(!Contains(negative, base + 0x1904));
+  auto const negative_whole =
+    scanner.FindFloat(-12.0f, hadesmem::ScanFloatMode::kRounded, 0);
+  BOOST_TEST(Contains(negative_whole, base + 0x1908));
+  BOOST_TEST(!Contains(negative_whole, base + 0x190C));
+
+  auto results =
+    scanner.ScanFloat(12.3f, hadesmem::ScanFloatMode::kTruncated, 1);
+  BOOST_TEST(Contains(results.GetAddresses(), base + 0xFFC));
+  float const moved = 13.0f;
+  std::memcpy(base + 0xFFC, &moved, sizeof(moved));
+  scanner.RefineFloat(results, 12.3f, hadesmem::ScanFloatMode::kTruncated, 1);
+  BOOST_TEST(Contains(results.GetAddresses(), base + 0x10));
+  BOOST_TEST(!Contains(results.GetAddresses(), base + 0xFFC));
+
+  BOOST_TEST_THROWS(
+    scanner.FindFloat(12.3f, hadesmem::ScanFloatMode::kRounded, 1.5),
+    hadesmem::Error);
+  BOOST_TEST_THROWS(
+    scanner.FindFloat(12.3f, hadesmem::ScanFloatMode::kAbsolute, -1),
+    hadesmem::Error);
+}
+
+void TestScannerPredicate()
+{
+  hadesmem::Process const process{::GetCurrentProcessId()};
+
+  hadesmem::Allocator const allocator = AllocateScanMemory(process, 0x2000);
+  auto const base = static_cast<std::uint8_t*>(allocator.GetBase());
+
+  std::uint32_t const flags = 0xABCD0000 | (::GetCurrentProcessId() & 0xFF);
+  std::memcpy(base + 0x10, &flags, sizeof(flags));
+  std::memcpy(base + 0x1FFC, &flags, sizeof(flags));
+
+  hadesmem::Scanner const scanner{process,
+                                  hadesmem::ScanProtectFlags::kWrite,
+                                  hadesmem::ScanTypeFlags::kPrivate};
+  auto const masked = scanner.FindIf<std::uint32_t>(
+    hadesmem::ScanBitmask<std::uint32_t>{0xFFFF0000, 0xABCD0000});
+  BOOST_TEST(Contains(masked, base + 0x10));
+  BOOST_TEST(Contains(masked, base + 0x1FFC));
+
+  auto const custom = scanner.FindIf<std::uint32_t>(
+    [&](std::uint32_t value)
+    {
+      return value == flags;
+    });
+  BOOST_TEST(Contains(custom, base + 0x10));
+  BOOST_TEST(Contains(custom, base + 0x1FFC));
+  BOOST_TEST(custom == scanner.Find(flags));
+
+  auto const snapshot = scanner.TakeSnapshot();
+  std::uint32_t const incremented = flags + 1;
+  std::memcpy(base + 0x10, &incremented, sizeof(incremented));
+  auto const incremented_addresses = scanner.CompareIf<std::uint32_t>(
+    snapshot,
+    [](std::uint32_t old_value, std::uint32_t cur_value)
+    {
+      return cur_value == old_value + 1;
+    });
+  BOOST_TEST(Contains(incremented_addresses, base + 0x10));
+  BOOST_TEST(!Contains(incremented_addresses, base + 0x1FFC));
+
+  auto results = scanner.ScanIf<std::uint32_t>(
+    hadesmem::ScanInRange<std::uint32_t>{flags, incremented});
+  BOOST_TEST(Contains(results.GetAddresses(), base + 0x10));
+  BOOST_TEST(Contains(results.GetAddresses(), base + 0x1FFC));
+  scanner.RefineIf<std::uint32_t>(results, snapshot, hadesmem::ScanChanged{});
+  BOOST_TEST(Contains(results.GetAddresses(), base + 0x10));
+  BOOST_TEST(!Contains(results.GetAddresses(), base + 0x1FFC));
+}
+
+void TestScannerSuspended()
+{
+  hadesmem::Process const process{::GetCurrentProcessId()};
+
+  hadesmem::Allocator const allocator = AllocateScanMemory(process, 0x2000);
+  auto const base = static_cast<std::uint8_t*>(allocator.GetBase());
+
+  std::uint32_t const value = 0x5C0FFEE5 ^ ::GetCurrentProcessId();
+  std::memcpy(base + 0x10, &value, sizeof(value));
+  std::memcpy(base + 0xFFE, &value, sizeof(value));
+
+  hadesmem::Scanner const scanner{process,
+                                  hadesmem::ScanProtectFlags::kWrite,
+                                  hadesmem::ScanTypeFlags::kPrivate,
+                                  0x10000,
+                                  0,
+                                  hadesmem::ScanModeFlags::kSuspend};
+  auto const addresses = scanner.Find(value, 2);
+  BOOST_TEST(Contains(addresses, base + 0x10));
+  BOOST_TEST(Contains(addresses, base + 0xFFE));
+
+  auto results = scanner.Scan(value, 2);
+  BOOST_TEST(Contains(results.GetAddresses(), base + 0x10));
+  BOOST_TEST(Contains(results.GetAddresses(), base + 0xFFE));
+  std::memset(base + 0x10, 0, sizeof(value));
+  scanner.Refine(results, value);
+  BOOST_TEST(!Contains(results.GetAddresses(), base + 0x10));
+  BOOST_TEST(Contains(results.GetAddresses(), base + 0xFFE));
+}
+
+int main()
+{
+  TestScanner();
+  TestScanPageStore();
+  TestScannerSnapshot();
+  TestScannerResults();
+  TestPointerScanner();
+  TestScannerHistory();
+  TestScannerGroup();
+  TestScannerString();
+  TestScannerFloat();
+  TestScannerPredicate();
+  TestScannerSuspended();
+  return boost::report_errors();
+}